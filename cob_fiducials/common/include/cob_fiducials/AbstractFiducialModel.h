@@ -39,6 +39,7 @@ public:
 	//*******************************************************************************
 	// AbstractFiducial interface implementation
 	//*******************************************************************************
+	AbstractFiducialModel();
 	virtual ~AbstractFiducialModel(){};
 
 	unsigned long Init(cv::Mat& camera_matrix, std::string directory_and_filename, 
@@ -49,14 +50,41 @@ public:
 	unsigned long ApplyExtrinsics(cv::Mat& rot_CfromO, cv::Mat& trans_CfromO);
 
 	/// Locates the fiducial within the image and inferes the camera pose from it
-	/// @param image scene image
+	/// @param image scene image (8 bit gray or BGR), it is not modified and may share its data with the caller
 	/// @param vec_pose Vector of poses from all detected tags relative to the camera
 	/// @return <code>RET_FAILED</code> if no tag could be detected
 	/// <code>RET_OK</code> on success
 	virtual unsigned long GetPose(cv::Mat& image, std::vector<t_pose>& vec_pose_CfromO) = 0;
 
+	/// Locates the fiducials like <code>GetPose()</code>, but remembers the tags of the previous frames.
+	/// In tracking mode, the image region of each tracked tag is predicted from its last poses and the detector
+	/// only runs on these padded regions. The full image is scanned if tracking is disabled, no tag is tracked,
+	/// a tracked tag is lost or the full scan interval has elapsed.
+	/// @param image scene image
+	/// @param vec_pose_CfromO Vector of poses from all detected tags relative to the camera
+	/// @return <code>RET_FAILED</code> if no tag could be detected
+	/// <code>RET_OK</code> on success
+	unsigned long GetPoseTracked(cv::Mat& image, std::vector<t_pose>& vec_pose_CfromO);
+
+	/// Configures the tracking mode of <code>GetPoseTracked()</code>
+	/// @param enable If false, every call of <code>GetPoseTracked()</code> scans the full image
+	/// @param full_scan_interval Number of frames after which the full image is scanned again to pick up new tags
+	/// @param roi_padding Padding added to each side of a predicted tag region, relative to the larger side of the region
+	/// @return <code>RET_FAILED</code> on invalid parameters
+	/// <code>RET_OK</code> on success
+	unsigned long SetTrackingParameters(bool enable, int full_scan_interval, double roi_padding);
+
+	/// Forgets all tracked tags, the next call of <code>GetPoseTracked()</code> scans the full image
+	void ResetTracking();
+
+	/// Sets the tile size of the thresholding and contour extraction, the tiles are processed in parallel
+	/// @param tile_size Side length of a tile in pixels, 0 processes the full image at once
+	/// @return <code>RET_FAILED</code> if the tile size is negative
+	/// <code>RET_OK</code> on success
+	unsigned long SetTileSize(int tile_size);
+
 	/// Computes a measure of image sharpness by analyzing the marker region and the inserted Siemens star
-	/// @param image Scene image
+	/// @param image Scene image (8 bit gray or BGR)
 	/// @param pose_CfromO Pose of the detected tag relative to the camera
 	/// @param fiducial_parameters Container for several parameters of the utilized marker. Mainly the offsets are relevant to the function.
 	/// @param sharpness_measure Degree of image sharpness (in [0...1] = [blurry...sharp]) computed by the function.
@@ -87,6 +115,10 @@ public:
 	// @return general fiducial parameters
 	AbstractFiducialParameters GetGeneralFiducialParameters(int marker_id);
 
+	// Gets the ids of all markers with general fiducial parameters
+	// @return marker ids in ascending order
+	std::vector<int> GetMarkerIds();
+
 	/// Load fiducial-centric coordinates of markers from file
 	/// @param directory_and_filename Path to XML filename, where the parameters of all fiducials are stores.
 	/// When using ROS, this function is replaced by parsing a launch file
@@ -101,8 +133,66 @@ private:
 	cv::Mat m_dist_coeffs; ///< Intrinsics of camera for PnP estimation
 	cv::Mat m_extrinsic_XYfromC; ///< Extrinsics 4x4 of camera to rotate and translate determined transformation before returning it
 
+	/// State of a tag in tracking mode, without extrinsics applied
+	struct t_tag_track
+	{
+		cv::Mat rot_CfromO; ///< 3x3 rotation of the last detection
+		cv::Mat trans_CfromO; ///< 3x1 translation of the last detection
+		cv::Mat prev_trans_CfromO; ///< 3x1 translation of the detection before, empty if the tag was detected only once
+	};
+
+	/// Predicts the image region of a tracked tag in the next frame (constant velocity model)
+	/// @return False if the region can not be predicted or lies outside the image
+	bool PredictTagRegion(int marker_id, const t_tag_track& track, const cv::Size& image_size, cv::Rect& roi);
+
+	/// Replaces the tracked tags by the given detections
+	void UpdateTracks(const std::vector<t_pose>& vec_pose_XYfromO);
+
+	bool m_tracking_enabled; ///< If true, GetPoseTracked searches the predicted regions of the tracked tags only
+	int m_tracking_full_scan_interval; ///< Number of frames after which the full image is scanned again in tracking mode
+	double m_tracking_roi_padding; ///< Padding of the predicted regions relative to their size
+	int m_frames_since_full_scan; ///< Number of frames processed in tracking mode since the last full scan
+	std::map<int, t_tag_track> m_tracks; ///< map of marker id to the tracking state of the tag
+
+	cv::Mat m_sharpness_color_conversion; ///< Scratch image of <code>GetSharpnessMeasure()</code> for the gray conversion of color input
+	cv::Mat m_sharpness_gray_image; ///< Scratch image of <code>GetSharpnessMeasure()</code> with the normalized gray values
+	std::vector<uchar> m_sharpness_gray_values; ///< Scratch buffer of <code>GetSharpnessMeasure()</code>
+
 protected:
 	std::map<int, AbstractFiducialParameters> m_general_fiducial_parameters;	///< map of marker id to some general parameters like offsets
+	int m_tile_size;	///< side length of the tiles of the thresholding and contour extraction in pixels, 0 disables tiling
+
+	/// Resets the statistics of the detector, called once at the start of each frame by <code>GetPoseTracked()</code>.
+	/// Models with statistics also reset them in <code>GetPose()</code> and accumulate them over the passes of a frame.
+	virtual void ResetDetectionStatistics() {};
+
+	/// Searches the full image like <code>GetPose()</code>, but continues the frame started by <code>ResetDetectionStatistics()</code>.
+	/// Used by the full scan of <code>GetPoseTracked()</code>, the default calls <code>GetPose()</code>
+	virtual unsigned long DetectPosesFullImage(cv::Mat& image, std::vector<t_pose>& vec_pose_CfromO)
+	{
+		return GetPose(image, vec_pose_CfromO);
+	};
+
+	/// Detects the tags in a single image without any region search of its own.
+	/// Used for the image regions searched by <code>GetPoseInRegions()</code>, the default calls <code>GetPose()</code>
+	virtual unsigned long DetectPoses(cv::Mat& image, std::vector<t_pose>& vec_pose_CfromO)
+	{
+		return GetPose(image, vec_pose_CfromO);
+	};
+
+	/// Detects the tags within the given image regions with <code>DetectPoses()</code>.
+	/// Overlapping regions are merged and the principal point is shifted into each region,
+	/// so the poses refer to the full image. Each id is reported once.
+	/// @param image scene image
+	/// @param rois Regions of the image to be searched
+	/// @param vec_pose_CfromO The poses found in the regions are appended
+	/// @return <code>RET_FAILED</code> if no tag could be detected
+	/// <code>RET_OK</code> on success
+	unsigned long GetPoseInRegions(cv::Mat& image, std::vector<cv::Rect> rois, std::vector<t_pose>& vec_pose_CfromO);
+
+	/// Reads the optional element <code>TileSize</code> of the model file into <code>m_tile_size</code>
+	/// @param p_xmlElement_Root The element <code>FiducialDetector</code> of the model file
+	unsigned long LoadTileSize(TiXmlElement* p_xmlElement_Root);
 
 	struct SharpnessLogData
 	{
@@ -13,9 +13,35 @@
 	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/aruco/FiducialModelAruco.h"
 #endif
 
+#include <iostream>
+#include <string>
+
 namespace ipa_Fiducials
 {
 
+/// Parameters of the synthetic scenes rendered by <code>FiducialTestingEnvironment::FiducialBenchmark</code>
+struct __DLL_LIBFIDUCIALS__ t_benchmark_parameters
+{
+	t_benchmark_parameters()
+		: image_size(1280, 960), number_images(100), tags_per_image(2),
+		  min_distance(0.5), max_distance(2.0), max_tilt(50.), blur_sigma(0.), noise_sigma(0.),
+		  number_distractors(50), pi_dot_diameter(0.12), seed(0)
+	{
+	}
+
+	cv::Size image_size; ///< Size of the rendered images
+	int number_images; ///< Number of rendered scenes per detector
+	int tags_per_image; ///< Tags per scene, limited by the number of tags of the model
+	double min_distance; ///< Minimum distance of a tag center to the camera [m]
+	double max_distance; ///< Maximum distance of a tag center to the camera [m]
+	double max_tilt; ///< Maximum angle between the tag normal and the optical axis [deg]
+	double blur_sigma; ///< Standard deviation of the Gaussian blur [pixel], 0 disables the blur
+	double noise_sigma; ///< Standard deviation of the additive Gaussian noise [gray values]
+	int number_distractors; ///< Number of dark ellipses scattered over the background
+	double pi_dot_diameter; ///< Diameter of the Pi-tag dots relative to the tag size
+	unsigned int seed; ///< Seed of the scene generator, equal seeds give equal poses for all detectors
+};
+
 /// @class FiducialTestingEnvironment
 ///
 /// Testing environment for fiducial detection
@@ -29,7 +55,46 @@ public:
 
 	unsigned long FiducialTestPI();
 	unsigned long FiducialTestAruco();
+
+	/// Renders synthetic scenes with known tag poses, runs the detectors on them and writes
+	/// one line per scene and a summary line per detector as tab separated values:
+	/// detection rate, false positives, total and per-stage processing times [ms] and pose errors [m, deg].
+	/// Per-stage times are only available for Pi-tags, the other detectors report nan.
+	/// @param pi_model_filename Model file of the Pi-tag detector, empty to skip the detector
+	/// @param aruco_model_filename Model file of the ArUco detector, empty to skip the detector
+	/// @param params Scene parameters
+	/// @param output Destination of the results
+	/// @return <code>RET_FAILED</code> if a detector could not be initialized
+	/// <code>RET_OK</code> on success
+	unsigned long FiducialBenchmark(const std::string& pi_model_filename, const std::string& aruco_model_filename,
+		const t_benchmark_parameters& params, std::ostream& output);
+
+	/// Compares the line association of Pi-tags by linear search over all reference tags with the <code>CrossRatioIndex</code>
+	/// on random tag libraries of the given sizes. Writes one line per library size as tab separated values:
+	/// time per query of both methods [us], the speedup, the number of matches and the number of queries whose matches differ.
+	/// @param library_sizes Numbers of reference tags
+	/// @param number_queries Number of random image line cross ratios per library
+	/// @param seed Seed of the random generator
+	/// @param output Destination of the results
+	/// @return <code>RET_FAILED</code> if both methods do not return the same matches
+	/// <code>RET_OK</code> on success
+	unsigned long CrossRatioIndexBenchmark(const std::vector<int>& library_sizes, int number_queries, unsigned int seed, std::ostream& output);
 private:
+	/// Texture of a tag and the mapping of its pixels into the marker coordinate system
+	struct t_tag_texture
+	{
+		cv::Mat image; ///< 8 bit, 3 channel texture
+		cv::Mat marker_from_texture; ///< 3x3 homogeneous transformation from texture pixels to marker coordinates [m]
+		cv::Mat rot_fronto_parallel; ///< 3x3 rotation CfromO under which the texture appears upright and unmirrored
+		cv::Mat rot_reported_from_rendered; ///< 3x3 rotation from the rendered marker frame to the frame reported by the detector
+	};
+
+	unsigned long BenchmarkModel(AbstractFiducialModel& model, const t_benchmark_parameters& params, std::ostream& output);
+	bool RenderTagTexture(AbstractFiducialModel& model, int marker_id, double pixels_per_meter,
+		const t_benchmark_parameters& params, t_tag_texture& texture);
+	unsigned long RenderScene(AbstractFiducialModel& model, const t_benchmark_parameters& params, cv::RNG& rng,
+		cv::Mat& image, std::vector<t_pose>& ground_truth);
+
 	unsigned long RenderPose(cv::Mat& image, cv::Mat& rot, cv::Mat& trans);
 	unsigned long ReprojectXYZ(double x, double y, double z, int& u, int& v);
 	boost::shared_ptr<FiducialModelPi> m_pi_tag;
@@ -0,0 +1,42 @@
+#ifndef __IPA_TILED_IMAGE_PROCESSING_H__
+#define __IPA_TILED_IMAGE_PROCESSING_H__
+
+#include <opencv2/core/core.hpp>
+
+#ifdef __LINUX__
+	#include "cob_fiducials/FiducialDefines.h"
+#else
+	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/FiducialDefines.h"
+#endif
+
+#include <vector>
+
+namespace ipa_Fiducials
+{
+
+/// Front end of the detectors (thresholding and contour extraction) for large images.
+/// The image is split into square tiles which are processed in parallel with cv::parallel_for_.
+/// A tile size of 0 processes the full image at once.
+
+/// Adaptive threshold like cv::adaptiveThreshold. The tiles are extended by half the block size,
+/// so the result is identical to thresholding the full image.
+/// @param src 8 bit single channel image
+/// @param dst Thresholded image, may be the same as <code>src</code>
+/// @param tile_size Side length of a tile in pixels, 0 disables tiling
+void __DLL_LIBFIDUCIALS__ TiledAdaptiveThreshold(const cv::Mat& src, cv::Mat& dst, double max_value, int adaptive_method,
+	int threshold_type, int block_size, double c, int tile_size);
+
+/// Extracts all contours (CV_RETR_LIST, CV_CHAIN_APPROX_NONE) of a binary image.
+/// Each tile is searched with an overlap of <code>max_contour_extent</code> pixels to the right and bottom.
+/// A contour is reported by the tile that contains the upper left corner of its bounding box, contours cut by a
+/// tile border are dropped, so contours crossing tile seams are merged without duplicates.
+/// @param binary Binary image, is modified if tiling is disabled
+/// @param contours The contours, ordered by tile
+/// @param max_contour_extent Contours with a larger bounding box may be missed when tiling is enabled
+/// @param tile_size Side length of a tile in pixels, 0 disables tiling
+void __DLL_LIBFIDUCIALS__ TiledFindContours(cv::Mat& binary, std::vector<std::vector<cv::Point> >& contours,
+	int max_contour_extent, int tile_size);
+
+} // end namespace ipa_Fiducials
+
+#endif // __IPA_TILED_IMAGE_PROCESSING_H__
@@ -51,6 +51,12 @@ public:
 	// Class specific functions
 	//*******************************************************************************
 	unsigned long LoadParameters(std::vector<FiducialArucoParameters> pi_tags);
+
+	/// Geometry of a marker as used for the pose estimation
+	/// @param marker_id Id of the marker
+	/// @param half_size Half the side length of the marker
+	/// @param offset Offset of the marker center to the target coordinate system
+	void GetMarkerGeometry(int marker_id, double& half_size, cv::Point2d& offset);
 private:
 	boost::shared_ptr<aruco::MarkerDetector> m_detector; ///< instance of aruco detector
 	double m_marker_size; ///< Aruco allows only a common marker size for all markers
@@ -147,6 +147,20 @@ public:
     }
 
 
+    /**
+     * Splits the image into tiles of the given size for the adaptive threshold and the contour extraction,
+     * the tiles are processed in parallel. 0 (default) processes the full image at once
+     */
+    void setTileSize(int tileSize) {
+        _tileSize=tileSize;
+    }
+    /**Returns the tile size of the adaptive threshold and the contour extraction
+     */
+    int getTileSize()const {
+        return _tileSize;
+    }
+
+
     /**Returns a reference to the internal image thresholded. It is for visualization purposes and to adjust manually
      * the parameters
      */
@@ -293,6 +307,8 @@ private:
     ThresholdMethods _thresMethod;
     //Threshold parameters
     double _thresParam1,_thresParam2;
+    //Tile size of the threshold and contour extraction, 0 disables tiling
+    int _tileSize;
     //Current corner method
     CornerRefinementMethod _cornerMethod;
     //minimum and maximum size of a contour lenght
@@ -307,6 +323,8 @@ private:
     int pyrdown_level;
     //Images
     cv::Mat grey,thres,thres2,reduced;
+    //gray conversion of color input, reused across calls
+    cv::Mat greyBuffer;
     //pointer to the function that analizes a rectangular region so as to detect its internal marker
     int (* markerIdDetector_ptrfunc)(const cv::Mat &in,int &nRotations);
 
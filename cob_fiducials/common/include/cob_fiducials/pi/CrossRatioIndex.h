@@ -0,0 +1,96 @@
+#ifndef __IPA_CROSS_RATIO_INDEX_H__
+#define __IPA_CROSS_RATIO_INDEX_H__
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace ipa_Fiducials
+{
+
+/// Reference tag with a line whose cross ratio fits a queried cross ratio
+struct t_cross_ratio_match
+{
+	int tag_index; ///< Index of the reference tag
+	int line_type; ///< 0 if the cross ratio fits line type 0 of the tag, 1 for line type 1
+};
+
+/// @class CrossRatioIndex
+///
+/// Sorted index over the cross ratios of both line types of all reference tags.
+/// A query for the cross ratio of an image line only visits the reference lines within the
+/// tolerance (binary search), so the line association does not depend linearly on the size of the tag library.
+class CrossRatioIndex
+{
+public:
+
+	/// Builds the index
+	/// @param cross_ratios_0 Cross ratio of line type 0 of each reference tag
+	/// @param cross_ratios_1 Cross ratio of line type 1 of each reference tag
+	void Build(const std::vector<double>& cross_ratios_0, const std::vector<double>& cross_ratios_1)
+	{
+		m_cross_ratios_0 = cross_ratios_0;
+		m_entries.clear();
+		m_entries.reserve(cross_ratios_0.size() + cross_ratios_1.size());
+		for (size_t i = 0; i < cross_ratios_0.size(); i++)
+			m_entries.push_back(t_entry(cross_ratios_0[i], (int)i, 0));
+		for (size_t i = 0; i < cross_ratios_1.size(); i++)
+			m_entries.push_back(t_entry(cross_ratios_1[i], (int)i, 1));
+		std::sort(m_entries.begin(), m_entries.end());
+	};
+
+	/// Collects the reference tags with a line that fits the cross ratio.
+	/// Like the linear search, a tag is matched by line type 0 if both of its cross ratios fit.
+	/// @param cross_ratio Cross ratio of the image line
+	/// @param max_dist Maximum absolute difference of the cross ratios
+	/// @param matches Receives the matches in ascending order of the cross ratios
+	/// @return Number of index entries that were visited
+	size_t Query(double cross_ratio, double max_dist, std::vector<t_cross_ratio_match>& matches) const
+	{
+		matches.clear();
+		// The search range is slightly wider than the tolerance, the exact test below decides like the linear search
+		double margin = max_dist + 1e-9;
+		std::vector<t_entry>::const_iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), t_entry(cross_ratio - margin, -1, -1));
+		size_t visited = 0;
+		for (; it != m_entries.end() && it->cross_ratio <= cross_ratio + margin; ++it)
+		{
+			visited++;
+			if (std::abs(cross_ratio - it->cross_ratio) >= max_dist)
+				continue;
+			if (it->line_type == 1 && std::abs(cross_ratio - m_cross_ratios_0[it->tag_index]) < max_dist)
+				continue;
+
+			t_cross_ratio_match match;
+			match.tag_index = it->tag_index;
+			match.line_type = it->line_type;
+			matches.push_back(match);
+		}
+		return visited;
+	};
+
+private:
+
+	struct t_entry
+	{
+		t_entry(double cr, int tag, int type)
+			: cross_ratio(cr), tag_index(tag), line_type(type)
+		{
+		};
+
+		bool operator<(const t_entry& other) const
+		{
+			return cross_ratio < other.cross_ratio;
+		};
+
+		double cross_ratio;
+		int tag_index;
+		int line_type;
+	};
+
+	std::vector<t_entry> m_entries; ///< Cross ratios of all reference lines in ascending order
+	std::vector<double> m_cross_ratios_0; ///< Cross ratio of line type 0 of each reference tag
+};
+
+} // end namespace ipa_Fiducials
+
+#endif // __IPA_CROSS_RATIO_INDEX_H__
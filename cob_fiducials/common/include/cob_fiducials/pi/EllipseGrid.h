@@ -0,0 +1,164 @@
+#ifndef __IPA_ELLIPSE_GRID_H__
+#define __IPA_ELLIPSE_GRID_H__
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace ipa_Fiducials
+{
+
+/// @class EllipseGrid
+///
+/// Uniform grid over the centers of the detected ellipses.
+/// The cell size is chosen relative to the ellipse size, so that a neighborhood query for
+/// the possible partners of an ellipse on a marker line only visits a few cells instead of all ellipses.
+/// The cells are stored in one contiguous index array (counting sort), building the grid is linear in the number of ellipses.
+class EllipseGrid
+{
+public:
+	EllipseGrid()
+		: m_cell_size(1.f), m_cols(0), m_rows(0)
+	{
+	};
+
+	/// Sorts the ellipse centers into the grid
+	/// @param ellipses Ellipses, the query results are indices into this vector
+	/// @param cell_size Side length of a grid cell in pixels
+	void Build(const std::vector<cv::RotatedRect>& ellipses, float cell_size)
+	{
+		m_centers.resize(ellipses.size());
+		m_cell_start.clear();
+		m_cell_entries.clear();
+		m_cols = 0;
+		m_rows = 0;
+		if (ellipses.empty())
+			return;
+
+		cv::Point2f min_pt = ellipses[0].center;
+		cv::Point2f max_pt = ellipses[0].center;
+		for (size_t i = 0; i < ellipses.size(); i++)
+		{
+			m_centers[i] = ellipses[i].center;
+			min_pt.x = std::min(min_pt.x, m_centers[i].x);
+			min_pt.y = std::min(min_pt.y, m_centers[i].y);
+			max_pt.x = std::max(max_pt.x, m_centers[i].x);
+			max_pt.y = std::max(max_pt.y, m_centers[i].y);
+		}
+
+		// Limit the number of cells to a small multiple of the number of ellipses
+		m_cell_size = std::max(1.f, cell_size);
+		double max_cells = 4.0*ellipses.size() + 64;
+		while (double(max_pt.x-min_pt.x)/m_cell_size * double(max_pt.y-min_pt.y)/m_cell_size > max_cells)
+			m_cell_size *= 2.f;
+
+		m_origin = min_pt;
+		m_cols = int((max_pt.x-min_pt.x)/m_cell_size) + 1;
+		m_rows = int((max_pt.y-min_pt.y)/m_cell_size) + 1;
+
+		// Counting sort of the ellipse indices by cell
+		std::vector<int> cell_of_ellipse(ellipses.size());
+		m_cell_start.assign(m_cols*m_rows + 1, 0);
+		for (size_t i = 0; i < m_centers.size(); i++)
+		{
+			cell_of_ellipse[i] = CellY(m_centers[i].y)*m_cols + CellX(m_centers[i].x);
+			m_cell_start[cell_of_ellipse[i] + 1]++;
+		}
+		for (size_t c = 1; c < m_cell_start.size(); c++)
+			m_cell_start[c] += m_cell_start[c-1];
+		std::vector<int> fill(m_cell_start.begin(), m_cell_start.end()-1);
+		m_cell_entries.resize(m_centers.size());
+		for (size_t i = 0; i < m_centers.size(); i++)
+			m_cell_entries[fill[cell_of_ellipse[i]]++] = (int)i;
+	};
+
+	/// Collects all ellipses whose center lies within the given radius
+	/// @param center Query point
+	/// @param radius Query radius in pixels
+	/// @param indices Receives the ellipse indices in ascending order
+	/// @return Number of grid entries that were visited
+	size_t QueryRadius(const cv::Point2f& center, double radius, std::vector<int>& indices) const
+	{
+		indices.clear();
+		size_t visited = VisitCells(center.x-radius, center.y-radius, center.x+radius, center.y+radius, indices);
+
+		double radius_sqr = radius*radius;
+		size_t n = 0;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			cv::Point2f d = m_centers[indices[i]] - center;
+			if (double(d.x)*d.x + double(d.y)*d.y <= radius_sqr)
+				indices[n++] = indices[i];
+		}
+		indices.resize(n);
+		std::sort(indices.begin(), indices.end());
+		return visited;
+	};
+
+	/// Collects all ellipses whose center lies strictly inside the rectangle
+	/// @param rect Query rectangle
+	/// @param indices Receives the ellipse indices in ascending order
+	/// @return Number of grid entries that were visited
+	size_t QueryRect(const cv::Rect& rect, std::vector<int>& indices) const
+	{
+		indices.clear();
+		size_t visited = VisitCells((float)rect.x, (float)rect.y, (float)(rect.x+rect.width), (float)(rect.y+rect.height), indices);
+
+		size_t n = 0;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			const cv::Point2f& c = m_centers[indices[i]];
+			if (rect.x < c.x && c.x < rect.x + rect.width && rect.y < c.y && c.y < rect.y + rect.height)
+				indices[n++] = indices[i];
+		}
+		indices.resize(n);
+		std::sort(indices.begin(), indices.end());
+		return visited;
+	};
+
+private:
+
+	int CellX(float x) const
+	{
+		return std::max(0, std::min(m_cols-1, int((x-m_origin.x)/m_cell_size)));
+	};
+
+	int CellY(float y) const
+	{
+		return std::max(0, std::min(m_rows-1, int((y-m_origin.y)/m_cell_size)));
+	};
+
+	/// Appends the entries of all cells overlapping the box, unfiltered
+	size_t VisitCells(float x_min, float y_min, float x_max, float y_max, std::vector<int>& indices) const
+	{
+		if (m_cell_entries.empty())
+			return 0;
+		if (x_max < m_origin.x || y_max < m_origin.y ||
+			x_min > m_origin.x + m_cols*m_cell_size || y_min > m_origin.y + m_rows*m_cell_size)
+			return 0;
+
+		int cx0 = CellX(x_min), cx1 = CellX(x_max);
+		int cy0 = CellY(y_min), cy1 = CellY(y_max);
+		for (int cy = cy0; cy <= cy1; cy++)
+		{
+			int first = m_cell_start[cy*m_cols + cx0];
+			int last = m_cell_start[cy*m_cols + cx1 + 1];
+			indices.insert(indices.end(), m_cell_entries.begin()+first, m_cell_entries.begin()+last);
+		}
+		return indices.size();
+	};
+
+	float m_cell_size; ///< Side length of a cell in pixels
+	cv::Point2f m_origin; ///< Upper left corner of cell (0,0)
+	int m_cols; ///< Number of cells in x direction
+	int m_rows; ///< Number of cells in y direction
+	std::vector<int> m_cell_start; ///< Entries of cell c are m_cell_entries[m_cell_start[c] ... m_cell_start[c+1]-1]
+	std::vector<int> m_cell_entries; ///< Ellipse indices sorted by cell
+	std::vector<cv::Point2f> m_centers; ///< Ellipse centers
+};
+
+} // end namespace ipa_Fiducials
+
+#endif // __IPA_ELLIPSE_GRID_H__
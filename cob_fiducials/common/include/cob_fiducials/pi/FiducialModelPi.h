@@ -6,11 +6,17 @@
 	#include "cob_fiducials/FiducialDefines.h"
 	#include "cob_fiducials/AbstractFiducialModel.h"
 	#include "cob_fiducials/pi/FiducialPiParameters.h"
+	#include "cob_fiducials/pi/EllipseGrid.h"
+	#include "cob_fiducials/pi/CrossRatioIndex.h"
+	#include "cob_fiducials/TiledImageProcessing.h"
 #else
 	#include "cob_perception_common/cob_vision_utils/common/include/cob_vision_utils/VisionUtils.h"
 	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/FiducialDefines.h"
 	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/AbstractFiducialModel.h"
 	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/pi/FiducialPiParameters.h"
+	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/pi/EllipseGrid.h"
+	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/pi/CrossRatioIndex.h"
+	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/TiledImageProcessing.h"
 #endif
 
 
@@ -41,6 +47,50 @@ struct t_pi
 };
 
 
+/// Candidate counts and processing times of the detection stages of the last frame (call to FiducialModelPi::GetPose or GetPoseTracked).
+/// The counts and times are summed over all detection passes of the frame, i.e. the coarse level and all regions.
+struct t_pi_detection_statistics
+{
+	t_pi_detection_statistics()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		contours = 0;
+		ellipses = 0;
+		rois = 0;
+		grid_entries_visited = 0;
+		ellipse_pairs = 0;
+		marker_lines = 0;
+		fitting_lines = 0;
+		tags = 0;
+		poses = 0;
+		time_threshold = 0.;
+		time_contours = 0.;
+		time_ellipses = 0.;
+		time_pairing = 0.;
+		time_pose = 0.;
+	}
+
+	size_t contours; ///< Contours of the thresholded image
+	size_t ellipses; ///< Ellipses that passed the plausibility checks
+	size_t rois; ///< Regions of interest (Fast Pi-Tag only)
+	size_t grid_entries_visited; ///< Ellipses visited by the neighborhood queries of the line search
+	size_t ellipse_pairs; ///< Ellipse pairs tested as end points of a marker line
+	size_t marker_lines; ///< Lines with exactly four collinear ellipses
+	size_t fitting_lines; ///< Marker lines whose cross ratio fits a reference tag
+	size_t tags; ///< Tag candidates with four matching sides
+	size_t poses; ///< Detected poses
+
+	double time_threshold; ///< Gray scale conversion and adaptive threshold [ms]
+	double time_contours; ///< Contour extraction [ms]
+	double time_ellipses; ///< Ellipse fitting and plausibility checks [ms]
+	double time_pairing; ///< Roi generation, line search and tag assembly [ms]
+	double time_pose; ///< solvePnP and projection check [ms]
+};
+
 /// @class FiducialModelPi
 ///
 /// A concrete class to represent a fiducial
@@ -54,7 +104,8 @@ public:
 	FiducialModelPi();
 	~FiducialModelPi();
 
-	/// Locates the fiducial within the image and inferes the camera pose from it
+	/// Locates the fiducial within the image and inferes the camera pose from it.
+	/// Images wider than the coarse-to-fine width limit are searched coarse-to-fine (see <code>GetPoseCoarseToFine</code>)
 	/// @param scene image
 	/// @return <code>RET_FAILED</code> if no tag could be detected
 	/// <code>RET_OK</code> on success
@@ -70,20 +121,71 @@ public:
 		return "PI";
 	};
 
+	/// Reference tags with their ellipse coordinates in the marker coordinate system
+	const std::vector<t_pi>& GetReferenceTags() const
+	{
+		return m_ref_tag_vec;
+	};
+
+	/// Candidate counts of the detection stages of the last call to <code>GetPose</code> or <code>GetPoseTracked</code>
+	const t_pi_detection_statistics& GetDetectionStatistics() const
+	{
+		return m_detection_statistics;
+	};
+
 	//*******************************************************************************
 	// Class specific functions
 	//*******************************************************************************
 
+protected:
+
+	/// Detects the tags at the resolution of the given image, the statistics are added to <code>m_detection_statistics</code>
+	unsigned long DetectPoses(cv::Mat& image, std::vector<t_pose>& vec_pose);
+
+	/// Resets <code>m_detection_statistics</code>
+	void ResetDetectionStatistics();
+
+	/// Searches the full image coarse-to-fine or at full resolution without resetting the statistics
+	unsigned long DetectPosesFullImage(cv::Mat& image, std::vector<t_pose>& vec_pose);
+
 private:
 
+	/// Detects tag candidates on the first pyramid level that is not wider than <code>m_coarse_max_image_width</code>
+	/// and refines the ellipse centers and the pose within the padded candidate regions at full resolution.
+	/// The pixel sizes of the detector are assumed to be tuned for images of <code>m_coarse_max_image_width</code>,
+	/// the full resolution pass scales them by the downsampling factor (see <code>m_pixel_scale</code>).
+	/// Tags have to be large enough to be found on the coarse level.
+	unsigned long GetPoseCoarseToFine(cv::Mat& image, std::vector<t_pose>& vec_pose);
+
 	bool TagUnique(std::vector<t_pi>& tag_vec, t_pi& newTag);
 	bool AnglesValid2D(std::vector<cv::Point2f>& image_points);
 	bool ProjectionValid(cv::Mat& rot_CfromO, cv::Mat& trans_CfromO, cv::Mat& camera_matrix,
 		cv::Mat& pattern_coords, cv::Mat& image_coords);
 
 	std::vector<t_pi> m_ref_tag_vec; ///< reference tags to be recognized
+	CrossRatioIndex m_cross_ratio_index; ///< Cross ratios of the lines of all reference tags, built in <code>LoadParameters</code>
+	std::vector<unsigned int> m_matched_ref_tags; ///< Indices of the reference tags with fitting image lines, in ascending order
 	cv::Mat m_debug_img; ///< image that holds debugging output
 	bool m_use_fast_pi_tag;
+
+	/// Search radius for the end points of a marker line in multiples of the ellipse size.
+	/// The line search only visits ellipses within this radius (using <code>EllipseGrid</code>)
+	/// instead of comparing all pairs and triples of ellipses in the image.
+	double m_max_line_length_factor;
+	t_pi_detection_statistics m_detection_statistics; ///< Candidate counts of the last detection
+
+	int m_coarse_max_image_width; ///< Images wider than this are searched coarse-to-fine, 0 disables the coarse-to-fine search
+	double m_coarse_roi_padding; ///< Padding of the full resolution regions relative to the size of the coarse tag candidates
+	std::vector<cv::Rect> m_tag_image_regions; ///< Bounding boxes of the ellipses of the poses found by the last call to <code>DetectPoses</code>
+	double m_pixel_scale; ///< Factor of the threshold kernel and ellipse sizes of <code>DetectPoses</code>, 1 except for the full resolution pass of <code>GetPoseCoarseToFine</code>
+
+	/// Scratch images of <code>DetectPoses</code> and <code>GetPoseCoarseToFine</code>.
+	/// They are kept across calls, so their memory is only allocated when the image size changes.
+	cv::Mat m_gray_image; ///< Gray scale conversion of color input
+	cv::Mat m_binary_image; ///< Thresholded image, modified by the contour extraction
+	cv::Mat m_ellipse_voting; ///< Fast Pi-tag: index of the ellipse voting for each pixel
+	cv::Mat m_ellipse_density; ///< Fast Pi-tag: number of ellipses voting for each pixel
+	std::vector<cv::Mat> m_pyramid_levels; ///< Downsampled images of the coarse-to-fine search
 };
 
 } // end namespace ipa_Fiducials
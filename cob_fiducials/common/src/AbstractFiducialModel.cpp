@@ -9,8 +9,20 @@
 	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/AbstractFiducialModel.h"
 #endif
 
+#include <algorithm>
+#include <cfloat>
+
 using namespace ipa_Fiducials;
 
+AbstractFiducialModel::AbstractFiducialModel()
+	: m_tracking_enabled(false),
+	  m_tracking_full_scan_interval(30),
+	  m_tracking_roi_padding(0.5),
+	  m_frames_since_full_scan(0),
+	  m_tile_size(0),
+	  m_log_or_calibrate_sharpness_measurements(false)
+{
+}
 
 unsigned long AbstractFiducialModel::Init(cv::Mat& camera_matrix, std::string directory_and_filename, bool log_or_calibrate_sharpness_measurements, cv::Mat extrinsic_matrix)
 {
@@ -82,7 +94,231 @@ unsigned long AbstractFiducialModel::ApplyExtrinsics(cv::Mat& rot_CfromO, cv::Ma
 	return ipa_Utils::RET_OK;
 }
 
-	
+unsigned long AbstractFiducialModel::SetTrackingParameters(bool enable, int full_scan_interval, double roi_padding)
+{
+	if (full_scan_interval < 1 || roi_padding < 0.)
+	{
+		std::cerr << "ERROR - AbstractFiducialModel::SetTrackingParameters" << std::endl;
+		std::cerr << "\t [FAILED] Full scan interval must be at least 1 and the ROI padding must not be negative" << std::endl;
+		return ipa_Utils::RET_FAILED;
+	}
+
+	m_tracking_enabled = enable;
+	m_tracking_full_scan_interval = full_scan_interval;
+	m_tracking_roi_padding = roi_padding;
+	ResetTracking();
+
+	return ipa_Utils::RET_OK;
+}
+
+void AbstractFiducialModel::ResetTracking()
+{
+	m_tracks.clear();
+	m_frames_since_full_scan = 0;
+}
+
+unsigned long AbstractFiducialModel::GetPoseInRegions(cv::Mat& image, std::vector<cv::Rect> rois, std::vector<t_pose>& vec_pose_CfromO)
+{
+	// Merge overlapping regions, so that each tag is searched only once
+	for (bool merged = true; merged == true; )
+	{
+		merged = false;
+		for (size_t i=0; i<rois.size() && merged == false; i++)
+			for (size_t j=i+1; j<rois.size() && merged == false; j++)
+				if ((rois[i] & rois[j]).area() > 0)
+				{
+					rois[i] |= rois[j];
+					rois.erase(rois.begin()+j);
+					merged = true;
+				}
+	}
+
+	// The principal point is shifted into each region, so that
+	// the poses are computed with respect to the full image
+	cv::Rect image_rect(0, 0, image.cols, image.rows);
+	cv::Mat camera_matrix = m_camera_matrix;
+	for (size_t i=0; i<rois.size(); i++)
+	{
+		cv::Rect roi = rois[i] & image_rect;
+		if (roi.area() == 0)
+			continue;
+
+		m_camera_matrix = camera_matrix.clone();
+		m_camera_matrix.at<double>(0,2) -= roi.x;
+		m_camera_matrix.at<double>(1,2) -= roi.y;
+
+		// The detectors do not modify their input, so the region is searched without a copy
+		cv::Mat roi_image = image(roi);
+
+		std::vector<t_pose> vec_roi_pose;
+		if (DetectPoses(roi_image, vec_roi_pose) & ipa_Utils::RET_FAILED)
+			continue;
+		for (size_t j=0; j<vec_roi_pose.size(); j++)
+		{
+			bool duplicate = false;
+			for (size_t k=0; k<vec_pose_CfromO.size() && duplicate == false; k++)
+				duplicate = vec_pose_CfromO[k].id == vec_roi_pose[j].id;
+			if (duplicate == false)
+				vec_pose_CfromO.push_back(vec_roi_pose[j]);
+		}
+	}
+	m_camera_matrix = camera_matrix;
+
+	if (vec_pose_CfromO.empty())
+		return ipa_Utils::RET_FAILED;
+	return ipa_Utils::RET_OK;
+}
+
+unsigned long AbstractFiducialModel::SetTileSize(int tile_size)
+{
+	if (tile_size < 0)
+	{
+		std::cerr << "ERROR - AbstractFiducialModel::SetTileSize" << std::endl;
+		std::cerr << "\t [FAILED] Tile size must not be negative" << std::endl;
+		return ipa_Utils::RET_FAILED;
+	}
+	m_tile_size = tile_size;
+	return ipa_Utils::RET_OK;
+}
+
+unsigned long AbstractFiducialModel::LoadTileSize(TiXmlElement* p_xmlElement_Root)
+{
+	TiXmlElement *p_xmlElement_tile_size = p_xmlElement_Root->FirstChildElement("TileSize");
+	if (p_xmlElement_tile_size == NULL)
+		return ipa_Utils::RET_OK;
+
+	int tile_size = 0;
+	if (p_xmlElement_tile_size->QueryValueAttribute("value", &tile_size) != TIXML_SUCCESS)
+	{
+		std::cerr << "ERROR - AbstractFiducialModel::LoadTileSize:" << std::endl;
+		std::cerr << "\t ... Can't find attribute 'value' of tag 'TileSize'" << std::endl;
+		return ipa_Utils::RET_FAILED;
+	}
+	return SetTileSize(tile_size);
+}
+
+unsigned long AbstractFiducialModel::GetPoseTracked(cv::Mat& image, std::vector<t_pose>& vec_pose_CfromO)
+{
+	vec_pose_CfromO.clear();
+	ResetDetectionStatistics();
+
+	bool full_scan = m_tracking_enabled == false || m_tracks.empty() ||
+		m_frames_since_full_scan+1 >= m_tracking_full_scan_interval;
+
+	// 1. Predict the image regions of the tracked tags
+	std::vector<cv::Rect> rois;
+	for (std::map<int, t_tag_track>::iterator it = m_tracks.begin(); full_scan == false && it != m_tracks.end(); ++it)
+	{
+		cv::Rect roi;
+		if (PredictTagRegion(it->first, it->second, image.size(), roi) == false)
+			full_scan = true;
+		else
+			rois.push_back(roi);
+	}
+
+	// 2. Search the regions
+	if (full_scan == false)
+	{
+		GetPoseInRegions(image, rois, vec_pose_CfromO);
+
+		// A lost tag triggers a full scan of the same frame
+		for (std::map<int, t_tag_track>::iterator it = m_tracks.begin(); full_scan == false && it != m_tracks.end(); ++it)
+		{
+			bool found = false;
+			for (size_t k=0; k<vec_pose_CfromO.size() && found == false; k++)
+				found = vec_pose_CfromO[k].id == it->first;
+			if (found == false)
+				full_scan = true;
+		}
+		m_frames_since_full_scan++;
+	}
+
+	// 3. Fall back to the full image
+	if (full_scan == true)
+	{
+		vec_pose_CfromO.clear();
+		DetectPosesFullImage(image, vec_pose_CfromO);
+		m_frames_since_full_scan = 0;
+	}
+
+	if (m_tracking_enabled == true)
+		UpdateTracks(vec_pose_CfromO);
+
+	if (vec_pose_CfromO.empty())
+		return ipa_Utils::RET_FAILED;
+	return ipa_Utils::RET_OK;
+}
+
+bool AbstractFiducialModel::PredictTagRegion(int marker_id, const t_tag_track& track, const cv::Size& image_size, cv::Rect& roi)
+{
+	std::map<int, AbstractFiducialParameters>::iterator it = m_general_fiducial_parameters.find(marker_id);
+	if (it == m_general_fiducial_parameters.end())
+		return false;
+	const cv::Rect_<double>& area = it->second.m_sharpness_pattern_area_rect3d;
+	const cv::Point2d& offset = it->second.m_offset;
+	if (area.width <= 0. || area.height <= 0.)
+		return false;
+
+	// Constant velocity of the translation, the rotation is covered by the padding
+	cv::Mat trans = track.trans_CfromO.clone();
+	if (track.prev_trans_CfromO.empty() == false)
+		trans += track.trans_CfromO - track.prev_trans_CfromO;
+
+	// Project the marker area like GetSharpnessMeasure does
+	double corners[4][2] = {
+		{area.x + offset.x, -area.y + offset.y},
+		{area.x + area.width + offset.x, -area.y + offset.y},
+		{area.x + area.width + offset.x, -area.y - area.height + offset.y},
+		{area.x + offset.x, -area.y - area.height + offset.y}};
+	cv::Point2d min_point(DBL_MAX, DBL_MAX), max_point(-DBL_MAX, -DBL_MAX);
+	for (int i=0; i<4; ++i)
+	{
+		cv::Mat point3d_marker = (cv::Mat_<double>(3,1) << corners[i][0], corners[i][1], 0.);
+		cv::Mat point3d_camera = track.rot_CfromO * point3d_marker + trans;
+		if (point3d_camera.at<double>(2) <= 0.)
+			return false;
+		cv::Mat point2d_camera = m_camera_matrix * point3d_camera;
+		double u = point2d_camera.at<double>(0)/point2d_camera.at<double>(2);
+		double v = point2d_camera.at<double>(1)/point2d_camera.at<double>(2);
+		min_point.x = std::min(min_point.x, u);
+		min_point.y = std::min(min_point.y, v);
+		max_point.x = std::max(max_point.x, u);
+		max_point.y = std::max(max_point.y, v);
+	}
+
+	double padding = m_tracking_roi_padding * std::max(max_point.x-min_point.x, max_point.y-min_point.y);
+	cv::Rect image_rect(0, 0, image_size.width, image_size.height);
+	cv::Rect predicted(cvFloor(min_point.x-padding), cvFloor(min_point.y-padding), 0, 0);
+	predicted.width = cvCeil(max_point.x+padding) - predicted.x;
+	predicted.height = cvCeil(max_point.y+padding) - predicted.y;
+	roi = predicted & image_rect;
+
+	return roi.area() > 0;
+}
+
+void AbstractFiducialModel::UpdateTracks(const std::vector<t_pose>& vec_pose_XYfromO)
+{
+	// The poses are tracked in camera coordinates, undo the extrinsics
+	cv::Mat extrinsic_CfromXY = m_extrinsic_XYfromC.inv();
+
+	std::map<int, t_tag_track> tracks;
+	for (size_t i=0; i<vec_pose_XYfromO.size(); i++)
+	{
+		cv::Mat frame_XYfromO = cv::Mat::eye(4, 4, CV_64FC1);
+		vec_pose_XYfromO[i].rot.copyTo(frame_XYfromO(cv::Rect(0, 0, 3, 3)));
+		vec_pose_XYfromO[i].trans.copyTo(frame_XYfromO(cv::Rect(3, 0, 1, 3)));
+		cv::Mat frame_CfromO = extrinsic_CfromXY * frame_XYfromO;
+
+		t_tag_track& track = tracks[vec_pose_XYfromO[i].id];
+		track.rot_CfromO = frame_CfromO(cv::Rect(0, 0, 3, 3)).clone();
+		track.trans_CfromO = frame_CfromO(cv::Rect(3, 0, 1, 3)).clone();
+		std::map<int, t_tag_track>::iterator it = m_tracks.find(vec_pose_XYfromO[i].id);
+		if (it != m_tracks.end())
+			track.prev_trans_CfromO = it->second.trans_CfromO;
+	}
+	m_tracks.swap(tracks);
+}
+
 unsigned long AbstractFiducialModel::GetSharpnessMeasure(const cv::Mat& image, t_pose pose_CfromO, 
 	const AbstractFiducialParameters& fiducial_parameters, double& sharpness_measure, 
 	double sharpness_calibration_parameter_m, double sharpness_calibration_parameter_n)
@@ -125,9 +361,14 @@ unsigned long AbstractFiducialModel::GetSharpnessMeasure(const cv::Mat& image, t
 	roi = roi.colRange(min_point.x, max_point.x);
 
 	// 2. compute sharpness measure
-	cv::Mat temp, gray_image;
-	cv::cvtColor(roi, temp, CV_BGR2GRAY);
-	cv::normalize(temp, gray_image, 0, 255, cv::NORM_MINMAX);
+	cv::Mat& gray_image = m_sharpness_gray_image;
+	if (roi.channels() == 3)
+	{
+		cv::cvtColor(roi, m_sharpness_color_conversion, CV_BGR2GRAY);
+		cv::normalize(m_sharpness_color_conversion, gray_image, 0, 255, cv::NORM_MINMAX);
+	}
+	else
+		cv::normalize(roi, gray_image, 0, 255, cv::NORM_MINMAX);
 
 //		cv::imshow("gray_image", gray_image);
 //		cv::Mat image_copy = image.clone();
@@ -139,7 +380,8 @@ unsigned long AbstractFiducialModel::GetSharpnessMeasure(const cv::Mat& image, t
 		sharpness_area[i] -= min_point;
 
 	// variant M_V (std. dev. of gray values)
-	std::vector<uchar> gray_values;
+	std::vector<uchar>& gray_values = m_sharpness_gray_values;
+	gray_values.clear();
 	double avg_gray = 0.;
 	for (int v=0; v<roi.rows; ++v)
 	{
@@ -252,3 +494,11 @@ AbstractFiducialParameters AbstractFiducialModel::GetGeneralFiducialParameters(i
 	}
 	return it->second;
 }
+
+std::vector<int> AbstractFiducialModel::GetMarkerIds()
+{
+	std::vector<int> marker_ids;
+	for (std::map<int, AbstractFiducialParameters>::iterator it = m_general_fiducial_parameters.begin(); it != m_general_fiducial_parameters.end(); ++it)
+		marker_ids.push_back(it->first);
+	return marker_ids;
+}
@@ -0,0 +1,148 @@
+/// @file FiducialBenchmarkMain.cpp
+/// Command line front end of FiducialTestingEnvironment::FiducialBenchmark.
+/// Usage: fiducial_benchmark [key=value ...]
+/// Keys: pi_model, aruco_model, output, width, height, focal_length, images, tags, min_distance, max_distance,
+/// max_tilt, blur, noise, distractors, dot_diameter, seed.
+/// cross_ratio_benchmark=1 compares the Pi-tag line association with and without the cross ratio index on random
+/// tag libraries of 10 to 100000 tags instead (keys: queries, seed, output).
+/// The results are written as tab separated values to the output file or to stdout.
+
+#include <cob_vision_utils/StdAfx.h>
+#ifdef __LINUX__
+	#include "cob_fiducials/FiducialTestingEnvironment.h"
+#else
+	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/FiducialTestingEnvironment.h"
+#endif
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ipa_Fiducials;
+
+template <class T>
+bool ParseValue(const std::string& text, T& value)
+{
+	std::istringstream stream(text);
+	stream >> value;
+	return !stream.fail();
+}
+
+int main(int argc, char** argv)
+{
+	std::string pi_model_filename;
+	std::string aruco_model_filename;
+	std::string output_filename;
+	double focal_length = 0.;
+	t_benchmark_parameters params;
+	int cross_ratio_benchmark = 0;
+	int number_queries = 100000;
+
+	for (int i=1; i<argc; i++)
+	{
+		std::string argument(argv[i]);
+		size_t separator = argument.find('=');
+		if (separator == std::string::npos)
+		{
+			std::cerr << "ERROR - fiducial_benchmark:" << std::endl;
+			std::cerr << "\t ... Arguments have to be given as key=value, got '" << argument << "'" << std::endl;
+			return 1;
+		}
+		std::string key = argument.substr(0, separator);
+		std::string value = argument.substr(separator+1);
+
+		bool valid = true;
+		if (key == "pi_model")
+			pi_model_filename = value;
+		else if (key == "aruco_model")
+			aruco_model_filename = value;
+		else if (key == "output")
+			output_filename = value;
+		else if (key == "width")
+			valid = ParseValue(value, params.image_size.width);
+		else if (key == "height")
+			valid = ParseValue(value, params.image_size.height);
+		else if (key == "focal_length")
+			valid = ParseValue(value, focal_length);
+		else if (key == "images")
+			valid = ParseValue(value, params.number_images);
+		else if (key == "tags")
+			valid = ParseValue(value, params.tags_per_image);
+		else if (key == "min_distance")
+			valid = ParseValue(value, params.min_distance);
+		else if (key == "max_distance")
+			valid = ParseValue(value, params.max_distance);
+		else if (key == "max_tilt")
+			valid = ParseValue(value, params.max_tilt);
+		else if (key == "blur")
+			valid = ParseValue(value, params.blur_sigma);
+		else if (key == "noise")
+			valid = ParseValue(value, params.noise_sigma);
+		else if (key == "distractors")
+			valid = ParseValue(value, params.number_distractors);
+		else if (key == "dot_diameter")
+			valid = ParseValue(value, params.pi_dot_diameter);
+		else if (key == "seed")
+			valid = ParseValue(value, params.seed);
+		else if (key == "cross_ratio_benchmark")
+			valid = ParseValue(value, cross_ratio_benchmark);
+		else if (key == "queries")
+			valid = ParseValue(value, number_queries);
+		else
+			valid = false;
+
+		if (valid == false)
+		{
+			std::cerr << "ERROR - fiducial_benchmark:" << std::endl;
+			std::cerr << "\t ... Unknown key or invalid value in '" << argument << "'" << std::endl;
+			return 1;
+		}
+	}
+
+	if (cross_ratio_benchmark == 0 && pi_model_filename.empty() && aruco_model_filename.empty())
+	{
+		std::cerr << "ERROR - fiducial_benchmark:" << std::endl;
+		std::cerr << "\t ... Specify at least one of pi_model=<file> and aruco_model=<file>" << std::endl;
+		return 1;
+	}
+
+	// Pinhole camera with the principal point in the image center, the default focal length gives a field of view of about 60 degrees
+	if (focal_length <= 0.)
+		focal_length = 0.85*params.image_size.width;
+	cv::Mat camera_matrix = cv::Mat::eye(3, 3, CV_64FC1);
+	camera_matrix.at<double>(0,0) = focal_length;
+	camera_matrix.at<double>(1,1) = focal_length;
+	camera_matrix.at<double>(0,2) = 0.5*(params.image_size.width-1);
+	camera_matrix.at<double>(1,2) = 0.5*(params.image_size.height-1);
+
+	FiducialTestingEnvironment environment(camera_matrix);
+	std::ofstream output_file;
+	if (output_filename.empty() == false)
+	{
+		output_file.open(output_filename.c_str());
+		if (output_file.is_open() == false)
+		{
+			std::cerr << "ERROR - fiducial_benchmark:" << std::endl;
+			std::cerr << "\t ... Could not open output file '" << output_filename << "'" << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& output = output_filename.empty() ? std::cout : output_file;
+
+	unsigned long ret_val = ipa_Utils::RET_OK;
+	if (cross_ratio_benchmark != 0)
+	{
+		std::vector<int> library_sizes;
+		for (int size=10; size<=100000; size*=10)
+			library_sizes.push_back(size);
+		ret_val = environment.CrossRatioIndexBenchmark(library_sizes, number_queries, params.seed, output);
+	}
+	else
+	{
+		ret_val = environment.FiducialBenchmark(pi_model_filename, aruco_model_filename, params, output);
+	}
+
+	return (ret_val & ipa_Utils::RET_FAILED) ? 1 : 0;
+}
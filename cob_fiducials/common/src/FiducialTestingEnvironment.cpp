@@ -4,14 +4,24 @@
 	#include "cob_fiducials/aruco/FiducialModelAruco.h"
 	#include "cob_fiducials/FiducialTestingEnvironment.h"
 
+	#include "cob_fiducials/aruco/arucofidmarkers.h"
+
 	#include <opencv/highgui.h>
+	#include <opencv2/imgproc/imgproc.hpp>
+	#include <opencv2/calib3d/calib3d.hpp>
 	#include <boost/progress.hpp>
 #else
 	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/pi/FiducialModelPi.h"
 	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/aruco/FiducialModelAruco.h"
 	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/FiducialTestingEnvironment.h"
+	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/aruco/arucofidmarkers.h"
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
 
 
 using namespace ipa_Fiducials;
@@ -147,6 +157,445 @@ unsigned long FiducialTestingEnvironment::FiducialTestPI()
 	return ipa_Utils::RET_OK;
 }
 
+unsigned long FiducialTestingEnvironment::FiducialBenchmark(const std::string& pi_model_filename, const std::string& aruco_model_filename,
+	const t_benchmark_parameters& params, std::ostream& output)
+{
+	output << "detector\timage\ttags\tdetected\tfalse_positives\tdetection_rate"
+		<< "\ttime_total\ttime_threshold\ttime_contours\ttime_ellipses\ttime_pairing\ttime_pose"
+		<< "\ttrans_error_mean\ttrans_error_max\trot_error_mean\trot_error_max" << std::endl;
+
+	if (!pi_model_filename.empty())
+	{
+		if (m_pi_tag->Init(m_camera_matrix, pi_model_filename, false) & ipa_Utils::RET_FAILED)
+			return ipa_Utils::RET_FAILED;
+		BenchmarkModel(*m_pi_tag, params, output);
+	}
+	if (!aruco_model_filename.empty())
+	{
+		if (m_aruco_tag->Init(m_camera_matrix, aruco_model_filename, false) & ipa_Utils::RET_FAILED)
+			return ipa_Utils::RET_FAILED;
+		BenchmarkModel(*m_aruco_tag, params, output);
+	}
+
+	return ipa_Utils::RET_OK;
+}
+
+namespace
+{
+
+/// Accumulated results of one or more benchmark scenes
+struct t_benchmark_result
+{
+	t_benchmark_result()
+		: tags(0), detected(0), false_positives(0), trans_error_sum(0.), trans_error_max(0.), rot_error_sum(0.), rot_error_max(0.)
+	{
+		for (int i=0; i<6; i++)
+			times[i] = 0.;
+	}
+
+	void add(const t_benchmark_result& other)
+	{
+		tags += other.tags;
+		detected += other.detected;
+		false_positives += other.false_positives;
+		trans_error_sum += other.trans_error_sum;
+		trans_error_max = std::max(trans_error_max, other.trans_error_max);
+		rot_error_sum += other.rot_error_sum;
+		rot_error_max = std::max(rot_error_max, other.rot_error_max);
+		for (int i=0; i<6; i++)
+			times[i] += other.times[i];
+	}
+
+	void write(std::ostream& output, const std::string& detector, const std::string& image, int number_images) const
+	{
+		double nan = std::numeric_limits<double>::quiet_NaN();
+		output << detector << "\t" << image << "\t" << tags << "\t" << detected << "\t" << false_positives
+			<< "\t" << (tags > 0 ? double(detected)/tags : nan);
+		for (int i=0; i<6; i++)
+			output << "\t" << times[i]/number_images;
+		output << "\t" << (detected > 0 ? trans_error_sum/detected : nan) << "\t" << trans_error_max
+			<< "\t" << (detected > 0 ? rot_error_sum/detected : nan) << "\t" << rot_error_max << std::endl;
+	}
+
+	int tags;
+	int detected;
+	int false_positives;
+	double times[6]; ///< total, threshold, contours, ellipses, pairing, pose [ms]
+	double trans_error_sum;
+	double trans_error_max;
+	double rot_error_sum;
+	double rot_error_max;
+};
+
+/// @return Rotation of <code>angle</code> [rad] around <code>axis</code>
+cv::Mat AxisAngle(double x, double y, double z, double angle)
+{
+	cv::Mat rodrigues = (cv::Mat_<double>(3,1) << x*angle, y*angle, z*angle);
+	cv::Mat rot;
+	cv::Rodrigues(rodrigues, rot);
+	return rot;
+}
+
+} // end anonymous namespace
+
+unsigned long FiducialTestingEnvironment::BenchmarkModel(AbstractFiducialModel& model, const t_benchmark_parameters& params, std::ostream& output)
+{
+	cv::RNG rng(params.seed);
+	FiducialModelPi* pi_model = dynamic_cast<FiducialModelPi*>(&model);
+	double nan = std::numeric_limits<double>::quiet_NaN();
+	double pi = 3.14159265359;
+
+	t_benchmark_result summary;
+	for (int n=0; n<params.number_images; n++)
+	{
+		cv::Mat image;
+		std::vector<t_pose> ground_truth;
+		if (RenderScene(model, params, rng, image, ground_truth) & ipa_Utils::RET_FAILED)
+			return ipa_Utils::RET_FAILED;
+
+		std::vector<t_pose> detections;
+		int64 start_tick = cv::getTickCount();
+		model.GetPose(image, detections);
+		double time_total = 1000.*(cv::getTickCount()-start_tick)/cv::getTickFrequency();
+
+		t_benchmark_result result;
+		result.tags = (int)ground_truth.size();
+		result.times[0] = time_total;
+		if (pi_model != NULL)
+		{
+			const t_pi_detection_statistics& statistics = pi_model->GetDetectionStatistics();
+			result.times[1] = statistics.time_threshold;
+			result.times[2] = statistics.time_contours;
+			result.times[3] = statistics.time_ellipses;
+			result.times[4] = statistics.time_pairing;
+			result.times[5] = statistics.time_pose;
+		}
+		else
+		{
+			for (int i=1; i<6; i++)
+				result.times[i] = nan;
+		}
+
+		// Match the detections to the rendered tags by id, every further detection is a false positive
+		std::vector<bool> matched(detections.size(), false);
+		for (size_t i=0; i<ground_truth.size(); i++)
+		{
+			for (size_t j=0; j<detections.size(); j++)
+			{
+				if (matched[j] || detections[j].id != ground_truth[i].id)
+					continue;
+				matched[j] = true;
+				result.detected++;
+
+				double trans_error = cv::norm(detections[j].trans - ground_truth[i].trans);
+				cv::Mat rot_difference = ground_truth[i].rot.t() * detections[j].rot;
+				double cos_angle = std::max(-1., std::min(1., 0.5*(cv::trace(rot_difference)[0]-1.)));
+				double rot_error = std::acos(cos_angle)*180./pi;
+
+				result.trans_error_sum += trans_error;
+				result.trans_error_max = std::max(result.trans_error_max, trans_error);
+				result.rot_error_sum += rot_error;
+				result.rot_error_max = std::max(result.rot_error_max, rot_error);
+				break;
+			}
+		}
+		for (size_t j=0; j<matched.size(); j++)
+			if (matched[j] == false)
+				result.false_positives++;
+
+		std::stringstream image_name;
+		image_name << n;
+		result.write(output, model.GetType(), image_name.str(), 1);
+		summary.add(result);
+	}
+	summary.write(output, model.GetType(), "all", std::max(1, params.number_images));
+
+	return ipa_Utils::RET_OK;
+}
+
+unsigned long FiducialTestingEnvironment::CrossRatioIndexBenchmark(const std::vector<int>& library_sizes, int number_queries,
+	unsigned int seed, std::ostream& output)
+{
+	// Tolerance of the line association in FiducialModelPi
+	double cross_ratio_max_dist = 0.03;
+	cv::RNG rng(seed);
+	bool all_equal = true;
+
+	output << "library_size\tqueries\ttime_linear_us_per_query\ttime_index_us_per_query\tspeedup\tmatches\tmismatches" << std::endl;
+	for (size_t n=0; n<library_sizes.size(); n++)
+	{
+		// Random tags with the relative dot positions of the model files, cross ratio 0 larger than cross ratio 1
+		std::vector<double> cross_ratios_0, cross_ratios_1;
+		while ((int)cross_ratios_0.size() < library_sizes[n])
+		{
+			double cross_ratio[2];
+			for (int l=0; l<2; l++)
+			{
+				double ab = rng.uniform(0.15, 0.5);
+				double ac = rng.uniform(ab+0.1, 0.85);
+				cross_ratio[l] = (ab/(1.-ab))/(ac/(1.-ac));
+			}
+			if (cross_ratio[0] < cross_ratio[1])
+				std::swap(cross_ratio[0], cross_ratio[1]);
+			if (cross_ratio[0]/cross_ratio[1] < 1.05)
+				continue;
+			cross_ratios_0.push_back(cross_ratio[0]);
+			cross_ratios_1.push_back(cross_ratio[1]);
+		}
+		CrossRatioIndex index;
+		index.Build(cross_ratios_0, cross_ratios_1);
+
+		std::vector<double> queries(number_queries);
+		for (int i=0; i<number_queries; i++)
+			queries[i] = rng.uniform(0., 1.);
+
+		// Linear search as in FiducialModelPi before the index
+		std::vector<std::vector<t_cross_ratio_match> > linear_matches(number_queries);
+		int64 start_tick = cv::getTickCount();
+		for (int i=0; i<number_queries; i++)
+		{
+			for (size_t j=0; j<cross_ratios_0.size(); j++)
+			{
+				t_cross_ratio_match match;
+				match.tag_index = (int)j;
+				if (std::abs(queries[i] - cross_ratios_0[j]) < cross_ratio_max_dist)
+					match.line_type = 0;
+				else if (std::abs(queries[i] - cross_ratios_1[j]) < cross_ratio_max_dist)
+					match.line_type = 1;
+				else
+					continue;
+				linear_matches[i].push_back(match);
+			}
+		}
+		double time_linear = 1000.*(cv::getTickCount()-start_tick)/cv::getTickFrequency();
+
+		std::vector<std::vector<t_cross_ratio_match> > index_matches(number_queries);
+		start_tick = cv::getTickCount();
+		for (int i=0; i<number_queries; i++)
+			index.Query(queries[i], cross_ratio_max_dist, index_matches[i]);
+		double time_index = 1000.*(cv::getTickCount()-start_tick)/cv::getTickFrequency();
+
+		// Both methods have to find the same (tag, line type) pairs
+		size_t matches = 0;
+		int mismatches = 0;
+		for (int i=0; i<number_queries; i++)
+		{
+			matches += linear_matches[i].size();
+			std::vector<std::pair<int, int> > linear_pairs, index_pairs;
+			for (size_t j=0; j<linear_matches[i].size(); j++)
+				linear_pairs.push_back(std::make_pair(linear_matches[i][j].tag_index, linear_matches[i][j].line_type));
+			for (size_t j=0; j<index_matches[i].size(); j++)
+				index_pairs.push_back(std::make_pair(index_matches[i][j].tag_index, index_matches[i][j].line_type));
+			std::sort(index_pairs.begin(), index_pairs.end());
+			if (linear_pairs != index_pairs)
+				mismatches++;
+		}
+		if (mismatches > 0)
+			all_equal = false;
+
+		double queries_per_us = std::max(1, number_queries)/1000.;
+		output << library_sizes[n] << "\t" << number_queries << "\t" << time_linear/queries_per_us << "\t" << time_index/queries_per_us
+			<< "\t" << (time_index > 0. ? time_linear/time_index : std::numeric_limits<double>::quiet_NaN())
+			<< "\t" << matches << "\t" << mismatches << std::endl;
+	}
+
+	if (all_equal == false)
+	{
+		std::cerr << "ERROR - FiducialTestingEnvironment::CrossRatioIndexBenchmark:" << std::endl;
+		std::cerr << "\t ... The cross ratio index and the linear search returned different matches" << std::endl;
+		return ipa_Utils::RET_FAILED;
+	}
+	return ipa_Utils::RET_OK;
+}
+
+bool FiducialTestingEnvironment::RenderTagTexture(AbstractFiducialModel& model, int marker_id, double pixels_per_meter,
+	const t_benchmark_parameters& params, t_tag_texture& texture)
+{
+	FiducialModelPi* pi_model = dynamic_cast<FiducialModelPi*>(&model);
+	FiducialModelAruco* aruco_model = dynamic_cast<FiducialModelAruco*>(&model);
+
+	if (pi_model != NULL)
+	{
+		// Black dots at the ellipse coordinates on white paper
+		const std::vector<t_pi>& ref_tags = pi_model->GetReferenceTags();
+		for (size_t i=0; i<ref_tags.size(); i++)
+		{
+			if (ref_tags[i].parameters.m_id != marker_id)
+				continue;
+
+			const std::vector<cv::Point2f>& marker_points = ref_tags[i].marker_points;
+			double tag_size = ref_tags[i].parameters.line_width_height;
+			double radius = 0.5*params.pi_dot_diameter*tag_size;
+			double margin = radius + 0.25*tag_size;
+			cv::Point2d min_point(marker_points[0].x, marker_points[0].y), max_point = min_point;
+			for (size_t j=0; j<marker_points.size(); j++)
+			{
+				min_point.x = std::min(min_point.x, (double)marker_points[j].x);
+				min_point.y = std::min(min_point.y, (double)marker_points[j].y);
+				max_point.x = std::max(max_point.x, (double)marker_points[j].x);
+				max_point.y = std::max(max_point.y, (double)marker_points[j].y);
+			}
+			double x0 = min_point.x - margin;
+			double y1 = max_point.y + margin;
+
+			int cols = cvCeil((max_point.x - min_point.x + 2*margin)*pixels_per_meter);
+			int rows = cvCeil((max_point.y - min_point.y + 2*margin)*pixels_per_meter);
+			texture.image = cv::Mat(rows, cols, CV_8UC3, cv::Scalar(255, 255, 255));
+			for (size_t j=0; j<marker_points.size(); j++)
+			{
+				cv::Point2d center((marker_points[j].x-x0)*pixels_per_meter, (y1-marker_points[j].y)*pixels_per_meter);
+				cv::circle(texture.image, cv::Point(cvRound(16*center.x), cvRound(16*center.y)), cvRound(16*radius*pixels_per_meter),
+					cv::Scalar(0, 0, 0), -1, CV_AA, 4);
+			}
+
+			// u to the right is +x, v downwards is -y
+			texture.marker_from_texture = (cv::Mat_<double>(3,3) << 1./pixels_per_meter, 0., x0, 0., -1./pixels_per_meter, y1, 0., 0., 1.);
+			texture.rot_fronto_parallel = (cv::Mat_<double>(3,3) << 1., 0., 0., 0., -1., 0., 0., 0., -1.);
+			texture.rot_reported_from_rendered = cv::Mat::eye(3, 3, CV_64FC1);
+			return true;
+		}
+		return false;
+	}
+
+	if (aruco_model != NULL)
+	{
+		double half_size;
+		cv::Point2d offset;
+		aruco_model->GetMarkerGeometry(marker_id, half_size, offset);
+		if (half_size <= 0.)
+			return false;
+
+		int marker_pixels = std::max(7, cvRound(2*half_size*pixels_per_meter));
+		int margin = marker_pixels/4 + 1;
+		cv::Mat marker;
+		try
+		{
+			marker = aruco::FiducidalMarkers::createMarkerImage(marker_id, marker_pixels);
+		}
+		catch (cv::Exception&)
+		{
+			return false;
+		}
+		cv::Mat marker_color;
+		cv::cvtColor(marker, marker_color, CV_GRAY2BGR);
+		texture.image = cv::Mat(marker_pixels+2*margin, marker_pixels+2*margin, CV_8UC3, cv::Scalar(255, 255, 255));
+		cv::Mat marker_area = texture.image(cv::Rect(margin, margin, marker_pixels, marker_pixels));
+		marker_color.copyTo(marker_area);
+
+		// The detector assigns the upper left marker corner to (-h,-h) and the upper right one to (-h,h),
+		// i.e. u to the right is +y and v downwards is +x
+		double scale = 2*half_size/marker_pixels;
+		texture.marker_from_texture = (cv::Mat_<double>(3,3) << 0., scale, -half_size + offset.x - margin*scale,
+			scale, 0., -half_size + offset.y - margin*scale, 0., 0., 1.);
+		texture.rot_fronto_parallel = (cv::Mat_<double>(3,3) << 0., 1., 0., 1., 0., 0., 0., 0., -1.);
+		// The detector rotates the reported frame so that y is perpendicular to the marker plane
+		texture.rot_reported_from_rendered = (cv::Mat_<double>(3,3) << 1., 0., 0., 0., 0., -1., 0., 1., 0.);
+		return true;
+	}
+
+	return false;
+}
+
+unsigned long FiducialTestingEnvironment::RenderScene(AbstractFiducialModel& model, const t_benchmark_parameters& params, cv::RNG& rng,
+	cv::Mat& image, std::vector<t_pose>& ground_truth)
+{
+	double pi = 3.14159265359;
+	double fx = m_camera_matrix.at<double>(0,0);
+	double fy = m_camera_matrix.at<double>(1,1);
+	double cx = m_camera_matrix.at<double>(0,2);
+	double cy = m_camera_matrix.at<double>(1,2);
+
+	// Background with ellipse-like clutter
+	image = cv::Mat(params.image_size, CV_8UC3, cv::Scalar(190, 190, 190));
+	int max_axis = std::max(3, params.image_size.width/30);
+	for (int i=0; i<params.number_distractors; i++)
+	{
+		cv::Point center(rng.uniform(0, params.image_size.width), rng.uniform(0, params.image_size.height));
+		cv::Size axes(rng.uniform(2, max_axis), rng.uniform(2, max_axis));
+		int gray = rng.uniform(0, 90);
+		cv::ellipse(image, center, axes, rng.uniform(0., 180.), 0., 360., cv::Scalar(gray, gray, gray), -1, CV_AA);
+	}
+
+	// Tags at random, non-overlapping poses
+	std::vector<int> marker_ids = model.GetMarkerIds();
+	for (size_t i=marker_ids.size(); i>1; i--)
+		std::swap(marker_ids[i-1], marker_ids[rng.uniform(0, (int)i)]);
+
+	ground_truth.clear();
+	std::vector<cv::Rect> occupied;
+	cv::Rect image_rect(0, 0, params.image_size.width, params.image_size.height);
+	for (size_t k=0; k<marker_ids.size() && (int)ground_truth.size()<params.tags_per_image; k++)
+	{
+		for (int attempt=0; attempt<50; attempt++)
+		{
+			// Position of the tag center
+			double z = rng.uniform(params.min_distance, params.max_distance);
+			double u = rng.uniform(0.15, 0.85)*params.image_size.width;
+			double v = rng.uniform(0.15, 0.85)*params.image_size.height;
+			cv::Mat center_C = (cv::Mat_<double>(3,1) << (u-cx)*z/fx, (v-cy)*z/fy, z);
+
+			// The texture resolution follows the projected size to avoid aliasing
+			t_tag_texture texture;
+			if (RenderTagTexture(model, marker_ids[k], 2.*fx/z, params, texture) == false)
+				break;
+
+			// In-plane rotation and tilt around a random axis in the image plane
+			double tilt_axis = rng.uniform(0., 2*pi);
+			cv::Mat rot_CfromO = AxisAngle(std::cos(tilt_axis), std::sin(tilt_axis), 0., rng.uniform(0., params.max_tilt)*pi/180.) *
+				AxisAngle(0., 0., 1., rng.uniform(0., 2*pi)) * texture.rot_fronto_parallel;
+
+			cv::Mat texture_center = (cv::Mat_<double>(3,1) << 0.5*texture.image.cols, 0.5*texture.image.rows, 1.);
+			cv::Mat center_O = texture.marker_from_texture * texture_center;
+			center_O.at<double>(2) = 0.;
+			cv::Mat trans_CfromO = center_C - rot_CfromO*center_O;
+
+			// Homography from texture pixels to image pixels
+			cv::Mat projection(3, 3, CV_64FC1);
+			rot_CfromO.col(0).copyTo(projection.col(0));
+			rot_CfromO.col(1).copyTo(projection.col(1));
+			trans_CfromO.copyTo(projection.col(2));
+			cv::Mat homography = m_camera_matrix * projection * texture.marker_from_texture;
+
+			std::vector<cv::Point2f> corners(4), image_corners;
+			corners[1] = cv::Point2f((float)texture.image.cols, 0.f);
+			corners[2] = cv::Point2f((float)texture.image.cols, (float)texture.image.rows);
+			corners[3] = cv::Point2f(0.f, (float)texture.image.rows);
+			cv::perspectiveTransform(corners, image_corners, homography);
+			cv::Rect bounding_box = cv::boundingRect(image_corners);
+			bool valid = (bounding_box & image_rect) == bounding_box;
+			for (size_t j=0; j<occupied.size() && valid; j++)
+				valid = (bounding_box & occupied[j]).area() == 0;
+			if (valid == false)
+				continue;
+
+			cv::warpPerspective(texture.image, image, homography, image.size(), cv::INTER_LINEAR, cv::BORDER_TRANSPARENT);
+			occupied.push_back(bounding_box);
+
+			t_pose pose;
+			pose.id = marker_ids[k];
+			pose.rot = rot_CfromO * texture.rot_reported_from_rendered;
+			pose.trans = trans_CfromO;
+			ground_truth.push_back(pose);
+			break;
+		}
+	}
+
+	// Imaging effects
+	if (params.blur_sigma > 0.)
+		cv::GaussianBlur(image, image, cv::Size(0, 0), params.blur_sigma);
+	if (params.noise_sigma > 0.)
+	{
+		cv::Mat noise(image.size(), CV_16SC3);
+		rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(params.noise_sigma));
+		cv::Mat noisy_image;
+		image.convertTo(noisy_image, CV_16SC3);
+		noisy_image += noise;
+		noisy_image.convertTo(image, CV_8UC3);
+	}
+
+	return ipa_Utils::RET_OK;
+}
+
 unsigned long FiducialTestingEnvironment::RenderPose(cv::Mat& image, cv::Mat& rot_3x3_CfromO, cv::Mat& trans_3x1_CfromO)
 {
 	cv::Mat object_center(3, 1, CV_64FC1);
@@ -0,0 +1,168 @@
+#include <cob_vision_utils/StdAfx.h>
+
+#ifdef __LINUX__
+	#include "cob_fiducials/TiledImageProcessing.h"
+	#include <opencv2/imgproc/imgproc.hpp>
+#else
+	#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/TiledImageProcessing.h"
+#endif
+
+#include <algorithm>
+
+using namespace ipa_Fiducials;
+
+namespace
+{
+
+/// Splits the image into square tiles of the given size, the tiles at the right and bottom border may be smaller
+void ComputeTiles(const cv::Size& image_size, int tile_size, std::vector<cv::Rect>& tiles)
+{
+	tiles.clear();
+	for (int y=0; y<image_size.height; y+=tile_size)
+		for (int x=0; x<image_size.width; x+=tile_size)
+			tiles.push_back(cv::Rect(x, y, std::min(tile_size, image_size.width-x), std::min(tile_size, image_size.height-y)));
+}
+
+class AdaptiveThresholdBody : public cv::ParallelLoopBody
+{
+public:
+	AdaptiveThresholdBody(const cv::Mat& src, cv::Mat& dst, const std::vector<cv::Rect>& tiles, double max_value,
+		int adaptive_method, int threshold_type, int block_size, double c)
+		: m_src(src), m_dst(dst), m_tiles(tiles), m_max_value(max_value), m_adaptive_method(adaptive_method),
+		  m_threshold_type(threshold_type), m_block_size(block_size), m_c(c)
+	{
+	}
+
+	void operator()(const cv::Range& range) const
+	{
+		cv::Rect image_rect(0, 0, m_src.cols, m_src.rows);
+		int border = m_block_size/2;
+		for (int i=range.start; i<range.end; i++)
+		{
+			// The extended tile provides the full filter support for every pixel of the tile
+			const cv::Rect& tile = m_tiles[i];
+			cv::Rect extended_tile = cv::Rect(tile.x-border, tile.y-border, tile.width+2*border, tile.height+2*border) & image_rect;
+
+			cv::Mat extended_dst;
+			cv::adaptiveThreshold(m_src(extended_tile), extended_dst, m_max_value, m_adaptive_method, m_threshold_type, m_block_size, m_c);
+
+			cv::Mat dst_tile = m_dst(tile);
+			extended_dst(cv::Rect(tile.x-extended_tile.x, tile.y-extended_tile.y, tile.width, tile.height)).copyTo(dst_tile);
+		}
+	}
+
+private:
+	const cv::Mat& m_src;
+	cv::Mat& m_dst;
+	const std::vector<cv::Rect>& m_tiles;
+	double m_max_value;
+	int m_adaptive_method;
+	int m_threshold_type;
+	int m_block_size;
+	double m_c;
+};
+
+class FindContoursBody : public cv::ParallelLoopBody
+{
+public:
+	FindContoursBody(const cv::Mat& binary, const std::vector<cv::Rect>& tiles, int max_contour_extent,
+		std::vector<std::vector<std::vector<cv::Point> > >& tile_contours)
+		: m_binary(binary), m_tiles(tiles), m_max_contour_extent(max_contour_extent), m_tile_contours(tile_contours)
+	{
+	}
+
+	void operator()(const cv::Range& range) const
+	{
+		cv::Rect image_rect(0, 0, m_binary.cols, m_binary.rows);
+		for (int i=range.start; i<range.end; i++)
+		{
+			// findContours ignores the outermost pixels of its input, so the search region starts two pixels before the tile
+			const cv::Rect& tile = m_tiles[i];
+			cv::Rect search_region = cv::Rect(tile.x-2, tile.y-2, tile.width+m_max_contour_extent+4, tile.height+m_max_contour_extent+4) & image_rect;
+
+			// findContours modifies its input and the search regions overlap
+			cv::Mat search_image = m_binary(search_region).clone();
+			std::vector<std::vector<cv::Point> > contours;
+			cv::findContours(search_image, contours, CV_RETR_LIST, CV_CHAIN_APPROX_NONE, search_region.tl());
+
+			// Keep the contours owned by this tile which are not cut by the border of the search region
+			int max_x = (search_region.br().x < image_rect.width) ? search_region.br().x-2 : image_rect.width;
+			int max_y = (search_region.br().y < image_rect.height) ? search_region.br().y-2 : image_rect.height;
+			std::vector<std::vector<cv::Point> >& kept = m_tile_contours[i];
+			kept.clear();
+			for (size_t j=0; j<contours.size(); j++)
+			{
+				cv::Rect bounding_box = cv::boundingRect(contours[j]);
+				if (tile.contains(bounding_box.tl()) && bounding_box.br().x <= max_x && bounding_box.br().y <= max_y)
+				{
+					kept.push_back(std::vector<cv::Point>());
+					kept.back().swap(contours[j]);
+				}
+			}
+		}
+	}
+
+private:
+	const cv::Mat& m_binary;
+	const std::vector<cv::Rect>& m_tiles;
+	int m_max_contour_extent;
+	std::vector<std::vector<std::vector<cv::Point> > >& m_tile_contours;
+};
+
+} // end anonymous namespace
+
+void ipa_Fiducials::TiledAdaptiveThreshold(const cv::Mat& src, cv::Mat& dst, double max_value, int adaptive_method,
+	int threshold_type, int block_size, double c, int tile_size)
+{
+	if (tile_size <= 0 || (src.cols <= tile_size && src.rows <= tile_size))
+	{
+		cv::adaptiveThreshold(src, dst, max_value, adaptive_method, threshold_type, block_size, c);
+		return;
+	}
+
+	std::vector<cv::Rect> tiles;
+	ComputeTiles(src.size(), tile_size, tiles);
+
+	// The tiles read beyond their own area, so a separate destination is needed if src and dst share their data.
+	// Otherwise the memory of dst is reused.
+	cv::Mat result;
+	if (dst.datastart != NULL && dst.datastart == src.datastart)
+		result.create(src.size(), CV_8UC1);
+	else
+	{
+		dst.create(src.size(), CV_8UC1);
+		result = dst;
+	}
+	cv::parallel_for_(cv::Range(0, (int)tiles.size()),
+		AdaptiveThresholdBody(src, result, tiles, max_value, adaptive_method, threshold_type, block_size, c));
+	dst = result;
+}
+
+void ipa_Fiducials::TiledFindContours(cv::Mat& binary, std::vector<std::vector<cv::Point> >& contours,
+	int max_contour_extent, int tile_size)
+{
+	contours.clear();
+	if (tile_size <= 0 || (binary.cols <= tile_size && binary.rows <= tile_size))
+	{
+		cv::findContours(binary, contours, CV_RETR_LIST, CV_CHAIN_APPROX_NONE);
+		return;
+	}
+
+	std::vector<cv::Rect> tiles;
+	ComputeTiles(binary.size(), tile_size, tiles);
+
+	std::vector<std::vector<std::vector<cv::Point> > > tile_contours(tiles.size());
+	cv::parallel_for_(cv::Range(0, (int)tiles.size()),
+		FindContoursBody(binary, tiles, std::max(0, max_contour_extent), tile_contours));
+
+	size_t number_contours = 0;
+	for (size_t i=0; i<tile_contours.size(); i++)
+		number_contours += tile_contours[i].size();
+	contours.reserve(number_contours);
+	for (size_t i=0; i<tile_contours.size(); i++)
+		for (size_t j=0; j<tile_contours[i].size(); j++)
+		{
+			contours.push_back(std::vector<cv::Point>());
+			contours.back().swap(tile_contours[i][j]);
+		}
+}
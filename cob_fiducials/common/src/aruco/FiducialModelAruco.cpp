@@ -21,6 +21,7 @@ FiducialModelAruco::FiducialModelAruco()
 
 	//Configure detector
 	m_detector = boost::shared_ptr<aruco::MarkerDetector>(new aruco::MarkerDetector());
+	m_detector->setTileSize(m_tile_size);
 	if (pyrDownLevels>0)
 		m_detector->pyrDown(pyrDownLevels);
 
@@ -42,14 +43,27 @@ FiducialModelAruco::~FiducialModelAruco()
 }
 
 
+void FiducialModelAruco::GetMarkerGeometry(int marker_id, double& half_size, cv::Point2d& offset)
+{
+	half_size = m_marker_size/2.;
+	offset = cv::Point2d(0.0, 0.0);
+
+	// Local parameters
+	if (marker_id >= 0 && marker_id < (int)m_tag_parameters.size() && m_tag_parameters[marker_id].m_isInit != 0)
+	{
+		offset = m_tag_parameters[marker_id].m_offset;
+		half_size = m_tag_parameters[marker_id].m_line_width_height;
+	}
+}
+
 unsigned long FiducialModelAruco::GetPose(cv::Mat& image, std::vector<t_pose>& vec_pose)
 {
 	std::vector<aruco::Marker> markers;
 	aruco::CameraParameters camera_parameters;
 	camera_parameters.setParams(GetCameraMatrix(), GetDistortionCoeffs(), image.size());
 
-	m_detector = boost::shared_ptr<aruco::MarkerDetector>(new aruco::MarkerDetector());
-
+	// The detector is kept across calls, so its internal gray and threshold images are reused
+	m_detector->setTileSize(m_tile_size);
 
 	try
 	{
@@ -69,15 +83,9 @@ unsigned long FiducialModelAruco::GetPose(cv::Mat& image, std::vector<t_pose>& v
 		int id = markers[i].id;
 		cv::Mat pattern_coords(nPoints, 3, CV_32F);
 		cv::Mat image_coords(nPoints, 2, CV_32F);
-		double halfSize=m_marker_size/2.;
-		cv::Point2d offset(0.0, 0.0); 
-
-		// Local parameters
-		if (m_tag_parameters[id].m_isInit != 0)
-		{
-			offset = m_tag_parameters[id].m_offset;
-			halfSize = m_tag_parameters[id].m_line_width_height;
-		}
+		double halfSize;
+		cv::Point2d offset;
+		GetMarkerGeometry(id, halfSize, offset);
 
 		pattern_coords.at<float>(1,0)=-halfSize + offset.x;
 		pattern_coords.at<float>(1,1)=halfSize + offset.y;
@@ -224,6 +232,17 @@ unsigned long FiducialModelAruco::LoadParameters(std::string directory_and_filen
 		if ( p_xmlElement_Root )
 		{
 
+//************************************************************************************
+//	BEGIN FiducialDetector->TileSize (optional)
+//************************************************************************************
+
+			if (LoadTileSize(p_xmlElement_Root) & ipa_Utils::RET_FAILED)
+				return ipa_Utils::RET_FAILED;
+
+//************************************************************************************
+//	END FiducialDetector->TileSize
+//************************************************************************************
+
 //************************************************************************************
 //	BEGIN FiducialDetector->Aruco
 //************************************************************************************
@@ -29,6 +29,7 @@ or implied, of Rafael Muñoz Salinas.
 #ifdef __LINUX__
 #include "cob_fiducials/aruco/markerdetector.h"
 #include "cob_fiducials/aruco/arucofidmarkers.h"
+#include "cob_fiducials/TiledImageProcessing.h"
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <iostream>
@@ -36,6 +37,7 @@ or implied, of Rafael Muñoz Salinas.
 #else
 #include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/aruco/markerdetector.h"
 #include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/aruco/arucofidmarkers.h"
+#include "cob_object_perception/cob_fiducials/common/include/cob_fiducials/TiledImageProcessing.h"
 #endif
 
 
@@ -57,6 +59,7 @@ MarkerDetector::MarkerDetector()
     _enableCylinderWarp=false;
     _thresMethod=ADPT_THRES;
     _thresParam1=_thresParam2=7;
+    _tileSize=0;
     _cornerMethod=LINES;
     _markerWarpSize=56;
     _speed=0;
@@ -129,7 +132,11 @@ void MarkerDetector::detect ( const cv::Mat &input,vector<Marker> &detectedMarke
 
 
     //it must be a 3 channel image
-    if ( input.type() ==CV_8UC3 ) cv::cvtColor ( input,grey,CV_BGR2GRAY );
+    //the conversion buffer never shares its data with the input, so a gray input of a previous call is not overwritten
+    if ( input.type() ==CV_8UC3 ) {
+        cv::cvtColor ( input,greyBuffer,CV_BGR2GRAY );
+        grey=greyBuffer;
+    }
     else grey=input;
 
 
@@ -283,10 +290,10 @@ void MarkerDetector::detectRectangles(const cv::Mat &thresImg,vector<MarkerCandi
     int minSize=_minSize*std::max(thresImg.cols,thresImg.rows)*1;//4;
     int maxSize=_maxSize*std::max(thresImg.cols,thresImg.rows)*1;//4;
     std::vector<std::vector<cv::Point> > contours2;
-    std::vector<cv::Vec4i> hierarchy2;
 
     thresImg.copyTo ( thres2 );
-    cv::findContours ( thres2 , contours2, hierarchy2,CV_RETR_TREE, CV_CHAIN_APPROX_NONE );
+    //a closed contour has at least twice as many points as its extent, so larger contours are rejected anyway
+    ipa_Fiducials::TiledFindContours ( thres2 , contours2, maxSize/2+1, _tileSize );
     vector<Point> approxCurve;
     ///for each contour, analyze if it is a paralelepiped likely to be the marker
 
@@ -303,13 +310,6 @@ void MarkerDetector::detectRectangles(const cv::Mat &thresImg,vector<MarkerCandi
             //check that the poligon has 4 points
             if ( approxCurve.size() ==4 )
             {
-                                cv::Mat out;
-                                cv::Mat in[] = {thresImg, thresImg, thresImg};
-                                cv::merge(in, 3, out);
-                                  drawContour(out,contours2[i],Scalar(255,0,225));
-                                  //namedWindow("input");
-                                  //imshow("input",input);
-                                   //waitKey(0);
                 //and is convex
                 if ( isContourConvex ( Mat ( approxCurve ) ) )
                 {
@@ -435,7 +435,7 @@ void MarkerDetector::thresHold ( int method,const Mat &grey,Mat &out,double para
         if ( param1<3 ) param1=3;
         else if ( ( ( int ) param1 ) %2 !=1 ) param1= ( int ) ( param1+1 );
 
-        cv::adaptiveThreshold ( grey,out,255,ADAPTIVE_THRESH_MEAN_C,THRESH_BINARY_INV,param1,param2 );
+        ipa_Fiducials::TiledAdaptiveThreshold ( grey,out,255,ADAPTIVE_THRESH_MEAN_C,THRESH_BINARY_INV,param1,param2,_tileSize );
         break;
     case CANNY:
     {
@@ -11,10 +11,25 @@
 
 using namespace ipa_Fiducials;
 
+namespace
+{
+/// @return Milliseconds since <code>tick</code>, which is reset to the current tick count
+double ElapsedMilliseconds(int64& tick)
+{
+		int64 now = cv::getTickCount();
+		double elapsed = 1000.*(now-tick)/cv::getTickFrequency();
+		tick = now;
+		return elapsed;
+}
+}
+
 
 FiducialModelPi::FiducialModelPi()
 {
-				
+		m_max_line_length_factor = 25;
+		m_coarse_max_image_width = 0;
+		m_coarse_roi_padding = 0.5;
+		m_pixel_scale = 1.;
 }
 
 FiducialModelPi::~FiducialModelPi()
@@ -25,25 +40,96 @@ FiducialModelPi::~FiducialModelPi()
 
 unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_pose)
 {
+		ResetDetectionStatistics();
+		return DetectPosesFullImage(image, vec_pose);
+}
+
+void FiducialModelPi::ResetDetectionStatistics()
+{
+		m_detection_statistics.reset();
+}
+
+unsigned long FiducialModelPi::DetectPosesFullImage(cv::Mat& image, std::vector<t_pose>& vec_pose)
+{
+		if (m_coarse_max_image_width > 0 && image.cols > m_coarse_max_image_width)
+				return GetPoseCoarseToFine(image, vec_pose);
+		return DetectPoses(image, vec_pose);
+}
+
+unsigned long FiducialModelPi::GetPoseCoarseToFine(cv::Mat& image, std::vector<t_pose>& vec_pose)
+{
+		// ------------ Downsample until the width limit is met --------------------
+		// The pyramid levels are kept across calls, so their memory is only allocated once
+		cv::Mat coarse_image = image;
+		int scale = 1;
+		size_t level = 0;
+		while (coarse_image.cols > m_coarse_max_image_width)
+		{
+				if (level == m_pyramid_levels.size())
+						m_pyramid_levels.push_back(cv::Mat());
+				cv::pyrDown(coarse_image, m_pyramid_levels[level]);
+				coarse_image = m_pyramid_levels[level];
+				level++;
+				scale *= 2;
+		}
+
+		// ------------ Detect tag candidates on the coarse level --------------------
+		// Pixel centers of the coarse level lie at (scale*u + (scale-1)/2) in the full image
+		cv::Mat camera_matrix = GetCameraMatrix();
+		cv::Mat coarse_camera_matrix = camera_matrix.clone();
+		coarse_camera_matrix.at<double>(0,0) /= scale;
+		coarse_camera_matrix.at<double>(1,1) /= scale;
+		coarse_camera_matrix.at<double>(0,2) = (coarse_camera_matrix.at<double>(0,2) - 0.5*(scale-1)) / scale;
+		coarse_camera_matrix.at<double>(1,2) = (coarse_camera_matrix.at<double>(1,2) - 0.5*(scale-1)) / scale;
+		SetCameraMatrix(coarse_camera_matrix);
+		std::vector<t_pose> vec_coarse_pose;
+		DetectPoses(coarse_image, vec_coarse_pose);
+		SetCameraMatrix(camera_matrix);
+
+		// ------------ Refine in full resolution regions --------------------
+		std::vector<cv::Rect> rois;
+		for (size_t i=0; i<m_tag_image_regions.size(); i++)
+		{
+				const cv::Rect& region = m_tag_image_regions[i];
+				int padding = cvCeil(m_coarse_roi_padding*std::max(region.width, region.height)*scale) + scale;
+				rois.push_back(cv::Rect(region.x*scale - padding, region.y*scale - padding,
+						region.width*scale + 2*padding, region.height*scale + 2*padding));
+		}
+		if (rois.empty())
+				return ipa_Utils::RET_FAILED;
+
+		// The pixel sizes of the detector are tuned for the coarse level, they grow with the resolution
+		m_pixel_scale = scale;
+		unsigned long ret = GetPoseInRegions(image, rois, vec_pose);
+		m_pixel_scale = 1.;
+		return ret;
+}
+
+unsigned long FiducialModelPi::DetectPoses(cv::Mat& image, std::vector<t_pose>& vec_pose)
+{
+		cv::Mat gray_image;
 		cv::Mat src_mat_8U1;
 		bool debug = false;
 		if (debug)
 				m_debug_img = image.clone();
+		m_tag_image_regions.assign(vec_pose.size(), cv::Rect());
+		int64 stage_tick = cv::getTickCount();
 
 // ------------ Convert image to gray scale if necessary -------------------
+		// Gray input is used directly, the input image is never written to
 		if (image.channels() == 3)
 		{
-				src_mat_8U1.create(image.rows, image.cols, CV_8UC1);
-				cv::cvtColor(image, src_mat_8U1, CV_RGB2GRAY );
+				cv::cvtColor(image, m_gray_image, CV_RGB2GRAY );
+				gray_image = m_gray_image;
 		}
 		else
 		{
-				src_mat_8U1 = image;
+				gray_image = image;
 		}
 
 		if (debug)
 		{
-				cv::imshow("00 Grayscale", src_mat_8U1);
+				cv::imshow("00 Grayscale", gray_image);
 				cv::waitKey(10);
 		}
 
@@ -53,7 +139,7 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 				// Divide the image by its morphologically closed counterpart
 				cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(19,19));
 				cv::Mat closed;
-				cv::morphologyEx(src_mat_8U1, closed, cv::MORPH_CLOSE, kernel);
+				cv::morphologyEx(gray_image, closed, cv::MORPH_CLOSE, kernel);
 
 				if (debug)
 				{
@@ -61,14 +147,15 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 						cv::waitKey(10);
 				}
 
-				src_mat_8U1.convertTo(src_mat_8U1, CV_32F); // divide requires floating-point
-				cv::divide(src_mat_8U1, closed, src_mat_8U1, 1, CV_32F);
-				cv::normalize(src_mat_8U1, src_mat_8U1, 0, 255, cv::NORM_MINMAX);
-				src_mat_8U1.convertTo(src_mat_8U1, CV_8UC1); // convert back to unsigned int
+				cv::Mat filtered;
+				gray_image.convertTo(filtered, CV_32F); // divide requires floating-point
+				cv::divide(filtered, closed, filtered, 1, CV_32F);
+				cv::normalize(filtered, filtered, 0, 255, cv::NORM_MINMAX);
+				filtered.convertTo(gray_image, CV_8UC1); // convert back to unsigned int
 
 				if (debug)
 				{
-						cv::imshow("11 filtering divide", src_mat_8U1);
+						cv::imshow("11 filtering divide", gray_image);
 						cv::waitKey(10);
 				}
 		}
@@ -82,8 +169,11 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 			minus_c = 11;
 			half_kernel_size = 5;
 		}        
-		cv::adaptiveThreshold(src_mat_8U1, src_mat_8U1, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C,
-				cv::THRESH_BINARY, 2*half_kernel_size+1, minus_c);
+		half_kernel_size = cvRound(half_kernel_size*m_pixel_scale);
+		TiledAdaptiveThreshold(gray_image, m_binary_image, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C,
+				cv::THRESH_BINARY, 2*half_kernel_size+1, minus_c, m_tile_size);
+		src_mat_8U1 = m_binary_image;
+		m_detection_statistics.time_threshold += ElapsedMilliseconds(stage_tick);
 
 		if (debug)
 		{
@@ -93,7 +183,11 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 
 // ------------ Contour extraction --------------------------------------
 		std::vector<std::vector<cv::Point> > contours;
-		cv::findContours(src_mat_8U1, contours, CV_RETR_LIST, CV_CHAIN_APPROX_NONE);
+		// Ellipses larger than a fifth of the image are rejected below, so larger contours may be missed at tile seams
+		int max_contour_extent = cvCeil(0.25*std::min(src_mat_8U1.rows, src_mat_8U1.cols));
+		TiledFindContours(src_mat_8U1, contours, max_contour_extent, m_tile_size);
+		m_detection_statistics.contours += contours.size();
+		m_detection_statistics.time_contours += ElapsedMilliseconds(stage_tick);
 
 		if (debug)
 		{
@@ -114,6 +208,7 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 			min_ellipse_size = 5;
 			max_ellipse_aspect_ratio = 15;
 		}
+		min_ellipse_size = cvRound(min_ellipse_size*m_pixel_scale);
 		
 		std::vector<cv::RotatedRect> ellipses;
 		for(size_t i = 0; i < contours.size(); i++)
@@ -146,7 +241,7 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 
 					double ellipse_aspect_ratio = box.size.height/box.size.width;
 					if(box.size.height > box.size.width) ellipse_aspect_ratio = 1/ellipse_aspect_ratio;
-					if(box.size.area() > 200 && ellipse_aspect_ratio < 0.1)
+					if(box.size.area() > 200*m_pixel_scale*m_pixel_scale && ellipse_aspect_ratio < 0.1)
 						continue;
 
 					//order ellipses in ascending order with respect to size
@@ -178,26 +273,23 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 				if (add_ellipse)
 					ellipses.push_back(box);
 		}
+		m_detection_statistics.time_ellipses += ElapsedMilliseconds(stage_tick);
 
 		//Fast Pi Tag
 		std::vector<cv::Point2i> points;
 		std::vector<cv::Rect> rois;
-		cv::Mat ellipsevoting(src_mat_8U1.rows,src_mat_8U1.cols,CV_32FC1);
-		cv::Mat ellipsedensity(src_mat_8U1.rows,src_mat_8U1.cols,CV_8UC1);
+		cv::Mat& ellipsevoting = m_ellipse_voting;
+		cv::Mat& ellipsedensity = m_ellipse_density;
 
 		if(m_use_fast_pi_tag)
 		{
 			std::vector<size_t> badellipses;
 
 			//Fil cv::Mat with -1
-			for(int i = 0; i < ellipsevoting.rows; i++)
-			{
-				for(int j = 0; j < ellipsevoting.cols; j++)
-				{
-					ellipsevoting.at<float> (i,j) = -1;
-					ellipsedensity.at<unsigned char> (i,j) = 0;
-				}
-			}
+			ellipsevoting.create(src_mat_8U1.rows,src_mat_8U1.cols,CV_32FC1);
+			ellipsedensity.create(src_mat_8U1.rows,src_mat_8U1.cols,CV_8UC1);
+			ellipsevoting.setTo(cv::Scalar(-1));
+			ellipsedensity.setTo(cv::Scalar(0));
 
 
 			//ellipse density voting
@@ -472,6 +564,14 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 		//FASTPITAG: For FASTPITAG the number of loop excecutions is based on the number of rois
 		std::vector<cv::RotatedRect> ellipses_copy(ellipses);
 		bool once = true;
+		m_detection_statistics.ellipses += ellipses.size();
+		m_detection_statistics.rois += rois.size();
+
+		// Index the ellipse cloud, so that each roi only visits the ellipses in its own area
+		EllipseGrid roi_grid;
+		std::vector<int> roi_ellipses;
+		if (m_use_fast_pi_tag)
+			roi_grid.Build(ellipses_copy, 0.05f*std::max(src_mat_8U1.cols, src_mat_8U1.rows));
 		
 		for(size_t n = 0; n < points.size() || (!m_use_fast_pi_tag && once); n++){ //Each point is the center of a roi
 			once = false;
@@ -479,16 +579,13 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 			if(m_use_fast_pi_tag){
 				ellipses.clear();
 				//prepare ellipse cloud for marker detection
-				for(size_t m = 0; m < ellipses_copy.size(); m++){
-					if(rois[n].x < ellipses_copy[m].center.x &&
-							ellipses_copy[m].center.x < rois[n].x + rois[n].width &&
-							rois[n].y < ellipses_copy[m].center.y &&
-							ellipses_copy[m].center.y < rois[n].y + rois[n].height ){
-						//ellipses size is 10*smaller than roi
-						double factor = 0.05;
-						if((int)ellipses_copy[m].size.width*ellipses_copy[m].size.height < (int)rois[n].width*rois[n].height*factor){
-							ellipses.push_back(ellipses_copy[m]);
-						}
+				roi_grid.QueryRect(rois[n], roi_ellipses);
+				for(size_t r = 0; r < roi_ellipses.size(); r++){
+					size_t m = roi_ellipses[r];
+					//ellipses size is 10*smaller than roi
+					double factor = 0.05;
+					if((int)ellipses_copy[m].size.width*ellipses_copy[m].size.height < (int)rois[n].width*rois[n].height*factor){
+						ellipses.push_back(ellipses_copy[m]);
 					}
 				}
 			}
@@ -514,10 +611,38 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 			}
 			//FPITAG
 
+			// A marker side spans at most m_max_line_length_factor ellipse sizes, so the end point j and
+			// the inner points k, l of a line starting at ellipse i are searched in the neighborhood of i only.
+			// Inner points may lie up to the line tolerance beyond the end point.
+			double max_line_tolerance = 2.0;
+			std::vector<double> search_radius(ellipses.size());
 			for(unsigned int i = 0; i < ellipses.size(); i++)
 			{
-				for(unsigned int j = i+1; j < ellipses.size(); j++)
+				search_radius[i] = m_max_line_length_factor * ref_A[i];
+				max_line_tolerance = std::max(max_line_tolerance, (double)std::sqrt(std::min(ellipses[i].size.height, ellipses[i].size.width)));
+			}
+			float grid_cell_size = 1.f;
+			if (!search_radius.empty())
+			{
+				std::vector<double> sorted_radius(search_radius);
+				std::nth_element(sorted_radius.begin(), sorted_radius.begin() + sorted_radius.size()/2, sorted_radius.end());
+				grid_cell_size = (float)sorted_radius[sorted_radius.size()/2];
+			}
+			EllipseGrid ellipse_grid;
+			ellipse_grid.Build(ellipses, grid_cell_size);
+			std::vector<int> neighbors;
+
+			for(unsigned int i = 0; i < ellipses.size(); i++)
+			{
+				m_detection_statistics.grid_entries_visited +=
+					ellipse_grid.QueryRadius(ellipses[i].center, search_radius[i] + max_line_tolerance, neighbors);
+
+				for(size_t n_j = 0; n_j < neighbors.size(); n_j++)
 				{
+					unsigned int j = neighbors[n_j];
+					if (j <= i)
+						continue;
+
 					//Fast Pi Tag
 					if(m_use_fast_pi_tag){
 						if(std::abs(ref_Ratio[i]-ref_Ratio[j]) > deviation_of_aspectratio)
@@ -533,6 +658,9 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 					// Compute line equation
 					cv::Point2f vec_IJ = ellipses[j].center - ellipses[i].center;
 					double dot_IJ_IJ = vec_IJ.ddot(vec_IJ);
+					if (dot_IJ_IJ > search_radius[i]*search_radius[i])
+						continue;
+					m_detection_statistics.ellipse_pairs++;
 
 					// Check all other ellipses if they fit to the line equation
 					// Condition: Between two points are at most two other points
@@ -540,8 +668,10 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 					std::vector<cv::Point2f> line_candidate;
 					int nLine_Candidates = 0;
 
-					for(unsigned int k = 0; k < ellipses.size() && nLine_Candidates < 2; k++)
+					for(size_t n_k = 0; n_k < neighbors.size() && nLine_Candidates < 2; n_k++)
 					{
+						unsigned int k = neighbors[n_k];
+
 						//Fast Pi Tag
 						if(m_use_fast_pi_tag){
 							if(std::abs(ref_Ratio[j]-ref_Ratio[k]) > deviation_of_aspectratio)
@@ -573,8 +703,10 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 						if (d_k_sqr > max_pixel_dist_to_line*max_pixel_dist_to_line)
 							continue;
 
-						for(unsigned int l = k+1; l < ellipses.size() && nLine_Candidates < 2; l++)
+						for(size_t n_l = n_k+1; n_l < neighbors.size() && nLine_Candidates < 2; n_l++)
 						{
+							unsigned int l = neighbors[n_l];
+
 							//Fast Pi Tag
 							if(m_use_fast_pi_tag){
 								if(std::abs(ref_Ratio[k]-ref_Ratio[l]) > deviation_of_aspectratio)
@@ -628,6 +760,7 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 						marker_lines.push_back(line_candidate);
 				}
 			}
+			m_detection_statistics.marker_lines += marker_lines.size();
 
 			if (debug)
 			{
@@ -645,11 +778,14 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 			double cross_ratio_max_dist = 0.03; //0.03
 			std::vector<t_pi> final_tag_vec;
 
-			for (unsigned int i = 0; i < m_ref_tag_vec.size(); i++)
+			// Only the reference tags matched before can hold fitting lines
+			for (unsigned int i = 0; i < m_matched_ref_tags.size(); i++)
 			{
-				m_ref_tag_vec[i].fitting_image_lines_0.clear();
-				m_ref_tag_vec[i].fitting_image_lines_1.clear();
+				m_ref_tag_vec[m_matched_ref_tags[i]].fitting_image_lines_0.clear();
+				m_ref_tag_vec[m_matched_ref_tags[i]].fitting_image_lines_1.clear();
 			}
+			m_matched_ref_tags.clear();
+			std::vector<t_cross_ratio_match> cross_ratio_matches;
 
 			for(unsigned int i = 0; i < marker_lines.size(); i++)
 			{
@@ -664,15 +800,22 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 				double l_CD = std::sqrt(i_CD.x*i_CD.x + i_CD.y*i_CD.y);
 				double cross_ratio_i = (l_AB/l_BD)/(l_AC/l_CD);
 
-				// Associate lines to markers based on their cross ratio
-				for (unsigned int j = 0; j < m_ref_tag_vec.size(); j++)
+				// Associate lines to markers based on their cross ratio, the index only visits reference lines within the tolerance
+				m_cross_ratio_index.Query(cross_ratio_i, cross_ratio_max_dist, cross_ratio_matches);
+				for (unsigned int j = 0; j < cross_ratio_matches.size(); j++)
 				{
-					if (std::abs(cross_ratio_i - m_ref_tag_vec[j].cross_ration_0) < cross_ratio_max_dist)
-						m_ref_tag_vec[j].fitting_image_lines_0.push_back(marker_lines[i]);
-					else if (std::abs(cross_ratio_i - m_ref_tag_vec[j].cross_ration_1) < cross_ratio_max_dist)
-						m_ref_tag_vec[j].fitting_image_lines_1.push_back(marker_lines[i]);
+					t_pi& ref_tag = m_ref_tag_vec[cross_ratio_matches[j].tag_index];
+					if (ref_tag.fitting_image_lines_0.empty() && ref_tag.fitting_image_lines_1.empty())
+						m_matched_ref_tags.push_back(cross_ratio_matches[j].tag_index);
+					if (cross_ratio_matches[j].line_type == 0)
+						ref_tag.fitting_image_lines_0.push_back(marker_lines[i]);
+					else
+						ref_tag.fitting_image_lines_1.push_back(marker_lines[i]);
+					m_detection_statistics.fitting_lines++;
 				}
 			}
+			// The tags are searched in the order of the reference tags, like without the index
+			std::sort(m_matched_ref_tags.begin(), m_matched_ref_tags.end());
 
 			if (debug)
 			{
@@ -694,8 +837,9 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 			}
 
 			// Search for all tag types independently
-			for(unsigned int i = 0; i < m_ref_tag_vec.size(); i++)
+			for(unsigned int matched_idx = 0; matched_idx < m_matched_ref_tags.size(); matched_idx++)
 			{
+				unsigned int i = m_matched_ref_tags[matched_idx];
 				std::vector<t_pi> ul_tag_vec;
 				std::vector<t_pi> lr_tag_vec;
 
@@ -1215,11 +1359,13 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 			}
 
 			// ------------ Compute pose --------------------------------------
+			m_detection_statistics.time_pairing += ElapsedMilliseconds(stage_tick);
 			int min_matching_lines = 4;
 			for (unsigned int i=0; i<final_tag_vec.size(); i++)
 			{
 				if (final_tag_vec[i].no_matching_lines < min_matching_lines)
 					continue;
+				m_detection_statistics.tags++;
 
 				int nPoints = 0;
 				for (unsigned int j=0; j<final_tag_vec[i].image_points.size(); j++)
@@ -1265,12 +1411,23 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 				ApplyExtrinsics(rot_3x3_CfromO, tag_pose.trans);
 				rot_3x3_CfromO.copyTo(tag_pose.rot);
 				vec_pose.push_back(tag_pose);
+				m_tag_image_regions.push_back(cv::boundingRect(image_coords.reshape(2)));
 			}
+			m_detection_statistics.time_pose += ElapsedMilliseconds(stage_tick);
 		}
 // ------------ END --------------------------------------
 		
 		if (debug)
 		{
+				std::cout << "INFO - FiducialModelPi::GetPose:" << std::endl;
+				std::cout << "\t ... " << m_detection_statistics.contours << " contours, "
+					<< m_detection_statistics.ellipses << " ellipses, "
+					<< m_detection_statistics.rois << " rois" << std::endl;
+				std::cout << "\t ... " << m_detection_statistics.grid_entries_visited << " grid entries visited, "
+					<< m_detection_statistics.ellipse_pairs << " ellipse pairs, "
+					<< m_detection_statistics.marker_lines << " marker lines, "
+					<< m_detection_statistics.fitting_lines << " fitting lines, "
+					<< m_detection_statistics.tags << " tags" << std::endl;
 				//cv::waitKey();
 		}
 		
@@ -1281,6 +1438,7 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 			for(size_t h = 0; h < vec_pose.size();h++){
 				if(vec_pose[h].trans.at<double>(2) > max_detection_distance){
 					vec_pose.erase(vec_pose.begin()+h);
+					m_tag_image_regions.erase(m_tag_image_regions.begin()+h);
 					h--;
 				}
 			}
@@ -1294,6 +1452,7 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 								vec_pose[h].trans.at<double>(2)*vec_pose[b].trans.at<double>(2) );
 						if( distance_between_markers > min_marker_distance){
 							vec_pose.erase(vec_pose.begin()+b);
+							m_tag_image_regions.erase(m_tag_image_regions.begin()+b);
 							b--;
 						}
 					}
@@ -1302,7 +1461,7 @@ unsigned long FiducialModelPi::GetPose(cv::Mat& image, std::vector<t_pose>& vec_
 		}
 		//Fast Pi Tag
 
-
+		m_detection_statistics.poses += vec_pose.size();
 		if (vec_pose.empty())
 				return ipa_Utils::RET_FAILED;
 
@@ -1505,6 +1664,17 @@ unsigned long FiducialModelPi::LoadParameters(std::vector<FiducialPiParameters>
 						return ipa_Utils::RET_FAILED;
 				}
 		}
+
+		// Index the cross ratios for the line association
+		std::vector<double> cross_ratios_0(m_ref_tag_vec.size());
+		std::vector<double> cross_ratios_1(m_ref_tag_vec.size());
+		for (unsigned int i=0; i<m_ref_tag_vec.size(); i++)
+		{
+				cross_ratios_0[i] = m_ref_tag_vec[i].cross_ration_0;
+				cross_ratios_1[i] = m_ref_tag_vec[i].cross_ration_1;
+		}
+		m_cross_ratio_index.Build(cross_ratios_0, cross_ratios_1);
+		m_matched_ref_tags.clear();
 		return ipa_Utils::RET_OK;
 }
 
@@ -1569,6 +1739,65 @@ unsigned long FiducialModelPi::LoadParameters(std::string directory_and_filename
 //END	FiducialDetector->Fast PiTag flag
 //************************************************************************************
 
+//************************************************************************************
+//	BEGIN FiducialDetector->TileSize (optional)
+//************************************************************************************
+
+					if (LoadTileSize(p_xmlElement_Root) & ipa_Utils::RET_FAILED)
+						return ipa_Utils::RET_FAILED;
+
+//************************************************************************************
+//END	FiducialDetector->TileSize
+//************************************************************************************
+
+//************************************************************************************
+//	BEGIN FiducialDetector->CoarseToFine (optional)
+//************************************************************************************
+
+					TiXmlElement *p_xmlElement_coarse_to_fine = NULL;
+					p_xmlElement_coarse_to_fine = p_xmlElement_Root->FirstChildElement("CoarseToFine");
+					if( p_xmlElement_coarse_to_fine ) {
+
+						// read and save value of attribute
+						if ( p_xmlElement_coarse_to_fine->QueryValueAttribute( "max_width", &m_coarse_max_image_width) != TIXML_SUCCESS)
+						{
+							std::cerr << "ERROR - FiducialModelPi::LoadParameters:" << std::endl;
+							std::cerr << "\t ... Can't find attribute 'max_width' of tag 'CoarseToFine'" << std::endl;
+							return ipa_Utils::RET_FAILED;
+						}
+						if ( p_xmlElement_coarse_to_fine->QueryValueAttribute( "roi_padding", &m_coarse_roi_padding) != TIXML_SUCCESS)
+						{
+							std::cerr << "ERROR - FiducialModelPi::LoadParameters:" << std::endl;
+							std::cerr << "\t ... Can't find attribute 'roi_padding' of tag 'CoarseToFine'" << std::endl;
+							return ipa_Utils::RET_FAILED;
+						}
+					}
+
+//************************************************************************************
+//END	FiducialDetector->CoarseToFine
+//************************************************************************************
+
+//************************************************************************************
+//	BEGIN FiducialDetector->MaxLineLengthFactor (optional)
+//************************************************************************************
+
+					TiXmlElement *p_xmlElement_line_length = NULL;
+					p_xmlElement_line_length = p_xmlElement_Root->FirstChildElement("MaxLineLengthFactor");
+					if( p_xmlElement_line_length ) {
+
+						// read and save value of attribute
+						if ( p_xmlElement_line_length->QueryValueAttribute( "value", &m_max_line_length_factor) != TIXML_SUCCESS)
+						{
+							std::cerr << "ERROR - FiducialModelPi::LoadParameters:" << std::endl;
+							std::cerr << "\t ... Can't find attribute 'value' of tag 'MaxLineLengthFactor'" << std::endl;
+							return ipa_Utils::RET_FAILED;
+						}
+					}
+
+//************************************************************************************
+//END	FiducialDetector->MaxLineLengthFactor
+//************************************************************************************
+
 //************************************************************************************
 //        BEGIN FiducialDetector->PI
 //************************************************************************************
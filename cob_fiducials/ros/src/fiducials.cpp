@@ -54,7 +54,9 @@
 //#### includes ####
 
 // standard includes
-//--
+#include <algorithm>
+#include <string>
+#include <vector>
 
 // ROS includes
 #include <ros/ros.h>
@@ -90,6 +92,8 @@
 #include <cob_fiducials/pi/FiducialModelPi.h>
 #include <cob_fiducials/aruco/FiducialModelAruco.h>
 
+#include <opencv2/imgproc/imgproc.hpp>
+
 #include <boost/thread/mutex.hpp>
 #include <boost/timer.hpp>
 
@@ -117,7 +121,9 @@ class CobFiducialsNode //: public nodelet::Nodelet
 
 
 private:
-    ros::NodeHandle node_handle_;
+    ros::NodeHandle node_handle_; ///< Topics and services of the camera
+    ros::NodeHandle parameter_node_handle_; ///< Parameters, shared by all cameras in multi-camera mode
+    std::string marker_frame_id_; ///< Child frame of the published marker transform
 
     boost::shared_ptr<image_transport::ImageTransport> image_transport_0_;
     boost::shared_ptr<image_transport::ImageTransport> image_transport_1_;
@@ -127,7 +133,6 @@ private:
     message_filters::Subscriber<sensor_msgs::CameraInfo> color_camera_info_sub_;	///< camera information service
 
     boost::shared_ptr<message_filters::Synchronizer<ColorImageSyncPolicy > > color_image_sub_sync_; ///< Synchronizer
-    tf::TransformListener transform_listener_; ///< tf transforms
 
     int sub_counter_; /// Number of subscribers to topic
     unsigned int endless_counter_; ///< A counter to show that node is still receiving images
@@ -143,7 +148,7 @@ private:
  
     ros::Publisher fiducial_publisher_;	
 
-    cv::Mat color_mat_8U3_;
+    cv::Mat color_mat_8U3_; ///< Image with the rendered detections for publishing, reused across frames
     cv::Mat camera_matrix_;
     bool camera_matrix_initialized_;
 
@@ -159,6 +164,10 @@ private:
     bool log_or_calibrate_sharpness_measurements_;		///< if true, the sharpness measurements are logged and saved to disc for calibration of the curve or directly calibrated within the program
     double sharpness_calibration_parameter_m_;		///< the m and n parameters of the linear calibration function sharpness_score = m * pixel_count + n -> m,n can be determined with the 'log_or_calibrate_sharpness_measurements_' option
     double sharpness_calibration_parameter_n_;
+    bool tracking_mode_;	///< if true, tags are only searched in the image regions predicted from their previous poses
+    int tracking_full_scan_interval_;	///< number of frames after which the full image is scanned again in tracking mode
+    double tracking_roi_padding_;	///< padding of the predicted tag regions relative to their size
+    bool mono_input_;	///< if true, images are received as mono8, which avoids a color conversion for gray cameras
     bool publish_tf_;
     tf::TransformBroadcaster tf_broadcaster_; ///< Broadcast transforms of detected fiducials
     bool publish_2d_image_;
@@ -187,13 +196,24 @@ private:
 
 public:
     /// Constructor.
-    CobFiducialsNode(ros::NodeHandle& nh)
+    /// @param nh Node handle, parameters are read from its namespace
+    /// @param camera_name Multi-camera mode: topics and services are advertised in the sub namespace camera_name of nh
+    CobFiducialsNode(ros::NodeHandle& nh, const std::string& camera_name = "")
         : sub_counter_(0),
           endless_counter_(0)
     {
         camera_matrix_initialized_ = false;
-        /// Void
-        node_handle_ = nh;
+        parameter_node_handle_ = nh;
+        if (camera_name.empty())
+        {
+            node_handle_ = nh;
+            marker_frame_id_ = "marker";
+        }
+        else
+        {
+            node_handle_ = ros::NodeHandle(nh, camera_name);
+            marker_frame_id_ = camera_name + "_marker";
+        }
         onInit();
     }
 
@@ -266,6 +286,11 @@ public:
         	ROS_ERROR("[fiducials] Unknown fiducial type");
 		return false;
 	}
+	if (tag_detector_->SetTrackingParameters(tracking_mode_, tracking_full_scan_interval_, tracking_roi_padding_) & ipa_Utils::RET_FAILED)
+	{
+		ROS_ERROR("[fiducials] Invalid tracking parameters");
+		return false;
+	}
 
 	if(publish_tf_) {
 		tf_pub_timer_.stop();
@@ -360,7 +385,8 @@ public:
             cv_bridge::CvImageConstPtr cv_ptr;
             try
             {
-              cv_ptr = cv_bridge::toCvShare(color_camera_data, sensor_msgs::image_encodings::BGR8);
+              // Shares the message data if it already has the requested encoding, otherwise converts once
+              cv_ptr = cv_bridge::toCvShare(color_camera_data, mono_input_ ? sensor_msgs::image_encodings::MONO8 : sensor_msgs::image_encodings::BGR8);
             }
             catch (cv_bridge::Exception& e)
             {
@@ -370,8 +396,8 @@ public:
 
             received_timestamp_ = color_camera_data->header.stamp;
             received_frame_id_ = color_camera_data->header.frame_id;
-            cv::Mat tmp = cv_ptr->image;
-            color_mat_8U3_ = tmp.clone();
+            // The detectors do not modify the image, so it is processed without a copy while cv_ptr holds the message
+            cv::Mat image = cv_ptr->image;
 
 //            cob_object_detection_msgs::DetectionArray detection_array;
             detection_array_.detections.clear();
@@ -380,7 +406,7 @@ public:
 			//detection_array_.header.stamp = ros::Time::now();
 			//detection_array_.header.frame_id = "/head_cam3d_link";
 
-			detectFiducials(detection_array_, color_mat_8U3_);
+			detectFiducials(detection_array_, image);
             if (ros_node_mode_ == MODE_TOPIC || ros_node_mode_ == MODE_TOPIC_AND_SERVICE)
             {
                 // Publish
@@ -494,7 +520,7 @@ public:
 	tf_lock_.unlock();
 
 	unsigned long ret_val = ipa_Utils::RET_OK;
-	ret_val = tag_detector_->GetPose(color_image, tags_vec);
+	ret_val = tag_detector_->GetPoseTracked(color_image, tags_vec);
 
 	if (ret_val & ipa_Utils::RET_OK)
         {
@@ -562,10 +588,15 @@ public:
         // Publish 2d image
         if (publish_2d_image_)
         {
+            // color_image may share its data with the received message, so the poses are rendered into a separate buffer
+            if (color_image.channels() == 1)
+                cv::cvtColor(color_image, color_mat_8U3_, CV_GRAY2BGR);
+            else
+                color_image.copyTo(color_mat_8U3_);
             for (unsigned int i=0; i<pose_array_size; i++)
-                RenderPose(color_image, tags_vec[i].rot, tags_vec[i].trans);
+                RenderPose(color_mat_8U3_, tags_vec[i].rot, tags_vec[i].trans);
             cv_bridge::CvImage cv_ptr;
-            cv_ptr.image = color_image;
+            cv_ptr.image = color_mat_8U3_;
             cv_ptr.encoding = CobFiducialsNode::color_image_encoding_;
             img2D_pub_.publish(cv_ptr.toImageMsg());
         }
@@ -608,7 +639,7 @@ public:
                 transform.setOrigin(tf::Vector3(vec_vec7d[i][0], vec_vec7d[i][1], vec_vec7d[i][2]));
                 transform.setRotation(tf::Quaternion(vec_vec7d[i][4], vec_vec7d[i][5], vec_vec7d[i][6], vec_vec7d[i][3]));
 		tf_lock_.lock();
-		marker_tf_ = tf::StampedTransform(transform, ros::Time::now(), detection_array.header.frame_id, "marker");	//TODO: make parameter
+		marker_tf_ = tf::StampedTransform(transform, ros::Time::now(), detection_array.header.frame_id, marker_frame_id_);	//TODO: make parameter
 		tf_lock_.unlock();
             }
         }
@@ -869,7 +900,7 @@ public:
     {
        std::string tmp_string;
         /// Parameters are set within the launch file
-        if (node_handle_.getParam("fiducial_type", tmp_string) == false)
+        if (parameter_node_handle_.getParam("fiducial_type", tmp_string) == false)
         {
             ROS_ERROR("[fiducials] fiducial type not specified");
             return false;
@@ -892,7 +923,7 @@ public:
         ROS_INFO("Fiducial type: %s", tmp_string.c_str());
 
         /// Parameters are set within the launch file
-        if (node_handle_.getParam("ros_node_mode", tmp_string) == false)
+        if (parameter_node_handle_.getParam("ros_node_mode", tmp_string) == false)
         {
             ROS_ERROR("[fiducials] Mode for fiducial node not specified");
             return false;
@@ -919,19 +950,19 @@ public:
         ROS_INFO("ROS node mode: %s", tmp_string.c_str());
 
         // Parameters are set within the launch file
-        if (node_handle_.getParam("model_directory", model_directory_) == false)
+        if (parameter_node_handle_.getParam("model_directory", model_directory_) == false)
         {
             ROS_ERROR("[fiducials] 'model_directory=<dir1>/ydir2>/' not specified in launch file");
             return false;
         }
         ROS_INFO("[fiducials] model_directory: %s", model_directory_.c_str());
-        if (node_handle_.getParam("model_filename", model_filename_) == false)
+        if (parameter_node_handle_.getParam("model_filename", model_filename_) == false)
         {
             ROS_ERROR("[fiducials] 'model_filename=<filename>.xml' not specified in yaml file");
             return false;
         }
         ROS_INFO("[fiducials] model_filename: %s", model_filename_.c_str());
-        if (node_handle_.getParam("compute_sharpness_measure", compute_sharpness_measure_) == false)
+        if (parameter_node_handle_.getParam("compute_sharpness_measure", compute_sharpness_measure_) == false)
         {
             ROS_ERROR("[fiducials] 'compute_sharpness_measure=[true/false]' not specified in yaml file");
             return false;
@@ -940,7 +971,7 @@ public:
             ROS_INFO("[fiducials] compute_sharpness_measure: true");
         else
             ROS_INFO("[fiducials] compute_sharpness_measure: false");
-        if (node_handle_.getParam("sharpness_calibration_parameter_m", sharpness_calibration_parameter_m_) == false)
+        if (parameter_node_handle_.getParam("sharpness_calibration_parameter_m", sharpness_calibration_parameter_m_) == false)
 		{
         	if (compute_sharpness_measure_ == true)
         	{
@@ -951,7 +982,7 @@ public:
         		sharpness_calibration_parameter_m_ = 0.;
 		}
 		ROS_INFO("[fiducials] sharpness_calibration_parameter_m: %f", sharpness_calibration_parameter_m_);
-		if (node_handle_.getParam("sharpness_calibration_parameter_n", sharpness_calibration_parameter_n_) == false)
+		if (parameter_node_handle_.getParam("sharpness_calibration_parameter_n", sharpness_calibration_parameter_n_) == false)
 		{
 			if (compute_sharpness_measure_ == true)
 			{
@@ -962,7 +993,7 @@ public:
 				sharpness_calibration_parameter_n_ = 0.;
 		}
 		ROS_INFO("[fiducials] sharpness_calibration_parameter_n: %f", sharpness_calibration_parameter_n_);
-        if (node_handle_.getParam("log_or_calibrate_sharpness_measurements", log_or_calibrate_sharpness_measurements_) == false)
+        if (parameter_node_handle_.getParam("log_or_calibrate_sharpness_measurements", log_or_calibrate_sharpness_measurements_) == false)
         {
         	log_or_calibrate_sharpness_measurements_ = false;
         }
@@ -970,7 +1001,33 @@ public:
 			ROS_INFO("[fiducials] log_or_calibrate_sharpness_measurements: true");
 		else
 			ROS_INFO("[fiducials] log_or_calibrate_sharpness_measurements: false");
-        if (node_handle_.getParam("publish_marker_array", publish_marker_array_) == false)
+        if (parameter_node_handle_.getParam("tracking_mode", tracking_mode_) == false)
+        {
+            tracking_mode_ = false;
+        }
+        if (tracking_mode_)
+            ROS_INFO("[fiducials] tracking_mode: true");
+        else
+            ROS_INFO("[fiducials] tracking_mode: false");
+        if (parameter_node_handle_.getParam("tracking_full_scan_interval", tracking_full_scan_interval_) == false)
+        {
+            tracking_full_scan_interval_ = 30;
+        }
+        ROS_INFO("[fiducials] tracking_full_scan_interval: %i", tracking_full_scan_interval_);
+        if (parameter_node_handle_.getParam("tracking_roi_padding", tracking_roi_padding_) == false)
+        {
+            tracking_roi_padding_ = 0.5;
+        }
+        ROS_INFO("[fiducials] tracking_roi_padding: %f", tracking_roi_padding_);
+        if (parameter_node_handle_.getParam("mono_input", mono_input_) == false)
+        {
+            mono_input_ = false;
+        }
+        if (mono_input_)
+            ROS_INFO("[fiducials] mono_input: true");
+        else
+            ROS_INFO("[fiducials] mono_input: false");
+        if (parameter_node_handle_.getParam("publish_marker_array", publish_marker_array_) == false)
         {
             ROS_ERROR("[fiducials] 'publish_marker_array=[true/false]' not specified in yaml file");
             return false;
@@ -979,7 +1036,7 @@ public:
             ROS_INFO("[fiducials] publish_marker_array: true");
         else
             ROS_INFO("[fiducials] publish_marker_array: false");
-        if (node_handle_.getParam("publish_tf", publish_tf_) == false)
+        if (parameter_node_handle_.getParam("publish_tf", publish_tf_) == false)
         {
             ROS_ERROR("[fiducials] 'publish_tf=[true/false]' not specified in yaml file");
             return false;
@@ -988,7 +1045,7 @@ public:
             ROS_INFO("[fiducials] publish_tf: true");
         else
             ROS_INFO("[fiducials] publish_tf: false");
-        if (node_handle_.getParam("publish_2d_image", publish_2d_image_) == false)
+        if (parameter_node_handle_.getParam("publish_2d_image", publish_2d_image_) == false)
         {
             ROS_ERROR("[fiducials] 'publish_2d_image=[true/false]' not specified in yaml file");
             return false;
@@ -997,13 +1054,13 @@ public:
             ROS_INFO("[fiducials] publish_2d_image: true");
         else
             ROS_INFO("[fiducials] publish_2d_image: false");
-        if (node_handle_.getParam("debug_verbosity", debug_verbosity_) == false)
+        if (parameter_node_handle_.getParam("debug_verbosity", debug_verbosity_) == false)
         {
             ROS_ERROR("[fiducials] 'debug_verbosity=[1,2]' not specified in yaml file");
             return false;
         }
         ROS_INFO("[fiducials] debug_verbosity: %i", debug_verbosity_);
-        //if (node_handle_.getParam("StereoPreFilterCap", StereoPreFilterCap_) == false)
+        //if (parameter_node_handle_.getParam("StereoPreFilterCap", StereoPreFilterCap_) == false)
         //{
         //	ROS_ERROR("[sensor_fusion] StereoPreFilterCap for sensor fusion node not specified");
         //	return false;
@@ -1035,10 +1092,25 @@ int main(int argc, char** argv)
     /// Create a handle for this node, initialize node
     ros::NodeHandle nh;
 
-    /// Create camera node class instance
-    ipa_Fiducials::CobFiducialsNode fiducials_node(nh);
+    /// Create camera node class instances.
+    /// In multi-camera mode each camera has its own detector and scratch images, so the cameras are processed concurrently
+    /// by the threads of the spinner. Each camera publishes its detections in its own namespace.
+    std::vector<std::string> camera_namespaces;
+    nh.getParam("camera_namespaces", camera_namespaces);
+    std::vector<boost::shared_ptr<ipa_Fiducials::CobFiducialsNode> > fiducials_nodes;
+    if (camera_namespaces.empty())
+        fiducials_nodes.push_back(boost::shared_ptr<ipa_Fiducials::CobFiducialsNode>(new ipa_Fiducials::CobFiducialsNode(nh)));
+    for (unsigned int i=0; i<camera_namespaces.size(); i++)
+    {
+        ROS_INFO("[fiducials] Setting up camera '%s'", camera_namespaces[i].c_str());
+        fiducials_nodes.push_back(boost::shared_ptr<ipa_Fiducials::CobFiducialsNode>(new ipa_Fiducials::CobFiducialsNode(nh, camera_namespaces[i])));
+    }
 
-    ros::MultiThreadedSpinner spinner(2); // Use 4 threads
+    /// The number of threads bounds the CPU usage of all cameras
+    int number_worker_threads = 2;
+    nh.getParam("number_worker_threads", number_worker_threads);
+    ROS_INFO("[fiducials] number_worker_threads: %i", number_worker_threads);
+    ros::MultiThreadedSpinner spinner(std::max(1, number_worker_threads));
     spinner.spin();
     //	ros::spin();
 
@@ -0,0 +1,102 @@
+/// @file DescriptorCache.h
+/// Content-addressed on-disk cache for the descriptors computed by the database loaders.
+/// An entry is addressed by a 64 bit hash over everything the descriptor depends on (content of the input files and the relevant parameters).
+/// Changed inputs or parameters address a different entry, so entries never have to be invalidated. Deleting the cache directory is always safe.
+
+#ifndef __DESCRIPTORCACHE_H__
+#define __DESCRIPTORCACHE_H__
+
+#include <string>
+#include <map>
+#include <ctime>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "object_categorization/GlobalDefines.h"
+
+namespace ipa_utils {
+
+/// Key of a cache entry, accumulates an FNV-1a hash over all values added.
+/// The type of each value is hashed as well, so e.g. Add(1) and Add(1.0) result in different keys.
+class DescriptorCacheKey
+{
+public:
+	DescriptorCacheKey();
+
+	void Add(const std::string& pValue);
+	void Add(int pValue);
+	void Add(double pValue);
+	void Add(const void* pData, size_t pBytes);
+
+	/// @return The accumulated hash.
+	boost::uint64_t Hash() const { return mHash; };
+
+	/// @return The hash as hexadecimal string (16 characters).
+	std::string Str() const;
+
+private:
+	void AddBytes(const void* pData, size_t pBytes);
+
+	boost::uint64_t mHash;
+};
+
+/// Cache directory with one file per entry. All functions may be called from multiple threads.
+class DescriptorCache
+{
+public:
+	DescriptorCache();
+
+	/// Sets the cache directory and creates it if necessary.
+	/// @param pCachePath The cache directory, an empty string disables the cache.
+	/// @return Return code.
+	int Open(const std::string& pCachePath);
+
+	/// @return True if a cache directory is set.
+	bool Enabled() const { return mCachePath.empty() == false; };
+
+	/// Adds the content of a file to a key. The hash of each file is computed only once per file name, size and modification time.
+	/// @param pKey The key.
+	/// @param pFileName The file.
+	/// @return Return code, RET_FAILED if the file cannot be read.
+	int AddFile(DescriptorCacheKey& pKey, const std::string& pFileName);
+
+	/// Reads an entry.
+	/// @param pKey The key of the entry.
+	/// @param pData The stored data.
+	/// @return True if the entry exists and is intact.
+	bool Load(const DescriptorCacheKey& pKey, std::string& pData);
+
+	/// Writes an entry. The file is written under a temporary name and renamed afterwards, so readers never see partial entries.
+	/// @param pKey The key of the entry.
+	/// @param pData The data.
+	/// @return Return code.
+	int Store(const DescriptorCacheKey& pKey, const std::string& pData);
+
+	/// @return Number of successful reads since <code>Open()</code>.
+	unsigned long Hits() const { return mHits; };
+	/// @return Number of failed reads since <code>Open()</code>.
+	unsigned long Misses() const { return mMisses; };
+
+private:
+	/// Memorized hash of a file.
+	struct FileHash
+	{
+		boost::uintmax_t size;
+		std::time_t modificationTime;
+		boost::uint64_t hash;
+	};
+
+	std::string EntryFileName(const DescriptorCacheKey& pKey) const;
+
+	std::string mCachePath;
+	std::map<std::string, FileHash> mFileHashes;
+	unsigned long mHits;
+	unsigned long mMisses;
+	unsigned long mTemporaryFileCounter;
+	boost::mutex mMutex;
+};
+
+} // end namespace ipa_utils
+
+#endif // __DESCRIPTORCACHE_H__
@@ -0,0 +1,158 @@
+/// @file FeatureStore.h
+/// Binary storage for the local and global feature data of ClassificationData.
+/// A feature store file consists of a fixed header, the data blocks (each aligned to 16 bytes) and an index at the end of the file
+/// which describes the blocks. The file is memory mapped for reading, so global feature matrices can directly point into the file.
+/// Numbers are stored in the byte order of the writing machine.
+
+#ifndef __FEATURESTORE_H__
+#define __FEATURESTORE_H__
+
+#include <string>
+#include <fstream>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "object_categorization/GlobalDefines.h"
+
+namespace ipa_utils {
+
+/// File name extension of feature store files. <code>ClassificationData::Save*Features()</code> writes the binary format for file names with this extension.
+static const char FEATURE_STORE_FILE_EXTENSION[] = ".fpb";
+
+/// Types of content of a feature store file.
+enum FeatureStoreContent {
+	FEATURE_STORE_GLOBAL = 1,	///< global feature matrices (float32, one matrix per object)
+	FEATURE_STORE_LOCAL = 2		///< local feature points (one block per view of an object)
+};
+
+/// Header at the beginning of each feature store file.
+struct FeatureStoreHeader
+{
+	char magic[8];					///< always "IPAFPBIN"
+	boost::uint32_t version;		///< format version
+	boost::uint32_t contentType;	///< cf. enum <code>FeatureStoreContent</code>
+	boost::uint64_t indexOffset;	///< position of the index in the file
+	boost::uint64_t indexSize;		///< size of the index in bytes
+};
+
+/// Whole file which is memory mapped (copy-on-write) or read into memory where mapping is not available.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/// Maps the file.
+	/// @param pFileName The file name.
+	/// @return Return code.
+	int Open(const std::string& pFileName);
+
+	/// Unmaps the file. All pointers into the data become invalid.
+	void Close();
+
+	/// Start of the file data. Writing is allowed, the changes are not written back to the file.
+	unsigned char* Data() { return mData; };
+
+	/// Size of the file in bytes.
+	size_t Size() const { return mSize; };
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	unsigned char* mData;	///< start of the file data
+	size_t mSize;			///< file size in bytes
+	bool mMapped;			///< true if mData is a memory mapping, false if it was allocated with new[]
+};
+
+/// Writes a feature store file: data blocks are appended one after another, index entries are collected and written by <code>Close()</code>.
+class FeatureStoreWriter
+{
+public:
+	FeatureStoreWriter();
+	~FeatureStoreWriter();
+
+	/// Creates the file and writes a preliminary header.
+	/// @param pFileName The file name.
+	/// @param pContentType The type of content (cf. enum <code>FeatureStoreContent</code>).
+	/// @return Return code.
+	int Open(const std::string& pFileName, unsigned int pContentType);
+
+	/// Appends a data block at the next aligned position.
+	/// @param pData The data.
+	/// @param pBytes Size of the data in bytes.
+	/// @return The offset of the block in the file, which can be stored in the index.
+	boost::uint64_t WriteBlock(const void* pData, size_t pBytes);
+
+	/// Appends a string to the index.
+	void IndexString(const std::string& pValue);
+	/// Appends a number to the index.
+	void IndexInt(int pValue);
+	/// Appends a block offset to the index.
+	void IndexOffset(boost::uint64_t pValue);
+
+	/// Writes the index and the final header and closes the file.
+	/// @return Return code.
+	int Close();
+
+private:
+	std::ofstream mFile;
+	std::string mIndex;				///< serialized index entries
+	boost::uint64_t mPosition;		///< current write position in the file
+	unsigned int mContentType;
+};
+
+/// Reads a memory mapped feature store file. The index is read sequentially in the same order as it was written.
+class FeatureStoreReader
+{
+public:
+	FeatureStoreReader();
+
+	/// Maps the file and checks the header.
+	/// @param pFileName The file name.
+	/// @param pContentType The expected type of content (cf. enum <code>FeatureStoreContent</code>).
+	/// @return Return code.
+	int Open(const std::string& pFileName, unsigned int pContentType);
+
+	/// @return True if the whole index has been read or the index is corrupt.
+	bool IndexEnd() const { return (mIndexPosition >= mIndexEnd) || mError; };
+	/// @return True if a read went beyond the index or a block is outside the file.
+	bool Error() const { return mError; };
+
+	/// Reads the next string from the index.
+	std::string ReadString();
+	/// Reads the next number from the index.
+	int ReadInt();
+	/// Reads the next block offset from the index.
+	boost::uint64_t ReadOffset();
+
+	/// Returns a pointer to a data block of the mapped file.
+	/// @param pOffset The offset of the block (as returned by <code>FeatureStoreWriter::WriteBlock()</code>).
+	/// @param pBytes The size of the block in bytes.
+	/// @return Pointer to the block or <code>NULL</code> if the block exceeds the file.
+	void* Block(boost::uint64_t pOffset, size_t pBytes);
+
+	/// The mapped file. Keep a reference as long as pointers into the file are used.
+	boost::shared_ptr<MappedFile> File() { return mFile; };
+
+private:
+	bool ReadIndexBytes(void* pDestination, size_t pBytes);
+
+	boost::shared_ptr<MappedFile> mFile;
+	size_t mIndexPosition;		///< current read position in the file
+	size_t mIndexEnd;			///< end of the index in the file
+	bool mError;
+};
+
+/// Checks whether a file starts with the feature store header.
+/// @param pFileName The file name.
+/// @return True for feature store files, false for other or missing files.
+bool IsFeatureStoreFile(const std::string& pFileName);
+
+/// Checks whether a file name ends with <code>FEATURE_STORE_FILE_EXTENSION</code>.
+bool HasFeatureStoreExtension(const std::string& pFileName);
+
+} // end namespace ipa_utils
+
+#endif // __FEATURESTORE_H__
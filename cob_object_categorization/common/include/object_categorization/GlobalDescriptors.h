@@ -0,0 +1,185 @@
+/// @file GlobalDescriptors.h
+/// The global descriptor families of <code>ObjectClassifier::ExtractGlobalFeatures()</code> as plugins.
+/// All plugins of a view share one <code>GlobalDescriptorContext</code>, which computes the intermediate results (3d points, PCA frame,
+/// pose normalized points, voxelized cloud, normals, search tree, cluster labels of the local features) on first use, so each of them
+/// is computed at most once per view, no matter how many descriptors need it.
+
+#ifndef __GLOBALDESCRIPTORS_H__
+#define __GLOBALDESCRIPTORS_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
+#include <boost/shared_ptr.hpp>
+
+#include "object_categorization/ObjectClassifier.h"
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#ifdef PCL_VERSION_COMPARE //fuerte
+	#include <pcl/search/kdtree.h>
+	typedef pcl::search::KdTree<pcl::PointXYZ> GlobalDescriptorSearchTree;
+#else
+	#include <pcl/kdtree/kdtree_flann.h>
+	typedef pcl::KdTreeFLANN<pcl::PointXYZ> GlobalDescriptorSearchTree;
+#endif
+
+#if (CV_MAJOR_VERSION<=2 && CV_MINOR_VERSION<=3)
+	typedef CvEM LocalFeatureClusterer;
+#else
+	typedef cv::EM LocalFeatureClusterer;
+#endif
+
+/// Data of one view (one pass of the artificial tilt) shared by all global descriptor plugins.
+/// <code>Prepare()</code> extracts the 3d points of the object and computes the PCA, everything else is computed when a plugin asks for it first.
+class GlobalDescriptorContext
+{
+public:
+	/// @param pBlobFeatures The local features of the view.
+	/// @param pGlobalFeatureParams The descriptor parameters.
+	/// @param pDatabase The database the view originates from (CIN measures in mm, the others in m).
+	/// @param pLocalFeatureClusterer The vocabulary of the local features, may be NULL if no plugin uses it.
+	/// @param pFileOutput Writes the data and parameters of the polynomial fits to files if true.
+	/// @param pScreenLogFile Log file for the messages, may be NULL.
+	GlobalDescriptorContext(BlobListRiB* pBlobFeatures, const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, Database pDatabase,
+							LocalFeatureClusterer* pLocalFeatureClusterer, bool pFileOutput, std::ofstream* pScreenLogFile);
+	~GlobalDescriptorContext();
+
+	/// Extracts the 3d points inside the mask (with artificial tilt, roll normalization and thinning as configured) and computes their PCA.
+	/// Falls back to the positions of the local features if not enough 3d points are available.
+	/// @param pCoordinateImage The 3d coordinates of the view (CV_32FC3), may be NULL.
+	/// @param pMask The object mask (CV_8UC1), may be NULL.
+	/// @param pDescriptorComputationPass 0 for the original view, i>0 for the view tilted by <code>additionalArtificialTiltedViewAngle[i-1]</code>.
+	/// @return Return code, RET_FAILED if the coordinate image and the mask do not match.
+	int Prepare(const IplImage* pCoordinateImage, const IplImage* pMask, int pDescriptorComputationPass);
+
+	/// @return True if enough 3d points are available for the 3d descriptors.
+	bool HasPointData() const { return mCoordinates != NULL && mCoordinates->rows > (int)mParams.minNumber3DPixels; };
+	/// @return Number of 3d points.
+	int NumberPoints() const { return (mCoordinates == NULL) ? 0 : mCoordinates->rows; };
+	/// @return True if the PCA of the points is available.
+	bool HasPCA() const { return mEigenvectors != NULL; };
+	/// @return True if the 3d points originate from the masked coordinate image (and not from the local feature positions).
+	bool HasMaskedPoints() const { return mPointsFromCoordinateImage; };
+
+	/// @return The 3d points, one per row (CV_32FC1). Must not be modified.
+	const CvMat* Coordinates() const { return mCoordinates; };
+	/// @return The PCA eigenvalues (1x3, descending).
+	const CvMat* Eigenvalues() const { return mEigenvalues; };
+	/// @return The PCA eigenvectors, one per row (3x3).
+	const CvMat* Eigenvectors() const { return mEigenvectors; };
+	/// @return The center of mass of the 3d points.
+	CvPoint3D32f Center() const { return mCenter; };
+
+	/// The points in the PCA frame (if <code>useFullPCAPoseNormalization</code> is set, otherwise only centered), scaled so that the largest extent in x and y is 1.
+	const std::vector<cv::Point3d>& NormalizedPoints();
+
+	/// Coefficients of the polynomials fitted along the lines parallel to the x- and y-axis of the normalized points.
+	/// @param pLevel The level of the surface approximation (0 = sap, 1 = sap2, ...).
+	/// @return <code>(numberLinesX[pLevel]+numberLinesY[pLevel])*(polynomOrder[pLevel]+1)</code> coefficients, zeros for lines with too few points.
+	const std::vector<float>& SurfacePolynomials(int pLevel);
+
+	/// Fraction of the normalized points in each cell of the point distribution grid (<code>cellCount</code>, <code>cellSize</code>), row by row along x.
+	const std::vector<float>& PointDistribution();
+
+	/// The 3d points moved to a virtual viewpoint 1m in front of their center (in m).
+	pcl::PointCloud<pcl::PointXYZ>::Ptr ViewpointNormalizedCloud();
+	/// The viewpoint normalized cloud voxelized with the given leaf size (in m).
+	pcl::PointCloud<pcl::PointXYZ>::Ptr VoxelizedCloud(float pLeafSize);
+	/// Search tree over <code>VoxelizedCloud(pLeafSize)</code>.
+	GlobalDescriptorSearchTree::Ptr SearchTree(float pLeafSize);
+	/// Normals of <code>VoxelizedCloud(pLeafSize)</code> estimated within the given radius (in m).
+	pcl::PointCloud<pcl::Normal>::Ptr Normals(float pLeafSize, double pRadius);
+
+	/// Vocabulary entry (cluster index) of each local feature.
+	const std::vector<int>& LocalFeatureClusters();
+
+	BlobListRiB* BlobFeatures() const { return mBlobFeatures; };
+	const ObjectClassifier::GlobalFeatureParams& Params() const { return mParams; };
+	Database GetDatabase() const { return mDatabase; };
+	LocalFeatureClusterer* GetLocalFeatureClusterer() const { return mLocalFeatureClusterer; };
+	std::ofstream* ScreenLogFile() const { return mScreenLogFile; };
+
+	/// Processing times of the stages of <code>Prepare()</code> in microseconds (for the timing log).
+	double mStageTimes[7];
+
+private:
+	BlobListRiB* mBlobFeatures;
+	const ObjectClassifier::GlobalFeatureParams& mParams;
+	Database mDatabase;
+	LocalFeatureClusterer* mLocalFeatureClusterer;
+	bool mFileOutput;
+	std::ofstream* mScreenLogFile;
+
+	CvMat* mCoordinates;
+	bool mPointsFromCoordinateImage;
+	CvMat* mEigenvalues;
+	CvMat* mEigenvectors;
+	CvPoint3D32f mCenter;
+
+	bool mNormalizedPointsValid;
+	std::vector<cv::Point3d> mNormalizedPoints;
+	std::map<int, std::vector<float> > mSurfacePolynomials;
+	bool mPointDistributionValid;
+	std::vector<float> mPointDistribution;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr mViewpointNormalizedCloud;
+	float mVoxelLeafSize;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr mVoxelizedCloud;
+	GlobalDescriptorSearchTree::Ptr mSearchTree;
+	double mNormalRadius;
+	pcl::PointCloud<pcl::Normal>::Ptr mNormals;
+	bool mLocalFeatureClustersValid;
+	std::vector<int> mLocalFeatureClusters;
+};
+
+/// Interface of a global descriptor family.
+/// Plugins do not keep state between views, so a single instance is used by all threads.
+class GlobalDescriptorPlugin
+{
+public:
+	virtual ~GlobalDescriptorPlugin() {};
+
+	/// @param pGlobalFeatureParams The descriptor parameters.
+	/// @param pLocalFeatureClusterer The vocabulary of the local features.
+	/// @return Number of values written by <code>Compute()</code>.
+	virtual int Size(const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, const LocalFeatureClusterer* pLocalFeatureClusterer) const = 0;
+
+	/// @return True if the descriptor is only computed for views with enough 3d points, otherwise its values stay zero.
+	virtual bool RequiresPointData() const { return true; };
+
+	/// Computes the descriptor of a view.
+	/// @param pContext The data of the view.
+	/// @param pDescriptor Destination of the <code>Size()</code> values, initialized with zeros.
+	virtual void Compute(GlobalDescriptorContext& pContext, float* pDescriptor) const = 0;
+};
+
+/// Registry of the global descriptor families. The order of registration is the order of the families in the descriptor.
+/// The families of this package (bow, sap, sap2, pointdistribution, normalstatistics, vfh, grsd, gfpfh) are registered on first use.
+class GlobalDescriptorRegistry
+{
+public:
+	/// @return The registry.
+	static GlobalDescriptorRegistry& Instance();
+
+	/// Appends a descriptor family. Registering a name again replaces the plugin and keeps the position.
+	/// Each registered family needs an entry in <code>GlobalFeatureParams::useFeature</code>.
+	/// @param pName The name of the family, i.e. the key in <code>GlobalFeatureParams::useFeature</code>.
+	/// @param pPlugin The plugin, the registry takes the ownership.
+	void Register(const std::string& pName, GlobalDescriptorPlugin* pPlugin);
+
+	/// @return The names of the registered families in descriptor order.
+	const std::vector<std::string>& Names() const { return mNames; };
+
+	/// @return The plugin of a family or NULL if the name is unknown.
+	const GlobalDescriptorPlugin* Get(const std::string& pName) const;
+
+private:
+	GlobalDescriptorRegistry();
+
+	std::vector<std::string> mNames;
+	std::map<std::string, boost::shared_ptr<GlobalDescriptorPlugin> > mPlugins;
+};
+
+#endif // __GLOBALDESCRIPTORS_H__
@@ -11,22 +11,30 @@
 #include "opencv/cxcore.h"
 #include "opencv/highgui.h"
 #include "opencv/ml.h"
+#include <opencv2/flann/flann.hpp>
 #include <string>
 #include <iostream>
 #include <sstream>
 #include <map>
 #include <vector>
+#include <list>
+#include <algorithm>
 #include <fstream>
 
 #include "object_categorization/BlobList.h"
 #include "object_categorization/DetectorCore.h"
 #include "object_categorization/GlobalDefines.h"
 #include "object_categorization/StopWatch.h"
+#include "object_categorization/FeatureStore.h"
+#include "object_categorization/DescriptorCache.h"
 
 #include "pcl/point_cloud.h"
 #include <pcl/point_types.h>
 #include <pcl/io/pcd_io.h>
+#include <pcl/PointIndices.h>
+#include <pcl/search/kdtree.h>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/filesystem.hpp>
 
@@ -54,6 +62,12 @@ enum {MASK_NO, MASK_LOAD, MASK_SAVE};
 
 enum Database {INVALID, CIN, CIN2, ALOI, WASHINGTON};
 
+/// Defines the object segmentation of the live point clouds (<code>PointcloudCallback()</code>).
+/// SEGMENTATION_VOXELGRID voxelizes the points of the considered volume, removes planes with RANSAC and clusters the remainder with a kd-tree.
+/// SEGMENTATION_ORGANIZED works on the image grid of the organized cloud: integral image normals, organized multi-plane segmentation and connected components of the remaining pixels.
+typedef int SegmentationMode;
+enum {SEGMENTATION_VOXELGRID, SEGMENTATION_ORGANIZED};
+
 /// A simple function returning the correct shortened form for the used classifier.
 /// Used for convenience when labelling files.
 /// @param pClassifierType The type of the used classifier.
@@ -107,6 +121,50 @@ struct ClassifierOutputCollection
 	}
 };
 
+/// Confusion counts of a multi-class cross-validation, indices: class name - "tp"/"fp"/"fn".
+typedef std::map<std::string, std::map<std::string, int> > MultiClassStatistics;
+
+/// Everything a single fold of the multi-class cross-validation needs, prepared serially before the folds are run.
+struct MultiClassFoldSetup
+{
+	ClassifierType classifierType;		///< classifier type (cf. enum <code>ClassifierType</code>)
+	float factorIncorrect;			///< ratio of non-class to class samples for the binary classifiers
+	int viewsPerObject;				///< number of views per training object, -1 = all views
+	double factorSamplesTrainData;	///< ratio of the samples of each training object that is used for training
+	double validationStartFactor;	///< validation starts at this ratio of the samples of each validation object
+	double svmGammaGridMax;			///< upper limit of the gamma grid of the SVM parameter search
+	int numberFeatures;				///< dimension of the feature vectors
+	std::map<std::string, int> objectClassNumberMapping;	///< maps each object class name to a unique number
+	std::map<int, std::string> numberObjectClassMapping;	///< maps a unique number to an object class name
+	std::map<std::string, std::list<int> > indicesTrain;		///< object indices of the training set for each class
+	std::map<std::string, std::list<int> > indicesValidation;	///< object indices of the validation set for each class
+	uint64 randomSeed;				///< seed for the random draws of this fold
+};
+
+/// Output of a single fold of the multi-class cross-validation.
+struct MultiClassFoldResult
+{
+	MultiClassStatistics multiclassStatistics;			///< statistics of the multi-class classifier
+	MultiClassStatistics multiclassStatisticsBinary;	///< statistics of the combined binary classifiers
+	std::map<std::string, std::map< int, std::vector< std::string > > > individualResults;	///< predictions, indices: class name - object number - view index
+	std::string screenOutput;		///< messages of this fold, printed when the results are merged
+	int returnCode;		///< ipa_utils::RET_FAILED if the fold could not be computed
+
+	MultiClassFoldResult() : returnCode(ipa_utils::RET_OK) {};
+};
+
+/// A group of global descriptor families (keys of <code>GlobalFeatureParams::useFeature</code>) which is stored as one entry of the descriptor cache for a single view.
+/// Families which are computed in a common code path of <code>ExtractGlobalFeatures()</code> (sap, sap2, pointdistribution) share one group.
+struct GlobalFeatureCacheGroup
+{
+	std::vector<std::string> families;	///< enabled families of the group in descriptor order
+	int size;							///< number of descriptor columns of the group
+	ipa_utils::DescriptorCacheKey key;	///< cache key of the group for the view
+	bool available;						///< true if rows and data are valid (loaded from the cache or computed)
+	int rows;							///< number of descriptor rows (one per tilt angle)
+	std::vector<float> data;			///< descriptor block, rows x size, row-major
+};
+
 /// Saves the relations between certain objects and their categories.
 struct ObjectStruct
 {
@@ -144,6 +202,47 @@ typedef std::map<std::string, float> ClassifierThresholdMap;
 /// Map that saves the reliability of binary classifiers, e.g. the probability ClassifierAccuracy[k][i] stands for the probability p(o_k|c_i) with o_k=classifier k outputs a hit, c_i=ground truth class of the data is i
 typedef std::map<std::string, std::map<std::string, double> > ClassifierAccuracy;
 
+/// Index-addressed view of a <code>GlobalClassifierMap</code> for the batch prediction: column c of the responses belongs to <code>classNames[c]</code>.
+/// The classifiers are not owned, the table is only valid as long as the map it was built from is unchanged.
+struct GlobalClassifierTable
+{
+	std::vector<std::string> classNames;	///< Class names in the order of the map.
+	std::vector<CvStatModel*> classifiers;	///< Classifier of <code>classNames[c]</code>.
+
+	/// Fills the table with the entries of the map (sorted by class name).
+	void Build(const GlobalClassifierMap& pClassifierMap);
+	/// @return Number of classes.
+	int Size() const { return (int)classNames.size(); };
+};
+
+
+/// Reusable storage for the matrices which are assembled over and over in training and cross-validation cycles.
+/// <code>Get()</code> returns a view into one allocation which only grows, so repeated cycles of similar size do not allocate.
+/// The buffer is released with its owner, i.e. nothing leaks on early returns.
+class TrainingMatrixBuffer
+{
+public:
+	/// @param pRows Number of rows of the view.
+	/// @param pCols Number of columns of the view.
+	/// @param pType OpenCV matrix type of the view.
+	/// @return A matrix view (pRows x pCols) into the buffer, the content is undefined. It is valid until the next call.
+	cv::Mat Get(int pRows, int pCols, int pType)
+	{
+		if (mStorage.empty() || mStorage.rows < pRows || mStorage.cols != pCols || mStorage.type() != pType)
+		{
+			int capacity = (mStorage.cols == pCols && mStorage.type() == pType) ? std::max(pRows, 2*mStorage.rows) : pRows;
+			mStorage.create(std::max(capacity, 1), pCols, pType);
+		}
+		return mStorage.rowRange(0, pRows);
+	};
+
+	/// Frees the buffer.
+	void Release() { mStorage.release(); };
+
+private:
+	cv::Mat mStorage;
+};
+
 
 /// Large data container which holds all relevant data for the categorization task.
 class ClassificationData
@@ -155,21 +254,58 @@ public:
 //	---------- Load/save functions ----------
 
 	/// Saves the local feature point data (<code>mLocalFeaturesMap</code>) to file.
+	/// File names ending with <code>ipa_utils::FEATURE_STORE_FILE_EXTENSION</code> are written in the binary format (cf. <code>SaveLocalFeaturesBinary()</code>).
 	/// @param pFileName The file (and path) name for local feature data storage.
 	/// @return Return code.
 	int SaveLocalFeatures(std::string pFileName);
 	/// Loads the local feature point data (<code>mLocalFeaturesMap</code>) from file.
+	/// Binary feature store files are recognized by their header and loaded with <code>LoadLocalFeaturesBinary()</code>.
 	/// @param pFileName The file (and path) name for local feature data storage.
 	/// @return Return code.
 	int LoadLocalFeatures(std::string pFileName);
 	/// Saves the global feature point data (<code>mGlobalFeaturesMap</code>) to file.
+	/// File names ending with <code>ipa_utils::FEATURE_STORE_FILE_EXTENSION</code> are written in the binary format (cf. <code>SaveGlobalFeaturesBinary()</code>).
 	/// @param pFileName The file (and path) name for global feature data storage.
 	/// @return Return code.
 	int SaveGlobalFeatures(std::string pFileName);
 	/// Loads the global feature point data (<code>mGlobalFeaturesMap</code>) from file.
+	/// Binary feature store files are recognized by their header and loaded with <code>LoadGlobalFeaturesBinary()</code>.
 	/// @param pFileName The file (and path) name for global feature data storage.
 	/// @return Return code.
 	int LoadGlobalFeatures(std::string pFileName);
+	/// Saves the local feature point data (<code>mLocalFeaturesMap</code>) to a binary feature store file (cf. FeatureStore.h).
+	/// The descriptors of each view are stored as one contiguous float32 block.
+	/// @param pFileName The file (and path) name for local feature data storage.
+	/// @return Return code.
+	int SaveLocalFeaturesBinary(std::string pFileName);
+	/// Loads the local feature point data (<code>mLocalFeaturesMap</code>) from a binary feature store file.
+	/// @param pFileName The file (and path) name for local feature data storage.
+	/// @return Return code.
+	int LoadLocalFeaturesBinary(std::string pFileName);
+	/// Saves the global feature point data (<code>mGlobalFeaturesMap</code>) to a binary feature store file (cf. FeatureStore.h).
+	/// The matrix of each object is stored as one contiguous float32 block.
+	/// @param pFileName The file (and path) name for global feature data storage.
+	/// @return Return code.
+	int SaveGlobalFeaturesBinary(std::string pFileName);
+	/// Loads the global feature point data (<code>mGlobalFeaturesMap</code>) from a binary feature store file.
+	/// The file is memory mapped and the matrices in <code>mGlobalFeaturesMap</code> are headers pointing into the mapping, i.e. nothing is copied or parsed.
+	/// The mapping is released when other global features are loaded or this object is destroyed.
+	/// @param pFileName The file (and path) name for global feature data storage.
+	/// @return Return code.
+	int LoadGlobalFeaturesBinary(std::string pFileName);
+	/// Converts a local or global feature text file into the binary format. The converted data stays loaded afterwards.
+	/// @param pTextFileName The existing text file.
+	/// @param pBinaryFileName The binary file which is created.
+	/// @param pLocalFeatures Local feature file if true, global feature file otherwise.
+	/// @return Return code.
+	int ConvertFeatureFileToBinary(std::string pTextFileName, std::string pBinaryFileName, bool pLocalFeatures);
+	/// Measures the load times of the text and the binary version of a feature file and checks that both contain the same data.
+	/// @param pTextFileName The text file.
+	/// @param pBinaryFileName The binary file (e.g. created with <code>ConvertFeatureFileToBinary()</code>).
+	/// @param pLocalFeatures Local feature files if true, global feature files otherwise.
+	/// @param pRepetitions Number of loads of each file.
+	/// @return Return code.
+	int BenchmarkFeatureFileLoading(std::string pTextFileName, std::string pBinaryFileName, bool pLocalFeatures, int pRepetitions=3);
 	/// Saves the global classifier models (<code>mGlobalClassifierMap</code>) to files.
 	/// There is one general file (class names, thresholds) and furthermore one model file for each classifier.
 	/// @param pPath The path where the files shall be stored.
@@ -239,16 +375,18 @@ public:
 	/// @param pFactorCorrect Is the part (0..1] of the whole amout of the given class' local features which shall occur in <code>pFeatureMatrix</code>.
 	/// @param pFactorIncorrect In <code>pFeatureMatrix</code> other class' local features will occur <code>pFactorIncorrect</code> times (0..inf) of the correct class.
 	/// @param pNumberCorrectSamples Is used to return the exact number of positive class samples in <code>pFeatureMatrix</code>.
+	/// @param pRNG Random number generator for drawing the samples. If <code>NULL</code>, <code>rand()</code> is used. Provide an own generator per thread for concurrent calls.
 	/// @return Return code.
-	int GetLocalFeatureMatrix(std::string pClass, CvMat** pFeatureMatrix, float pFactorCorrect, float pFactorIncorrect, int& pNumberCorrectSamples);
+	int GetLocalFeatureMatrix(std::string pClass, CvMat** pFeatureMatrix, float pFactorCorrect, float pFactorIncorrect, int& pNumberCorrectSamples, cv::RNG* pRNG=NULL);
 
 	/// Get a matrix with a given number of negative (non-class) local feature point samples drawn by chance from <code>mLocalFeaturesMap</code>.
 	/// @param pClass The positive class from which no samples are drawn.
 	/// @param pNegativeSamplesMatrix The destination matrix for the negative samples.
 	/// @param pLowerBound Start index from which on negative samples are written into <code>pNegativeSamplesMatrix</code>.
 	/// @param pUpperBound Negative samples are written into <code>pNegativeSamplesMatrix</code> until index (pUpperBound-1).
+	/// @param pRNG Random number generator for drawing the samples. If <code>NULL</code>, <code>rand()</code> is used.
 	/// @return Return code.
-	int GetNegativeSamplesMatrixLocal(std::string pClass, CvMat* pNegativeSamplesMatrix, int pLowerBound, int pUpperBound);
+	int GetNegativeSamplesMatrixLocal(std::string pClass, CvMat* pNegativeSamplesMatrix, int pLowerBound, int pUpperBound, cv::RNG* pRNG=NULL);
 	
 	/// Create a matrix of all local feature samples which occur in <code>mLocalFeaturesMap</code>.
 	/// @param pNumberSamples The total number of samples can be given to the function if already known.
@@ -264,8 +402,10 @@ public:
 	/// @param pFactorCorrect Is the part (0..1] of the whole amout of the given class' global features which shall occur in <code>pFeatureMatrix</code>.
 	/// @param pFactorIncorrect In <code>pFeatureMatrix</code> other class' global features will occur <code>pFactorIncorrect</code> times (0..inf) of the correct class.
 	/// @param pNumberCorrectSamples Is used to return the exact number of positive class samples in <code>pFeatureMatrix</code>.
+	/// @param pRNG Random number generator for drawing the samples. If <code>NULL</code>, <code>rand()</code> is used. Provide an own generator per thread for concurrent calls.
+	/// @param pBuffer If given, <code>pFeatureMatrix</code> becomes a view into this buffer, otherwise it is (re)allocated as needed.
 	/// @return Return code.
-	int GetGlobalFeatureMatrix(std::string pClass, CvMat** pFeatureMatrix, float pFactorCorrect, float pFactorIncorrect, int& pNumberCorrectSamples);
+	int GetGlobalFeatureMatrix(std::string pClass, cv::Mat& pFeatureMatrix, float pFactorCorrect, float pFactorIncorrect, int& pNumberCorrectSamples, cv::RNG* pRNG=NULL, TrainingMatrixBuffer* pBuffer=NULL);
 
 	/// Get a matrix with a given number of negative (non-class) global feature point samples drawn by chance from <code>mGlobalFeaturesMap</code>.
 	/// @param pClass The positive class from which no samples are drawn.
@@ -274,8 +414,12 @@ public:
 	/// @param pLowerBound Start index from which on negative samples are written into <code>pNegativeSamplesMatrix</code>.
 	/// @param pUpperBound Negative samples are written into <code>pNegativeSamplesMatrix</code> until index (pUpperBound-1).
 	/// @param pViewsPerObject Can be used to reduce the number of views which are used for training of each object. By default (-1), all views are used for training.
+	/// @param pRNG Random number generator for drawing the samples. If <code>NULL</code>, <code>rand()</code> is used.
 	/// @return Return code.
-	int GetNegativeSamplesMatrixGlobal(std::string pClass, CvMat* pNegativeSamplesMatrix, std::vector<std::string>& pLabels, int pLowerBound, int pUpperBound, int pViewsPerObject=-1);
+	int GetNegativeSamplesMatrixGlobal(std::string pClass, CvMat* pNegativeSamplesMatrix, std::vector<std::string>& pLabels, int pLowerBound, int pUpperBound, int pViewsPerObject=-1, cv::RNG* pRNG=NULL);
+	/// Same as above, writing into an existing <code>cv::Mat</code> (or a view of it, e.g. from a <code>TrainingMatrixBuffer</code>).
+	/// The samples are converted to the type of <code>pNegativeSamplesMatrix</code>.
+	int GetNegativeSamplesMatrixGlobal(std::string pClass, cv::Mat& pNegativeSamplesMatrix, std::vector<std::string>& pLabels, int pLowerBound, int pUpperBound, int pViewsPerObject=-1, cv::RNG* pRNG=NULL);
 
 	// this one just uses a certain range of samples from the global sample matrices 
 	int GetNegativeSamplesMatrixGlobalSampleRange(std::string pClass, CvMat* pNegativeSamplesMatrix, std::vector<std::string>& pLabels, int pLowerBound, int pUpperBound, double rangeStartFactor, double rangeEndFactor);
@@ -317,11 +461,19 @@ public:
 	StatisticsMap mStatisticsMap;		///< Map for the (temporary) storage of the classifier performance statistics for each class' classifier (ClassName, ClassifierPerformanceStruct).
 
 private:
+	/// Releases all matrices of <code>mGlobalFeaturesMap</code> and a mapped global feature file.
+	void ClearGlobalFeatures();
+
+	/// Sum over all loaded local or global feature values, used to compare loaded data.
+	double FeatureChecksum(bool pLocalFeatures);
+
 	/// Some iterators for convenience.
 	LocalFeaturesMap::iterator mItLocalFeaturesMap;
 	ObjectMap::iterator mItObjectMap;
 	GlobalFeaturesMap::iterator mItGlobalFeaturesMap;
 
+	boost::shared_ptr<ipa_utils::MappedFile> mGlobalFeaturesFile;	///< mapped binary file the matrices of mGlobalFeaturesMap point into (if loaded with LoadGlobalFeaturesBinary)
+
 };
 
 struct ObjectLocalizationIdentification
@@ -358,7 +510,14 @@ public:
 		std::string useFeature;	// enables/disables the use of features: useFeature["surf"] = false; 	useFeature["rsd"] = true;	useFeature["fpfh"] = true;
 	};
 
-	ObjectClassifier() {} ;
+	/// Reference point cloud of one pan/tilt view for the pose refinement of Hermes, prepared once by HermesDetectInit.
+	struct HermesReferenceModel
+	{
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud;	// valid points of the reference view, centered at their mean and optionally downsampled
+		pcl::search::KdTree<pcl::PointXYZRGB>::Ptr tree;	// search tree over cloud, used as ICP target search
+	};
+
+	ObjectClassifier() : mHermesReferenceVoxelSize(0.), mHermesVfhViewMaxMass(0.f), mHermesApproximateViewSearch(true), mHermesViewSearchTrees(4), mHermesViewSearchChecks(64) {} ;
 	ObjectClassifier(std::string pEMClusterFilename, std::string pGlobalClassifierPath);
 
 	/// Load function for the CIN database.
@@ -379,11 +538,21 @@ public:
 	/// @return Return code.
 	int LoadCINDatabase(std::string pAnnotationFileName, std::string pDatabasePath, int pMode, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, std::string pLocalFeatureFileName = "Data/IPAFP_loc.txt", std::string pGlobalFeatureFileName = "Data/IPAFP_glob.txt", std::string pCovarianceMatrixFileName = "Data/IPAFP_loc_covar.txt", std::string pLocalFeatureClustererPath = "Data/Classifier/", std::string pTimingLogFileName = "timing.txt", MaskMode pMaskMode = MASK_NO);
 
+	/// Load function for the CIN2 (IPA2) database, parameters as for <code>LoadCINDatabase()</code>.
+	/// @param pDescriptorCachePath If not empty, the local features and each group of global descriptor families are cached per view in this directory,
+	/// keyed by the content of the input files and the relevant parameters. A later run then only recomputes the descriptors whose inputs or parameters changed.
+	/// @param pNumberThreads Number of views whose descriptors are computed concurrently while further views are read from disk (1 = serial, 0 = number of hardware threads).
+	/// The results are merged in the order of the serial loader. With more than one thread, messages of the descriptor computation are not written to <code>pScreenLogFile</code>.
+	/// @return Return code.
 	int LoadCIN2Database(std::string pAnnotationFileName, std::string pDatabasePath, int pMode, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, LocalFeatureParams& pLocalFeatureParams, std::string pLocalFeatureFileName,
-						 std::string pGlobalFeatureFileName, std::string pCovarianceMatrixFileName, std::string pLocalFeatureClustererPath, std::string pTimingLogFileName, std::ofstream& pScreenLogFile, MaskMode pMaskMode);
+						 std::string pGlobalFeatureFileName, std::string pCovarianceMatrixFileName, std::string pLocalFeatureClustererPath, std::string pTimingLogFileName, std::ofstream& pScreenLogFile, MaskMode pMaskMode, std::string pDescriptorCachePath="",
+						 int pNumberThreads=1);
 
+	/// Load function for the Washington RGB-D object database (or the IPA3 database if <code>useIPA3Database</code> is set), parameters as for <code>LoadCIN2Database()</code>.
+	/// @return Return code.
 	int LoadWashingtonDatabase(std::string pAnnotationFileName, std::string pDatabasePath, int pMode, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, std::string pLocalFeatureFileName,
-						std::string pGlobalFeatureFileName, std::string pCovarianceMatrixFileName, std::string pLocalFeatureClustererPath, std::string pTimingLogFileName, std::ofstream& pScreenLogFile, MaskMode pMaskMode, bool useIPA3Database=false);
+						std::string pGlobalFeatureFileName, std::string pCovarianceMatrixFileName, std::string pLocalFeatureClustererPath, std::string pTimingLogFileName, std::ofstream& pScreenLogFile, MaskMode pMaskMode, bool useIPA3Database=false, std::string pDescriptorCachePath="",
+						int pNumberThreads=1);
 
 	/// Load function for the ALOI database.
 	/// Loads the local and global features of all objects of the database for further use with cross-validation or classifier training tasks.
@@ -427,8 +596,10 @@ public:
 	/// @param pFactorCorrect Is the part (0..1] of the whole amout of the given class' local features which shall occur in the training data matrices (usually set to 1.0).
 	/// @param pFactorIncorrect In the training data matrices other class' local features will occur <code>pFactorIncorrect</code> times (0..inf) of the correct class.
 	/// @param pClassifierType The type of used classifier (cf. enum <code>ClassifierType</code>).
+	/// @param pNumberThreads Number of classes trained concurrently. 1 trains the classes one after another with samples drawn by <code>rand()</code>, 0 uses all hardware threads.
+	/// @param pRandomSeed Base seed for the multi-threaded mode. Every class draws its samples and trains its classifier with an own generator seeded from this value and the class name, so results do not depend on the number of threads.
 	/// @return Return code.
-	int TrainLocal(std::string pClassifierSavePath, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType);
+	int TrainLocal(std::string pClassifierSavePath, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType, int pNumberThreads=1, unsigned int pRandomSeed=1);
 
 	/// Single class local classifier training method with previous training matrix construction.
 	/// This method trains the local classifier for one category but builds the necessary training data matrix before. The built is done with a list of the 
@@ -465,8 +636,10 @@ public:
 	/// @param pFactorCorrect Is the part (0..1] of the whole amout of the given class' global features which shall occur in the training data matrices (usually set to 1.0).
 	/// @param pFactorIncorrect In the training data matrices other class' global features will occur <code>pFactorIncorrect</code> times (0..inf) of the correct class.
 	/// @param pClassifierType The type of used classifier (cf. enum <code>ClassifierType</code>).
+	/// @param pNumberThreads Number of classes trained concurrently. 1 trains the classes one after another with samples drawn by <code>rand()</code>, 0 uses all hardware threads.
+	/// @param pRandomSeed Base seed for the multi-threaded mode. Every class draws its samples and trains its classifier with an own generator seeded from this value and the class name, so results do not depend on the number of threads.
 	/// @return Return code.
-	int TrainGlobal(std::string pPath, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType);
+	int TrainGlobal(std::string pPath, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType, int pNumberThreads=1, unsigned int pRandomSeed=1);
 
 	/// Single class global classifier training method with previous training matrix construction.
 	/// This method trains the global classifier for one category but builds the necessary training data matrix before. The built is done with a list of the 
@@ -475,6 +648,7 @@ public:
 	/// where the negative samples can be found in the matrix <code>pNegativeSamplesMatrix</code>. This method is primarily used by <code>CrossValidationGlobal()</code>
 	/// and it is rather not commended to be used directly except one needs exactly this funtionality.
 	/// This method needs the global features to be loaded into <code>mData.mLocalFeaturesMap</code> before.
+	/// The training data matrix is assembled in <code>mTrainingFeatureBuffer</code>, so the method must not run concurrently on the same object.
 	/// @param pClassifierType The type of used classifier (cf. enum <code>ClassifierType</code>).
 	/// @param pClass The class whose classifier shall be trained.
 	/// @param pNumberSamples The total number of positive and negative samples which determines the number of rows of the training data matrix.
@@ -519,6 +693,32 @@ public:
 	/// @return Return code.
 	int PredictGlobal(ClassifierType pClassifierType, std::string pClass, CvMat* pFeatureData, double& pPredictionResponse);
 
+	/// Class membership prediction with the given classifier.
+	/// @param pClassifierType The type of used classifier (cf. enum <code>ClassifierType</code>).
+	/// @param pClassifier The classifier model.
+	/// @param pFeatureData A one-dimensional matrix (1 x number global features) with the global feature vector.
+	/// @param pPredictionResponse The prediction result is written into this variable.
+	/// @return Return code.
+	int PredictGlobal(ClassifierType pClassifierType, CvStatModel* pClassifier, CvMat* pFeatureData, double& pPredictionResponse);
+
+	/// Batch class membership prediction of many samples for many classes.
+	/// Each classifier is resolved once per call and evaluated on all rows, so the cost per sample and class is a bare <code>predict</code>.
+	/// @param pClassifierType The type of used classifier (cf. enum <code>ClassifierType</code>).
+	/// @param pTable The classifiers, see <code>GlobalClassifierTable</code>.
+	/// @param pFeatureData The samples (number samples x number global features), one global feature vector per row.
+	/// @param pResponses Receives the responses (number samples x <code>pTable.Size()</code>, CV_32FC1), entry (i,c) is the response of classifier c to sample i.
+	/// An existing matrix of the right size is reused, otherwise it is (re)created and has to be released by the caller.
+	/// @return Return code.
+	int PredictGlobalBatch(ClassifierType pClassifierType, const GlobalClassifierTable& pTable, const CvMat* pFeatureData, CvMat** pResponses);
+
+	/// Batch class membership prediction with all classifiers of <code>mData.mGlobalClassifierMap</code>, columns in the order of the map.
+	/// @param pClassifierType The type of used classifier (cf. enum <code>ClassifierType</code>).
+	/// @param pFeatureData The samples (number samples x number global features), one global feature vector per row.
+	/// @param pResponses Receives the responses (number samples x number classes, CV_32FC1), see above.
+	/// @param pClassNames Receives the class name of each column.
+	/// @return Return code.
+	int PredictGlobalBatch(ClassifierType pClassifierType, const CvMat* pFeatureData, CvMat** pResponses, std::vector<std::string>& pClassNames);
+
 	/// Class membership prediction, loads the predictor from file.
 	/// This method accepts one global feature sample (i.e. a global feature vector) and decides on the basis of a previously trained classifier whether this sample belongs to <code>pClass</code> or not. The predictor is loaded previously from file.
 	/// Please note: Old code, should not be used.
@@ -682,11 +882,12 @@ public:
 
 	/// Cross-validation with a multi-class classifier.
 	/// @param pViewsPerObject Can be used to reduce the number of views which are used for training of each object. By default (-1), all views are used for training.
+	/// @param pNumberThreads Number of folds computed in parallel (1 = serial, 0 = number of hardware threads). The results do not depend on this number.
 	int CrossValidationGlobalMultiClass(std::string pStatisticsPath, std::string pFileDescription, ClassifierType pClassifierType, int pFold, float pFactorIncorrect, float pPercentTest, float pPercentValidation,
-								int pViewsPerObject=-1, std::ofstream* pScreenLogFile=0);
+								int pViewsPerObject=-1, std::ofstream* pScreenLogFile=0, int pNumberThreads=1);
 
 	int CrossValidationGlobalMultiClassSampleRange(std::string pStatisticsPath, std::string pFileDescription, ClassifierType pClassifierType, int pFold, float pFactorIncorrect, float pPercentTest, float pPercentValidation,
-		int pViewsPerObject=-1, std::ofstream* pScreenLogFile=0, double pFactorSamplesTrainData=0.5);
+		int pViewsPerObject=-1, std::ofstream* pScreenLogFile=0, double pFactorSamplesTrainData=0.5, int pNumberThreads=1);
 
 
 	/// loads the parameters for runtime use
@@ -697,9 +898,25 @@ public:
 
 	/// Callback for point cloud data from kinect
 	void PointcloudCallback(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &pInputCloud, ClusterMode pClusterMode, ClassifierType pClassifierTypeGlobal, GlobalFeatureParams& pGlobalFeatureParams);
+
+	/// Segments the objects in the considered cluster center volume with voxel grid, RANSAC plane removal and euclidean clustering (<code>SEGMENTATION_VOXELGRID</code>).
+	/// @param pInputCloud The organized input cloud.
+	/// @param pObjectPixelIndices Returns the indices of the pixels of each object in <code>pInputCloud</code>.
+	/// @param pObjectCenters Returns the center of each object in [m].
+	/// @return Return code.
+	int SegmentObjectsVoxelGrid(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& pInputCloud, std::vector<pcl::PointIndices>& pObjectPixelIndices, std::vector<cv::Point3d>& pObjectCenters);
+
+	/// Segments the objects in the considered cluster center volume on the image grid of the organized cloud (<code>SEGMENTATION_ORGANIZED</code>).
+	/// The planes are found by organized multi-plane segmentation on integral image normals, the remaining pixels are grouped into connected components.
+	/// @param pInputCloud The organized input cloud.
+	/// @param pObjectPixelIndices Returns the indices of the pixels of each object in <code>pInputCloud</code>.
+	/// @param pObjectCenters Returns the center of each object in [m].
+	/// @return Return code.
+	int SegmentObjectsOrganized(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& pInputCloud, std::vector<pcl::PointIndices>& pObjectPixelIndices, std::vector<cv::Point3d>& pObjectCenters);
 	int mImageNumber;
 
 	/// Categorizes an object
+	/// Only reads the loaded clusterer and classifiers, so several objects may be categorized concurrently.
 	/// @param pResultsOrdered ordered list of results (percentage, class name)
 	int CategorizeObject(SharedImage* pSourceImage, std::map<std::string, double>& pResults, std::map<double, std::string>& pResultsOrdered, ClusterMode pClusterMode, ClassifierType pClassifierTypeGlobal, GlobalFeatureParams& pGlobalFeatureParams);
 
@@ -709,7 +926,10 @@ public:
 
 	// Hermes
 	int HermesLoadCameraCalibration(const std::string& object_name, cv::Mat& projection_matrix);
+	/// Loads the detection model of pObjectName, which is kept for subsequent calls with the same object.
 	int HermesDetectInit(const ClusterMode pClusterMode, const ClassifierType pClassifierTypeGlobal, const GlobalFeatureParams& pGlobalFeatureParams, const std::string& pObjectName);
+	/// Reads the descriptors and reference views of the object mFilePrefix from disk, replacing the previously loaded object.
+	int HermesLoadDetectionModel();
 	void HermesPointcloudCallbackDetect(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &pInputCloud, ClusterMode pClusterMode, ClassifierType pClassifierTypeGlobal, GlobalFeatureParams& pGlobalFeatureParams);
 	int HermesCategorizeObject(pcl::PointCloud<pcl::PointXYZRGB>::Ptr pPointCloud, pcl::PointXYZ pAvgPoint, SharedImage* pSourceImage, ClusterMode pClusterMode, ClassifierType pClassifierTypeGlobal, GlobalFeatureParams& pGlobalFeatureParams, double& pan, double& tilt, double& roll, Eigen::Matrix4f& pFinalTransform, double& pMatchingScore);
 	int HermesCapture(ClusterMode pClusterMode, ClassifierType pClassifierTypeGlobal, GlobalFeatureParams& pGlobalFeatureParams);
@@ -719,6 +939,24 @@ public:
 	int HermesMatchRollHistogram(std::vector<float>& pReferenceHistogram, cv::Mat& pMatchHistogram, int pCoarseStep, int& pOffset, double& pMatchScore);
 	double HermesHistogramIntersectionKernel(std::vector<float>& pReferenceHistogram, cv::Mat& pMatchHistogram, int pOffset);
 	int HermesMatchPointClouds(pcl::PointCloud<pcl::PointXYZRGB>::Ptr pCapturedCloud, pcl::PointXYZ pAvgPoint, double pan, double tilt, double roll, Eigen::Matrix4f& pFinalTransform, double& pMatchingScore);
+	/// Loads a reference view from disk, centers it, downsamples it with mHermesReferenceVoxelSize and builds its search tree.
+	int HermesLoadReferenceModel(const std::string& pFilename, HermesReferenceModel& pModel);
+	/// Copies the mean VFH descriptors of all views (mVfhData) into one contiguous matrix and builds the approximate nearest neighbor index (randomized kd-forest) over it.
+	/// Histogram intersection is no distance, but for nonnegative histograms a and b it holds sum_i min(a_i,b_i) = (|a| + |b| - L1(a,b))/2.
+	/// Hence each row is augmented by its mass |b| and each query by mHermesVfhViewMaxMass, so the L1 distance of the index ranks the views exactly like the intersection kernel.
+	int HermesBuildViewIndex();
+	/// Retrieves the pK views whose mean VFH descriptor fits pDescriptor best.
+	/// @param pDescriptor Query descriptor (1 x descriptor size, CV_32FC1).
+	/// @param pK Number of retrieved views.
+	/// @param pApproximate Searches the kd-forest if true, else compares pDescriptor with all views.
+	/// @param pViews Returns (-histogram intersection, (pan, tilt)) of the retrieved views in ascending order of the score, the convention of the former vfhOrderedList.
+	int HermesRetrieveViews(const cv::Mat& pDescriptor, int pK, bool pApproximate, std::vector<std::pair<double, std::pair<double, double> > >& pViews);
+	/// Compares exact and approximate view retrieval on the loaded views (HermesDetectInit), the queries are the view descriptors with multiplicative noise.
+	/// @param pNumberQueries Number of queries.
+	/// @param pK Number of retrieved views per query.
+	/// @param pNoiseLevel Standard deviation of the relative noise added to each histogram bin of a query.
+	/// @param pOutput Receives the query time of both searches, the recall of the approximate top pK views and the rate of identical best views.
+	int HermesViewIndexBenchmark(int pNumberQueries, int pK, double pNoiseLevel, std::ostream& pOutput);
 	bool mFinishCapture;
 	double mPanAngle;
 	double mTiltAngle;
@@ -729,6 +967,16 @@ public:
 	std::map<double, std::map<double, std::vector<std::vector<float> > > > mVfhData;
 	std::map<double, std::map<double, std::vector<std::vector<float> > > > mRollHistogram;
 	std::map<double, std::map<double, std::string > > mReferenceFilenames;
+	std::map<double, std::map<double, HermesReferenceModel> > mReferenceModels;		// [pan][tilt], memory resident reference views of mReferenceFilenames
+	double mHermesReferenceVoxelSize;		// leaf size [m] of the voxel grid applied to the reference views, 0 keeps the full resolution
+	std::string mHermesLoadedObjectName;		// object of the loaded detection model (HermesLoadDetectionModel), empty if none is loaded
+	cv::Mat mHermesVfhViewDescriptors;		// [view][descriptor index], mean VFH descriptor of each view of mVfhData in one contiguous matrix, the last column holds the descriptor mass
+	std::vector<std::pair<double, double> > mHermesVfhViewAngles;		// (pan, tilt) of each row of mHermesVfhViewDescriptors
+	float mHermesVfhViewMaxMass;		// largest descriptor mass of all views, mass coordinate of the queries
+	cv::Ptr<cv::flann::Index> mHermesVfhViewIndex;		// randomized kd-forest over mHermesVfhViewDescriptors (L1 distance)
+	bool mHermesApproximateViewSearch;		// retrieves the views with mHermesVfhViewIndex if true, else compares with all views
+	int mHermesViewSearchTrees;		// number of randomized kd-trees of mHermesVfhViewIndex
+	int mHermesViewSearchChecks;		// number of leaves visited by an approximate query, higher values are more accurate and slower
 
 
 	/// Decide whether an object of a certain class is visible or not (and where).
@@ -795,6 +1043,8 @@ public:
 	/// added. These are: A PCA analysis where the largest PCA Eigenvalue is saved as feature as it is and the both other Eigenvalues relative to it (percentage),
 	/// a 3D surface curve fitting along the Eigenvector projections to the 2D image and statistics about feature point frame directions compared to
 	/// the largest principal component (eigenvector).
+	/// The descriptor families are the plugins of <code>GlobalDescriptorRegistry</code> (see GlobalDescriptors.h), which share the intermediate results of a view.
+	/// Each additional artificial tilt angle adds a row to <code>pGlobalFeatures</code>.
 	/// The local features must be computed before because the list of local features of the image is needed. Furthermore, the local feature clusterer must be loaded before.
 	/// @param pBlobFeatures List of local features (input to this function).
 	/// @param pGlobalFeatures Returned vector containing the extracted global features for the object/image.
@@ -884,6 +1134,112 @@ public:
 	ClassificationData* GetDataPointer() { return &mData; };
 
 private:
+	/// Settings of a database loader which are shared by all views.
+	struct DatabaseLoaderSettings
+	{
+		Database database;							///< CIN2 or WASHINGTON
+		ClusterMode clusterMode;
+		MaskMode maskMode;
+		LocalFeatureParams* localFeatureParams;		///< only used for CIN2
+		GlobalFeatureParams* globalFeatureParams;
+		std::string timingLogFileName;
+		std::ofstream* screenLogFile;				///< NULL if the views are processed concurrently
+	};
+
+	/// A single view of a database and the results of its descriptor computation in the pipelined database loaders.
+	struct DatabaseView
+	{
+		std::string category;				///< class of the view in <code>LocalFeaturesMap</code>
+		int objectIndex;					///< object of the view in <code>ObjectMap</code>
+		std::string className;				///< class name passed to <code>ExtractLocalFeatures()</code>
+		BlobListStruct localFeatures;		///< file name and computed local features of the view
+		BlobListStruct* blobList;			///< local features of the view in mData, input of the global descriptor computation
+		ipa_utils::DescriptorCacheKey cacheKey;	///< key of the local features
+		bool useCache;						///< true if <code>cacheKey</code> is valid
+		std::vector<GlobalFeatureCacheGroup> cacheGroups;	///< groups of global descriptor families, cf. <code>LoadGlobalFeaturesFromCache()</code>
+		bool readError;						///< true if the input files could not be read, the loader stops at this view
+		int result;							///< return code of the descriptor computation
+		CvMat* globalFeatures;				///< computed global descriptor, released by the loader
+	};
+
+	/// Coordinate image and mask of a view, decoded for the global descriptor computation.
+	struct DatabaseViewCoordinates
+	{
+		cv::Mat coordinateImage;	///< CV_32FC3
+		cv::Mat mask;				///< CV_8UC1, empty if not available
+	};
+
+	/// Decode stage of the pipelined local feature extraction: reads the local features from the descriptor cache or loads the images of the view.
+	/// @return True if the local features have to be computed.
+	bool LoadDatabaseViewImages(const DatabaseLoaderSettings* pSettings, std::vector<DatabaseView>* pViews, int pViewIndex, boost::shared_ptr<SharedImage>& pImage);
+
+	/// Process stage of the pipelined local feature extraction.
+	void ExtractDatabaseViewLocalFeatures(const DatabaseLoaderSettings* pSettings, std::vector<DatabaseView>* pViews, int pViewIndex, boost::shared_ptr<SharedImage>& pImage);
+
+	/// Decode stage of the pipelined global feature extraction: reads the global descriptor from the descriptor cache or loads the coordinate image and mask of the view.
+	/// @return True if (a part of) the global descriptor has to be computed.
+	bool LoadDatabaseViewCoordinates(const DatabaseLoaderSettings* pSettings, std::vector<DatabaseView>* pViews, int pViewIndex, DatabaseViewCoordinates& pCoordinates);
+
+	/// Process stage of the pipelined global feature extraction.
+	void ExtractDatabaseViewGlobalFeatures(const DatabaseLoaderSettings* pSettings, std::vector<DatabaseView>* pViews, int pViewIndex, DatabaseViewCoordinates& pCoordinates);
+
+	/// Creates a new view for the pipelined database loaders.
+	static DatabaseView MakeDatabaseView(const std::string& pCategory, int pObjectIndex, const std::string& pClassName, const std::string& pFileName, BlobListStruct* pBlobList);
+
+	/// Creates and trains a new local classifier of the given type. The caller takes ownership of the returned model.
+	/// @param pClassifierType The type of used classifier (cf. enum <code>ClassifierType</code>).
+	/// @param pTrainingFeatureMatrix A (number samples x number features) matrix with local feature samples aligned in rows.
+	/// @param pTrainingCorrectResponses A one-dimensional (number samples x 1) vector indicating the correct classifier responses.
+	/// @return The trained classifier or <code>NULL</code> if the classifier type is unknown.
+	CvStatModel* CreateLocalClassifier(ClassifierType pClassifierType, CvMat* pTrainingFeatureMatrix, CvMat* pTrainingCorrectResponses);
+
+	/// Creates and trains a new global classifier of the given type. The caller takes ownership of the returned model.
+	/// @param pClassifierType The type of used classifier (cf. enum <code>ClassifierType</code>).
+	/// @param pTrainingFeatureMatrix A (number samples x number features) matrix with global feature samples aligned in rows.
+	/// @param pTrainingCorrectResponses A one-dimensional (number samples x 1) vector indicating the correct classifier responses.
+	/// @return The trained classifier or <code>NULL</code> if the classifier type is unknown.
+	CvStatModel* CreateGlobalClassifier(ClassifierType pClassifierType, CvMat* pTrainingFeatureMatrix, CvMat* pTrainingCorrectResponses);
+
+	/// Worker task of the multi-threaded <code>TrainLocal()</code>: builds the training data of one class with its own random generator and trains the classifier.
+	void TrainLocalClassTask(std::string pClass, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType, unsigned int pRandomSeed, boost::mutex* pResultMutex);
+
+	/// Worker task of the multi-threaded <code>TrainGlobal()</code>: builds the training data of one class with its own random generator and trains the classifier.
+	void TrainGlobalClassTask(std::string pClass, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType, unsigned int pRandomSeed, boost::mutex* pResultMutex);
+
+	/// Trains and validates one fold of the multi-class cross-validation. Uses only fold-local classifiers and random generators, so folds can run concurrently.
+	/// @param pSetup Training and validation sets of the fold.
+	/// @param pResult The statistics of the fold are written into this structure.
+	void CrossValidationGlobalMultiClassFold(const MultiClassFoldSetup* pSetup, MultiClassFoldResult* pResult);
+
+	/// Runs the folds of the multi-class cross-validation (in parallel if <code>pNumberThreads</code> != 1) and merges their results in fold order.
+	/// @return Return code.
+	int CrossValidationGlobalMultiClassRunFolds(std::vector<MultiClassFoldSetup>& pFoldSetups, int pNumberThreads, MultiClassStatistics& pMulticlassStatistics, MultiClassStatistics& pMulticlassStatisticsBinary,
+							std::vector<MultiClassStatistics>& pSingleFoldMulticlassStatistics, std::vector<MultiClassStatistics>& pSingleFoldMulticlassStatisticsBinary,
+							std::map<std::string, std::map< int, std::vector< std::string > > >& pIndividualResults, std::ofstream* pScreenLogFile);
+
+	/// Number of descriptor columns which <code>ExtractGlobalFeatures()</code> creates for a descriptor family in mode <code>CLUSTER_EM</code> (size of the registered plugin).
+	/// @param pFamily The family (key of <code>GlobalFeatureParams::useFeature</code>).
+	/// @return Number of columns, 0 for unknown families.
+	int GlobalFeatureFamilySize(const std::string& pFamily, GlobalFeatureParams& pGlobalFeatureParams);
+
+	/// Determines the enabled groups of global descriptor families of a view and their cache keys and reads them from the descriptor cache.
+	/// @param pBlobFeatures The local features of the view, they are part of the keys.
+	/// @param pViewKey Key over the input files of the view.
+	/// @param pGroups The enabled groups, <code>available</code> is set for all groups found in the cache. Empty if the cache cannot be used for these parameters.
+	/// @param pGlobalFeatures The complete descriptor if all groups were found in the cache.
+	/// @return True if all groups were found in the cache and <code>pGlobalFeatures</code> is valid.
+	bool LoadGlobalFeaturesFromCache(BlobListRiB* pBlobFeatures, CvMat** pGlobalFeatures, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, const ipa_utils::DescriptorCacheKey& pViewKey,
+									std::vector<GlobalFeatureCacheGroup>& pGroups);
+
+	/// Computes the groups which were not found by <code>LoadGlobalFeaturesFromCache()</code> with a single call of <code>ExtractGlobalFeatures()</code>,
+	/// stores them in the descriptor cache and assembles the complete descriptor. Falls back to <code>ExtractGlobalFeatures()</code> if <code>pGroups</code> is empty.
+	/// @return Return code.
+	int ExtractGlobalFeaturesCached(BlobListRiB* pBlobFeatures, CvMat** pGlobalFeatures, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, std::vector<GlobalFeatureCacheGroup>& pGroups,
+									Database pDatabase, const IplImage* pCoordinateImage, IplImage* pMask, std::string pTimingLogFileName, std::ofstream* pScreenLogFile);
+
+	/// Adds the parameters of the local feature clusterer (<code>mLocalFeatureClusterer</code>) to a cache key.
+	void AddLocalFeatureClustererToCacheKey(ipa_utils::DescriptorCacheKey& pKey);
+
 	/// Converts a binary number to an integer.
 	/// @param pBinary Binary number, first entry = LSB, last entry = MSB.
 	/// @return Integer value of the binary number.
@@ -909,6 +1265,12 @@ private:
 
 	ClassificationData mData;		///< Data container for all classifier, feature and statistics data.
 
+	TrainingMatrixBuffer mTrainingFeatureBuffer;		///< Training data matrix of the sequential training and cross-validation cycles.
+	TrainingMatrixBuffer mTrainingResponseBuffer;		///< Response matrix of the sequential training and cross-validation cycles.
+	TrainingMatrixBuffer mNegativeSamplesBuffer;		///< Negative samples of <code>CrossValidationGlobal()</code>.
+
+	ipa_utils::DescriptorCache mDescriptorCache;	///< On-disk cache for the descriptors computed by the database loaders, disabled if no path is set.
+
 	boost::mutex mDisplayImageMutex;
 
 	cv::Mat mDisplayImageOriginal, mDisplayImageSegmentation;
@@ -930,4 +1292,12 @@ private:
 	cv::Point3f mConsideredClusterCenterVolume;	// in [m]
 	cv::Scalar mDisplayFontColorBGR;	// order: B, G, R
 	double mTrackingInfluenceFactorOldData;	// within [0.0, 1.0]
+	SegmentationMode mSegmentationMode;	// SEGMENTATION_VOXELGRID or SEGMENTATION_ORGANIZED
+	float mOrganizedNormalMaxDepthChangeFactor;	// in [m]
+	float mOrganizedNormalSmoothingSize;	// in [pixels]
+	unsigned int mOrganizedPlaneMinInliers;	// in [#pixels]
+	double mOrganizedPlaneAngularThreshold;	// in [deg]
+	double mOrganizedClusterDistanceThreshold;	// in [m], maximum distance of neighboring pixels of one cluster
+	int mOrganizedClusterMinClusterSize;	// in [#pixels]
+	int mOrganizedClusterMaxClusterSize;	// in [#pixels]
 };
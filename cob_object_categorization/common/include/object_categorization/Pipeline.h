@@ -0,0 +1,192 @@
+/// @file Pipeline.h
+/// Two-stage pipeline based on boost::thread for the database loaders: decode workers (file I/O) feed a bounded queue which is drained by processing workers (descriptor computation).
+/// Disk access and computation overlap and the number of decoded items in memory is limited by the queue capacity.
+/// An exception thrown by a stage stops the pipeline, the first one is rethrown by Run() after all workers have finished.
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <deque>
+#include <utility>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace ipa_utils {
+
+/// Queue with a maximum number of entries. push() blocks while the queue is full, pop() blocks while it is empty.
+template <class T>
+class BoundedQueue
+{
+public:
+	/// @param pCapacity Maximum number of entries (at least 1).
+	BoundedQueue(size_t pCapacity)
+	{
+		mCapacity = (pCapacity < 1) ? 1 : pCapacity;
+		mClosed = false;
+	};
+
+	/// Appends an entry, waits while the queue is full.
+	/// @return False if the queue has been closed.
+	bool push(const T& pEntry)
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		while (mEntries.size() >= mCapacity && mClosed == false)
+			mNotFull.wait(lock);
+		if (mClosed == true)
+			return false;
+		mEntries.push_back(pEntry);
+		mNotEmpty.notify_one();
+		return true;
+	};
+
+	/// Removes the first entry, waits while the queue is empty.
+	/// @return False if the queue is closed and empty.
+	bool pop(T& pEntry)
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		while (mEntries.empty() && mClosed == false)
+			mNotEmpty.wait(lock);
+		if (mEntries.empty())
+			return false;
+		pEntry = mEntries.front();
+		mEntries.pop_front();
+		mNotFull.notify_one();
+		return true;
+	};
+
+	/// No more entries are accepted, waiting consumers return as soon as the queue is empty.
+	void close()
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mClosed = true;
+		mNotEmpty.notify_all();
+		mNotFull.notify_all();
+	};
+
+private:
+	size_t mCapacity;
+	bool mClosed;
+	std::deque<T> mEntries;
+	boost::mutex mMutex;
+	boost::condition_variable mNotEmpty;
+	boost::condition_variable mNotFull;
+};
+
+/// Runs tasks 0..pNumberTasks-1 through the two stages decode and process.
+/// The decode function fills the item of a task and returns true if the task still needs the process stage (false e.g. for cache hits or errors).
+/// The functions are called concurrently for different tasks, each task has to write its results to its own place (e.g. a vector indexed by the task number)
+/// so that the caller can merge them in a deterministic order.
+template <class T>
+class Pipeline
+{
+public:
+	typedef boost::function<bool (int, T&)> DecodeFunction;
+	typedef boost::function<void (int, T&)> ProcessFunction;
+
+	/// @param pNumberTasks Number of tasks.
+	/// @param pDecode Decode stage, called in the order of the task numbers by the decode workers.
+	/// @param pProcess Process stage.
+	/// @param pNumberThreads Number of process workers. The pipeline additionally uses about a quarter as many decode workers.
+	/// With 1, both stages run sequentially in the calling thread, task after task.
+	static void Run(int pNumberTasks, DecodeFunction pDecode, ProcessFunction pProcess, int pNumberThreads)
+	{
+		if (pNumberThreads <= 1)
+		{
+			for (int task=0; task<pNumberTasks; task++)
+			{
+				T item;
+				if (pDecode(task, item) == true)
+					pProcess(task, item);
+			}
+			return;
+		}
+
+		int numberDecodeThreads = (pNumberThreads+3)/4;
+		BoundedQueue< std::pair<int, T> > queue(2*pNumberThreads);
+		int nextTask = 0;
+		boost::mutex taskMutex;
+		boost::exception_ptr exception;		// first exception of a worker, guarded by taskMutex
+
+		boost::thread_group decodeWorkers, processWorkers;
+		for (int i=0; i<pNumberThreads; i++)
+			processWorkers.create_thread(boost::bind(&Pipeline<T>::ProcessLoop, &taskMutex, &exception, &queue, pProcess));
+		for (int i=0; i<numberDecodeThreads; i++)
+			decodeWorkers.create_thread(boost::bind(&Pipeline<T>::DecodeLoop, pNumberTasks, &nextTask, &taskMutex, &exception, &queue, pDecode));
+		decodeWorkers.join_all();
+		queue.close();
+		processWorkers.join_all();
+
+		if (exception)
+			boost::rethrow_exception(exception);
+	};
+
+private:
+	/// Stores the first exception and closes the queue, so that the other workers stop taking new tasks and entries.
+	static void Fail(boost::mutex* pTaskMutex, boost::exception_ptr* pException, BoundedQueue< std::pair<int, T> >* pQueue)
+	{
+		{
+			boost::mutex::scoped_lock lock(*pTaskMutex);
+			if (!*pException)
+				*pException = boost::current_exception();
+		}
+		pQueue->close();
+	};
+
+	static void DecodeLoop(int pNumberTasks, int* pNextTask, boost::mutex* pTaskMutex, boost::exception_ptr* pException, BoundedQueue< std::pair<int, T> >* pQueue, DecodeFunction pDecode)
+	{
+		try
+		{
+			while (true)
+			{
+				int task = 0;
+				{
+					boost::mutex::scoped_lock lock(*pTaskMutex);
+					if (*pNextTask >= pNumberTasks || *pException)
+						return;
+					task = (*pNextTask)++;
+				}
+				std::pair<int, T> entry(task, T());
+				if (pDecode(task, entry.second) == true)
+				{
+					if (pQueue->push(entry) == false)
+						return;		// closed after a failure
+				}
+			}
+		}
+		catch (...)
+		{
+			Fail(pTaskMutex, pException, pQueue);
+		}
+	};
+
+	static void ProcessLoop(boost::mutex* pTaskMutex, boost::exception_ptr* pException, BoundedQueue< std::pair<int, T> >* pQueue, ProcessFunction pProcess)
+	{
+		try
+		{
+			std::pair<int, T> entry;
+			while (pQueue->pop(entry) == true)
+			{
+				{
+					boost::mutex::scoped_lock lock(*pTaskMutex);
+					if (*pException)
+						return;
+				}
+				pProcess(entry.first, entry.second);
+				entry.second = T();		// release the item before waiting for the next one
+			}
+		}
+		catch (...)
+		{
+			Fail(pTaskMutex, pException, pQueue);
+		}
+	};
+};
+
+} // end namespace ipa_utils
+
+#endif // __PIPELINE_H__
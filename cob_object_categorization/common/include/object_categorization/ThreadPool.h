@@ -0,0 +1,149 @@
+/// @file ThreadPool.h
+/// Small fixed-size worker pool based on boost::thread for the training and feature extraction loops.
+/// Tasks are executed in the order of scheduling by the next free worker. wait() blocks until all scheduled tasks are finished.
+/// An exception thrown by a task does not stop its worker, the first one is rethrown by the next wait().
+
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <deque>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/exception_ptr.hpp>
+
+namespace ipa_utils {
+
+class ThreadPool
+{
+public:
+	/// Starts the workers.
+	/// @param pNumberThreads Number of worker threads, 0 or less selects the number of hardware threads.
+	ThreadPool(int pNumberThreads=0)
+	{
+		mNumberThreads = ResolveNumberThreads(pNumberThreads);
+		mNumberActiveTasks = 0;
+		mShutdown = false;
+		for (int i=0; i<mNumberThreads; i++)
+			mWorkers.create_thread(boost::bind(&ThreadPool::WorkerLoop, this));
+	};
+
+	/// Finishes all scheduled tasks and joins the workers. Exceptions of the tasks that were not collected by wait() are discarded.
+	~ThreadPool()
+	{
+		WaitForTasks();
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			mShutdown = true;
+		}
+		mTaskAvailable.notify_all();
+		mWorkers.join_all();
+	};
+
+	/// Appends a task to the queue.
+	void schedule(const boost::function<void ()>& pTask)
+	{
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			mTasks.push_back(pTask);
+		}
+		mTaskAvailable.notify_one();
+	};
+
+	/// Blocks until the queue is empty and no worker is busy anymore.
+	/// Rethrows the first exception thrown by a task since the last call of wait().
+	void wait()
+	{
+		WaitForTasks();
+		boost::exception_ptr exception;
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			exception = mException;
+			mException = boost::exception_ptr();
+		}
+		if (exception)
+			boost::rethrow_exception(exception);
+	};
+
+	/// Returns the number of workers.
+	int size() const { return mNumberThreads; };
+
+	/// Maps a requested number of threads to the number actually used (0 or less = number of hardware threads, at least 1).
+	static int ResolveNumberThreads(int pNumberThreads)
+	{
+		if (pNumberThreads <= 0)
+			pNumberThreads = (int)boost::thread::hardware_concurrency();
+		return (pNumberThreads < 1) ? 1 : pNumberThreads;
+	};
+
+private:
+	/// Marks a task as finished when it goes out of scope, also if the task throws.
+	class ActiveTaskGuard
+	{
+	public:
+		ActiveTaskGuard(ThreadPool& pPool) : mPool(pPool) {};
+		~ActiveTaskGuard()
+		{
+			boost::mutex::scoped_lock lock(mPool.mMutex);
+			mPool.mNumberActiveTasks--;
+			if (mPool.mTasks.empty() && mPool.mNumberActiveTasks==0)
+				mPool.mTasksFinished.notify_all();
+		};
+	private:
+		ThreadPool& mPool;
+	};
+
+	void WaitForTasks()
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		while (mTasks.empty()==false || mNumberActiveTasks>0)
+			mTasksFinished.wait(lock);
+	};
+
+	void WorkerLoop()
+	{
+		while (true)
+		{
+			boost::function<void ()> task;
+			{
+				boost::mutex::scoped_lock lock(mMutex);
+				while (mTasks.empty() && mShutdown==false)
+					mTaskAvailable.wait(lock);
+				if (mTasks.empty() && mShutdown==true)
+					return;
+				task = mTasks.front();
+				mTasks.pop_front();
+				mNumberActiveTasks++;
+			}
+
+			ActiveTaskGuard guard(*this);
+			try
+			{
+				task();
+			}
+			catch (...)
+			{
+				boost::mutex::scoped_lock lock(mMutex);
+				if (!mException)
+					mException = boost::current_exception();
+			}
+		}
+	};
+
+	int mNumberThreads;
+	int mNumberActiveTasks;
+	bool mShutdown;
+	std::deque<boost::function<void ()> > mTasks;
+	boost::thread_group mWorkers;
+	boost::mutex mMutex;
+	boost::condition_variable mTaskAvailable;
+	boost::condition_variable mTasksFinished;
+	boost::exception_ptr mException;	///< first exception of a task since the last wait()
+};
+
+} // end namespace ipa_utils
+
+#endif // __THREADPOOL_H__
@@ -0,0 +1,272 @@
+#include "object_categorization/DescriptorCache.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#ifdef __LINUX__
+	#include <unistd.h>
+#endif
+
+namespace ipa_utils {
+
+static const char DESCRIPTOR_CACHE_MAGIC[8] = {'I','P','A','D','C','A','C','H'};
+static const boost::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const boost::uint64_t FNV_PRIME = 1099511628211ULL;
+
+/// Header of each cache entry file.
+struct DescriptorCacheEntryHeader
+{
+	char magic[8];				///< always "IPADCACH"
+	boost::uint64_t key;		///< hash of the key, guards against renamed or mixed up files
+	boost::uint64_t dataSize;	///< size of the data following the header in bytes
+};
+
+
+DescriptorCacheKey::DescriptorCacheKey()
+{
+	mHash = FNV_OFFSET_BASIS;
+}
+
+void DescriptorCacheKey::AddBytes(const void* pData, size_t pBytes)
+{
+	const unsigned char* data = (const unsigned char*)pData;
+	for (size_t i=0; i<pBytes; i++)
+	{
+		mHash ^= (boost::uint64_t)data[i];
+		mHash *= FNV_PRIME;
+	}
+}
+
+void DescriptorCacheKey::Add(const std::string& pValue)
+{
+	// the length separates consecutive strings, i.e. "ab"+"c" differs from "a"+"bc"
+	const char type = 's';
+	boost::uint64_t length = pValue.length();
+	AddBytes(&type, 1);
+	AddBytes(&length, sizeof(length));
+	AddBytes(pValue.data(), pValue.length());
+}
+
+void DescriptorCacheKey::Add(int pValue)
+{
+	const char type = 'i';
+	boost::int64_t value = pValue;
+	AddBytes(&type, 1);
+	AddBytes(&value, sizeof(value));
+}
+
+void DescriptorCacheKey::Add(double pValue)
+{
+	const char type = 'd';
+	AddBytes(&type, 1);
+	AddBytes(&pValue, sizeof(pValue));
+}
+
+void DescriptorCacheKey::Add(const void* pData, size_t pBytes)
+{
+	const char type = 'b';
+	boost::uint64_t length = pBytes;
+	AddBytes(&type, 1);
+	AddBytes(&length, sizeof(length));
+	AddBytes(pData, pBytes);
+}
+
+std::string DescriptorCacheKey::Str() const
+{
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << mHash;
+	return ss.str();
+}
+
+
+DescriptorCache::DescriptorCache()
+{
+	mHits = 0;
+	mMisses = 0;
+	mTemporaryFileCounter = 0;
+}
+
+int DescriptorCache::Open(const std::string& pCachePath)
+{
+	boost::mutex::scoped_lock lock(mMutex);
+	mCachePath = pCachePath;
+	mHits = 0;
+	mMisses = 0;
+	if (mCachePath.empty())
+		return RET_OK;
+
+	try
+	{
+		if (fs::exists(mCachePath) == false)
+			fs::create_directories(mCachePath);
+	}
+	catch (const fs::filesystem_error& e)
+	{
+		std::cout << "DescriptorCache::Open: Could not create the cache directory '" << mCachePath << "': " << e.what() << std::endl;
+		mCachePath.clear();
+		return RET_FAILED;
+	}
+	if (fs::is_directory(mCachePath) == false)
+	{
+		std::cout << "DescriptorCache::Open: '" << mCachePath << "' is no directory." << std::endl;
+		mCachePath.clear();
+		return RET_FAILED;
+	}
+	return RET_OK;
+}
+
+int DescriptorCache::AddFile(DescriptorCacheKey& pKey, const std::string& pFileName)
+{
+	boost::uintmax_t size = 0;
+	std::time_t modificationTime = 0;
+	try
+	{
+		size = fs::file_size(pFileName);
+		modificationTime = fs::last_write_time(pFileName);
+	}
+	catch (const fs::filesystem_error&)
+	{
+		return RET_FAILED;
+	}
+
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		std::map<std::string, FileHash>::iterator it = mFileHashes.find(pFileName);
+		if (it != mFileHashes.end() && it->second.size == size && it->second.modificationTime == modificationTime)
+		{
+			pKey.Add(&(it->second.hash), sizeof(it->second.hash));
+			return RET_OK;
+		}
+	}
+
+	// hash the file content outside of the lock, several files may be hashed concurrently
+	std::ifstream file(pFileName.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return RET_FAILED;
+	DescriptorCacheKey contentKey;
+	std::vector<char> buffer(1<<16);
+	while (file)
+	{
+		file.read(&buffer[0], buffer.size());
+		if (file.gcount() > 0)
+			contentKey.Add(&buffer[0], (size_t)file.gcount());
+	}
+
+	FileHash fileHash;
+	fileHash.size = size;
+	fileHash.modificationTime = modificationTime;
+	fileHash.hash = contentKey.Hash();
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mFileHashes[pFileName] = fileHash;
+	}
+	pKey.Add(&fileHash.hash, sizeof(fileHash.hash));
+	return RET_OK;
+}
+
+std::string DescriptorCache::EntryFileName(const DescriptorCacheKey& pKey) const
+{
+	// the first two hex digits select a subdirectory to keep the directories small
+	std::string key = pKey.Str();
+	return mCachePath + "/" + key.substr(0, 2) + "/" + key + ".dc";
+}
+
+bool DescriptorCache::Load(const DescriptorCacheKey& pKey, std::string& pData)
+{
+	if (Enabled() == false)
+		return false;
+
+	bool success = false;
+	std::ifstream file(EntryFileName(pKey).c_str(), std::ios::in | std::ios::binary);
+	if (file.is_open())
+	{
+		DescriptorCacheEntryHeader header;
+		file.read((char*)&header, sizeof(header));
+		if (file.gcount() == (std::streamsize)sizeof(header) && memcmp(header.magic, DESCRIPTOR_CACHE_MAGIC, sizeof(header.magic)) == 0 && header.key == pKey.Hash())
+		{
+			pData.resize((size_t)header.dataSize);
+			if (header.dataSize > 0)
+				file.read(&pData[0], (std::streamsize)header.dataSize);
+			success = (header.dataSize == 0) || (file.gcount() == (std::streamsize)header.dataSize);
+		}
+	}
+	if (success == false)
+		pData.clear();
+
+	boost::mutex::scoped_lock lock(mMutex);
+	if (success)
+		mHits++;
+	else
+		mMisses++;
+	return success;
+}
+
+int DescriptorCache::Store(const DescriptorCacheKey& pKey, const std::string& pData)
+{
+	if (Enabled() == false)
+		return RET_FAILED;
+
+	std::string fileName = EntryFileName(pKey);
+	std::stringstream temporaryFileName;
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		temporaryFileName << fileName << ".tmp" << mTemporaryFileCounter++;
+#ifdef __LINUX__
+		temporaryFileName << "_" << getpid();
+#endif
+	}
+
+	try
+	{
+		fs::path directory = fs::path(fileName).parent_path();
+		if (fs::exists(directory) == false)
+			fs::create_directories(directory);
+	}
+	catch (const fs::filesystem_error& e)
+	{
+		std::cout << "DescriptorCache::Store: Could not create a directory for '" << fileName << "': " << e.what() << std::endl;
+		return RET_FAILED;
+	}
+
+	DescriptorCacheEntryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DESCRIPTOR_CACHE_MAGIC, sizeof(header.magic));
+	header.key = pKey.Hash();
+	header.dataSize = pData.size();
+	std::ofstream file(temporaryFileName.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "DescriptorCache::Store: Could not open '" << temporaryFileName.str() << "'" << std::endl;
+		return RET_FAILED;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write(pData.data(), pData.size());
+	file.close();
+	if (file.fail())
+	{
+		std::cout << "DescriptorCache::Store: Error while writing '" << temporaryFileName.str() << "'" << std::endl;
+		fs::remove(temporaryFileName.str());
+		return RET_FAILED;
+	}
+
+	try
+	{
+		fs::rename(temporaryFileName.str(), fileName);
+	}
+	catch (const fs::filesystem_error& e)
+	{
+		std::cout << "DescriptorCache::Store: Could not rename '" << temporaryFileName.str() << "': " << e.what() << std::endl;
+		fs::remove(temporaryFileName.str());
+		return RET_FAILED;
+	}
+	return RET_OK;
+}
+
+} // end namespace ipa_utils
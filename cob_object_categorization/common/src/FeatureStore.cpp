@@ -0,0 +1,295 @@
+#include "object_categorization/FeatureStore.h"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef __LINUX__
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace ipa_utils {
+
+static const char FEATURE_STORE_MAGIC[8] = {'I','P','A','F','P','B','I','N'};
+static const boost::uint32_t FEATURE_STORE_VERSION = 1;
+static const boost::uint64_t FEATURE_STORE_ALIGNMENT = 16;
+
+
+MappedFile::MappedFile()
+{
+	mData = NULL;
+	mSize = 0;
+	mMapped = false;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+int MappedFile::Open(const std::string& pFileName)
+{
+	Close();
+
+#ifdef __LINUX__
+	int fileDescriptor = open(pFileName.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		std::cout << "MappedFile::Open: Could not open '" << pFileName << "'" << std::endl;
+		return RET_FAILED;
+	}
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0)
+	{
+		std::cout << "MappedFile::Open: Could not determine the size of '" << pFileName << "' or the file is empty." << std::endl;
+		close(fileDescriptor);
+		return RET_FAILED;
+	}
+	// private mapping: pages are only copied if a matrix pointing into the file is modified
+	void* data = mmap(NULL, fileStatus.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (data == MAP_FAILED)
+	{
+		std::cout << "MappedFile::Open: Could not map '" << pFileName << "'" << std::endl;
+		return RET_FAILED;
+	}
+	mData = (unsigned char*)data;
+	mSize = fileStatus.st_size;
+	mMapped = true;
+#else
+	std::ifstream file(pFileName.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "MappedFile::Open: Could not open '" << pFileName << "'" << std::endl;
+		return RET_FAILED;
+	}
+	file.seekg(0, std::ios::end);
+	mSize = (size_t)file.tellg();
+	file.seekg(0, std::ios::beg);
+	mData = new unsigned char[mSize];
+	file.read((char*)mData, mSize);
+	mMapped = false;
+#endif
+
+	return RET_OK;
+}
+
+void MappedFile::Close()
+{
+	if (mData == NULL)
+		return;
+#ifdef __LINUX__
+	if (mMapped)
+		munmap(mData, mSize);
+	else
+		delete[] mData;
+#else
+	delete[] mData;
+#endif
+	mData = NULL;
+	mSize = 0;
+	mMapped = false;
+}
+
+
+FeatureStoreWriter::FeatureStoreWriter()
+{
+	mPosition = 0;
+	mContentType = 0;
+}
+
+FeatureStoreWriter::~FeatureStoreWriter()
+{
+	if (mFile.is_open())
+		mFile.close();
+}
+
+int FeatureStoreWriter::Open(const std::string& pFileName, unsigned int pContentType)
+{
+	mFile.open(pFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!mFile.is_open())
+	{
+		std::cout << "FeatureStoreWriter::Open: Could not open '" << pFileName << "'" << std::endl;
+		return RET_FAILED;
+	}
+	mContentType = pContentType;
+	mIndex.clear();
+
+	// the header is rewritten with the index position when the file is closed
+	FeatureStoreHeader header;
+	memset(&header, 0, sizeof(header));
+	mFile.write((const char*)&header, sizeof(header));
+	mPosition = sizeof(header);
+
+	return RET_OK;
+}
+
+boost::uint64_t FeatureStoreWriter::WriteBlock(const void* pData, size_t pBytes)
+{
+	static const char padding[FEATURE_STORE_ALIGNMENT] = {0};
+	boost::uint64_t paddingBytes = (FEATURE_STORE_ALIGNMENT - mPosition%FEATURE_STORE_ALIGNMENT) % FEATURE_STORE_ALIGNMENT;
+	mFile.write(padding, paddingBytes);
+	mPosition += paddingBytes;
+
+	boost::uint64_t offset = mPosition;
+	if (pBytes > 0)
+		mFile.write((const char*)pData, pBytes);
+	mPosition += pBytes;
+	return offset;
+}
+
+void FeatureStoreWriter::IndexString(const std::string& pValue)
+{
+	IndexInt((int)pValue.size());
+	mIndex.append(pValue);
+}
+
+void FeatureStoreWriter::IndexInt(int pValue)
+{
+	boost::int32_t value = pValue;
+	mIndex.append((const char*)&value, sizeof(value));
+}
+
+void FeatureStoreWriter::IndexOffset(boost::uint64_t pValue)
+{
+	mIndex.append((const char*)&pValue, sizeof(pValue));
+}
+
+int FeatureStoreWriter::Close()
+{
+	FeatureStoreHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FEATURE_STORE_MAGIC, sizeof(header.magic));
+	header.version = FEATURE_STORE_VERSION;
+	header.contentType = mContentType;
+	header.indexOffset = WriteBlock(mIndex.data(), mIndex.size());
+	header.indexSize = mIndex.size();
+
+	mFile.seekp(0, std::ios::beg);
+	mFile.write((const char*)&header, sizeof(header));
+	bool success = mFile.good();
+	mFile.close();
+	mIndex.clear();
+
+	if (!success)
+	{
+		std::cout << "FeatureStoreWriter::Close: Error while writing the file." << std::endl;
+		return RET_FAILED;
+	}
+	return RET_OK;
+}
+
+
+FeatureStoreReader::FeatureStoreReader()
+{
+	mIndexPosition = 0;
+	mIndexEnd = 0;
+	mError = false;
+}
+
+int FeatureStoreReader::Open(const std::string& pFileName, unsigned int pContentType)
+{
+	mFile.reset(new MappedFile);
+	mIndexPosition = 0;
+	mIndexEnd = 0;
+	mError = false;
+	if (mFile->Open(pFileName) != RET_OK)
+		return RET_FAILED;
+
+	FeatureStoreHeader header;
+	if (mFile->Size() < sizeof(header))
+	{
+		std::cout << "FeatureStoreReader::Open: '" << pFileName << "' is too small for a feature store file." << std::endl;
+		return RET_FAILED;
+	}
+	memcpy(&header, mFile->Data(), sizeof(header));
+	if (memcmp(header.magic, FEATURE_STORE_MAGIC, sizeof(header.magic)) != 0 || header.version != FEATURE_STORE_VERSION)
+	{
+		std::cout << "FeatureStoreReader::Open: '" << pFileName << "' is no feature store file of version " << FEATURE_STORE_VERSION << "." << std::endl;
+		return RET_FAILED;
+	}
+	if (header.contentType != pContentType)
+	{
+		std::cout << "FeatureStoreReader::Open: '" << pFileName << "' contains content type " << header.contentType << " instead of " << pContentType << "." << std::endl;
+		return RET_FAILED;
+	}
+	if (header.indexOffset > mFile->Size() || header.indexSize > mFile->Size()-header.indexOffset)
+	{
+		std::cout << "FeatureStoreReader::Open: The index of '" << pFileName << "' exceeds the file." << std::endl;
+		return RET_FAILED;
+	}
+	mIndexPosition = (size_t)header.indexOffset;
+	mIndexEnd = (size_t)(header.indexOffset + header.indexSize);
+
+	return RET_OK;
+}
+
+bool FeatureStoreReader::ReadIndexBytes(void* pDestination, size_t pBytes)
+{
+	if (mError || pBytes > mIndexEnd-mIndexPosition)
+	{
+		mError = true;
+		return false;
+	}
+	memcpy(pDestination, mFile->Data()+mIndexPosition, pBytes);
+	mIndexPosition += pBytes;
+	return true;
+}
+
+std::string FeatureStoreReader::ReadString()
+{
+	int length = ReadInt();
+	if (mError || length < 0 || (size_t)length > mIndexEnd-mIndexPosition)
+	{
+		mError = true;
+		return "";
+	}
+	std::string value((const char*)mFile->Data()+mIndexPosition, length);
+	mIndexPosition += length;
+	return value;
+}
+
+int FeatureStoreReader::ReadInt()
+{
+	boost::int32_t value = 0;
+	ReadIndexBytes(&value, sizeof(value));
+	return value;
+}
+
+boost::uint64_t FeatureStoreReader::ReadOffset()
+{
+	boost::uint64_t value = 0;
+	ReadIndexBytes(&value, sizeof(value));
+	return value;
+}
+
+void* FeatureStoreReader::Block(boost::uint64_t pOffset, size_t pBytes)
+{
+	if (mFile.get() == NULL || pOffset > mFile->Size() || pBytes > mFile->Size()-pOffset)
+	{
+		mError = true;
+		return NULL;
+	}
+	return mFile->Data() + pOffset;
+}
+
+
+bool IsFeatureStoreFile(const std::string& pFileName)
+{
+	std::ifstream file(pFileName.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+	char magic[sizeof(FEATURE_STORE_MAGIC)];
+	file.read(magic, sizeof(magic));
+	return (file.gcount() == (std::streamsize)sizeof(magic)) && (memcmp(magic, FEATURE_STORE_MAGIC, sizeof(magic)) == 0);
+}
+
+bool HasFeatureStoreExtension(const std::string& pFileName)
+{
+	std::string extension(FEATURE_STORE_FILE_EXTENSION);
+	return (pFileName.length() >= extension.length()) && (pFileName.compare(pFileName.length()-extension.length(), extension.length(), extension) == 0);
+}
+
+} // end namespace ipa_utils
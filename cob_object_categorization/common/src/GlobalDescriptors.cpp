@@ -0,0 +1,939 @@
+#include "object_categorization/GlobalDescriptors.h"
+#include "object_categorization/timer.h"
+
+#include <sstream>
+
+#include <pcl/features/rsd.h>
+#ifndef __LINUX__
+	#include <pcl/features/gfpfh.h>
+#endif
+#include <pcl/features/vfh.h>
+#include <pcl/features/normal_3d.h>
+#include <pcl/filters/voxel_grid.h>
+
+struct Point2Dbl{double s; double z; Point2Dbl(double ps, double pz){s=ps; z=pz;}; };
+
+
+//////////////////////////////////////////////////////////////////////////
+// GlobalDescriptorContext
+//////////////////////////////////////////////////////////////////////////
+
+GlobalDescriptorContext::GlobalDescriptorContext(BlobListRiB* pBlobFeatures, const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, Database pDatabase,
+												 LocalFeatureClusterer* pLocalFeatureClusterer, bool pFileOutput, std::ofstream* pScreenLogFile)
+	: mBlobFeatures(pBlobFeatures), mParams(pGlobalFeatureParams), mDatabase(pDatabase), mLocalFeatureClusterer(pLocalFeatureClusterer), mFileOutput(pFileOutput), mScreenLogFile(pScreenLogFile)
+{
+	for (int i=0; i<7; i++)
+		mStageTimes[i] = 0.0;
+	mCoordinates = NULL;
+	mPointsFromCoordinateImage = false;
+	mEigenvalues = NULL;
+	mEigenvectors = NULL;
+	mCenter = cvPoint3D32f(0.f, 0.f, 0.f);
+	mNormalizedPointsValid = false;
+	mPointDistributionValid = false;
+	mVoxelLeafSize = 0.f;
+	mNormalRadius = 0.;
+	mLocalFeatureClustersValid = false;
+}
+
+GlobalDescriptorContext::~GlobalDescriptorContext()
+{
+	if (mCoordinates) cvReleaseMat(&mCoordinates);
+	if (mEigenvalues) cvReleaseMat(&mEigenvalues);
+	if (mEigenvectors) cvReleaseMat(&mEigenvectors);
+}
+
+int GlobalDescriptorContext::Prepare(const IplImage* pCoordinateImage, const IplImage* pMask, int pDescriptorComputationPass)
+{
+	Timer tim1;
+	tim1.start();
+
+	// 3d data is only available if the local features carry a frame
+	if (mBlobFeatures->size() > 0 && mBlobFeatures->begin()->m_Frame.size() != 6)
+		return ipa_utils::RET_OK;
+
+	const unsigned int minNumber3DPixels = mParams.minNumber3DPixels;
+	if ((pCoordinateImage!=NULL) && (pMask!=NULL))
+	{	// PCA using all points inside mask
+		if ((pCoordinateImage->width != pMask->width) || (pCoordinateImage->height != pMask->height))
+		{
+			std::cout << "ObjectClassifier::ExtractGlobalFeatures: pCoordinateImage and pMask do not have the same size." << std::endl;
+			if (mScreenLogFile) *mScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: pCoordinateImage and pMask do not have the same size." << std::endl;
+			return ipa_utils::RET_FAILED;
+		}
+
+		IplImage* mask = cvCloneImage(pMask);
+		if (mDatabase == CIN)
+			cvErode(mask, mask, 0, 8);	// necessary to avoid false depth pixels at object borders
+
+		IplImage* CoordinateImage = cvCloneImage(pCoordinateImage);
+		cvSmooth(CoordinateImage, CoordinateImage, CV_GAUSSIAN, 5);
+
+		////////////////////////////////////////
+		// tilt point cloud if in second pass
+		if (pDescriptorComputationPass >= 1 && mParams.additionalArtificialTiltedViewAngle[pDescriptorComputationPass-1]!=0)
+		{
+			double tiltAngle = (double)mParams.additionalArtificialTiltedViewAngle[pDescriptorComputationPass-1] / 180. * M_PI;
+
+			// compute 3d center
+			double cx=0., cy=0., cz=0.;
+			int numberPoints = 0;
+			for (int v=0; v<mask->height; v++)
+			{
+				for (int u=0; u<mask->width; u++)
+				{
+					if (cvGetReal2D(mask, v, u) != 0)
+					{
+						CvScalar point = cvGet2D(CoordinateImage, v, u);
+						cx += point.val[0];
+						cy += point.val[1];
+						cz += point.val[2];
+						numberPoints++;
+					}
+				}
+			}
+			cx /= (double)numberPoints;
+			cy /= (double)numberPoints;
+			cz /= (double)numberPoints;
+
+			double cosTilt = cos(tiltAngle);
+			double sinTilt = sin(tiltAngle);
+
+			// rotate point cloud by tiltAngle around its centroid
+			for (int v=0; v<mask->height; v++)
+			{
+				// only keep cos(alpha) % of the lines, i.e. set the remainder of the data (and mask!) to zero
+				bool keepThisLine = (rand() <= cosTilt*RAND_MAX);
+				if (keepThisLine == false)
+					for (int u=0; u<mask->width; u++) cvSetReal2D(mask, v, u, 0);
+				else
+				{
+					for (int u=0; u<mask->width; u++)
+					{
+						if (cvGetReal2D(mask, v, u) != 0)
+						{
+							CvScalar point = cvGet2D(CoordinateImage, v, u);
+							//point.val[0] -= cx;	does not rotate
+							point.val[1] -= cy;
+							point.val[2] -= cz;
+
+							double y = cosTilt * point.val[1] - sinTilt * point.val[2];
+							double z = sinTilt * point.val[1] + cosTilt * point.val[2];
+
+							point.val[1] = y + cy;
+							point.val[2] = z + cz;
+							cvSet2D(CoordinateImage, v, u, point);
+						}
+					}
+				}
+			}
+		}
+
+		mStageTimes[0] = tim1.getElapsedTimeInMicroSec();
+		tim1.start();
+
+		CvMat mask_buffer;
+		CvMat* mask_mat = cvGetMat(mask, &mask_buffer);
+		assert(CV_MAT_TYPE(mask_mat->type) == CV_8UC1);
+
+		//////////////////////// START: new, 2d rotation
+		if (mParams.useRollPoseNormalization == true)
+		{
+			// rotate 3d coordinates by rotating around z-axis so that mask image has a normalized orientation
+			double cx=0, cy=0;
+			unsigned int numberPoints = 0;
+			std::vector<cv::Point2f> maskPointList;
+			for (int y=0; y<mask->height; y++)
+			{
+				for (int x=0; x<mask->width; x++)
+				{
+					if (((uchar*)(mask_mat->data.ptr + (size_t)mask_mat->step*y))[x] != 0)
+					{
+						maskPointList.push_back(cv::Point2i(x, y));
+						CvScalar point = cvGet2D(CoordinateImage, y, x);
+						cx += point.val[0];
+						cy += point.val[1];
+						numberPoints++;
+					}
+				}
+			}
+			cx /= (double)numberPoints;
+			cy /= (double)numberPoints;
+
+			mStageTimes[1] = tim1.getElapsedTimeInMicroSec();
+			tim1.start();
+
+			if (maskPointList.size() > minNumber3DPixels)
+			{
+				cv::Mat maskPointMat(maskPointList.size(), 2, CV_32FC1);
+				for (int i=0; i<(int)maskPointList.size(); i++)
+				{
+					maskPointMat.at<float>(i, 0) = maskPointList[i].x;
+					maskPointMat.at<float>(i, 1) = maskPointList[i].y;
+				}
+
+				mStageTimes[2] = tim1.getElapsedTimeInMicroSec();
+				tim1.start();
+
+				// find prominent direction in 2d image
+				cv::PCA pca(maskPointMat, cv::noArray(), CV_PCA_DATA_AS_ROW);
+				// find repeatable direction (e.g. side of the centroid with more points is always positive)
+				int positiveDirection = 0, negativeDirection = 0;
+				float e11 = pca.eigenvectors.at<float>(0, 0);
+				float e12 = pca.eigenvectors.at<float>(0, 1);
+				float m1 = pca.mean.at<float>(0, 0);
+				float m2 = pca.mean.at<float>(0, 1);
+
+				mStageTimes[3] = tim1.getElapsedTimeInMicroSec();
+				tim1.start();
+
+				for (int i=0; i<(int)maskPointList.size(); i++)
+				{
+					float x = maskPointList[i].x;
+					float y = maskPointList[i].y;
+					if ((((float)x-m1)*e11 + ((float)y-m2)*e12) >= 0.f)
+						positiveDirection++;
+					else
+						negativeDirection++;
+				}
+				if (positiveDirection < negativeDirection)
+				{
+					e11 *= -1;
+					e12 *= -1;
+					std::cout << "Have to turn 2d direction\n";
+					if (mScreenLogFile) *mScreenLogFile << "Have to turn 2d direction\n";
+				}
+
+				mStageTimes[4] = tim1.getElapsedTimeInMicroSec();
+				tim1.start();
+
+				// compute rotation around z-axis, i.e. the angle between old x-axis (1, 0, 0) and new x-axis (e11, e12, 0)
+				double cosAlpha = e11/sqrt(e11*e11+e12*e12);
+				double sinAlpha = sin(acos(cosAlpha));
+
+				std::cout << "alpha=" << acos(cosAlpha)/M_PI * 180 << "\n";
+				if (mScreenLogFile) *mScreenLogFile << "alpha=" << acos(cosAlpha)/M_PI * 180 << "\n";
+
+				// rotate 3d coordinates around z-axis by alpha
+				for (int i=0; i<(int)maskPointList.size(); i++)
+				{
+					int u = maskPointList[i].x;
+					int v = maskPointList[i].y;
+					CvScalar point = cvGet2D(CoordinateImage, v, u);
+					double x = point.val[0] - cx;
+					double y = point.val[1] - cy;
+					point.val[0] = cosAlpha * x - sinAlpha * y + cx;
+					point.val[1] = sinAlpha * x + cosAlpha * y + cy;
+					cvSet2D(CoordinateImage, v, u, point);
+				}
+
+				mStageTimes[5] = tim1.getElapsedTimeInMicroSec();
+				tim1.start();
+			}
+			else
+			{
+				std::cout << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3D points available for roll pose normalization." << std::endl;
+				if (mScreenLogFile) *mScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3D points available for roll pose normalization." << std::endl;
+			}
+		}
+		//////////////////////// END: new, 2d rotation
+
+		// get 3D coordinates of points inside mask
+		std::vector<CvScalar> CoordinateList;
+		for (int i=0; i<mask->height; i++)
+		{
+			for (int j=0; j<mask->width; j++)
+			{
+				if (((uchar*)(mask_mat->data.ptr + (size_t)mask_mat->step*i))[j] != 0)
+				{
+					if (mParams.thinningFactor >= 1.0)
+						CoordinateList.push_back(cvGet2D(CoordinateImage, i, j));
+					else
+					{
+						if ((pDescriptorComputationPass == 0) || rand() < mParams.thinningFactor * RAND_MAX)		// thinning of data to emulate scale change
+							CoordinateList.push_back(cvGet2D(CoordinateImage, i, j));
+					}
+				}
+			}
+		}
+		cvReleaseImage(&CoordinateImage);
+		cvReleaseImage(&mask);
+
+		// can only process data if at least some 3d data of the object is available
+		if (CoordinateList.size() > minNumber3DPixels)
+		{
+			mCoordinates = cvCreateMat(CoordinateList.size(), 3, CV_32FC1);
+			for (int i=0; i<(int)CoordinateList.size(); i++)
+				for (int j=0; j<mCoordinates->width; j++)
+					cvmSet(mCoordinates, i, j, CoordinateList[i].val[j]);
+			mPointsFromCoordinateImage = true;
+		}
+		else
+		{
+			std::cout << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3D points available, switching to BlobFPCoordinates." << std::endl;
+			if (mScreenLogFile) *mScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3D points available, switching to BlobFPCoordinates." << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << "ObjectClassifier::ExtractGlobalFeatures: No 3D points available, switching to BlobFPCoordinates." << std::endl;
+		if (mScreenLogFile) *mScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: No 3D points available, switching to BlobFPCoordinates." << std::endl;
+	}
+
+	// PCA using feature points only
+	if (mCoordinates == NULL && mBlobFeatures->size() > 0)
+	{
+		mCoordinates = cvCreateMat(mBlobFeatures->size(), 3, CV_32FC1);
+		int FeatureCounter = 0;
+		for (BlobListRiB::iterator ItBlobFeatures = mBlobFeatures->begin(); ItBlobFeatures != mBlobFeatures->end(); ItBlobFeatures++, FeatureCounter++)
+		{
+			ipa_utils::Point3Dbl Point;
+			ItBlobFeatures->m_Frame.GetT(Point);
+			cvmSet(mCoordinates, FeatureCounter, 0, Point.m_x);
+			cvmSet(mCoordinates, FeatureCounter, 1, Point.m_y);
+			cvmSet(mCoordinates, FeatureCounter, 2, Point.m_z);
+		}
+	}
+
+	// stop data processing if too few 3d data of the object is available
+	if (HasPointData() == false)
+		return ipa_utils::RET_OK;
+
+	// PCA, the eigenvectors are stored one in each row -> cvmGet(mEigenvectors, Eigenvector_index, Component_index) and are normalized to L_2 norm 1
+	if (mCoordinates->height > 2)
+	{
+		CvMat* Avgs = cvCreateMat(1, 3, CV_32FC1);
+		mEigenvalues = cvCreateMat(1, 3, CV_32FC1);
+		mEigenvectors = cvCreateMat(3, 3, CV_32FC1);
+
+		cvCalcPCA(mCoordinates, Avgs, mEigenvalues, mEigenvectors, CV_PCA_DATA_AS_ROW);
+
+		mCenter.x = (float)cvGetReal1D(Avgs, 0);
+		mCenter.y = (float)cvGetReal1D(Avgs, 1);
+		mCenter.z = (float)cvGetReal1D(Avgs, 2);
+		cvReleaseMat(&Avgs);
+	}
+
+	mStageTimes[6] = tim1.getElapsedTimeInMicroSec();
+
+	return ipa_utils::RET_OK;
+}
+
+const std::vector<cv::Point3d>& GlobalDescriptorContext::NormalizedPoints()
+{
+	if (mNormalizedPointsValid == true)
+		return mNormalizedPoints;
+	mNormalizedPointsValid = true;
+	mNormalizedPoints.clear();
+	if (HasPCA() == false)
+		return mNormalizedPoints;
+
+	const int numberPoints = mCoordinates->rows;
+	mNormalizedPoints.resize(numberPoints);
+	double normX = 1.0, normY = 1.0;
+
+	if (mParams.useFullPCAPoseNormalization == true)
+	{
+		// align coordinate system, the eigenvectors of the context stay untouched
+		double eigenvectors[3][3];
+		for (int i=0; i<3; i++)
+			for (int j=0; j<3; j++)
+				eigenvectors[i][j] = cvmGet(mEigenvectors, i, j);
+
+		// check if eigenvalues form a right hand system ((XxY)*Z > 0)
+		double tempVec[3];
+		tempVec[0] = (eigenvectors[0][1]*eigenvectors[1][2]-eigenvectors[0][2]*eigenvectors[1][1]);
+		tempVec[1] = (eigenvectors[0][2]*eigenvectors[1][0]-eigenvectors[0][0]*eigenvectors[1][2]);
+		tempVec[2] = (eigenvectors[0][0]*eigenvectors[1][1]-eigenvectors[0][1]*eigenvectors[1][0]);
+		if (tempVec[0]*eigenvectors[2][0] + tempVec[1]*eigenvectors[2][1] + tempVec[2]*eigenvectors[2][2] < 0)
+		{
+			// left hand system --> invert z-axis
+			std::cout << "Left hand system. Have to turn z." << std::endl;
+			if (mScreenLogFile) *mScreenLogFile << "Left hand system. Have to turn z." << std::endl;
+			for (int j=0; j<3; j++)
+				eigenvectors[2][j] = -eigenvectors[2][j];
+		}
+
+		// keep the direction of the eigenvectors repeatable
+		// 1. rule: the new z'-axis must point towards the camera, which is z*z' < 0 or z'_3 < 0 since z = (0,0,1)   --> can be done before
+		// 2. rule: positive x'-direction on that side of the x'=0 plane where fewer points are located   --> will be decided after first point coordinate tranformation (50% chance that the outcome is already well-aligned)
+		// 3. rule: choose y' to yield a right-hand system   --> adapted after steps 1 and 2
+		if (eigenvectors[2][2] > 0)
+		{
+			// 1. rule not fulfilled
+			// so keep x'-axis coordinates and invert y' and z' to enforce rule 1 and 3
+			for (int i=1; i<3; i++)
+				for (int j=0; j<3; j++)
+					eigenvectors[i][j] = -eigenvectors[i][j];
+		}
+
+		// translate origin to center of mass of the point cloud and
+		// rotate frame so that the eigenvectors are the coordinate axes (1,0,0), (0,1,0) and (0,0,1)
+		// in this case the Eigenvector matrix is the rotation matrix when the eigenvectors are stored row-wise
+		int pointMajoritySide = 0;	// counts +1 if a transformed point has positive x' coordinates and -1 for negative x' coordinates
+		for (int i=0; i<numberPoints; i++)
+		{
+			double x = cvmGet(mCoordinates, i, 0) - mCenter.x;
+			double y = cvmGet(mCoordinates, i, 1) - mCenter.y;
+			double z = cvmGet(mCoordinates, i, 2) - mCenter.z;
+			cv::Point3d& point = mNormalizedPoints[i];
+			point.x = eigenvectors[0][0]*x + eigenvectors[0][1]*y + eigenvectors[0][2]*z;
+			point.y = eigenvectors[1][0]*x + eigenvectors[1][1]*y + eigenvectors[1][2]*z;
+			point.z = eigenvectors[2][0]*x + eigenvectors[2][1]*y + eigenvectors[2][2]*z;
+			pointMajoritySide += (int)sign(point.x);	// checks the x'-coordinate for rule 2
+		}
+
+		if (pointMajoritySide > 0)
+		{
+			std::cout << "Turning x' and y' coordinates necessary (rule 2)." << std::endl;
+			if (mScreenLogFile) *mScreenLogFile << "Turning x' and y' coordinates necessary (rule 2)." << std::endl;
+			// 2. rule not fulfilled -> invert x' and y' coordinates to enforce rule 2 and 3
+			for (int i=0; i<numberPoints; i++)
+			{
+				mNormalizedPoints[i].x = -mNormalizedPoints[i].x;
+				mNormalizedPoints[i].y = -mNormalizedPoints[i].y;
+			}
+		}
+
+		normX = 1.0/(2.0*sqrt(cvGetReal1D(mEigenvalues, 0))); // normalize the coordinates by the magnitude of the respective eigenvalue to the eigenvector (new coordinate system's axis)
+		normY = 1.0/(2.0*sqrt(cvGetReal1D(mEigenvalues, 1))); // this provides scale invariance
+	}
+	else
+	{
+		// without pose normalization
+		double maxX=0, maxY=0;
+		for (int i=0; i<numberPoints; i++)
+		{
+			cv::Point3d& point = mNormalizedPoints[i];
+			point.x = cvmGet(mCoordinates, i, 0) - mCenter.x;
+			point.y = cvmGet(mCoordinates, i, 1) - mCenter.y;
+			point.z = cvmGet(mCoordinates, i, 2) - mCenter.z;
+			if (fabs(point.x) > maxX)
+				maxX = fabs(point.x);
+			if (fabs(point.y) > maxY)
+				maxY = fabs(point.y);
+		}
+		normX = 1.0/maxX;
+		normY = 1.0/maxY;
+	}
+
+	// scale the largest dimension to 1 and use the same factor for the remaining dimensions
+	double norm = (normX < normY) ? normX : normY;
+	for (int i=0; i<numberPoints; i++)
+		mNormalizedPoints[i] *= norm;
+
+	return mNormalizedPoints;
+}
+
+const std::vector<float>& GlobalDescriptorContext::SurfacePolynomials(int pLevel)
+{
+	std::map<int, std::vector<float> >::iterator itPolynomials = mSurfacePolynomials.find(pLevel);
+	if (itPolynomials != mSurfacePolynomials.end())
+		return itPolynomials->second;
+
+	const int polynomOrder = mParams.polynomOrder[pLevel];
+	const int numberLinesX = mParams.numberLinesX[pLevel];
+	const int numberLinesY = mParams.numberLinesY[pLevel];
+	std::vector<float>& coefficients = mSurfacePolynomials[pLevel];
+	coefficients.resize((numberLinesX+numberLinesY)*(polynomOrder+1), 0.f);
+
+	const std::vector<cv::Point3d>& points = NormalizedPoints();
+	if (points.empty() == true)
+		return coefficients;
+
+	// approximate a polynomial along lines parallel to the x axis and the y axis in the normalized coordinate system
+	std::vector<double> linesX;		// y coordinates of the polynomials parallel to the x-axis
+	std::vector<double> linesY;		// x coordinates of the polynomials parallel to the y-axis
+	double step = 2.0/(double)(numberLinesX+1.0);
+	for (double y=-1.0+step; y<0.998; y+=step) linesX.push_back(y);
+	step = 2.0/(double)(numberLinesY+1.0);
+	for (double x=-1.0+step; x<0.998; x+=step) linesY.push_back(x);
+	std::vector< std::vector<Point2Dbl> > RegressionPointList(linesX.size()+linesY.size());	// first index=list index (x lines, then y lines), second index=point index
+	double distanceThreshold = 2.0/sqrt((double)points.size());	// sampling invariance
+
+	// fill point lists for the polynomials
+	for (unsigned int p=0; p<points.size(); p++)
+	{
+		const cv::Point3d& point = points[p];
+		for (int l=0; l<(int)linesX.size(); l++)
+			if (fabs(point.y-linesX[l]) < distanceThreshold) RegressionPointList[l].push_back(Point2Dbl(point.x, point.z));
+		for (int l=0; l<(int)linesY.size(); l++)
+			if (fabs(point.x-linesY[l]) < distanceThreshold) RegressionPointList[linesX.size()+l].push_back(Point2Dbl(point.y, point.z));
+	}
+
+	// fit the polynomials into the data
+	int position = 0;
+	for (int l=0; l<(int)RegressionPointList.size() && position+polynomOrder<(int)coefficients.size(); l++, position+=polynomOrder+1)
+	{
+		// check availability of enough points for polynomial fitting, otherwise the coefficients stay zero
+		if ((int)RegressionPointList[l].size()<=(polynomOrder+1+mParams.pointDataExcess))
+		{
+			std::cout << "ObjectClassifier::ExtractGlobalFeatures: Too few points in polynomial " << l << ".\n";
+			if (mScreenLogFile) *mScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Too few points in polynomial " << l << ".\n";
+			continue;
+		}
+
+		std::ofstream DataFile, ParamsFile;
+		if (mFileOutput)
+		{
+			std::stringstream DataFileName, ParamsFileName;
+			DataFileName << "GlobalFP_CurveFitting(" << pLevel << "-" << l << ")_SensorData.txt";
+			ParamsFileName << "GlobalFP_CurveFitting(" << pLevel << "-" << l << ")_PolyParams.txt";
+			DataFile.open((DataFileName.str()).c_str(), std::fstream::out);
+			ParamsFile.open(ParamsFileName.str().c_str(), std::fstream::out);
+		}
+
+		//create regression problem matrices
+		CvMat* A = cvCreateMat(RegressionPointList[l].size(), polynomOrder+1, CV_32FC1);
+		CvMat* B = cvCreateMat(RegressionPointList[l].size(), 1, CV_32FC1);
+		CvMat* X = cvCreateMat(polynomOrder+1, 1, CV_32FC1);
+		for (int i=0; i<A->height; i++)
+		{
+			double value = 1.0;
+			for (int j=0; j<A->width; j++)
+			{
+				cvmSet(A, i, j, value);
+				value *= RegressionPointList[l][i].s;
+			}
+			cvSetReal1D(B, i, RegressionPointList[l][i].z);
+			if (mFileOutput) DataFile << RegressionPointList[l][i].s << "\t" << RegressionPointList[l][i].z << "\n";
+		}
+		cvSolve(A, B, X, CV_SVD);
+
+		if (mFileOutput)
+		{
+			for (int i=0; i<X->height; i++)
+			{
+				for (int j=0; j<X->width; j++) ParamsFile << cvmGet(X, i, j) << "\t";
+				ParamsFile << "\n";
+			}
+			DataFile.close();
+			ParamsFile.close();
+		}
+
+		for (int s=0; s<=polynomOrder; s++)
+			coefficients[position+s] = (float)cvGetReal1D(X, s);
+
+		cvReleaseMat(&A);
+		cvReleaseMat(&B);
+		cvReleaseMat(&X);
+	}
+
+	return coefficients;
+}
+
+const std::vector<float>& GlobalDescriptorContext::PointDistribution()
+{
+	if (mPointDistributionValid == true)
+		return mPointDistribution;
+	mPointDistributionValid = true;
+
+	const double* cellSize = mParams.cellSize;
+	const double* cellCount = mParams.cellCount;
+	mPointDistribution.assign((size_t)(cellCount[0]*cellCount[1]), 0.f);
+	const std::vector<cv::Point3d>& points = NormalizedPoints();
+	if (points.empty() == true)
+		return mPointDistribution;
+
+	// compute distribution of 3d points in the current camera plane (which is either the original view or normalized to the plane spanned by the two largest eigenvectors of the point cloud)
+	std::map< double, std::map<double, int> > pointCount;	// matrix of point counts in the respective cells of the point distribution grid
+	for (unsigned int p=0; p<points.size(); p++)
+	{
+		double cell[2] = {floor(points[p].x/cellSize[0] + 0.5)*cellSize[0], floor(points[p].y/cellSize[1] + 0.5)*cellSize[1]};
+		pointCount[cell[0]][cell[1]]++;
+	}
+
+	double cellLimits[2] = { cellSize[0]/2*(cellCount[0]-1), cellSize[1]/2*(cellCount[1]-1) };
+	unsigned int position = 0;
+	for (double cellX = -cellLimits[0]; cellX < cellLimits[0]+1e-3; cellX += cellSize[0])
+	{
+		for (double cellY = -cellLimits[1]; cellY < cellLimits[1]+1e-3 && position < mPointDistribution.size(); cellY += cellSize[1], position++)
+		{
+			std::map< double, std::map<double, int> >::iterator itX = pointCount.find(cellX);
+			if (itX == pointCount.end())
+				continue;
+			std::map<double, int>::iterator itY = itX->second.find(cellY);
+			if (itY != itX->second.end())
+				mPointDistribution[position] = (float)((double)itY->second/(double)points.size());
+		}
+	}
+
+	return mPointDistribution;
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr GlobalDescriptorContext::ViewpointNormalizedCloud()
+{
+	if (mViewpointNormalizedCloud)
+		return mViewpointNormalizedCloud;
+
+	mViewpointNormalizedCloud.reset(new pcl::PointCloud<pcl::PointXYZ>);
+	if (mPointsFromCoordinateImage == false)
+		return mViewpointNormalizedCloud;
+
+	double metricFactor = 1.0;
+	if (mDatabase == CIN) metricFactor = 0.001;
+	mViewpointNormalizedCloud->reserve(mCoordinates->rows);
+	for (int i=0; i<mCoordinates->rows; i++)
+	{
+		pcl::PointXYZ point;
+		point.x = cvmGet(mCoordinates, i, 0)*metricFactor - mCenter.x;
+		point.y = cvmGet(mCoordinates, i, 1)*metricFactor - mCenter.y;
+		point.z = cvmGet(mCoordinates, i, 2)*metricFactor - mCenter.z + 1.0;
+		mViewpointNormalizedCloud->push_back(point);
+	}
+	return mViewpointNormalizedCloud;
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr GlobalDescriptorContext::VoxelizedCloud(float pLeafSize)
+{
+	if (mVoxelizedCloud && mVoxelLeafSize == pLeafSize)
+		return mVoxelizedCloud;
+
+	mVoxelLeafSize = pLeafSize;
+	mSearchTree.reset();
+	mNormals.reset();
+	mVoxelizedCloud.reset(new pcl::PointCloud<pcl::PointXYZ>());
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = ViewpointNormalizedCloud();
+	if (cloud->empty() == false)
+	{
+		pcl::VoxelGrid<pcl::PointXYZ> voxg;
+		voxg.setInputCloud(cloud);
+		voxg.setLeafSize(pLeafSize, pLeafSize, pLeafSize);
+		voxg.filter(*mVoxelizedCloud);
+	}
+	return mVoxelizedCloud;
+}
+
+GlobalDescriptorSearchTree::Ptr GlobalDescriptorContext::SearchTree(float pLeafSize)
+{
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = VoxelizedCloud(pLeafSize);
+	if (!mSearchTree)
+	{
+		mSearchTree.reset(new GlobalDescriptorSearchTree());
+		if (cloud->empty() == false)
+			mSearchTree->setInputCloud(cloud);
+	}
+	return mSearchTree;
+}
+
+pcl::PointCloud<pcl::Normal>::Ptr GlobalDescriptorContext::Normals(float pLeafSize, double pRadius)
+{
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = VoxelizedCloud(pLeafSize);
+	if (mNormals && mNormalRadius == pRadius)
+		return mNormals;
+
+	mNormalRadius = pRadius;
+	mNormals.reset(new pcl::PointCloud<pcl::Normal>());
+	if (cloud->empty() == false)
+	{
+		pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
+		ne.setInputCloud(cloud);
+		ne.setSearchMethod(SearchTree(pLeafSize));
+		ne.setRadiusSearch(pRadius);
+		ne.compute(*mNormals);
+	}
+	return mNormals;
+}
+
+const std::vector<int>& GlobalDescriptorContext::LocalFeatureClusters()
+{
+	if (mLocalFeatureClustersValid == true)
+		return mLocalFeatureClusters;
+	mLocalFeatureClustersValid = true;
+
+	mLocalFeatureClusters.clear();
+	if (mLocalFeatureClusterer == NULL)
+		return mLocalFeatureClusters;
+	mLocalFeatureClusters.reserve(mBlobFeatures->size());
+	for (BlobListRiB::iterator ItBlobFeatures = mBlobFeatures->begin(); ItBlobFeatures != mBlobFeatures->end(); ItBlobFeatures++)
+	{
+		CvMat* LocalFeatureVector = cvCreateMat(1, ItBlobFeatures->m_D.size(), CV_32FC1);
+		for (unsigned int j=0; j<ItBlobFeatures->m_D.size(); j++) cvSetReal1D(LocalFeatureVector, j, ItBlobFeatures->m_D[j]);
+#if (CV_MAJOR_VERSION<=2 && CV_MINOR_VERSION<=3)
+		int Bin = cvRound(mLocalFeatureClusterer->predict((const CvMat*)LocalFeatureVector, NULL));		// speedup: replace round by (int)
+#else
+		cv::Mat localFeatureVectorMat(LocalFeatureVector);
+		int Bin = cvRound((mLocalFeatureClusterer->predict(localFeatureVectorMat))[1]);		// speedup: replace round by (int)
+#endif
+		mLocalFeatureClusters.push_back(Bin);
+		cvReleaseMat(&LocalFeatureVector);
+	}
+	return mLocalFeatureClusters;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Descriptor families of this package
+//////////////////////////////////////////////////////////////////////////
+
+/// Bag of words: histogram of the vocabulary entries of the local features.
+class BagOfWordsDescriptor : public GlobalDescriptorPlugin
+{
+public:
+	int Size(const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, const LocalFeatureClusterer* pLocalFeatureClusterer) const
+	{
+		if (pLocalFeatureClusterer == NULL)
+			return 0;
+#if (CV_MAJOR_VERSION<=2 && CV_MINOR_VERSION<=3)
+		return pLocalFeatureClusterer->get_nclusters();
+#else
+		return pLocalFeatureClusterer->get<int>("nclusters");
+#endif
+	};
+
+	bool RequiresPointData() const { return false; };
+
+	void Compute(GlobalDescriptorContext& pContext, float* pDescriptor) const
+	{
+		const std::vector<int>& clusters = pContext.LocalFeatureClusters();
+		int size = Size(pContext.Params(), pContext.GetLocalFeatureClusterer());
+		for (unsigned int i=0; i<clusters.size(); i++)
+			if (clusters[i] >= 0 && clusters[i] < size)
+				pDescriptor[clusters[i]] += 1.f;
+		if (clusters.size() > 0)
+			for (int i=0; i<size; i++)
+				pDescriptor[i] /= (float)clusters.size();
+	};
+};
+
+/// Surface approximation by polynomials (sap, sap2, ...), level 0 additionally stores the PCA eigenvalues.
+class SurfaceApproximationDescriptor : public GlobalDescriptorPlugin
+{
+public:
+	SurfaceApproximationDescriptor(int pLevel) : mLevel(pLevel) {};
+
+	int Size(const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, const LocalFeatureClusterer* pLocalFeatureClusterer) const
+	{
+		if (mLevel >= (int)pGlobalFeatureParams.polynomOrder.size() || mLevel >= (int)pGlobalFeatureParams.numberLinesX.size() || mLevel >= (int)pGlobalFeatureParams.numberLinesY.size())
+			return 0;
+		return (mLevel==0 ? 3 : 0) + (pGlobalFeatureParams.numberLinesX[mLevel]+pGlobalFeatureParams.numberLinesY[mLevel])*(pGlobalFeatureParams.polynomOrder[mLevel]+1);
+	};
+
+	void Compute(GlobalDescriptorContext& pContext, float* pDescriptor) const
+	{
+		if (pContext.HasPCA() == false || Size(pContext.Params(), pContext.GetLocalFeatureClusterer()) == 0)
+			return;
+
+		// save largest PCA Eigenvalue as it is and the both others relative to it
+		if (mLevel == 0)
+		{
+			const CvMat* Eigenvalues = pContext.Eigenvalues();
+			if (pContext.GetDatabase() == CIN)
+				pDescriptor[0] = (float)(cvGetReal1D(Eigenvalues, 0)/10000.0);	// CIN database measures 3d coordinates in mm
+			else
+				pDescriptor[0] = (float)cvGetReal1D(Eigenvalues, 0);	// for 3d coordinates measured in m
+			for (int s=1; s<3; s++)
+				pDescriptor[s] = (float)(cvGetReal1D(Eigenvalues, s)/cvGetReal1D(Eigenvalues, 0));
+			pDescriptor += 3;
+		}
+
+		// the polynomials are only fitted into the masked 3d data
+		if (pContext.HasMaskedPoints() == false)
+			return;
+		const std::vector<float>& coefficients = pContext.SurfacePolynomials(mLevel);
+		for (unsigned int i=0; i<coefficients.size(); i++)
+			pDescriptor[i] = coefficients[i];
+	};
+
+private:
+	int mLevel;
+};
+
+/// Distribution of the points over a grid in the (normalized) camera plane.
+class PointDistributionDescriptor : public GlobalDescriptorPlugin
+{
+public:
+	int Size(const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, const LocalFeatureClusterer* pLocalFeatureClusterer) const
+	{
+		return (int)(pGlobalFeatureParams.cellCount[0] * pGlobalFeatureParams.cellCount[1]);
+	};
+
+	void Compute(GlobalDescriptorContext& pContext, float* pDescriptor) const
+	{
+		if (pContext.HasPCA() == false || pContext.HasMaskedPoints() == false)
+			return;
+		const std::vector<float>& distribution = pContext.PointDistribution();
+		for (unsigned int i=0; i<distribution.size(); i++)
+			pDescriptor[i] = distribution[i];
+	};
+};
+
+/// Statistics about feature point frame directions compared to the largest principal component (eigenvector).
+class NormalStatisticsDescriptor : public GlobalDescriptorPlugin
+{
+public:
+	int Size(const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, const LocalFeatureClusterer* pLocalFeatureClusterer) const
+	{
+		return 6;		// 6 bin histogram for statistics about frame alignment of the feature points with respect to the largest PCA eigenvector
+	};
+
+	void Compute(GlobalDescriptorContext& pContext, float* pDescriptor) const
+	{
+		if (pContext.HasPCA() == false)
+			return;
+
+		// find invariant direction (largest PCA direction)
+		const CvMat* Eigenvectors = pContext.Eigenvectors();
+		ipa_utils::Point3Dbl PCAMainDirection = ipa_utils::Point3Dbl(cvmGet(Eigenvectors, 0, 0), cvmGet(Eigenvectors, 0, 1), cvmGet(Eigenvectors, 0, 2));
+		// --improvement needed: direction is not chosen by chance but still not invariant with respect to the object
+		if (PCAMainDirection.m_x < 0.0) PCAMainDirection.Negative();
+		else if (PCAMainDirection.m_x==0.0)
+		{
+			if (PCAMainDirection.m_y < 0.0) PCAMainDirection.Negative();
+			else if (PCAMainDirection.m_y==0.0 && PCAMainDirection.m_z < 0.0) PCAMainDirection.Negative();
+		}
+		PCAMainDirection.Normalize();
+
+		double Bins[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+		for (BlobListRiB::iterator ItBlobFeatures = pContext.BlobFeatures()->begin(); ItBlobFeatures != pContext.BlobFeatures()->end(); ItBlobFeatures++)
+		{
+			ipa_utils::Point3Dbl FPDirection;
+			ItBlobFeatures->m_Frame.eX(FPDirection);
+			if (FPDirection.ScalarProd(PCAMainDirection) > 0) Bins[0]++;
+			else Bins[1]++;
+
+			ItBlobFeatures->m_Frame.eY(FPDirection);
+			if (FPDirection.ScalarProd(PCAMainDirection) > 0) Bins[2]++;
+			else Bins[3]++;
+
+			ItBlobFeatures->m_Frame.eZ(FPDirection);
+			if (FPDirection.ScalarProd(PCAMainDirection) > 0) Bins[4]++;
+			else Bins[5]++;
+		}
+		for (int i=0; i<5; i+=2)
+		{
+			double Sum = Bins[i]+Bins[i+1];
+			pDescriptor[i] = (float)(Bins[i]/Sum);
+			pDescriptor[i+1] = (float)(Bins[i+1]/Sum);
+		}
+	};
+};
+
+/// Viewpoint feature histogram of the voxelized point cloud.
+class VFHDescriptor : public GlobalDescriptorPlugin
+{
+public:
+	int Size(const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, const LocalFeatureClusterer* pLocalFeatureClusterer) const
+	{
+		return 308;
+	};
+
+	void Compute(GlobalDescriptorContext& pContext, float* pDescriptor) const
+	{
+		const float leafSize = 0.005f;
+		pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = pContext.VoxelizedCloud(leafSize);
+		if (cloud->empty() == true)
+			return;
+
+		// Create the VFH estimation class, and pass the input dataset+normals to it
+		pcl::VFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::VFHSignature308> vfh;
+		vfh.setInputCloud(cloud);
+		vfh.setInputNormals(pContext.Normals(leafSize, 0.03));		// all neighbors in a sphere of radius 3cm
+		vfh.setSearchMethod(pContext.SearchTree(leafSize));
+
+		pcl::PointCloud<pcl::VFHSignature308>::Ptr vfhs (new pcl::PointCloud<pcl::VFHSignature308> ());
+		vfh.compute(*vfhs);
+
+		// write descriptor into the descriptor vector
+		for (int i=0; i<308; i++)
+			pDescriptor[i] = vfhs->at(0).histogram[i];
+	};
+};
+
+/// Global fast point feature histogram over the labeled local feature positions.
+/// The labels are the simple RSD types (grsd) or the vocabulary entries (gfpfh) of the local features.
+class GlobalLabelHistogramDescriptor : public GlobalDescriptorPlugin
+{
+public:
+	GlobalLabelHistogramDescriptor(bool pUseRSDTypes) : mUseRSDTypes(pUseRSDTypes) {};
+
+	int Size(const ObjectClassifier::GlobalFeatureParams& pGlobalFeatureParams, const LocalFeatureClusterer* pLocalFeatureClusterer) const
+	{
+		return 16;
+	};
+
+	void Compute(GlobalDescriptorContext& pContext, float* pDescriptor) const
+	{
+#ifndef __LINUX__
+		BlobListRiB* blobFeatures = pContext.BlobFeatures();
+		pcl::PointCloud<pcl::PointXYZL>::Ptr labels (new pcl::PointCloud<pcl::PointXYZL>());
+		pcl::PointCloud<pcl::PointXYZ>::Ptr points (new pcl::PointCloud<pcl::PointXYZ>());
+		const std::vector<int>* clusters = (mUseRSDTypes == true) ? NULL : &(pContext.LocalFeatureClusters());
+		int featureIndex = 0;
+		for (BlobListRiB::iterator ItBlobFeatures = blobFeatures->begin(); ItBlobFeatures != blobFeatures->end(); ItBlobFeatures++, featureIndex++)
+		{
+			pcl::PointXYZL pointl;
+			ipa_utils::Point3Dbl ipaPoint;
+			ItBlobFeatures->m_Frame.GetT(ipaPoint);
+			pointl.x = ipaPoint.m_x;
+			pointl.y = ipaPoint.m_y;
+			pointl.z = ipaPoint.m_z;
+			if (mUseRSDTypes == true)
+				pointl.label = pcl::getSimpleType(ItBlobFeatures->m_D[0], ItBlobFeatures->m_D[1]);
+			else
+				pointl.label = (unsigned char)(*clusters)[featureIndex];
+			labels->push_back(pointl);
+
+			pcl::PointXYZ point;
+			point.x = pointl.x;
+			point.y = pointl.y;
+			point.z = pointl.z;
+			points->push_back(point);
+		}
+
+		pcl::PointCloud<pcl::GFPFHSignature16>::Ptr gfpfhs (new pcl::PointCloud<pcl::GFPFHSignature16> ());
+		pcl::GFPFHEstimation<pcl::PointXYZ, pcl::PointXYZL, pcl::GFPFHSignature16> gfpfh;
+		gfpfh.setInputCloud(points);
+		gfpfh.setInputLabels(labels);
+		GlobalDescriptorSearchTree::Ptr gfpfhTree (new GlobalDescriptorSearchTree());
+		gfpfh.setSearchMethod(gfpfhTree);
+		gfpfh.compute(*gfpfhs);
+
+		// write descriptor into the descriptor vector
+		for (int i=0; i<gfpfhs->at(0).descriptorSize() && i<16; i++)
+			pDescriptor[i] = gfpfhs->at(0).histogram[i];
+#endif
+	};
+
+private:
+	bool mUseRSDTypes;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// GlobalDescriptorRegistry
+//////////////////////////////////////////////////////////////////////////
+
+GlobalDescriptorRegistry::GlobalDescriptorRegistry()
+{
+	// order of the descriptor of ExtractGlobalFeatures()
+	Register("bow", new BagOfWordsDescriptor());
+	Register("sap", new SurfaceApproximationDescriptor(0));
+	Register("sap2", new SurfaceApproximationDescriptor(1));
+	Register("pointdistribution", new PointDistributionDescriptor());
+	Register("normalstatistics", new NormalStatisticsDescriptor());
+	Register("vfh", new VFHDescriptor());
+	Register("grsd", new GlobalLabelHistogramDescriptor(true));
+	Register("gfpfh", new GlobalLabelHistogramDescriptor(false));
+}
+
+GlobalDescriptorRegistry& GlobalDescriptorRegistry::Instance()
+{
+	static GlobalDescriptorRegistry registry;
+	return registry;
+}
+
+void GlobalDescriptorRegistry::Register(const std::string& pName, GlobalDescriptorPlugin* pPlugin)
+{
+	if (mPlugins.find(pName) == mPlugins.end())
+		mNames.push_back(pName);
+	mPlugins[pName] = boost::shared_ptr<GlobalDescriptorPlugin>(pPlugin);
+}
+
+const GlobalDescriptorPlugin* GlobalDescriptorRegistry::Get(const std::string& pName) const
+{
+	std::map<std::string, boost::shared_ptr<GlobalDescriptorPlugin> >::const_iterator itPlugin = mPlugins.find(pName);
+	if (itPlugin == mPlugins.end())
+		return NULL;
+	return itPlugin->second.get();
+}
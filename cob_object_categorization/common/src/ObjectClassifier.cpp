@@ -1,9 +1,14 @@
 #include "object_categorization/ObjectClassifier.h"
 #include "object_categorization/timer.h"
+#include "object_categorization/ThreadPool.h"
+#include "object_categorization/Pipeline.h"
+#include "object_categorization/GlobalDescriptors.h"
 
 //#define BOOST_FILESYSTEM_VERSION 3
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
+#include <limits>
+#include <algorithm>
 namespace fs = boost::filesystem;
 
 #ifdef PCL_VERSION_COMPARE //fuerte
@@ -31,6 +36,8 @@ namespace fs = boost::filesystem;
 #include <pcl/sample_consensus/model_types.h>
 #include <pcl/segmentation/sac_segmentation.h>
 #include <pcl/segmentation/extract_clusters.h>
+#include <pcl/features/integral_image_normal.h>
+#include <pcl/segmentation/organized_multi_plane_segmentation.h>
 #include <pcl/registration/icp.h>
 #include <pcl/visualization/pcl_visualizer.h>
 
@@ -45,6 +52,7 @@ namespace fs = boost::filesystem;
 
 
 ObjectClassifier::ObjectClassifier(std::string pEMClusterFilename, std::string pGlobalClassifierPath)
+	: mHermesReferenceVoxelSize(0.), mHermesVfhViewMaxMass(0.f), mHermesApproximateViewSearch(true), mHermesViewSearchTrees(4), mHermesViewSearchChecks(64)
 {
 	if (pEMClusterFilename != "" && pGlobalClassifierPath != "")
 	{
@@ -299,14 +307,162 @@ unsigned long LoadMat(cv::Mat& mat, std::string filename)
 	return ipa_utils::RET_OK;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Descriptor cache helpers for the database loaders
+//////////////////////////////////////////////////////////////////////////
+
+template <class T>
+static void AppendCacheData(std::string& pData, const T& pValue)
+{
+	pData.append((const char*)&pValue, sizeof(T));
+}
+
+template <class T>
+static bool ReadCacheData(const std::string& pData, size_t& pPosition, T& pValue)
+{
+	if (pPosition+sizeof(T) > pData.size())
+		return false;
+	memcpy(&pValue, pData.data()+pPosition, sizeof(T));
+	pPosition += sizeof(T);
+	return true;
+}
+
+/// Adds all values of the local features of a view to a cache key.
+static void AddBlobListToCacheKey(BlobListRiB& pBlobFeatures, ipa_utils::DescriptorCacheKey& pKey)
+{
+	pKey.Add((int)pBlobFeatures.size());
+	for (BlobListRiB::iterator ItBlob = pBlobFeatures.begin(); ItBlob != pBlobFeatures.end(); ItBlob++)
+	{
+		boost::int32_t geometry[4] = {ItBlob->m_x, ItBlob->m_y, ItBlob->m_r, ItBlob->m_Id};
+		double response[2] = {ItBlob->m_Res, ItBlob->m_Phi};
+		pKey.Add(geometry, sizeof(geometry));
+		pKey.Add(response, sizeof(response));
+		pKey.Add(ItBlob->m_D.empty() ? NULL : &(ItBlob->m_D[0]), ItBlob->m_D.size()*sizeof(float));
+		pKey.Add(ItBlob->m_Frame.empty() ? NULL : &(ItBlob->m_Frame[0]), ItBlob->m_Frame.size()*sizeof(double));
+	}
+}
+
+/// Serializes the local features of a view for the descriptor cache.
+static void SerializeBlobList(BlobListRiB& pBlobFeatures, std::string& pData)
+{
+	pData.clear();
+	AppendCacheData(pData, (boost::int32_t)pBlobFeatures.size());
+	for (BlobListRiB::iterator ItBlob = pBlobFeatures.begin(); ItBlob != pBlobFeatures.end(); ItBlob++)
+	{
+		AppendCacheData(pData, (boost::int32_t)ItBlob->m_x);
+		AppendCacheData(pData, (boost::int32_t)ItBlob->m_y);
+		AppendCacheData(pData, (boost::int32_t)ItBlob->m_r);
+		AppendCacheData(pData, (boost::int32_t)ItBlob->m_Id);
+		AppendCacheData(pData, ItBlob->m_Res);
+		AppendCacheData(pData, ItBlob->m_Phi);
+		AppendCacheData(pData, (boost::int32_t)ItBlob->m_D.size());
+		for (unsigned int j=0; j<ItBlob->m_D.size(); j++) AppendCacheData(pData, ItBlob->m_D[j]);
+		AppendCacheData(pData, (boost::int32_t)ItBlob->m_Frame.size());
+		for (unsigned int j=0; j<ItBlob->m_Frame.size(); j++) AppendCacheData(pData, ItBlob->m_Frame[j]);
+	}
+}
+
+/// Restores the local features of a view written by <code>SerializeBlobList()</code>.
+/// @return False if the data is corrupt.
+static bool DeserializeBlobList(const std::string& pData, BlobListRiB& pBlobFeatures)
+{
+	pBlobFeatures.clear();
+	size_t position = 0;
+	boost::int32_t numberPoints = 0;
+	if (ReadCacheData(pData, position, numberPoints) == false || numberPoints < 0)
+		return false;
+	for (int point=0; point<numberPoints; point++)
+	{
+		BlobFeatureRiB fp;
+		boost::int32_t x=0, y=0, r=0, id=0, descriptorDimension=0, frameDimension=0;
+		bool ok = ReadCacheData(pData, position, x) && ReadCacheData(pData, position, y) && ReadCacheData(pData, position, r) && ReadCacheData(pData, position, id) &&
+				  ReadCacheData(pData, position, fp.m_Res) && ReadCacheData(pData, position, fp.m_Phi) && ReadCacheData(pData, position, descriptorDimension);
+		if (ok == false || descriptorDimension < 0 || position+(size_t)descriptorDimension*sizeof(float) > pData.size())
+			return false;
+		fp.m_x = x;
+		fp.m_y = y;
+		fp.m_r = r;
+		fp.m_Id = id;
+		const float* descriptor = (const float*)(pData.data()+position);
+		fp.m_D.assign(descriptor, descriptor+descriptorDimension);
+		position += descriptorDimension*sizeof(float);
+		if (ReadCacheData(pData, position, frameDimension) == false || frameDimension < 0 || position+(size_t)frameDimension*sizeof(double) > pData.size())
+			return false;
+		const double* frame = (const double*)(pData.data()+position);
+		fp.m_Frame.assign(frame, frame+frameDimension);
+		position += frameDimension*sizeof(double);
+		pBlobFeatures.push_back(fp);
+	}
+	return position == pData.size();
+}
+
+/// Serializes a (pRows x pCols) descriptor block for the descriptor cache.
+static void SerializeFloatBlock(int pRows, int pCols, const std::vector<float>& pBlock, std::string& pData)
+{
+	pData.clear();
+	AppendCacheData(pData, (boost::int32_t)pRows);
+	AppendCacheData(pData, (boost::int32_t)pCols);
+	if (pBlock.empty() == false)
+		pData.append((const char*)&pBlock[0], pBlock.size()*sizeof(float));
+}
+
+/// Restores a descriptor block written by <code>SerializeFloatBlock()</code>.
+/// @return False if the data is corrupt.
+static bool DeserializeFloatBlock(const std::string& pData, int& pRows, int& pCols, std::vector<float>& pBlock)
+{
+	size_t position = 0;
+	boost::int32_t rows = 0, cols = 0;
+	if (ReadCacheData(pData, position, rows) == false || ReadCacheData(pData, position, cols) == false || rows < 0 || cols < 0)
+		return false;
+	if (pData.size()-position != (size_t)rows*cols*sizeof(float))
+		return false;
+	pRows = rows;
+	pCols = cols;
+	const float* block = (const float*)(pData.data()+position);
+	pBlock.assign(block, block+rows*cols);
+	return true;
+}
+
+/// Concatenates the descriptor blocks of all groups in group order into one (rows x sum of sizes) matrix.
+/// @return False if a group is not available or the groups have different numbers of rows.
+static bool AssembleGlobalFeatureCacheGroups(std::vector<GlobalFeatureCacheGroup>& pGroups, CvMat** pGlobalFeatures)
+{
+	int rows = 0, cols = 0;
+	for (unsigned int g=0; g<pGroups.size(); g++)
+	{
+		if (pGroups[g].available == false || (g > 0 && pGroups[g].rows != rows))
+			return false;
+		rows = pGroups[g].rows;
+		cols += pGroups[g].size;
+	}
+	if (rows == 0 || cols == 0)
+		return false;
+
+	if (*pGlobalFeatures != NULL) cvReleaseMat(pGlobalFeatures);
+	*pGlobalFeatures = cvCreateMat(rows, cols, CV_32FC1);
+	int column = 0;
+	for (unsigned int g=0; g<pGroups.size(); g++)
+	{
+		for (int i=0; i<rows; i++)
+			for (int j=0; j<pGroups[g].size; j++)
+				cvmSet(*pGlobalFeatures, i, column+j, pGroups[g].data[i*pGroups[g].size+j]);
+		column += pGroups[g].size;
+	}
+	return true;
+}
+
 int ObjectClassifier::LoadCIN2Database(std::string pAnnotationFileName, std::string pDatabasePath, int pMode, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, LocalFeatureParams& pLocalFeatureParams, std::string pLocalFeatureFileName,
-										std::string pGlobalFeatureFileName, std::string pCovarianceMatrixFileName, std::string pLocalFeatureClustererPath, std::string pTimingLogFileName, std::ofstream& pScreenLogFile, MaskMode pMaskMode)
+										std::string pGlobalFeatureFileName, std::string pCovarianceMatrixFileName, std::string pLocalFeatureClustererPath, std::string pTimingLogFileName, std::ofstream& pScreenLogFile, MaskMode pMaskMode, std::string pDescriptorCachePath,
+										int pNumberThreads)
 {
 	SimpleStopWatch sw;
 	sw.start();
 
 	const int numberOfViewsPerObject = 36;
 
+	if (mDescriptorCache.Open(pDescriptorCachePath) != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
+
 
 	// read in object classes available in pDatabasePath (each class has its own folder)
 	std::cout << "Reading data from directory: '" << pDatabasePath << "'" << std::endl;
@@ -384,6 +540,14 @@ int ObjectClassifier::LoadCIN2Database(std::string pAnnotationFileName, std::str
 		std::cout << "\n\nLocal feature extraction\n\n";
 		pScreenLogFile << "\n\nLocal feature extraction\n\n";
 
+		if (pLocalFeatureParams.useFeature.compare("surf") != 0 && pLocalFeatureParams.useFeature.compare("rsd") != 0 && pLocalFeatureParams.useFeature.compare("fpfh") != 0)
+		{
+			std::cout << "ObjectClassifier::LoadCIN2Database: Error: Local feature type " << pLocalFeatureParams.useFeature << " unknown" << std::endl;
+			return ipa_utils::RET_FAILED;
+		}
+
+		// collect the views of all objects
+		std::vector<DatabaseView> views;
 		int ObjectCounter = 0;
 		std::map<std::string, std::vector<std::string> >::iterator ItObjectCategoryMap;
 		for (ItObjectCategoryMap = ObjectCategoryMap.begin(); ItObjectCategoryMap != ObjectCategoryMap.end(); ItObjectCategoryMap++)
@@ -400,11 +564,13 @@ int ObjectClassifier::LoadCIN2Database(std::string pAnnotationFileName, std::str
 				std::cout << "\n\nFeature extraction in class " << ItObjectCategoryMap->first << " on object " << sampleIndex << " (" << ++ObjectCounter << ". object overall) in path " << ItObjectCategoryMap->second[sampleIndex] << std::endl;
 				pScreenLogFile << "\n\nFeature extraction in class " << ItObjectCategoryMap->first << " on object " << sampleIndex << " (" << ObjectCounter << ". object overall) in path " << ItObjectCategoryMap->second[sampleIndex] << std::endl;
 				std::string directory = ItObjectCategoryMap->second[sampleIndex] + "/";
+				std::string classString = ItObjectCategoryMap->first;
+				if (classString == "pen" && (sampleIndex == 6 || sampleIndex == 7 || sampleIndex == 8 || sampleIndex == 10))
+					classString = "pen_highbase";
 
 				// iterate through all views
 				for (int imageIndex = 0; imageIndex < numberOfViewsPerObject; imageIndex++)
 				{
-					// load shared images
 					double exp = 0;
 					if (imageIndex > 0)
 						exp = std::log10((double)imageIndex);
@@ -413,78 +579,29 @@ int ObjectClassifier::LoadCIN2Database(std::string pAnnotationFileName, std::str
 						indexFormatted << "0";
 					indexFormatted << imageIndex;
 
-					// color (CV_8UC3)
-					std::string inputFilename = directory + "sharedImage_color_" + indexFormatted.str() + ".png";
-					cv::Mat colorImage = cv::imread(inputFilename);
-					IplImage colorImageIpl = (IplImage)colorImage;
-					IplImage* colorImageIplCopy = cvCreateImage(cvSize(colorImageIpl.width, colorImageIpl.height), colorImageIpl.depth, colorImageIpl.nChannels);
-					cvCopyImage(&colorImageIpl, colorImageIplCopy);
-
-					// xyz (CV_32FC3)
-					inputFilename = directory + "sharedImage_xyz_" + indexFormatted.str() + ".bin";
-					cv::Mat xyzImage;
-					LoadMat(xyzImage, inputFilename);
-					IplImage xyzImageIpl = (IplImage)xyzImage;
-					IplImage* xyzImageIplCopy = cvCreateImage(cvSize(xyzImageIpl.width, xyzImageIpl.height), xyzImageIpl.depth, xyzImageIpl.nChannels);
-					cvCopyImage(&xyzImageIpl, xyzImageIplCopy);
-
-					// intensity (CV_32FC1)
-					inputFilename = directory + "sharedImage_inten_" + indexFormatted.str() + ".bin";
-					cv::Mat intenImage;
-					//LoadMat(intenImage, inputFilename);	// intensity images are buggy
-					cv::cvtColor(colorImage, intenImage, CV_BGR2GRAY);
-					IplImage intenImageIpl = (IplImage)intenImage;
-					IplImage* intenImageIplCopy = cvCreateImage(cvSize(intenImageIpl.width, intenImageIpl.height), intenImageIpl.depth, intenImageIpl.nChannels);
-					cvCopyImage(&intenImageIpl, intenImageIplCopy);
-
-					SharedImage si;
-					si.setCoord(xyzImageIplCopy);
-					si.setShared(colorImageIplCopy);
-					si.setInten(intenImageIplCopy);
-
-					//if (imageIndex>29)
-					//{
-					//	std::string fnam = directory + "color.bmp";
-					//	cv::imwrite(fnam, colorImage);
-					//	fnam = directory + "coordinates.txt";
-					//	std::ofstream ofi(fnam.c_str());
-					//	for (int v=0; v<xyzImage.rows; v++)
-					//		for (int u=0; u<xyzImage.cols; u++)
-					//			ofi << xyzImage.at<cv::Point3f>(v, u).x << "\t" << xyzImage.at<cv::Point3f>(v, u).y << "\t" << xyzImage.at<cv::Point3f>(v, u).z << "\n";
-					//	ofi.close();
-					//	getchar();
-					//}
-
-
-					BlobListStruct TempBlobListStruct;
-					TempBlobListStruct.FileName = directory + "sharedImage_" + indexFormatted.str();		// should not have an extension
-					std::string classString = ItObjectCategoryMap->first;
-					if (pLocalFeatureParams.useFeature.compare("surf") == 0)
-					{
-						if (classString == "pen" && (sampleIndex == 6 || sampleIndex == 7 || sampleIndex == 8 || sampleIndex == 10))
-							classString = "pen_highbase";
-						ExtractLocalFeatures(&si, TempBlobListStruct.BlobFPs, pClusterMode, pMaskMode, TempBlobListStruct.FileName, CIN2, classString); /*, MASK_SAVE, ViewFileName.str() ... remove comment in order to create new masks*/
-					}
-					else if (pLocalFeatureParams.useFeature.compare("rsd") == 0)
-					{
-						ExtractLocalRSDorFPFHFeatures(&si, TempBlobListStruct.BlobFPs, pLocalFeatureParams, pMaskMode, TempBlobListStruct.FileName, CIN2);
-					}
-					else if (pLocalFeatureParams.useFeature.compare("fpfh") == 0)
-					{
-						ExtractLocalRSDorFPFHFeatures(&si, TempBlobListStruct.BlobFPs, pLocalFeatureParams, pMaskMode, TempBlobListStruct.FileName, CIN2);
-					}
-					else
-					{
-						std::cout << "ObjectClassifier::LoadCIN2Database: Error: Local feature type " << pLocalFeatureParams.useFeature << " unknown" << std::endl;
-						return ipa_utils::RET_FAILED;
-					}
-
-					si.Release();
-
-					(mData.mLocalFeaturesMap[ItObjectCategoryMap->first])[ClassObjectCounter].push_back(TempBlobListStruct);
+					// should not have an extension
+					views.push_back(MakeDatabaseView(ItObjectCategoryMap->first, ClassObjectCounter, classString, directory + "sharedImage_" + indexFormatted.str(), NULL));
 				}
 			}
 		}
+
+		// load the shared images and extract the local features, image loading and feature extraction overlap
+		DatabaseLoaderSettings settings;
+		settings.database = CIN2;
+		settings.clusterMode = pClusterMode;
+		settings.maskMode = pMaskMode;
+		settings.localFeatureParams = &pLocalFeatureParams;
+		settings.globalFeatureParams = &pGlobalFeatureParams;
+		int numberThreads = ipa_utils::ThreadPool::ResolveNumberThreads(pNumberThreads);
+		settings.timingLogFileName = (numberThreads > 1) ? "" : pTimingLogFileName;
+		settings.screenLogFile = (numberThreads > 1) ? NULL : &pScreenLogFile;
+		ipa_utils::Pipeline< boost::shared_ptr<SharedImage> >::Run((int)views.size(),
+			boost::bind(&ObjectClassifier::LoadDatabaseViewImages, this, &settings, &views, _1, _2),
+			boost::bind(&ObjectClassifier::ExtractDatabaseViewLocalFeatures, this, &settings, &views, _1, _2), numberThreads);
+
+		// merge in the order of the views
+		for (unsigned int viewIndex=0; viewIndex<views.size(); viewIndex++)
+			(mData.mLocalFeaturesMap[views[viewIndex].category])[views[viewIndex].objectIndex].push_back(views[viewIndex].localFeatures);
 		SaveFPDataLocal(pLocalFeatureFileName);
 	}
 	else
@@ -542,7 +659,27 @@ int ObjectClassifier::LoadCIN2Database(std::string pAnnotationFileName, std::str
 		if (NumberLocalFeatures <= 0) return ipa_utils::RET_FAILED;
 		int NumberGlobalFeatures = 0;
 
+		/// Compute the global features of all views, reading the input files and the descriptor computation overlap
+		std::vector<DatabaseView> views;
+		for (ItLocalFeaturesMap = mData.mLocalFeaturesMap.begin(); ItLocalFeaturesMap != mData.mLocalFeaturesMap.end(); ItLocalFeaturesMap++)
+			for (ItObjectMap = ItLocalFeaturesMap->second.begin(); ItObjectMap != ItLocalFeaturesMap->second.end(); ItObjectMap++)
+				for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
+					views.push_back(MakeDatabaseView(ItLocalFeaturesMap->first, ItObjectMap->first, ItLocalFeaturesMap->first, ItBlobListStructs->FileName, &(*ItBlobListStructs)));
+		DatabaseLoaderSettings settings;
+		settings.database = CIN2;
+		settings.clusterMode = pClusterMode;
+		settings.maskMode = pMaskMode;
+		settings.localFeatureParams = &pLocalFeatureParams;
+		settings.globalFeatureParams = &pGlobalFeatureParams;
+		int numberThreads = ipa_utils::ThreadPool::ResolveNumberThreads(pNumberThreads);
+		settings.timingLogFileName = (numberThreads > 1) ? "" : pTimingLogFileName;
+		settings.screenLogFile = (numberThreads > 1) ? NULL : &pScreenLogFile;
+		ipa_utils::Pipeline<DatabaseViewCoordinates>::Run((int)views.size(),
+			boost::bind(&ObjectClassifier::LoadDatabaseViewCoordinates, this, &settings, &views, _1, _2),
+			boost::bind(&ObjectClassifier::ExtractDatabaseViewGlobalFeatures, this, &settings, &views, _1, _2), numberThreads);
+
 		/// Iterate over classes
+		unsigned int viewIndex = 0;
 		for (ItLocalFeaturesMap = mData.mLocalFeaturesMap.begin(); ItLocalFeaturesMap != mData.mLocalFeaturesMap.end(); ItLocalFeaturesMap++)
 		{
 //			if (ItLocalFeaturesMap->first != "coffeepot") continue;
@@ -560,28 +697,23 @@ int ObjectClassifier::LoadCIN2Database(std::string pAnnotationFileName, std::str
 				int BlobListCounter=0;
 				int numberOfTiltAngles = 1 + pGlobalFeatureParams.additionalArtificialTiltedViewAngle.size();
 				int Rows = ItObjectMap->second.size() * numberOfTiltAngles;
-				CvMat* Features = NULL;
-				for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
-				{					
-					std::string inputFilename = ItBlobListStructs->FileName + ".bin";
-					size_t pos = inputFilename.find("sharedImage_");
-					if (pos != std::string::npos)
-						inputFilename.replace(pos, 12, "sharedImage_xyz_");
-					else
+				for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++, viewIndex++)
+				{
+					CvMat* Features = views[viewIndex].globalFeatures;
+					int extractionResult = views[viewIndex].result;
+					if (views[viewIndex].readError == true)
 					{
-						std::cout << "Error: LoadCIN2Database: Filename " << inputFilename << " does not contain sharedImage_ ." << std::endl;
-						pScreenLogFile << "Error: LoadCIN2Database: Filename " << inputFilename << " does not contain sharedImage_ ." << std::endl;
+						std::cout << "Error: LoadCIN2Database: Filename " << ItBlobListStructs->FileName << " does not contain sharedImage_ ." << std::endl;
+						pScreenLogFile << "Error: LoadCIN2Database: Filename " << ItBlobListStructs->FileName << " does not contain sharedImage_ ." << std::endl;
+						for (; viewIndex<views.size(); viewIndex++)
+							if (views[viewIndex].globalFeatures != NULL) cvReleaseMat(&(views[viewIndex].globalFeatures));
 						return ipa_utils::RET_FAILED;
 					}
-					cv::Mat xyzImage;
-					LoadMat(xyzImage, inputFilename);
-					IplImage xyzImageIpl = (IplImage)xyzImage;
-					
-					IplImage* Mask = cvLoadImage((ItBlobListStructs->FileName+"_Mask.png").c_str(), 0);
 					std::cout << ItBlobListStructs->FileName << "\n";
 					pScreenLogFile << ItBlobListStructs->FileName << "\n";
-					// check whether features were extracted																	// disabled image output
-					if (ExtractGlobalFeatures(&(ItBlobListStructs->BlobFPs), &Features, pClusterMode, pGlobalFeatureParams, CIN2, &xyzImageIpl, Mask/*, cvCloneImage(SourceImage.Shared())*/, 0, false, pTimingLogFileName, &pScreenLogFile) == ipa_utils::RET_OK)
+
+					// check whether features were extracted
+					if (extractionResult == ipa_utils::RET_OK)
 					{
 						// initialize GlobalFeatures and determine number of global features
 						if (!GlobalFeatures)
@@ -616,7 +748,7 @@ int ObjectClassifier::LoadCIN2Database(std::string pAnnotationFileName, std::str
 						}
 						Rows -= numberOfTiltAngles;
 					}
-					cvReleaseImage(&Mask);
+					if (Features != NULL) cvReleaseMat(&Features);
 				}
 				(mData.mGlobalFeaturesMap[ItLocalFeaturesMap->first])[ObjectCounter] = GlobalFeatures;
 
@@ -637,6 +769,11 @@ int ObjectClassifier::LoadCIN2Database(std::string pAnnotationFileName, std::str
 	}
 	std::cout << "Processing time for global feature extraction: " << sw.stop() << "s.\n";
 	pScreenLogFile << "Processing time for global feature extraction: " << sw.stop() << "s.\n";
+	if (mDescriptorCache.Enabled() == true)
+	{
+		std::cout << "Descriptor cache: " << mDescriptorCache.Hits() << " entries reused, " << mDescriptorCache.Misses() << " entries computed.\n";
+		pScreenLogFile << "Descriptor cache: " << mDescriptorCache.Hits() << " entries reused, " << mDescriptorCache.Misses() << " entries computed.\n";
+	}
 
 	return ipa_utils::RET_OK;
 }
@@ -675,11 +812,15 @@ POINT_CLOUD_REGISTER_POINT_STRUCT (PointXYZRGBIM,
 
 
 int ObjectClassifier::LoadWashingtonDatabase(std::string pAnnotationFileName, std::string pDatabasePath, int pMode, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, std::string pLocalFeatureFileName,
-										std::string pGlobalFeatureFileName, std::string pCovarianceMatrixFileName, std::string pLocalFeatureClustererPath, std::string pTimingLogFileName, std::ofstream& pScreenLogFile, MaskMode pMaskMode, bool useIPA3Database)
+										std::string pGlobalFeatureFileName, std::string pCovarianceMatrixFileName, std::string pLocalFeatureClustererPath, std::string pTimingLogFileName, std::ofstream& pScreenLogFile, MaskMode pMaskMode, bool useIPA3Database, std::string pDescriptorCachePath,
+										int pNumberThreads)
 {
 	SimpleStopWatch sw;
 	sw.start();
 
+	if (mDescriptorCache.Open(pDescriptorCachePath) != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
+
 	// no fixed number of views, we take every fifth frame as in the original paper
 	// const int numberOfViewsPerObject = 3*50;	// contains 3 sequences with 200-250 images
 
@@ -766,6 +907,8 @@ int ObjectClassifier::LoadWashingtonDatabase(std::string pAnnotationFileName, st
 		std::cout << "\n\nLocal feature extraction\n\n";
 		pScreenLogFile << "\n\nLocal feature extraction\n\n";
 
+		// collect the views of all objects
+		std::vector<DatabaseView> views;
 		int ObjectCounter = 0;
 		std::map<std::string, std::vector<std::string> >::iterator ItObjectCategoryMap;
 		for (ItObjectCategoryMap = ObjectCategoryMap.begin(); ItObjectCategoryMap != ObjectCategoryMap.end(); ItObjectCategoryMap++)
@@ -844,77 +987,47 @@ int ObjectClassifier::LoadWashingtonDatabase(std::string pAnnotationFileName, st
 
 						//if (fs::exists(filename) == false)
 						//	std::cout << filename << " does not exist." << std::endl;
-						
-						// load pcd file and write images
-						IplImage* colorImage = cvCreateImage(cvSize(640, 480), IPL_DEPTH_8U, 3);
-						cvSetZero(colorImage);
-						IplImage* intenImage = cvCreateImage(cvSize(640, 480), IPL_DEPTH_8U, 1);
-						cvSetZero(intenImage);
-						IplImage* xyzImage = cvCreateImage(cvSize(640, 480), IPL_DEPTH_32F, 3);
-						cvSetZero(xyzImage);
-
-						pcl::PointCloud<PointXYZRGBIM>::Ptr cloud (new pcl::PointCloud<PointXYZRGBIM>);
-
-						if (pcl::io::loadPCDFile<PointXYZRGBIM> (filename, *cloud) == -1) //* load the file
-						{
-							std::cout << "Couldn't read file " << filename << "." << std::endl;
-							return ipa_utils::RET_FAILED;
-						}
-						//std::cout << "Loaded " << cloud->width * cloud->height << " data points from test_pcd.pcd with the following fields: " << std::endl;
-
-						for (size_t i = 0; i < cloud->points.size (); ++i)
-						{
-							uint32_t rgb = *reinterpret_cast<int*>(&cloud->points[i].rgb);
-							uint8_t r = (rgb >> 16) & 0x0000ff;
-							uint8_t g = (rgb >> 8)  & 0x0000ff;
-							uint8_t b = (rgb)       & 0x0000ff;
-							int u = cloud->points[i].imX;
-							int v = cloud->points[i].imY;
-							float x = cloud->points[i].x;
-							float y = -cloud->points[i].z;
-							float z = cloud->points[i].y;
-
-							cvSet2D(colorImage, v, u, cvScalar(b, g, r, 0));
-							cvSet2D(xyzImage, v, u, cvScalar(x, y, z, 0));
-						}
-
-						cvCvtColor(colorImage, intenImage, CV_BGR2GRAY);
 
-						// create shared image
-						SharedImage si;
-						si.setCoord(xyzImage);
-						si.setShared(colorImage);
-						si.setInten(intenImage);
-
-						//cvNamedWindow("color");
-						//cvShowImage("color", colorImage);
-						//cvNamedWindow("xyz");
-						//cvShowImage("xyz", xyzImage);
-						//cvNamedWindow("inten");
-						//cvShowImage("inten", intenImage);
-						//cvWaitKey(10);
-						//cvWaitKey();
+						views.push_back(MakeDatabaseView(ItObjectCategoryMap->first, ClassObjectCounter, ItObjectCategoryMap->first, filename, NULL));
+					}
+				}
+			}
+		}
 
-						BlobListStruct TempBlobListStruct;
-						TempBlobListStruct.FileName = filename;
-						std::string classString = ItObjectCategoryMap->first;
-						ExtractLocalFeatures(&si, TempBlobListStruct.BlobFPs, pClusterMode, pMaskMode, TempBlobListStruct.FileName, WASHINGTON, classString); //, MASK_SAVE, ViewFileName.str() ... remove comment in order to create new masks
+		// load the pcd files and extract the local features, file loading and feature extraction overlap
+		DatabaseLoaderSettings settings;
+		settings.database = WASHINGTON;
+		settings.clusterMode = pClusterMode;
+		settings.maskMode = pMaskMode;
+		settings.localFeatureParams = NULL;
+		settings.globalFeatureParams = &pGlobalFeatureParams;
+		int numberThreads = ipa_utils::ThreadPool::ResolveNumberThreads(pNumberThreads);
+		settings.timingLogFileName = (numberThreads > 1) ? "" : pTimingLogFileName;
+		settings.screenLogFile = (numberThreads > 1) ? NULL : &pScreenLogFile;
+		ipa_utils::Pipeline< boost::shared_ptr<SharedImage> >::Run((int)views.size(),
+			boost::bind(&ObjectClassifier::LoadDatabaseViewImages, this, &settings, &views, _1, _2),
+			boost::bind(&ObjectClassifier::ExtractDatabaseViewLocalFeatures, this, &settings, &views, _1, _2), numberThreads);
 
-						si.Release();
+		// merge in the order of the views
+		for (unsigned int viewIndex=0; viewIndex<views.size(); viewIndex++)
+		{
+			BlobListStruct& TempBlobListStruct = views[viewIndex].localFeatures;
+			if (views[viewIndex].readError == true)
+			{
+				std::cout << "Couldn't read file " << TempBlobListStruct.FileName << "." << std::endl;
+				return ipa_utils::RET_FAILED;
+			}
+			if (useIPA3Database==true && TempBlobListStruct.BlobFPs.size()==0)
+			{
+				BlobFeature blob;
+				blob.m_D.push_back(0);
+				TempBlobListStruct.BlobFPs.push_back(blob);
+			}
+			(mData.mLocalFeaturesMap[views[viewIndex].category])[views[viewIndex].objectIndex].push_back(TempBlobListStruct);
 
-						if (useIPA3Database==true && TempBlobListStruct.BlobFPs.size()==0)
-						{
-							BlobFeature blob;
-							blob.m_D.push_back(0);
-							TempBlobListStruct.BlobFPs.push_back(blob);
-						}
-						(mData.mLocalFeaturesMap[ItObjectCategoryMap->first])[ClassObjectCounter].push_back(TempBlobListStruct);
-		
-						std::cout << ".";
-					}
-				}
+			std::cout << ".";
+			if (viewIndex+1 == views.size() || views[viewIndex+1].category != views[viewIndex].category || views[viewIndex+1].objectIndex != views[viewIndex].objectIndex)
 				std::cout << std::endl;
-			}
 		}
 		SaveFPDataLocal(pLocalFeatureFileName);
 	}
@@ -968,7 +1081,27 @@ int ObjectClassifier::LoadWashingtonDatabase(std::string pAnnotationFileName, st
 		if (NumberLocalFeatures <= 0) return ipa_utils::RET_FAILED;
 		int NumberGlobalFeatures = 0;
 
+		/// Compute the global features of all views, reading the pcd files and the descriptor computation overlap
+		std::vector<DatabaseView> views;
+		for (ItLocalFeaturesMap = mData.mLocalFeaturesMap.begin(); ItLocalFeaturesMap != mData.mLocalFeaturesMap.end(); ItLocalFeaturesMap++)
+			for (ItObjectMap = ItLocalFeaturesMap->second.begin(); ItObjectMap != ItLocalFeaturesMap->second.end(); ItObjectMap++)
+				for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
+					views.push_back(MakeDatabaseView(ItLocalFeaturesMap->first, ItObjectMap->first, ItLocalFeaturesMap->first, ItBlobListStructs->FileName, &(*ItBlobListStructs)));
+		DatabaseLoaderSettings settings;
+		settings.database = WASHINGTON;
+		settings.clusterMode = pClusterMode;
+		settings.maskMode = pMaskMode;
+		settings.localFeatureParams = NULL;
+		settings.globalFeatureParams = &pGlobalFeatureParams;
+		int numberThreads = ipa_utils::ThreadPool::ResolveNumberThreads(pNumberThreads);
+		settings.timingLogFileName = (numberThreads > 1) ? "" : pTimingLogFileName;
+		settings.screenLogFile = (numberThreads > 1) ? NULL : &pScreenLogFile;
+		ipa_utils::Pipeline<DatabaseViewCoordinates>::Run((int)views.size(),
+			boost::bind(&ObjectClassifier::LoadDatabaseViewCoordinates, this, &settings, &views, _1, _2),
+			boost::bind(&ObjectClassifier::ExtractDatabaseViewGlobalFeatures, this, &settings, &views, _1, _2), numberThreads);
+
 		/// Iterate over classes
+		unsigned int viewIndex = 0;
 		for (ItLocalFeaturesMap = mData.mLocalFeaturesMap.begin(); ItLocalFeaturesMap != mData.mLocalFeaturesMap.end(); ItLocalFeaturesMap++)
 		{
 			//if (ItLocalFeaturesMap->first != "bottle") continue;
@@ -985,38 +1118,23 @@ int ObjectClassifier::LoadWashingtonDatabase(std::string pAnnotationFileName, st
 				/// Iterate over pictures of an object
 				int BlobListCounter=0;
 				int Rows = ItObjectMap->second.size();
-				CvMat* Features = NULL;
-				for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
+				for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++, viewIndex++)
 				{
-					IplImage* maskImage = cvCreateImage(cvSize(640, 480), IPL_DEPTH_8U, 1);
-					cvSetZero(maskImage);
-					IplImage* xyzImage = cvCreateImage(cvSize(640, 480), IPL_DEPTH_32F, 3);
-					cvSetZero(xyzImage);
-
-					pcl::PointCloud<PointXYZRGBIM>::Ptr cloud (new pcl::PointCloud<PointXYZRGBIM>);
+					std::cout << ItBlobListStructs->FileName << "\n";
+					pScreenLogFile << ItBlobListStructs->FileName << "\n";
 
-					if (pcl::io::loadPCDFile<PointXYZRGBIM> (ItBlobListStructs->FileName, *cloud) == -1) //* load the file
+					CvMat* Features = views[viewIndex].globalFeatures;
+					int extractionResult = views[viewIndex].result;
+					if (views[viewIndex].readError == true)
 					{
 						std::cout << "Couldn't read file " << ItBlobListStructs->FileName << "." << std::endl;
+						for (; viewIndex<views.size(); viewIndex++)
+							if (views[viewIndex].globalFeatures != NULL) cvReleaseMat(&(views[viewIndex].globalFeatures));
 						return ipa_utils::RET_FAILED;
 					}
 
-					for (size_t i = 0; i < cloud->points.size (); ++i)
-					{
-						int u = cloud->points[i].imX;
-						int v = cloud->points[i].imY;
-						float x = cloud->points[i].x;
-						float y = -cloud->points[i].z;
-						float z = cloud->points[i].y;
-
-						cvSet2D(xyzImage, v, u, cvScalar(x, y, z, 0));
-						cvSetReal2D(maskImage, v, u, 255);
-					}
-
-					std::cout << ItBlobListStructs->FileName << "\n";
-					pScreenLogFile << ItBlobListStructs->FileName << "\n";
-					// check whether features were extracted																	// disabled image output
-					if (ExtractGlobalFeatures(&(ItBlobListStructs->BlobFPs), &Features, pClusterMode, pGlobalFeatureParams, CIN2, xyzImage, maskImage/*, cvCloneImage(SourceImage.Shared())*/, 0, false, pTimingLogFileName, &pScreenLogFile) == ipa_utils::RET_OK)
+					// check whether features were extracted
+					if (extractionResult == ipa_utils::RET_OK)
 					{
 						// initialize GlobalFeatures and determine number of global features
 						if (!GlobalFeatures)
@@ -1043,8 +1161,7 @@ int ObjectClassifier::LoadWashingtonDatabase(std::string pAnnotationFileName, st
 							Rows--;
 						}
 					}
-					cvReleaseImage(&maskImage);
-					cvReleaseImage(&xyzImage);
+					if (Features != NULL) cvReleaseMat(&Features);
 				}
 				(mData.mGlobalFeaturesMap[ItLocalFeaturesMap->first])[ObjectCounter] = GlobalFeatures;
 
@@ -1065,6 +1182,11 @@ int ObjectClassifier::LoadWashingtonDatabase(std::string pAnnotationFileName, st
 	}
 	std::cout << "Processing time for global feature extraction: " << sw.stop() << "s.\n";
 	pScreenLogFile << "Processing time for global feature extraction: " << sw.stop() << "s.\n";
+	if (mDescriptorCache.Enabled() == true)
+	{
+		std::cout << "Descriptor cache: " << mDescriptorCache.Hits() << " entries reused, " << mDescriptorCache.Misses() << " entries computed.\n";
+		pScreenLogFile << "Descriptor cache: " << mDescriptorCache.Hits() << " entries reused, " << mDescriptorCache.Misses() << " entries computed.\n";
+	}
 
 	return ipa_utils::RET_OK;
 }
@@ -1542,12 +1664,40 @@ int ObjectClassifier::ClusterLocalFeatures(std::string pCovarianceMatrixFileName
 }
 
 
-int ObjectClassifier::TrainLocal(std::string pClassifierSavePath, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType)
+/// Seed of the random generator used for class pClass in the multi-threaded training modes (FNV-1a hash of the class name combined with the base seed).
+/// It only depends on the base seed and the class name, hence the results are reproducible independently of the number of threads or classes.
+static uint64 ClassRandomSeed(unsigned int pRandomSeed, const std::string& pClass)
+{
+	uint64 hash = 14695981039346656037ULL ^ (uint64)pRandomSeed;
+	for (size_t i=0; i<pClass.length(); i++)
+	{
+		hash ^= (uint64)(unsigned char)pClass[i];
+		hash *= 1099511628211ULL;
+	}
+	return (hash==0) ? 1 : hash;	// cv::RNG replaces a zero state
+}
+
+
+int ObjectClassifier::TrainLocal(std::string pClassifierSavePath, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType, int pNumberThreads, unsigned int pRandomSeed)
 {
 	std::cout << "\n\nTraining " << ClassifierLabel(pClassifierType) << " classifiers.\n";
 
 	/// Train local classifiers
-	
+	if (pNumberThreads != 1)
+	{
+		// one task per class, the classifiers are independent of each other
+		boost::mutex resultMutex;
+		{
+			ipa_utils::ThreadPool threadPool(pNumberThreads);
+			std::cout << "Training " << mData.mLocalFeaturesMap.size() << " classes with " << threadPool.size() << " threads.\n";
+			for (LocalFeaturesMap::iterator ItLocalFeaturesMap = mData.mLocalFeaturesMap.begin(); ItLocalFeaturesMap != mData.mLocalFeaturesMap.end(); ItLocalFeaturesMap++)
+				threadPool.schedule(boost::bind(&ObjectClassifier::TrainLocalClassTask, this, ItLocalFeaturesMap->first, pFactorCorrect, pFactorIncorrect, pClassifierType, pRandomSeed, &resultMutex));
+			threadPool.wait();
+		}
+		mData.SaveLocalClassifiers(pClassifierSavePath, pClassifierType);
+		return ipa_utils::RET_OK;
+	}
+
 	// iterate over all classes
 	LocalFeaturesMap::iterator ItLocalFeaturesMap;
 	int Counter = 1;
@@ -1577,6 +1727,46 @@ int ObjectClassifier::TrainLocal(std::string pClassifierSavePath, float pFactorC
 }
 
 
+void ObjectClassifier::TrainLocalClassTask(std::string pClass, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType, unsigned int pRandomSeed, boost::mutex* pResultMutex)
+{
+	// cv::theRNG() is thread-local, the random trees draw their bootstrap samples from it
+	cv::RNG rng(ClassRandomSeed(pRandomSeed, pClass));
+	cv::theRNG() = cv::RNG(rng.next());
+
+	// get training data matrix
+	CvMat* TrainingFeatureMatrix = NULL;
+	int NumberCorrectSamples = 0;
+	if (mData.GetLocalFeatureMatrix(pClass, &TrainingFeatureMatrix, pFactorCorrect, pFactorIncorrect, NumberCorrectSamples, &rng) == ipa_utils::RET_FAILED)
+	{
+		if (TrainingFeatureMatrix != NULL) cvReleaseMat(&TrainingFeatureMatrix);
+		return;
+	}
+
+	// create correct response matrix
+	CvMat* TrainingCorrectResponses = cvCreateMat(TrainingFeatureMatrix->rows, 1, CV_32FC1);
+	for (int i=0; i<NumberCorrectSamples; i++) cvSetReal1D(TrainingCorrectResponses, i, 1.0);
+	for (int i=NumberCorrectSamples; i<TrainingCorrectResponses->rows; i++) cvSetReal1D(TrainingCorrectResponses, i, 0.0);
+
+	CvStatModel* classifier = CreateLocalClassifier(pClassifierType, TrainingFeatureMatrix, TrainingCorrectResponses);
+
+	cvReleaseMat(&TrainingFeatureMatrix);
+	cvReleaseMat(&TrainingCorrectResponses);
+
+	// store classifier
+	boost::mutex::scoped_lock lock(*pResultMutex);
+	LocalClassifierMap::iterator ItLocalClassifierMap;
+	if ((ItLocalClassifierMap=mData.mLocalClassifierMap.find(pClass)) != mData.mLocalClassifierMap.end())
+	{
+		ItLocalClassifierMap->second->clear();
+		delete ItLocalClassifierMap->second;
+		mData.mLocalClassifierMap.erase(ItLocalClassifierMap);
+	}
+	if (classifier != NULL)
+		mData.mLocalClassifierMap[pClass] = classifier;
+	std::cout << "Training class " << pClass << " finished.\n";
+}
+
+
 int ObjectClassifier::TrainLocal(ClassifierType pClassifierType, std::string pClass, int pNumberSamples, int pNumberFeatures, LocalFeaturesMap::iterator pItLocalFeaturesClass, std::list<int>* pIndicesTrainCorrect, std::list<int>* pIndicesTrainIncorrect, CvMat* pNegativeSamplesMatrix)
 {
 	// create training data matrix and response matrix
@@ -1632,14 +1822,23 @@ int ObjectClassifier::TrainLocal(ClassifierType pClassifierType, std::string pCl
 		ItLocalClassifierMap->second->clear();
 	}
 
+	CvStatModel* classifier = CreateLocalClassifier(pClassifierType, pTrainingFeatureMatrix, pTrainingCorrectResponses);
+	if (classifier != NULL)
+		mData.mLocalClassifierMap[pClass] = classifier;
+	return ipa_utils::RET_OK;
+}
+
+
+CvStatModel* ObjectClassifier::CreateLocalClassifier(ClassifierType pClassifierType, CvMat* pTrainingFeatureMatrix, CvMat* pTrainingCorrectResponses)
+{
+	CvStatModel* classifier = NULL;
 	switch (pClassifierType)
 	{
 		case CLASSIFIER_RTC:
 			{
 				// create new classifier
-				mData.mLocalClassifierMap[pClass] = new CvRTrees;
-				CvRTrees* RTC = NULL;
-				RTC = dynamic_cast<CvRTrees*>(mData.mLocalClassifierMap[pClass]);
+				CvRTrees* RTC = new CvRTrees;
+				classifier = RTC;
 
 				// train classifier
 				CvMat* VarType = cvCreateMat(1,(pTrainingFeatureMatrix->width+1),CV_8UC1);
@@ -1668,8 +1867,8 @@ int ObjectClassifier::TrainLocal(ClassifierType pClassifierType, std::string pCl
 		case CLASSIFIER_SVM:
 			{
 				// create new classifier
-				mData.mLocalClassifierMap[pClass] = new CvSVM;
-				CvSVM* SVM = dynamic_cast<CvSVM*>(mData.mLocalClassifierMap[pClass]);
+				CvSVM* SVM = new CvSVM;
+				classifier = SVM;
 
 				// train classifier
 				CvSVMParams SVMParams = CvSVMParams(CvSVM::NU_SVR, CvSVM::RBF, 0, 2.0, 0, 1.0, 0.2, 0, 0, cvTermCriteria(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 50, 0.05));
@@ -1679,8 +1878,8 @@ int ObjectClassifier::TrainLocal(ClassifierType pClassifierType, std::string pCl
 		case CLASSIFIER_BOOST:
 			{
 				// create new classifier
-				mData.mLocalClassifierMap[pClass] = new CvBoost;
-				CvBoost* Boost = dynamic_cast<CvBoost*>(mData.mLocalClassifierMap[pClass]);
+				CvBoost* Boost = new CvBoost;
+				classifier = Boost;
 
 				// train classifier
 				CvMat* VarType = cvCreateMat(1,(pTrainingFeatureMatrix->width+1),CV_8UC1);
@@ -1696,8 +1895,8 @@ int ObjectClassifier::TrainLocal(ClassifierType pClassifierType, std::string pCl
 		case CLASSIFIER_KNN:
 			{
 				// create new classifier
-				mData.mLocalClassifierMap[pClass] = new CvKNearest;
-				CvKNearest* KNN = dynamic_cast<CvKNearest*>(mData.mLocalClassifierMap[pClass]);
+				CvKNearest* KNN = new CvKNearest;
+				classifier = KNN;
 
 				// train classifier
 				KNN->train(pTrainingFeatureMatrix, pTrainingCorrectResponses, 0, true);
@@ -1705,15 +1904,29 @@ int ObjectClassifier::TrainLocal(ClassifierType pClassifierType, std::string pCl
 				break;
 			}
 	}
-	return ipa_utils::RET_OK;
+	return classifier;
 }
 
 
-int ObjectClassifier::TrainGlobal(std::string pPath, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType)
+int ObjectClassifier::TrainGlobal(std::string pPath, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType, int pNumberThreads, unsigned int pRandomSeed)
 {
 	std::cout << "\n\nTraining " << ClassifierLabel(pClassifierType) << " classifiers.\n";
 	
 	/// Train global classifiers
+	if (pNumberThreads != 1)
+	{
+		// one task per class, the classifiers are independent of each other
+		boost::mutex resultMutex;
+		{
+			ipa_utils::ThreadPool threadPool(pNumberThreads);
+			std::cout << "Training " << mData.mGlobalFeaturesMap.size() << " classes with " << threadPool.size() << " threads.\n";
+			for (GlobalFeaturesMap::iterator ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+				threadPool.schedule(boost::bind(&ObjectClassifier::TrainGlobalClassTask, this, ItGlobalFeaturesMap->first, pFactorCorrect, pFactorIncorrect, pClassifierType, pRandomSeed, &resultMutex));
+			threadPool.wait();
+		}
+		mData.SaveGlobalClassifiers(pPath, pClassifierType);
+		return ipa_utils::RET_OK;
+	}
 	
 	// iterate over all classes
 	GlobalFeaturesMap::iterator ItGlobalFeaturesMap;
@@ -1722,19 +1935,17 @@ int ObjectClassifier::TrainGlobal(std::string pPath, float pFactorCorrect, float
 	{
 		std::cout << "Training class " << ItGlobalFeaturesMap->first << " (" << Counter << "th out of " << mData.mGlobalFeaturesMap.size() << ")" << ".\n";
 		// get training data matrix
-		CvMat* TrainingFeatureMatrix = NULL;
+		cv::Mat TrainingFeatureMatrix;
 		int NumberCorrectSamples = 0;
-		if (mData.GetGlobalFeatureMatrix(ItGlobalFeaturesMap->first, &TrainingFeatureMatrix, pFactorCorrect, pFactorIncorrect, NumberCorrectSamples) == ipa_utils::RET_FAILED) continue;
+		if (mData.GetGlobalFeatureMatrix(ItGlobalFeaturesMap->first, TrainingFeatureMatrix, pFactorCorrect, pFactorIncorrect, NumberCorrectSamples, NULL, &mTrainingFeatureBuffer) == ipa_utils::RET_FAILED) continue;
 
 		// create correct response matrix
-		CvMat* TrainingCorrectResponses = cvCreateMat(TrainingFeatureMatrix->rows, 1, CV_32FC1);
-		for (int i=0; i<NumberCorrectSamples; i++) cvmSet(TrainingCorrectResponses, i, 0, 1.0);
-		for (int i=NumberCorrectSamples; i<TrainingCorrectResponses->rows; i++) cvmSet(TrainingCorrectResponses, i, 0, 0.0);
+		cv::Mat TrainingCorrectResponses = mTrainingResponseBuffer.Get(TrainingFeatureMatrix.rows, 1, CV_32FC1);
+		TrainingCorrectResponses.rowRange(0, NumberCorrectSamples).setTo(cv::Scalar(1.0));
+		TrainingCorrectResponses.rowRange(NumberCorrectSamples, TrainingCorrectResponses.rows).setTo(cv::Scalar(0.0));
 
-		TrainGlobal(pClassifierType, ItGlobalFeaturesMap->first, TrainingFeatureMatrix, TrainingCorrectResponses);
-		
-		cvReleaseMat(&TrainingFeatureMatrix);
-		cvReleaseMat(&TrainingCorrectResponses);
+		CvMat TrainingFeatureHeader = TrainingFeatureMatrix, TrainingResponseHeader = TrainingCorrectResponses;
+		TrainGlobal(pClassifierType, ItGlobalFeaturesMap->first, &TrainingFeatureHeader, &TrainingResponseHeader);
 	}
 
 	// save: file name: ClassName_Classifier_Loc/Glob.txt
@@ -1744,27 +1955,61 @@ int ObjectClassifier::TrainGlobal(std::string pPath, float pFactorCorrect, float
 }
 
 
+void ObjectClassifier::TrainGlobalClassTask(std::string pClass, float pFactorCorrect, float pFactorIncorrect, ClassifierType pClassifierType, unsigned int pRandomSeed, boost::mutex* pResultMutex)
+{
+	// cv::theRNG() is thread-local, the random trees draw their bootstrap samples from it
+	cv::RNG rng(ClassRandomSeed(pRandomSeed, pClass));
+	cv::theRNG() = cv::RNG(rng.next());
+
+	// get training data matrix (one per task, the member buffers are reserved for the sequential code paths)
+	cv::Mat TrainingFeatureMatrix;
+	int NumberCorrectSamples = 0;
+	if (mData.GetGlobalFeatureMatrix(pClass, TrainingFeatureMatrix, pFactorCorrect, pFactorIncorrect, NumberCorrectSamples, &rng) == ipa_utils::RET_FAILED)
+		return;
+
+	// create correct response matrix
+	cv::Mat TrainingCorrectResponses(TrainingFeatureMatrix.rows, 1, CV_32FC1, cv::Scalar(0.0));
+	TrainingCorrectResponses.rowRange(0, NumberCorrectSamples).setTo(cv::Scalar(1.0));
+
+	CvMat TrainingFeatureHeader = TrainingFeatureMatrix, TrainingResponseHeader = TrainingCorrectResponses;
+	CvStatModel* classifier = CreateGlobalClassifier(pClassifierType, &TrainingFeatureHeader, &TrainingResponseHeader);
+
+	// store classifier
+	boost::mutex::scoped_lock lock(*pResultMutex);
+	GlobalClassifierMap::iterator ItGlobalClassifierMap;
+	if ((ItGlobalClassifierMap=mData.mGlobalClassifierMap.find(pClass)) != mData.mGlobalClassifierMap.end())
+	{
+		ItGlobalClassifierMap->second->clear();
+		delete ItGlobalClassifierMap->second;
+		mData.mGlobalClassifierMap.erase(ItGlobalClassifierMap);
+	}
+	if (classifier != NULL)
+		mData.mGlobalClassifierMap[pClass] = classifier;
+	std::cout << "Training class " << pClass << " finished.\n";
+}
+
+
 int ObjectClassifier::TrainGlobalSampleRange(ClassifierType pClassifierType, std::string pClass, int pNumberSamples, int pNumberFeatures, GlobalFeaturesMap::iterator pItGlobalFeaturesClass, std::list<int>* pIndicesTrainCorrect, std::list<int>* pIndicesTrainIncorrect, CvMat* pNegativeSamplesMatrix, double rangeStartFactor, double rangeEndFactor)
 {
-	// create training data matrix and response matrix
-	CvMat* TrainingFeatureMatrix = cvCreateMat(pNumberSamples, pNumberFeatures, pItGlobalFeaturesClass->second[0]->type);
-	CvMat* TrainingFeatureResponseMatrix = cvCreateMat(pNumberSamples, 1, pItGlobalFeaturesClass->second[0]->type);
+	// create training data matrix and response matrix (views into the reused training buffers)
+	int type = pItGlobalFeaturesClass->second[0]->type;
+	cv::Mat TrainingFeatureMatrix = mTrainingFeatureBuffer.Get(pNumberSamples, pNumberFeatures, type);
+	cv::Mat TrainingFeatureResponseMatrix = mTrainingResponseBuffer.Get(pNumberSamples, 1, CV_32FC1);
+	cv::Mat NegativeSamplesMatrix(pNegativeSamplesMatrix);
 
 	// fill training data matrix with correct samples
 	std::list<int>::iterator ItIndices;
 	int SampleIndex = 0;
 	for (ItIndices = pIndicesTrainCorrect->begin(); ItIndices != pIndicesTrainCorrect->end(); ItIndices++)
 	{
+		cv::Mat ObjectSamples(pItGlobalFeaturesClass->second[*ItIndices]);
 		for (double dSample=pItGlobalFeaturesClass->second[*ItIndices]->rows*rangeStartFactor; dSample<pItGlobalFeaturesClass->second[*ItIndices]->rows * rangeEndFactor; dSample+=1.)
 		{
 			int i = (int)dSample;
 			//for (int i=0; i<pItGlobalFeaturesClass->second[*ItIndices]->rows; i++, SampleIndex++)
 			//{
-			for (int j=0; j<pNumberFeatures; j++)
-			{
-				cvmSet(TrainingFeatureMatrix, SampleIndex, j, cvmGet(pItGlobalFeaturesClass->second[*ItIndices], i, j));
-			}
-			cvmSet(TrainingFeatureResponseMatrix, SampleIndex, 0, 1.0);
+			ObjectSamples.row(i).colRange(0, pNumberFeatures).copyTo(TrainingFeatureMatrix.row(SampleIndex));
+			TrainingFeatureResponseMatrix.at<float>(SampleIndex, 0) = 1.f;
 			SampleIndex++;
 		}
 	}
@@ -1772,17 +2017,13 @@ int ObjectClassifier::TrainGlobalSampleRange(ClassifierType pClassifierType, std
 	// fill training data matrix with incorrect samples
 	for (ItIndices = pIndicesTrainIncorrect->begin(); ItIndices != pIndicesTrainIncorrect->end(); ItIndices++, SampleIndex++)
 	{
-		for (int j=0; j<pNumberFeatures; j++)
-		{
-			cvmSet(TrainingFeatureMatrix, SampleIndex, j, cvmGet(pNegativeSamplesMatrix, *ItIndices, j));
-		}
-		cvmSet(TrainingFeatureResponseMatrix, SampleIndex, 0, 0.0);
+		NegativeSamplesMatrix.row(*ItIndices).colRange(0, pNumberFeatures).copyTo(TrainingFeatureMatrix.row(SampleIndex));
+		TrainingFeatureResponseMatrix.at<float>(SampleIndex, 0) = 0.f;
 	}
 
 	// train classifier
-	TrainGlobal(pClassifierType, pClass, TrainingFeatureMatrix, TrainingFeatureResponseMatrix);
-	cvReleaseMat(&TrainingFeatureMatrix);
-	cvReleaseMat(&TrainingFeatureResponseMatrix);
+	CvMat TrainingFeatureHeader = TrainingFeatureMatrix, TrainingResponseHeader = TrainingFeatureResponseMatrix;
+	TrainGlobal(pClassifierType, pClass, &TrainingFeatureHeader, &TrainingResponseHeader);
 
 	return ipa_utils::RET_OK;
 }
@@ -1790,25 +2031,25 @@ int ObjectClassifier::TrainGlobalSampleRange(ClassifierType pClassifierType, std
 
 int ObjectClassifier::TrainGlobal(ClassifierType pClassifierType, std::string pClass, int pNumberSamples, int pNumberFeatures, GlobalFeaturesMap::iterator pItGlobalFeaturesClass, std::list<int>* pIndicesTrainCorrect, std::list<int>* pIndicesTrainIncorrect, CvMat* pNegativeSamplesMatrix, int pViewsPerObject)
 {
-	// create training data matrix and response matrix
-	CvMat* TrainingFeatureMatrix = cvCreateMat(pNumberSamples, pNumberFeatures, pItGlobalFeaturesClass->second[0]->type);
-	CvMat* TrainingFeatureResponseMatrix = cvCreateMat(pNumberSamples, 1, pItGlobalFeaturesClass->second[0]->type);
+	// create training data matrix and response matrix (views into the reused training buffers)
+	int type = pItGlobalFeaturesClass->second[0]->type;
+	cv::Mat TrainingFeatureMatrix = mTrainingFeatureBuffer.Get(pNumberSamples, pNumberFeatures, type);
+	cv::Mat TrainingFeatureResponseMatrix = mTrainingResponseBuffer.Get(pNumberSamples, 1, CV_32FC1);
+	cv::Mat NegativeSamplesMatrix(pNegativeSamplesMatrix);
 
 	// fill training data matrix with correct samples
 	std::list<int>::iterator ItIndices;
 	int SampleIndex = 0;
 	for (ItIndices = pIndicesTrainCorrect->begin(); ItIndices != pIndicesTrainCorrect->end(); ItIndices++)
 	{
+		cv::Mat ObjectSamples(pItGlobalFeaturesClass->second[*ItIndices]);
 		for (double dSample=0; dSample<pItGlobalFeaturesClass->second[*ItIndices]->rows; (pViewsPerObject==-1) ? dSample+=1. : dSample+=max(1., (double)pItGlobalFeaturesClass->second[*ItIndices]->rows/(double)pViewsPerObject))
 		{
 			int i = (int)dSample;
 		//for (int i=0; i<pItGlobalFeaturesClass->second[*ItIndices]->rows; i++, SampleIndex++)
 		//{
-			for (int j=0; j<pNumberFeatures; j++)
-			{
-				cvmSet(TrainingFeatureMatrix, SampleIndex, j, cvmGet(pItGlobalFeaturesClass->second[*ItIndices], i, j));
-			}
-			cvmSet(TrainingFeatureResponseMatrix, SampleIndex, 0, 1.0);
+			ObjectSamples.row(i).colRange(0, pNumberFeatures).copyTo(TrainingFeatureMatrix.row(SampleIndex));
+			TrainingFeatureResponseMatrix.at<float>(SampleIndex, 0) = 1.f;
 			SampleIndex++;
 		}
 	}
@@ -1816,17 +2057,13 @@ int ObjectClassifier::TrainGlobal(ClassifierType pClassifierType, std::string pC
 	// fill training data matrix with incorrect samples
 	for (ItIndices = pIndicesTrainIncorrect->begin(); ItIndices != pIndicesTrainIncorrect->end(); ItIndices++, SampleIndex++)
 	{
-		for (int j=0; j<pNumberFeatures; j++)
-		{
-			cvmSet(TrainingFeatureMatrix, SampleIndex, j, cvmGet(pNegativeSamplesMatrix, *ItIndices, j));
-		}
-		cvmSet(TrainingFeatureResponseMatrix, SampleIndex, 0, 0.0);
+		NegativeSamplesMatrix.row(*ItIndices).colRange(0, pNumberFeatures).copyTo(TrainingFeatureMatrix.row(SampleIndex));
+		TrainingFeatureResponseMatrix.at<float>(SampleIndex, 0) = 0.f;
 	}
 
 	// train classifier
-	TrainGlobal(pClassifierType, pClass, TrainingFeatureMatrix, TrainingFeatureResponseMatrix);
-	cvReleaseMat(&TrainingFeatureMatrix);
-	cvReleaseMat(&TrainingFeatureResponseMatrix);
+	CvMat TrainingFeatureHeader = TrainingFeatureMatrix, TrainingResponseHeader = TrainingFeatureResponseMatrix;
+	TrainGlobal(pClassifierType, pClass, &TrainingFeatureHeader, &TrainingResponseHeader);
 	
 	return ipa_utils::RET_OK;
 }
@@ -1839,16 +2076,26 @@ int ObjectClassifier::TrainGlobal(ClassifierType pClassifierType, std::string pC
 	{
 		ItGlobalClassifierMap->second->clear();
 		delete ItGlobalClassifierMap->second;
+		mData.mGlobalClassifierMap.erase(ItGlobalClassifierMap);
 	}
 
+	CvStatModel* classifier = CreateGlobalClassifier(pClassifierType, pTrainingFeatureMatrix, pTrainingCorrectResponses);
+	if (classifier != NULL)
+		mData.mGlobalClassifierMap[pClass] = classifier;
+	return ipa_utils::RET_OK;
+}
+
+
+CvStatModel* ObjectClassifier::CreateGlobalClassifier(ClassifierType pClassifierType, CvMat* pTrainingFeatureMatrix, CvMat* pTrainingCorrectResponses)
+{
+	CvStatModel* classifier = NULL;
 	switch (pClassifierType)
 	{
 		case CLASSIFIER_RTC:
 			{
 				// create new classifier
-				mData.mGlobalClassifierMap[pClass] = new CvRTrees;
-				CvRTrees* RTC = NULL;
-				RTC = dynamic_cast<CvRTrees*>(mData.mGlobalClassifierMap[pClass]);
+				CvRTrees* RTC = new CvRTrees;
+				classifier = RTC;
 
 				// train classifier
 				CvMat* VarType = cvCreateMat(1,(pTrainingFeatureMatrix->width+1),CV_8UC1);
@@ -1879,8 +2126,8 @@ int ObjectClassifier::TrainGlobal(ClassifierType pClassifierType, std::string pC
 		case CLASSIFIER_SVM:
 			{
 				// create new classifier
-				mData.mGlobalClassifierMap[pClass] = new CvSVM;
-				CvSVM* SVM = dynamic_cast<CvSVM*>(mData.mGlobalClassifierMap[pClass]);
+				CvSVM* SVM = new CvSVM;
+				classifier = SVM;
 
 				// train classifier
 				CvSVMParams SVMParams = CvSVMParams(CvSVM::NU_SVR, CvSVM::RBF, 0, 0.1, 0, 1.0, 0.7, 0, 0, cvTermCriteria(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 2500, 0.0001));
@@ -1890,8 +2137,8 @@ int ObjectClassifier::TrainGlobal(ClassifierType pClassifierType, std::string pC
 		case CLASSIFIER_BOOST:
 			{
 				// create new classifier
-				mData.mGlobalClassifierMap[pClass] = new CvBoost;
-				CvBoost* Boost = dynamic_cast<CvBoost*>(mData.mGlobalClassifierMap[pClass]);
+				CvBoost* Boost = new CvBoost;
+				classifier = Boost;
 
 				// train classifier
 				CvMat* VarType = cvCreateMat(1,(pTrainingFeatureMatrix->width+1),CV_8UC1);
@@ -1907,8 +2154,8 @@ int ObjectClassifier::TrainGlobal(ClassifierType pClassifierType, std::string pC
 		case CLASSIFIER_KNN:
 			{
 				// create new classifier
-				mData.mGlobalClassifierMap[pClass] = new CvKNearest;
-				CvKNearest* KNN = dynamic_cast<CvKNearest*>(mData.mGlobalClassifierMap[pClass]);
+				CvKNearest* KNN = new CvKNearest;
+				classifier = KNN;
 
 				// train classifier
 				KNN->train(pTrainingFeatureMatrix, pTrainingCorrectResponses, 0, true);
@@ -1916,7 +2163,7 @@ int ObjectClassifier::TrainGlobal(ClassifierType pClassifierType, std::string pC
 				break;
 			}
 	}
-	return ipa_utils::RET_OK;
+	return classifier;
 }
 
 
@@ -1980,24 +2227,30 @@ int ObjectClassifier::PredictGlobal(ClassifierType pClassifierType, std::string
 		return ipa_utils::RET_FAILED;
 	}
 
+	return PredictGlobal(pClassifierType, ItGlobalClassifierMap->second, pFeatureData, pPredictionResponse);
+}
+
+
+int ObjectClassifier::PredictGlobal(ClassifierType pClassifierType, CvStatModel* pClassifier, CvMat* pFeatureData, double& pPredictionResponse)
+{
 	switch (pClassifierType)
 	{
 		case CLASSIFIER_RTC:
 			{
 				CvRTrees* RTC = NULL;
-				RTC = dynamic_cast<CvRTrees*> (ItGlobalClassifierMap->second);
+				RTC = dynamic_cast<CvRTrees*> (pClassifier);
 				pPredictionResponse = RTC->predict(pFeatureData);
 				break;
 			}
 		case CLASSIFIER_SVM:
 			{
-				CvSVM* SVM = dynamic_cast<CvSVM*> (ItGlobalClassifierMap->second);
+				CvSVM* SVM = dynamic_cast<CvSVM*> (pClassifier);
 				pPredictionResponse = SVM->predict(pFeatureData);
 				break;
 			}
 		case CLASSIFIER_BOOST:
 			{
-				CvBoost* Boost = dynamic_cast<CvBoost*> (ItGlobalClassifierMap->second);
+				CvBoost* Boost = dynamic_cast<CvBoost*> (pClassifier);
 				pPredictionResponse = Boost->predict(pFeatureData, 0, 0, CV_WHOLE_SEQ, false, true);
 				double posExp = exp(pPredictionResponse);
 				pPredictionResponse = posExp/(posExp + exp(-pPredictionResponse));
@@ -2005,7 +2258,7 @@ int ObjectClassifier::PredictGlobal(ClassifierType pClassifierType, std::string
 			}
 		case CLASSIFIER_KNN:
 			{
-				CvKNearest* KNN = dynamic_cast<CvKNearest*> (ItGlobalClassifierMap->second);
+				CvKNearest* KNN = dynamic_cast<CvKNearest*> (pClassifier);
 				int k=1;
 				pPredictionResponse = KNN->find_nearest(pFeatureData, k);
 				break;
@@ -2017,36 +2270,126 @@ int ObjectClassifier::PredictGlobal(ClassifierType pClassifierType, std::string
 			}
 	};
 
-//	std::cout << "Sample belongs to class " << pClass << " with degree " << pPredictionResponse << ".\n";
-
 	return ipa_utils::RET_OK;
 }
 
 
-int ObjectClassifier::PredictGlobal(std::string pPath, std::string pClass, CvMat* pFeatureData, double& pPredictionResponse, ClassifierType pClassifierType)
+void GlobalClassifierTable::Build(const GlobalClassifierMap& pClassifierMap)
 {
-	switch (pClassifierType)
+	classNames.clear();
+	classifiers.clear();
+	classNames.reserve(pClassifierMap.size());
+	classifiers.reserve(pClassifierMap.size());
+	for (GlobalClassifierMap::const_iterator ItGlobalClassifierMap=pClassifierMap.begin(); ItGlobalClassifierMap!=pClassifierMap.end(); ItGlobalClassifierMap++)
 	{
-		case CLASSIFIER_RTC:
-			{
-				CvRTrees* RTC = new CvRTrees;
-				std::stringstream ss;
-				ss << pPath << pClass << "_" << "RTC" << "_glob.txt";
-				RTC->load((ss.str()).c_str());
+		classNames.push_back(ItGlobalClassifierMap->first);
+		classifiers.push_back(ItGlobalClassifierMap->second);
+	}
+}
 
-				pPredictionResponse = RTC->predict(pFeatureData);
-				break;
-			}
-		case CLASSIFIER_SVM:
-			{
-				CvSVM* SVM = new CvSVM;
-				std::stringstream ss;
-				ss << pPath << pClass << "_" << "SVM" << "_glob.txt";
-				SVM->load((ss.str()).c_str());
 
-				pPredictionResponse = SVM->predict(pFeatureData);
-				break;
-			}
+int ObjectClassifier::PredictGlobalBatch(ClassifierType pClassifierType, const GlobalClassifierTable& pTable, const CvMat* pFeatureData, CvMat** pResponses)
+{
+	if (pFeatureData == NULL || pResponses == NULL)
+	{
+		std::cout << "ObjectClassifier::PredictGlobalBatch: Error: No feature data or response matrix given.\n";
+		return ipa_utils::RET_FAILED;
+	}
+
+	int numberSamples = pFeatureData->rows;
+	int numberClasses = pTable.Size();
+	if (*pResponses != NULL && ((*pResponses)->rows != numberSamples || (*pResponses)->cols != numberClasses || CV_MAT_TYPE((*pResponses)->type) != CV_32FC1))
+		cvReleaseMat(pResponses);
+	if (*pResponses == NULL)
+		*pResponses = cvCreateMat(numberSamples, numberClasses, CV_32FC1);
+	if (numberSamples == 0 || numberClasses == 0)
+		return ipa_utils::RET_OK;
+
+	// class by class, so that each model is cast once and stays hot in the cache while all samples pass through it
+	CvMat sample;
+	for (int c=0; c<numberClasses; c++)
+	{
+		CvStatModel* classifier = pTable.classifiers[c];
+		switch (pClassifierType)
+		{
+			case CLASSIFIER_RTC:
+				{
+					CvRTrees* RTC = dynamic_cast<CvRTrees*> (classifier);
+					for (int i=0; i<numberSamples; i++)
+						CV_MAT_ELEM(**pResponses, float, i, c) = (float)RTC->predict(cvGetRow(pFeatureData, &sample, i));
+					break;
+				}
+			case CLASSIFIER_SVM:
+				{
+					CvSVM* SVM = dynamic_cast<CvSVM*> (classifier);
+					for (int i=0; i<numberSamples; i++)
+						CV_MAT_ELEM(**pResponses, float, i, c) = (float)SVM->predict(cvGetRow(pFeatureData, &sample, i));
+					break;
+				}
+			case CLASSIFIER_BOOST:
+				{
+					CvBoost* Boost = dynamic_cast<CvBoost*> (classifier);
+					for (int i=0; i<numberSamples; i++)
+					{
+						double response = Boost->predict(cvGetRow(pFeatureData, &sample, i), 0, 0, CV_WHOLE_SEQ, false, true);
+						double posExp = exp(response);
+						CV_MAT_ELEM(**pResponses, float, i, c) = (float)(posExp/(posExp + exp(-response)));
+					}
+					break;
+				}
+			case CLASSIFIER_KNN:
+				{
+					CvKNearest* KNN = dynamic_cast<CvKNearest*> (classifier);
+					int k=1;
+					for (int i=0; i<numberSamples; i++)
+						CV_MAT_ELEM(**pResponses, float, i, c) = KNN->find_nearest(cvGetRow(pFeatureData, &sample, i), k);
+					break;
+				}
+			default:
+				{
+					std::cout << "ObjectClassifier::PredictGlobalBatch: Error: Classifier type unknown.\n";
+					return ipa_utils::RET_FAILED;
+				}
+		};
+	}
+
+	return ipa_utils::RET_OK;
+}
+
+
+int ObjectClassifier::PredictGlobalBatch(ClassifierType pClassifierType, const CvMat* pFeatureData, CvMat** pResponses, std::vector<std::string>& pClassNames)
+{
+	GlobalClassifierTable classifierTable;
+	classifierTable.Build(mData.mGlobalClassifierMap);
+	pClassNames = classifierTable.classNames;
+	return PredictGlobalBatch(pClassifierType, classifierTable, pFeatureData, pResponses);
+}
+
+
+int ObjectClassifier::PredictGlobal(std::string pPath, std::string pClass, CvMat* pFeatureData, double& pPredictionResponse, ClassifierType pClassifierType)
+{
+	switch (pClassifierType)
+	{
+		case CLASSIFIER_RTC:
+			{
+				CvRTrees* RTC = new CvRTrees;
+				std::stringstream ss;
+				ss << pPath << pClass << "_" << "RTC" << "_glob.txt";
+				RTC->load((ss.str()).c_str());
+
+				pPredictionResponse = RTC->predict(pFeatureData);
+				break;
+			}
+		case CLASSIFIER_SVM:
+			{
+				CvSVM* SVM = new CvSVM;
+				std::stringstream ss;
+				ss << pPath << pClass << "_" << "SVM" << "_glob.txt";
+				SVM->load((ss.str()).c_str());
+
+				pPredictionResponse = SVM->predict(pFeatureData);
+				break;
+			}
 		case CLASSIFIER_BOOST:
 			{
 				CvBoost* Boost = new CvBoost;
@@ -2127,30 +2470,56 @@ int ObjectClassifier::ValidateGlobal(ClassifierType pClassifierType, std::string
 									 std::list<int>* pIndicesValidationCorrect, std::list<int>* pIndicesValidationIncorrect, CvMat* pNegativeSamplesMatrix,
 									 std::vector<std::string>& pNegativeSamplesLabels, ClassifierOutputCollection& pOutputStorage)
 {
-	// validate classifier
-	CvMat* SampleMat;
+	// validate classifier: gather all validation samples (positives first) and predict them in one batch
+	GlobalClassifierTable classifierTable;
+	GlobalClassifierMap::iterator ItGlobalClassifierMap = mData.mGlobalClassifierMap.find(pClass);
+	if (ItGlobalClassifierMap == mData.mGlobalClassifierMap.end())
+	{
+		std::cout << "ObjectClassifier::ValidateGlobal: No classifier found for class " << pClass << ".\n";
+		return ipa_utils::RET_FAILED;
+	}
+	classifierTable.classNames.push_back(pClass);
+	classifierTable.classifiers.push_back(ItGlobalClassifierMap->second);
+
 	std::list<int>::iterator ItIndices;
-	double ClassificationResult=0;
-	SampleMat = cvCreateMat(1, pNumberFeatures, pItGlobalFeaturesClass->second[0]->type);
+	int numberPositiveSamples = 0;
 	for (ItIndices = pIndicesValidationCorrect->begin(); ItIndices != pIndicesValidationCorrect->end(); ItIndices++)
-	{	// positive samples
 		for (int SampleNumber=0; SampleNumber<pItGlobalFeaturesClass->second[*ItIndices]->rows; SampleNumber++)
-		{
-			cvGetRow(pItGlobalFeaturesClass->second[*ItIndices], SampleMat, SampleNumber);
-			PredictGlobal(pClassifierType, pClass, SampleMat, ClassificationResult);
-
-			pOutputStorage.positiveSampleResponses.push_back(ClassificationResult);
-		}
+			numberPositiveSamples++;
+	int numberSamples = numberPositiveSamples + (int)pIndicesValidationIncorrect->size();
+	if (numberSamples == 0)
+		return ipa_utils::RET_OK;
+
+	CvMat* SampleMatrix = cvCreateMat(numberSamples, pNumberFeatures, pItGlobalFeaturesClass->second[0]->type);
+	CvMat SampleRow, SourceRow;
+	int row = 0;
+	for (ItIndices = pIndicesValidationCorrect->begin(); ItIndices != pIndicesValidationCorrect->end(); ItIndices++)
+	{	// positive samples
+		for (int SampleNumber=0; SampleNumber<pItGlobalFeaturesClass->second[*ItIndices]->rows; SampleNumber++, row++)
+			cvCopy(cvGetRow(pItGlobalFeaturesClass->second[*ItIndices], &SourceRow, SampleNumber), cvGetRow(SampleMatrix, &SampleRow, row));
 	}
-	for (ItIndices = pIndicesValidationIncorrect->begin(); ItIndices != pIndicesValidationIncorrect->end(); ItIndices++)
+	for (ItIndices = pIndicesValidationIncorrect->begin(); ItIndices != pIndicesValidationIncorrect->end(); ItIndices++, row++)
 	{	// negative Samples
-		cvGetRow(pNegativeSamplesMatrix, SampleMat, *ItIndices);
-		PredictGlobal(pClassifierType, pClass, SampleMat, ClassificationResult);
+		cvCopy(cvGetRow(pNegativeSamplesMatrix, &SourceRow, *ItIndices), cvGetRow(SampleMatrix, &SampleRow, row));
+	}
 
-		pOutputStorage.negativeSampleResponses.push_back(ClassificationResult);
+	CvMat* Responses = NULL;
+	if (PredictGlobalBatch(pClassifierType, classifierTable, SampleMatrix, &Responses) != ipa_utils::RET_OK)
+	{
+		cvReleaseMat(&SampleMatrix);
+		if (Responses != NULL) cvReleaseMat(&Responses);
+		return ipa_utils::RET_FAILED;
+	}
+
+	for (row=0; row<numberPositiveSamples; row++)
+		pOutputStorage.positiveSampleResponses.push_back(CV_MAT_ELEM(*Responses, float, row, 0));
+	for (ItIndices = pIndicesValidationIncorrect->begin(); ItIndices != pIndicesValidationIncorrect->end(); ItIndices++, row++)
+	{
+		pOutputStorage.negativeSampleResponses.push_back(CV_MAT_ELEM(*Responses, float, row, 0));
 		pOutputStorage.negativeSampleCorrectLabel.push_back(pNegativeSamplesLabels[*ItIndices]);
 	}
-	cvReleaseMat(&SampleMat);
+	cvReleaseMat(&SampleMatrix);
+	cvReleaseMat(&Responses);
 
 	return ipa_utils::RET_OK;
 }
@@ -2160,30 +2529,56 @@ int ObjectClassifier::ValidateGlobalSampleRange(ClassifierType pClassifierType,
 	std::list<int>* pIndicesValidationCorrect, std::list<int>* pIndicesValidationIncorrect, CvMat* pNegativeSamplesMatrix,
 	std::vector<std::string>& pNegativeSamplesLabels, ClassifierOutputCollection& pOutputStorage, double rangeStartFactor, double rangeEndFactor)
 {
-	// validate classifier
-	CvMat* SampleMat;
+	// validate classifier: gather all validation samples (positives first) and predict them in one batch
+	GlobalClassifierTable classifierTable;
+	GlobalClassifierMap::iterator ItGlobalClassifierMap = mData.mGlobalClassifierMap.find(pClass);
+	if (ItGlobalClassifierMap == mData.mGlobalClassifierMap.end())
+	{
+		std::cout << "ObjectClassifier::ValidateGlobalSampleRange: No classifier found for class " << pClass << ".\n";
+		return ipa_utils::RET_FAILED;
+	}
+	classifierTable.classNames.push_back(pClass);
+	classifierTable.classifiers.push_back(ItGlobalClassifierMap->second);
+
 	std::list<int>::iterator ItIndices;
-	double ClassificationResult=0;
-	SampleMat = cvCreateMat(1, pNumberFeatures, pItGlobalFeaturesClass->second[0]->type);
+	int numberPositiveSamples = 0;
 	for (ItIndices = pIndicesValidationCorrect->begin(); ItIndices != pIndicesValidationCorrect->end(); ItIndices++)
-	{	// positive samples
 		for (int SampleNumber=pItGlobalFeaturesClass->second[*ItIndices]->rows*rangeStartFactor; SampleNumber<pItGlobalFeaturesClass->second[*ItIndices]->rows*rangeEndFactor; SampleNumber++)
-		{
-			cvGetRow(pItGlobalFeaturesClass->second[*ItIndices], SampleMat, SampleNumber);
-			PredictGlobal(pClassifierType, pClass, SampleMat, ClassificationResult);
-
-			pOutputStorage.positiveSampleResponses.push_back(ClassificationResult);
-		}
+			numberPositiveSamples++;
+	int numberSamples = numberPositiveSamples + (int)pIndicesValidationIncorrect->size();
+	if (numberSamples == 0)
+		return ipa_utils::RET_OK;
+
+	CvMat* SampleMatrix = cvCreateMat(numberSamples, pNumberFeatures, pItGlobalFeaturesClass->second[0]->type);
+	CvMat SampleRow, SourceRow;
+	int row = 0;
+	for (ItIndices = pIndicesValidationCorrect->begin(); ItIndices != pIndicesValidationCorrect->end(); ItIndices++)
+	{	// positive samples
+		for (int SampleNumber=pItGlobalFeaturesClass->second[*ItIndices]->rows*rangeStartFactor; SampleNumber<pItGlobalFeaturesClass->second[*ItIndices]->rows*rangeEndFactor; SampleNumber++, row++)
+			cvCopy(cvGetRow(pItGlobalFeaturesClass->second[*ItIndices], &SourceRow, SampleNumber), cvGetRow(SampleMatrix, &SampleRow, row));
 	}
-	for (ItIndices = pIndicesValidationIncorrect->begin(); ItIndices != pIndicesValidationIncorrect->end(); ItIndices++)
+	for (ItIndices = pIndicesValidationIncorrect->begin(); ItIndices != pIndicesValidationIncorrect->end(); ItIndices++, row++)
 	{	// negative Samples
-		cvGetRow(pNegativeSamplesMatrix, SampleMat, *ItIndices);
-		PredictGlobal(pClassifierType, pClass, SampleMat, ClassificationResult);
+		cvCopy(cvGetRow(pNegativeSamplesMatrix, &SourceRow, *ItIndices), cvGetRow(SampleMatrix, &SampleRow, row));
+	}
 
-		pOutputStorage.negativeSampleResponses.push_back(ClassificationResult);
+	CvMat* Responses = NULL;
+	if (PredictGlobalBatch(pClassifierType, classifierTable, SampleMatrix, &Responses) != ipa_utils::RET_OK)
+	{
+		cvReleaseMat(&SampleMatrix);
+		if (Responses != NULL) cvReleaseMat(&Responses);
+		return ipa_utils::RET_FAILED;
+	}
+
+	for (row=0; row<numberPositiveSamples; row++)
+		pOutputStorage.positiveSampleResponses.push_back(CV_MAT_ELEM(*Responses, float, row, 0));
+	for (ItIndices = pIndicesValidationIncorrect->begin(); ItIndices != pIndicesValidationIncorrect->end(); ItIndices++, row++)
+	{
+		pOutputStorage.negativeSampleResponses.push_back(CV_MAT_ELEM(*Responses, float, row, 0));
 		pOutputStorage.negativeSampleCorrectLabel.push_back(pNegativeSamplesLabels[*ItIndices]);
 	}
-	cvReleaseMat(&SampleMat);
+	cvReleaseMat(&SampleMatrix);
+	cvReleaseMat(&Responses);
 
 	return ipa_utils::RET_OK;
 }
@@ -2677,11 +3072,15 @@ int ObjectClassifier::CrossValidationGlobalSampleRange(ClassifierType pClassifie
 	}
 
 	// create matrix with incorrect samples (drawn by chance from all other classes)
-	CvMat* NegativeSamplesMatrixTrain = cvCreateMat(NumberSamplesIncorrect, NumberFeatures, ItGlobalFeaturesClass->second[0]->type);
+	cv::Mat NegativeSamplesTrain(NumberSamplesIncorrect, NumberFeatures, ItGlobalFeaturesClass->second[0]->type);
+	CvMat NegativeSamplesTrainHeader = NegativeSamplesTrain;
+	CvMat* NegativeSamplesMatrixTrain = &NegativeSamplesTrainHeader;
 	std::vector<std::string> NegativeSamplesLabelsTrain(NumberSamplesIncorrect);
 	mData.GetNegativeSamplesMatrixGlobalSampleRange(pClass, NegativeSamplesMatrixTrain, NegativeSamplesLabelsTrain, 0, NumberSamplesIncorrect, 0., factorSamplesTrainData);
 
-	CvMat* NegativeSamplesMatrixTestValidation = cvCreateMat(NumberSamplesIncorrect, NumberFeatures, ItGlobalFeaturesClass->second[0]->type);
+	cv::Mat NegativeSamplesTestValidation(NumberSamplesIncorrect, NumberFeatures, ItGlobalFeaturesClass->second[0]->type);
+	CvMat NegativeSamplesTestValidationHeader = NegativeSamplesTestValidation;
+	CvMat* NegativeSamplesMatrixTestValidation = &NegativeSamplesTestValidationHeader;
 	std::vector<std::string> NegativeSamplesLabelsTestValidation(NumberSamplesIncorrect);
 	mData.GetNegativeSamplesMatrixGlobalSampleRange(pClass, NegativeSamplesMatrixTestValidation, NegativeSamplesLabelsTestValidation, 0, NumberSamplesIncorrect, factorSamplesTrainData, 1.);
 
@@ -2780,8 +3179,6 @@ int ObjectClassifier::CrossValidationGlobalSampleRange(ClassifierType pClassifie
 	// variable importance
 	if (*pVariableImportance != NULL) GetVariableImportance(mData.mGlobalClassifierMap.find(pClass)->second, pClassifierType, pVariableImportance);
 
-	cvReleaseMat(&NegativeSamplesMatrixTrain);
-	cvReleaseMat(&NegativeSamplesMatrixTestValidation);
 	return ipa_utils::RET_OK;
 }
 
@@ -3022,10 +3419,12 @@ int ObjectClassifier::CrossValidationGlobal(ClassifierType pClassifierType, std:
 		IndicesTrainCorrect.remove(*ItIndices);
 	}
 
-	// create matrix with incorrect samples (drawn by chance from all other classes)
-	CvMat* NegativeSamplesMatrix = cvCreateMat(NumberSamplesIncorrect, NumberFeatures, ItGlobalFeaturesClass->second[0]->type);
+	// create matrix with incorrect samples (drawn by chance from all other classes), it is reused by all cycles and the following classes
+	cv::Mat NegativeSamples = mNegativeSamplesBuffer.Get(NumberSamplesIncorrect, NumberFeatures, ItGlobalFeaturesClass->second[0]->type);
 	std::vector<std::string> NegativeSamplesLabels(NumberSamplesIncorrect);
-	mData.GetNegativeSamplesMatrixGlobal(pClass, NegativeSamplesMatrix, NegativeSamplesLabels, 0, NumberSamplesIncorrect, pViewsPerObject);
+	mData.GetNegativeSamplesMatrixGlobal(pClass, NegativeSamples, NegativeSamplesLabels, 0, NumberSamplesIncorrect, pViewsPerObject);
+	CvMat NegativeSamplesHeader = NegativeSamples;
+	CvMat* NegativeSamplesMatrix = &NegativeSamplesHeader;
 
 	// fill index list for training with all non-class objects and remove test and validation set later
 	for (int i=0; i<NumberSamplesIncorrect; i++) IndicesTrainIncorrect.push_back(i);
@@ -3121,7 +3520,6 @@ int ObjectClassifier::CrossValidationGlobal(ClassifierType pClassifierType, std:
 	// variable importance
 	if (*pVariableImportance != NULL) GetVariableImportance(mData.mGlobalClassifierMap.find(pClass)->second, pClassifierType, pVariableImportance);
 
-	cvReleaseMat(&NegativeSamplesMatrix);
 	return ipa_utils::RET_OK;
 }
 
@@ -3279,473 +3677,570 @@ int ObjectClassifier::CrossValidationGlobal(std::string pStatisticsPath, std::st
 	return ipa_utils::RET_OK;
 }
 
-int ObjectClassifier::CrossValidationGlobalMultiClass(std::string pStatisticsPath, std::string pFileDescription, ClassifierType pClassifierType, int pFold, float pFactorIncorrect, float pPercentTest,
-														float pPercentValidation, int pViewsPerObject, std::ofstream* pScreenLogFile)
+void ObjectClassifier::CrossValidationGlobalMultiClassFold(const MultiClassFoldSetup* pSetup, MultiClassFoldResult* pResult)
 {
-	bool drawValidationSetRandomized = false;
-
-	if (pPercentTest > 0.)
-	{
-		std::cout << "Error: CrossValidationGlobalMultiClass: A test set is not supported at the moment. Please use only the training and validation sets." << std::endl;
-		if (pScreenLogFile) *pScreenLogFile << "Error: CrossValidationGlobalMultiClass: A test set is not supported at the moment. Please use only the training and validation sets." << std::endl;
-		return ipa_utils::RET_FAILED;
+	// all randomness of this fold comes from its own generator, cv::theRNG() is thread-local and used by the random trees
+	cv::RNG rng(pSetup->randomSeed);
+	cv::theRNG() = cv::RNG(rng.next());
+
+	// local copies, the operator[] accesses below would otherwise insert into shared maps
+	std::map<std::string, std::list<int> > indicesTrain = pSetup->indicesTrain;
+	std::map<std::string, std::list<int> > indicesValidation = pSetup->indicesValidation;
+	std::map<std::string, int> objectClassNumberMapping = pSetup->objectClassNumberMapping;
+	std::map<int, std::string> numberObjectClassMapping = pSetup->numberObjectClassMapping;
+	ClassifierThresholdMap thresholdMap = mData.mGlobalClassifierThresholdMap;
+	ClassifierAccuracy accuracy = mData.mGlobalClassifierAccuracy;
+	GlobalClassifierMap classifierMap;		// binary classifiers of this fold
+	const ClassifierType classifierType = pSetup->classifierType;
+	const int numberFeatures = pSetup->numberFeatures;
+	const int viewsPerObject = pSetup->viewsPerObject;
+	const double factorSamplesTrainData = pSetup->factorSamplesTrainData;
+	const double validationStartFactor = pSetup->validationStartFactor;
+	std::stringstream screenOutput;
+
+	// look up the feature matrices of the training and validation objects once, the shared feature map is only read with find()
+	GlobalFeaturesMap foldFeaturesMap;
+	for (GlobalFeaturesMap::const_iterator ItClass = mData.mGlobalFeaturesMap.begin(); ItClass != mData.mGlobalFeaturesMap.end(); ItClass++)
+	{
+		ObjectNrFeatureMap& foldObjects = foldFeaturesMap[ItClass->first];
+		const std::list<int>* indexLists[2] = {&indicesTrain[ItClass->first], &indicesValidation[ItClass->first]};
+		for (int list=0; list<2; list++)
+		{
+			for (std::list<int>::const_iterator ItIndex = indexLists[list]->begin(); ItIndex != indexLists[list]->end(); ItIndex++)
+			{
+				ObjectNrFeatureMap::const_iterator ItObject = ItClass->second.find(*ItIndex);
+				if (ItObject == ItClass->second.end())
+				{
+					screenOutput << "ObjectClassifier::CrossValidationGlobalMultiClassFold: Error: No global features for object " << *ItIndex << " of class " << ItClass->first << "." << std::endl;
+					pResult->returnCode = ipa_utils::RET_FAILED;
+					pResult->screenOutput = screenOutput.str();
+					return;
+				}
+				foldObjects[*ItIndex] = ItObject->second;
+			}
+		}
 	}
 
-	// determine number of objects available for training/validation/test set for each class
 	GlobalFeaturesMap::iterator ItGlobalFeaturesMap, ItGlobalFeaturesMap2;
-	std::map<std::string, int> numberObjects;		// number of objects available for each class
-	std::map<std::string, int> numberObjectsTest;	// number of objects used in test set for each class
-	std::map<std::string, int> numberObjectsTrain;	// number of objects used in training set for each class
-	std::map<std::string, int> numberObjectsValidation;	// number of objects used in validation set for each class
-	int numberFeatures = 0;		// dimension of the feature vectors
-	std::map<std::string, int> objectClassNumberMapping;	// maps each object class name to a unique number
-	std::map<int, std::string> numberObjectClassMapping;	// maps a unique number to an object class name
-	int uniqueID = 0;
-	for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	std::list<int>::iterator ItIndices;
+
+	// prepare statistics
+	for (ItGlobalFeaturesMap = foldFeaturesMap.begin(); ItGlobalFeaturesMap != foldFeaturesMap.end(); ItGlobalFeaturesMap++)
 	{
 		std::string label = ItGlobalFeaturesMap->first;
-		objectClassNumberMapping[label] = uniqueID;
-		numberObjectClassMapping[uniqueID] = label;
-		uniqueID++;
-		numberObjects[label] = ItGlobalFeaturesMap->second.size();
-		
-		if (((numberObjectsTest[label]=cvRound((double)numberObjects[label]*pPercentTest)) < 1) && (pPercentTest > 0.0))	// check for a large enough number of objects
-		{
-			numberObjectsTest[label] = 1;
-			//std::cout << "ObjectClassifier::CrossValidationGlobal: Not enough objects to do cross validation for class " << pClass << ". Use more examples or increase the percentage of the test set.\n";
-			//return ipa_utils::RET_FAILED;
-		}
-		if ((numberObjectsValidation[label]=cvRound((double)numberObjects[label]*pPercentValidation)) < 1)
-		{
-			numberObjectsValidation[label] = 1;
-			//std::cout << "ObjectClassifier::CrossValidationGlobal: Not enough objects to do cross validation for class " << pClass << ". Use more examples or increase the percentage of the validation set.\n";
-			//return ipa_utils::RET_FAILED;
-		}
-		if ((numberObjectsTrain[label] = numberObjects[label]-numberObjectsTest[label]-numberObjectsValidation[label]) < 1)
-		{
-			std::cout << "ObjectClassifier::CrossValidationGlobal: Not enough objects to do cross validation for class " << label << ". Use more examples or leave more percentage for the train set.\n";
-			if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::CrossValidationGlobal: Not enough objects to do cross validation for class " << label << ". Use more examples or leave more percentage for the train set.\n";
-			return ipa_utils::RET_FAILED;
-		}
-
-		if (numberFeatures == 0)
-			numberFeatures = ItGlobalFeaturesMap->second[0]->cols;
+		pResult->multiclassStatistics[label]["tp"] = 0;
+		pResult->multiclassStatistics[label]["fp"] = 0;
+		pResult->multiclassStatistics[label]["fn"] = 0;
+		pResult->multiclassStatisticsBinary[label]["tp"] = 0;
+		pResult->multiclassStatisticsBinary[label]["fp"] = 0;
+		pResult->multiclassStatisticsBinary[label]["fn"] = 0;
 	}
 
-	// index lists of object indices (to put whole object datasets in individual sets, i.e. no data of object x can be split into validation and training set, it all goes into one set)
-	std::map<std::string, std::list<int> > indicesTrain;	// object indices for each set
-	std::map<std::string, std::list<int> > indicesValidation;
-	std::map<std::string, std::list<int> > indicesTest;
-	std::list<int>::iterator ItIndices;
-	std::map<std::string, int> numberSamples;		// total number of feature vectors available for each class
-	std::map<std::string, int> numberSamplesTest;	// number of feature vectors available for the test set of each class
-	for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	// count number of feature vectors for the training set
+	int numberSamplesTrain = 0;	// number of feature vectors available for the training set
+	std::map<std::string, int> numberSamplesTrainClasswise;	// number of feature vectors available for the training set in each class
+	for (ItGlobalFeaturesMap = foldFeaturesMap.begin(); ItGlobalFeaturesMap != foldFeaturesMap.end(); ItGlobalFeaturesMap++)
 	{
 		std::string label = ItGlobalFeaturesMap->first;
-		// fill index lists for training with all objects of each class and remove indices of objects for test and validation set later
-		for (int i=0; i<numberObjects[label]; i++) indicesTrain[label].push_back(i);
-
-		// note: was not used anywhere
-		//// determine total number of available feature vectors for this class
-		//numberSamples[label] = 0;
-		//for (ItIndices = indicesTrain[label].begin(); ItIndices != indicesTrain[label].end(); ItIndices++)
-		//	numberSamples[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows;
-
-		// prepare index list for test set
-		numberSamplesTest[label] = 0;
-		for (int i=0; i<numberObjectsTest[label]; i++)
+		numberSamplesTrainClasswise[label] = 0;
+		for (ItIndices = indicesTrain[label].begin(); ItIndices != indicesTrain[label].end(); ItIndices++)
 		{
-			int index = int(indicesTrain[label].size()*((double)rand()/((double)RAND_MAX+1.0)));
-			ItIndices = indicesTrain[label].begin();
-			for (int k=0; k<index; k++, ItIndices++);
-			numberSamplesTest[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows;
-			indicesTest[label].push_back(*ItIndices);
-			indicesTrain[label].remove(*ItIndices);
+			if (viewsPerObject == -1)
+			{
+				numberSamplesTrain += ItGlobalFeaturesMap->second[*ItIndices]->rows * factorSamplesTrainData;
+				numberSamplesTrainClasswise[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows * factorSamplesTrainData;
+			}
+			else
+			{
+				numberSamplesTrain += min(viewsPerObject, int(ItGlobalFeaturesMap->second[*ItIndices]->rows * factorSamplesTrainData));
+				numberSamplesTrainClasswise[label] += min(viewsPerObject, int(ItGlobalFeaturesMap->second[*ItIndices]->rows * factorSamplesTrainData));
+			}
 		}
 	}
 
-
-	// cross validation cycles
-	std::map<std::string, std::map<std::string, int> > multiclassStatistics;   // statistics: tp=true positive, fp=false positive, fn=false negative
-	std::map<std::string, std::map<std::string, int> > multiclassStatisticsBinary;   // statistics: tp=true positive, fp=false positive, fn=false negative
-	std::map<std::string, std::map< int, std::vector< std::string > > > individualResults;	// prediction results, indices: classname - object number - view index - prediction
-
-	// prepare statistics
-	for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	// construct training data and label matrices
+	cv::Mat TrainingFeatureMatrix(numberSamplesTrain, numberFeatures, CV_32FC1);	// contains all training data, suited for multiclass classifiers
+	cv::Mat TrainingFeatureResponseMatrix(numberSamplesTrain, 1, CV_32SC1);
+	std::map<std::string, cv::Mat> TrainingFeatureMatricesBinary;		// contains binary training data (class samples and non-class samples), suited for binary classifiers
+	std::map<std::string, cv::Mat> TrainingFeatureResponseMatricesBinary;
+	int insertPosition = 0;
+	for (ItGlobalFeaturesMap = foldFeaturesMap.begin(); ItGlobalFeaturesMap != foldFeaturesMap.end(); ItGlobalFeaturesMap++)
 	{
 		std::string label = ItGlobalFeaturesMap->first;
-		multiclassStatistics[label]["tp"] = 0;
-		multiclassStatistics[label]["fp"] = 0;
-		multiclassStatistics[label]["fn"] = 0;
-		multiclassStatisticsBinary[label]["tp"] = 0;
-		multiclassStatisticsBinary[label]["fp"] = 0;
-		multiclassStatisticsBinary[label]["fn"] = 0;
-	}
-	std::vector<std::map<std::string, std::map<std::string, int> > > singleFoldMulticlassStatistics(pFold, multiclassStatistics);   // statistics: tp=true positive, fp=false positive, fn=false negative
-	std::vector<std::map<std::string, std::map<std::string, int> > > singleFoldMulticlassStatisticsBinary(pFold, multiclassStatisticsBinary);   // statistics: tp=true positive, fp=false positive, fn=false negative
-
-	for (int fold=0; fold<pFold; fold++)
-	{
-		int numberSamplesTrain = 0;	// number of feature vectors available for the training set
-		int numberSamplesValidation = 0;	// number of feature vectors available for the validation set
-		std::map<std::string, int> numberSamplesTrainClasswise;	// number of feature vectors available for the training set in each class
-		std::map<std::string, int> numberSamplesValidationClasswise;
-		for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+		int insertPositionBinary = 0;
+		TrainingFeatureMatricesBinary[label] = cv::Mat(cvRound((double)numberSamplesTrainClasswise[label]*(1.0+pSetup->factorIncorrect)), numberFeatures, CV_32FC1);
+		TrainingFeatureResponseMatricesBinary[label] = cv::Mat(TrainingFeatureMatricesBinary[label].rows, 1, CV_32FC1);
+		// class samples
+		for (ItIndices = indicesTrain[label].begin(); ItIndices != indicesTrain[label].end(); ItIndices++)
 		{
-			std::string label = ItGlobalFeaturesMap->first;
-			// prepare index list for validation and training set
-			for (int i=0; i<numberObjectsValidation[label]; i++)
-			{
-				int index = 0;
-				if (drawValidationSetRandomized == true || fold>=(int)indicesTrain[label].size())
-					index = int(indicesTrain[label].size()*((double)rand()/((double)RAND_MAX+1.0)));
-				else
-					index = (fold+i)%indicesTrain[label].size();
-				ItIndices = indicesTrain[label].begin();
-				for (int k=0; k<index; k++, ItIndices++);
-				indicesValidation[label].push_back(*ItIndices);
-				indicesTrain[label].remove(*ItIndices);
-			}
-
-			// count number of feature vectors for each set
-			numberSamplesTrainClasswise[label] = 0;
-			for (ItIndices = indicesTrain[label].begin(); ItIndices != indicesTrain[label].end(); ItIndices++)
+			for (double dSample=0; dSample<ItGlobalFeaturesMap->second[*ItIndices]->rows*factorSamplesTrainData; (viewsPerObject==-1) ? dSample+=1. : dSample+=max(1., (double)ItGlobalFeaturesMap->second[*ItIndices]->rows*factorSamplesTrainData/(double)viewsPerObject))
 			{
-				if (pViewsPerObject == -1)
-				{
-					numberSamplesTrain += ItGlobalFeaturesMap->second[*ItIndices]->rows;
-					numberSamplesTrainClasswise[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows;
-				}
-				else
+				int sample = (int)dSample;
+				for (int j=0; j<numberFeatures; j++)
 				{
-					numberSamplesTrain += min(pViewsPerObject, ItGlobalFeaturesMap->second[*ItIndices]->rows);
-					numberSamplesTrainClasswise[label] += min(pViewsPerObject, ItGlobalFeaturesMap->second[*ItIndices]->rows);
+					TrainingFeatureMatrix.at<float>(insertPosition, j) = (float)cvmGet(ItGlobalFeaturesMap->second[*ItIndices], sample, j);
+					TrainingFeatureMatricesBinary[label].at<float>(insertPositionBinary, j) = (float)cvmGet(ItGlobalFeaturesMap->second[*ItIndices], sample, j);
 				}
+				TrainingFeatureResponseMatrix.at<int>(insertPosition, 0) = objectClassNumberMapping[label];
+				TrainingFeatureResponseMatricesBinary[label].at<float>(insertPositionBinary, 0) = 1.0;
+				insertPosition++;
+				insertPositionBinary++;
 			}
-			numberSamplesValidationClasswise[label] = 0;
-			for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices++)
+		}
+		// non-class samples for the matrices suited for binary classifiers
+		while (insertPositionBinary < TrainingFeatureMatricesBinary[label].rows)
+		{
+			// pick random class
+			int index =	rng.uniform(0, (int)foldFeaturesMap.size());
+			ItGlobalFeaturesMap2 = foldFeaturesMap.begin();
+			for (int k=0; k<index; k++, ItGlobalFeaturesMap2++);
+			std::string labelIncorrect = ItGlobalFeaturesMap2->first;
+			if (labelIncorrect == label) continue;		// do not pick samples from correct class
+
+			// pick random training object
+			index = rng.uniform(0, (int)indicesTrain[labelIncorrect].size());
+			ItIndices = indicesTrain[labelIncorrect].begin();
+			for (int k=0; k<index; k++, ItIndices++);
+
+			// pick random sample from that object
+			if (viewsPerObject == -1)
+				index = int((ItGlobalFeaturesMap2->second[*ItIndices]->rows*factorSamplesTrainData)*rng.uniform(0., 1.));
+			else
 			{
-				numberSamplesValidation += ItGlobalFeaturesMap->second[*ItIndices]->rows;
-				numberSamplesValidationClasswise[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows;
+				double step=(double)ItGlobalFeaturesMap2->second[*ItIndices]->rows*factorSamplesTrainData/(double)viewsPerObject;
+				do
+				{
+					index = int((ItGlobalFeaturesMap2->second[*ItIndices]->rows*factorSamplesTrainData)*rng.uniform(0., 1.));
+				} while (index != int(step * int((double)index/step)));
 			}
+			for (int j=0; j<numberFeatures; j++)
+				TrainingFeatureMatricesBinary[label].at<float>(insertPositionBinary, j) = (float)cvmGet(ItGlobalFeaturesMap2->second[*ItIndices], index, j);
+			TrainingFeatureResponseMatricesBinary[label].at<float>(insertPositionBinary, 0) = 0.0;
+			insertPositionBinary++;
 		}
+	}
 
-		// construct training data and label matrices
-		cv::Mat TrainingFeatureMatrix(numberSamplesTrain, numberFeatures, CV_32FC1);	// contains all training data, suited for multiclass classifiers
-		cv::Mat TrainingFeatureResponseMatrix(numberSamplesTrain, 1, CV_32SC1);
-		std::map<std::string, cv::Mat> TrainingFeatureMatricesBinary;		// contains binary training data (class samples and non-class samples), suited for binary classifiers
-		std::map<std::string, cv::Mat> TrainingFeatureResponseMatricesBinary;
-		int insertPosition = 0;
-		for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+
+	if (classifierType == CLASSIFIER_KNN)
+	{
+		// train KNN multi classifier
+		CvKNearest* KNN = new CvKNearest;
+		CvMat trainMat = (CvMat)TrainingFeatureMatrix;
+		CvMat labelMat = (CvMat)TrainingFeatureResponseMatrix;
+		bool trainResult = KNN->train(&trainMat, &labelMat, 0, false);
+		if (!trainResult) screenOutput << "Training Multiclass failed." << std::endl;
+
+		// validate KNN multi classifier
+		//statistics
+		for (ItGlobalFeaturesMap = foldFeaturesMap.begin(); ItGlobalFeaturesMap != foldFeaturesMap.end(); ItGlobalFeaturesMap++)
 		{
 			std::string label = ItGlobalFeaturesMap->first;
-			int insertPositionBinary = 0;
-			TrainingFeatureMatricesBinary[label] = cv::Mat(cvRound((double)numberSamplesTrainClasswise[label]*(1.0+pFactorIncorrect)), numberFeatures, CV_32FC1);
-			TrainingFeatureResponseMatricesBinary[label] = cv::Mat(TrainingFeatureMatricesBinary[label].rows, 1, CV_32FC1);
-			// class samples
-			for (ItIndices = indicesTrain[label].begin(); ItIndices != indicesTrain[label].end(); ItIndices++)
+			for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices++)
 			{
-				for (double dSample=0; dSample<ItGlobalFeaturesMap->second[*ItIndices]->rows; (pViewsPerObject==-1) ? dSample+=1. : dSample+=max(1., (double)ItGlobalFeaturesMap->second[*ItIndices]->rows/(double)pViewsPerObject))
+				for (int sample=ItGlobalFeaturesMap->second[*ItIndices]->rows*validationStartFactor; sample<ItGlobalFeaturesMap->second[*ItIndices]->rows; sample++)
 				{
-					int sample = (int)dSample;
-					for (int j=0; j<numberFeatures; j++)
+					CvMat* featureVector = cvCreateMat(1, ItGlobalFeaturesMap->second[*ItIndices]->cols, ItGlobalFeaturesMap->second[*ItIndices]->type);
+					cvGetRow(ItGlobalFeaturesMap->second[*ItIndices], featureVector, sample);
+
+					// validate multi classifier
+					int k=1;
+					float result = KNN->find_nearest(featureVector, k);
+					if (result == (float)objectClassNumberMapping[label])
 					{
-						TrainingFeatureMatrix.at<float>(insertPosition, j) = (float)cvmGet(ItGlobalFeaturesMap->second[*ItIndices], sample, j);
-						TrainingFeatureMatricesBinary[label].at<float>(insertPositionBinary, j) = (float)cvmGet(ItGlobalFeaturesMap->second[*ItIndices], sample, j);
+						// correct classification
+						pResult->multiclassStatistics[label]["tp"]++;
 					}
-					TrainingFeatureResponseMatrix.at<int>(insertPosition, 0) = objectClassNumberMapping[label];
-					TrainingFeatureResponseMatricesBinary[label].at<float>(insertPositionBinary, 0) = 1.0;
-					insertPosition++;
-					insertPositionBinary++;
-				}
-			}
-			// non-class samples for the matrices suited for binary classifiers
-			while (insertPositionBinary < TrainingFeatureMatricesBinary[label].rows)
-			{
-				// pick random class
-				int index =	int(mData.mGlobalFeaturesMap.size()*((double)rand()/((double)RAND_MAX+1.0)));
-				ItGlobalFeaturesMap2 = mData.mGlobalFeaturesMap.begin();
-				for (int k=0; k<index; k++, ItGlobalFeaturesMap2++);
-				std::string labelIncorrect = ItGlobalFeaturesMap2->first;
-				if (labelIncorrect == label) continue;		// do not pick samples from correct class
-				
-				// pick random training object
-				index = int(indicesTrain[labelIncorrect].size()*((double)rand()/((double)RAND_MAX+1.0)));
-				ItIndices = indicesTrain[labelIncorrect].begin();
-				for (int k=0; k<index; k++, ItIndices++);
-
-				// pick random sample from that object
-				if (pViewsPerObject == -1)
-					index = int(ItGlobalFeaturesMap2->second[*ItIndices]->rows*((double)rand()/((double)RAND_MAX+1.0)));
-				else
-				{
-					double step=(double)ItGlobalFeaturesMap2->second[*ItIndices]->rows/(double)pViewsPerObject;
-					do
+					else
 					{
-						index = int(ItGlobalFeaturesMap2->second[*ItIndices]->rows*((double)rand()/((double)RAND_MAX+1.0)));
-					} while (index != int(step * int((double)index/step)));
+						// false classification
+						pResult->multiclassStatistics[label]["fn"]++;
+						pResult->multiclassStatistics[numberObjectClassMapping[(int)result]]["fp"]++;
+					}
+
+					pResult->individualResults[label][*ItIndices].push_back(numberObjectClassMapping[(int)result]);
+
+					cvReleaseMat(&featureVector);
 				}
-				for (int j=0; j<numberFeatures; j++)
-					TrainingFeatureMatricesBinary[label].at<float>(insertPositionBinary, j) = (float)cvmGet(ItGlobalFeaturesMap2->second[*ItIndices], index, j);
-				TrainingFeatureResponseMatricesBinary[label].at<float>(insertPositionBinary, 0) = 0.0;
-				insertPositionBinary++;
 			}
 		}
-
-		
-		if (pClassifierType == CLASSIFIER_KNN)
-		{
-			// train KNN multi classifier
-			CvKNearest* KNN = new CvKNearest;
-			CvMat trainMat = (CvMat)TrainingFeatureMatrix;
+		KNN->clear();
+		delete KNN;
+	}
+	else
+	{
+		CvSVM* SVM = new CvSVM;
+		if (classifierType == CLASSIFIER_SVM)
+		{
+			// train multi classifier
+			CvSVMParams SVMParams = CvSVMParams(CvSVM::NU_SVC, CvSVM::RBF, 0, 0.007, 0, 1.0, 0.09, 0, 0, cvTermCriteria(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 2500, 0.0001));
+			CvMat trainMat = (CvMat)TrainingFeatureMatrix;
 			CvMat labelMat = (CvMat)TrainingFeatureResponseMatrix;
-			bool trainResult = KNN->train(&trainMat, &labelMat, 0, false);
-			if (!trainResult) std::cout << "Training Multiclass failed." << std::endl;
-
-			// validate KNN multi classifier
-			//statistics
-			for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+			//bool trainResult = SVM->train(&trainMat, &labelMat, 0, 0, SVMParams);
+			CvParamGrid cGrid(0, 1, 0);
+			CvParamGrid gammaGrid(0.00021875, pSetup->svmGammaGridMax, 2.0);//CvParamGrid gammaGrid(0.00021875, 5.0, 2.0);  //CvParamGrid gammaGrid(0.000875, 1.0, 2.0);  CvParamGrid gammaGrid(0.00175, 0.00176, 2.0);
+			CvParamGrid pGrid(0, 1, 0);
+			CvParamGrid nuGrid(0.01125, 0.3, 2.0); //CvParamGrid nuGrid(0.01125, 0.3, 2.0);  CvParamGrid nuGrid(0.0225, 0.091, 2.0);
+			CvParamGrid coeffGrid(0, 1, 0);
+			CvParamGrid degreeGrid(0, 1, 0);
+			bool trainResult = SVM->train_auto(&trainMat, &labelMat, 0, 0, SVMParams, 10, cGrid, gammaGrid, pGrid, nuGrid, coeffGrid, degreeGrid);
+			CvSVMParams optimalParams = SVM->get_params();
+			screenOutput << "\nOptimal params: gamma=" << optimalParams.gamma << "  nu=" << optimalParams.nu << "  C=" << optimalParams.C << "  p=" << optimalParams.p << "  coeff=" << optimalParams.coef0 << "  degree=" << optimalParams.degree << std::endl;
+			if (trainResult) screenOutput << "Training Multiclass finished successfully." << std::endl;
+			else screenOutput << "Training Multiclass failed." << std::endl;
+		}
+		else
+		{
+			// train binary classifiers
+			for (ItGlobalFeaturesMap = foldFeaturesMap.begin(); ItGlobalFeaturesMap != foldFeaturesMap.end(); ItGlobalFeaturesMap++)
 			{
 				std::string label = ItGlobalFeaturesMap->first;
-				for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices++)
+				CvMat trainMatBinary = TrainingFeatureMatricesBinary[label];
+				CvMat labelMatBinary = TrainingFeatureResponseMatricesBinary[label];
+				CvStatModel* classifier = CreateGlobalClassifier(classifierType, &trainMatBinary, &labelMatBinary);
+				if (classifier != NULL)
+					classifierMap[label] = classifier;
+			}
+		}
+
+		// validate multi classifier and binary classifiers
+		//compute marginals p(o_k) for output o_k, assuming p(c_i) uniformly distributed
+		std::map<std::string, double> p_ok;
+		for (ItGlobalFeaturesMap = foldFeaturesMap.begin(); ItGlobalFeaturesMap != foldFeaturesMap.end(); ItGlobalFeaturesMap++)
+		{
+			std::string outputLabel = ItGlobalFeaturesMap->first;
+			p_ok[outputLabel] = 0.0;
+			for (ItGlobalFeaturesMap2 = foldFeaturesMap.begin(); ItGlobalFeaturesMap2 != foldFeaturesMap.end(); ItGlobalFeaturesMap2++)
+			{
+				std::string groundTruthLabel = ItGlobalFeaturesMap2->first;
+				p_ok[outputLabel] += accuracy[outputLabel][groundTruthLabel];
+			}
+			p_ok[outputLabel] /= (double)foldFeaturesMap.size();
+		}
+		// binary classifiers of this fold, addressed by index in the validation loop
+		GlobalClassifierTable classifierTable;
+		classifierTable.Build(classifierMap);
+		CvMat* classifierResponses = NULL;
+
+		//statistics
+		for (ItGlobalFeaturesMap = foldFeaturesMap.begin(); ItGlobalFeaturesMap != foldFeaturesMap.end(); ItGlobalFeaturesMap++)
+		{
+			std::string label = ItGlobalFeaturesMap->first;
+			for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices++)
+			{
+				for (int sample=ItGlobalFeaturesMap->second[*ItIndices]->rows*validationStartFactor; sample<ItGlobalFeaturesMap->second[*ItIndices]->rows; sample++)
 				{
-					for (int sample=0; sample<ItGlobalFeaturesMap->second[*ItIndices]->rows; sample++)
-					{
-						CvMat* featureVector = cvCreateMat(1, ItGlobalFeaturesMap->second[*ItIndices]->cols, ItGlobalFeaturesMap->second[*ItIndices]->type);
-						cvGetRow(ItGlobalFeaturesMap->second[*ItIndices], featureVector, sample);
+					CvMat* featureVector = cvCreateMat(1, ItGlobalFeaturesMap->second[*ItIndices]->cols, ItGlobalFeaturesMap->second[*ItIndices]->type);
+					cvGetRow(ItGlobalFeaturesMap->second[*ItIndices], featureVector, sample);
 
+					if (classifierType == CLASSIFIER_SVM)
+					{
 						// validate multi classifier
-						int k=1;
-						float result = KNN->find_nearest(featureVector, k);
+						float result = SVM->predict(featureVector);
 						if (result == (float)objectClassNumberMapping[label])
 						{
 							// correct classification
-							multiclassStatistics[label]["tp"]++;
-							singleFoldMulticlassStatistics[fold][label]["tp"]++;
+							pResult->multiclassStatistics[label]["tp"]++;
 						}
 						else
 						{
 							// false classification
-							multiclassStatistics[label]["fn"]++;
-							multiclassStatistics[numberObjectClassMapping[(int)result]]["fp"]++;
-							singleFoldMulticlassStatistics[fold][label]["fn"]++;
-							singleFoldMulticlassStatistics[fold][numberObjectClassMapping[(int)result]]["fp"]++;
+							pResult->multiclassStatistics[label]["fn"]++;
+							pResult->multiclassStatistics[numberObjectClassMapping[(int)result]]["fp"]++;
 						}
-						
-						individualResults[label][*ItIndices].push_back(numberObjectClassMapping[(int)result]);
 
-						cvReleaseMat(&featureVector);
+						pResult->individualResults[label][*ItIndices].push_back(numberObjectClassMapping[(int)result]);
 					}
-				}
-			}
-		}
-		else
-		{
-			CvSVM* SVM = new CvSVM;
-			if (pClassifierType == CLASSIFIER_SVM)
-			{
-				// train multi classifier
-				CvSVMParams SVMParams = CvSVMParams(CvSVM::NU_SVC, CvSVM::RBF, 0, 0.007, 0, 1.0, 0.09, 0, 0, cvTermCriteria(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 2500, 0.0001));
-				CvMat trainMat = (CvMat)TrainingFeatureMatrix;
-				CvMat labelMat = (CvMat)TrainingFeatureResponseMatrix;
-				//bool trainResult = SVM->train(&trainMat, &labelMat, 0, 0, SVMParams);
-				CvParamGrid cGrid(0, 1, 0);
-				CvParamGrid gammaGrid(0.00021875, 3.0, 2.0);//CvParamGrid gammaGrid(0.00021875, 5.0, 2.0);  //CvParamGrid gammaGrid(0.000875, 1.0, 2.0);  CvParamGrid gammaGrid(0.00175, 0.00176, 2.0);
-				CvParamGrid pGrid(0, 1, 0);
-				CvParamGrid nuGrid(0.01125, 0.3, 2.0); //CvParamGrid nuGrid(0.01125, 0.3, 2.0);  CvParamGrid nuGrid(0.0225, 0.091, 2.0);
-				CvParamGrid coeffGrid(0, 1, 0);
-				CvParamGrid degreeGrid(0, 1, 0);
-				bool trainResult = SVM->train_auto(&trainMat, &labelMat, 0, 0, SVMParams, 10, cGrid, gammaGrid, pGrid, nuGrid, coeffGrid, degreeGrid);
-				CvSVMParams optimalParams = SVM->get_params();
-				std::cout << "\nOptimal params: gamma=" << optimalParams.gamma << "  nu=" << optimalParams.nu << "  C=" << optimalParams.C << "  p=" << optimalParams.p << "  coeff=" << optimalParams.coef0 << "  degree=" << optimalParams.degree << std::endl;
-				*pScreenLogFile << "\nOptimal params: gamma=" << optimalParams.gamma << "  nu=" << optimalParams.nu << "  C=" << optimalParams.C << "  p=" << optimalParams.p << "  coeff=" << optimalParams.coef0 << "  degree=" << optimalParams.degree << std::endl;
-				if (trainResult) std::cout << "Training Multiclass finished successfully." << std::endl;
-				else std::cout << "Training Multiclass failed." << std::endl;
-			}
-			else
-			{
-				// train binary classifiers
-				for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-				{
-					std::string label = ItGlobalFeaturesMap->first;
-					CvMat trainMatBinary = TrainingFeatureMatricesBinary[label];
-					CvMat labelMatBinary = TrainingFeatureResponseMatricesBinary[label];
-					TrainGlobal(pClassifierType, label, &trainMatBinary, &labelMatBinary);
-				}
-			}
-
-			// validate multi classifier and binary classifiers
-			//compute marginals p(o_k) for output o_k, assuming p(c_i) uniformly distributed
-			std::map<std::string, double> p_ok;
-			for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-			{
-				std::string outputLabel = ItGlobalFeaturesMap->first;
-				p_ok[outputLabel] = 0.0;
-				for (ItGlobalFeaturesMap2 = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap2 != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap2++)
-				{
-					std::string groundTruthLabel = ItGlobalFeaturesMap2->first;
-					p_ok[outputLabel] += mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel];
-				}
-				p_ok[outputLabel] /= (double)mData.mGlobalFeaturesMap.size();
-			}
-			//statistics
-			for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-			{
-				std::string label = ItGlobalFeaturesMap->first;
-				for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices++)
-				{
-					for (int sample=0; sample<ItGlobalFeaturesMap->second[*ItIndices]->rows; sample++)
+					else if (classifierType == CLASSIFIER_RTC)
 					{
-						CvMat* featureVector = cvCreateMat(1, ItGlobalFeaturesMap->second[*ItIndices]->cols, ItGlobalFeaturesMap->second[*ItIndices]->type);
-						cvGetRow(ItGlobalFeaturesMap->second[*ItIndices], featureVector, sample);
-
-						if (pClassifierType == CLASSIFIER_SVM)
+						// validate binary classifiers
+						std::map<std::string, double> classProbabilities;	// outputs p(o_k|x) of the different binary classifiers given the sample x
+						double maxAPrioriProbability = -1.0;
+						std::string maxAPrioriLabel = "";
+						if (PredictGlobalBatch(classifierType, classifierTable, featureVector, &classifierResponses) != ipa_utils::RET_OK)
 						{
-							// validate multi classifier
-							float result = SVM->predict(featureVector);
-							if (result == (float)objectClassNumberMapping[label])
-							{
-								// correct classification
-								multiclassStatistics[label]["tp"]++;
-								singleFoldMulticlassStatistics[fold][label]["tp"]++;
-							}
-							else
-							{
-								// false classification
-								multiclassStatistics[label]["fn"]++;
-								multiclassStatistics[numberObjectClassMapping[(int)result]]["fp"]++;
-								singleFoldMulticlassStatistics[fold][label]["fn"]++;
-								singleFoldMulticlassStatistics[fold][numberObjectClassMapping[(int)result]]["fp"]++;
-							}
-
-							individualResults[label][*ItIndices].push_back(numberObjectClassMapping[(int)result]);
+							// skip the sample, it is neither counted as correct nor as false classification
+							screenOutput << "ObjectClassifier::CrossValidationGlobalMultiClassFold: Error: Prediction failed for sample " << sample << " of object " << *ItIndices << " of class " << label << "." << std::endl;
+							cvReleaseMat(&featureVector);
+							continue;
 						}
-						else if (pClassifierType == CLASSIFIER_RTC)
+						for (int c=0; c<classifierTable.Size(); c++)
 						{
-							// validate binary classifiers
-							std::map<std::string, double> classProbabilities;	// outputs p(o_k|x) of the different binary classifiers given the sample x
-							double maxAPrioriProbability = -1.0;
-							std::string maxAPrioriLabel = "";
-							for (GlobalClassifierMap::iterator ItGlobalClassifierMap=mData.mGlobalClassifierMap.begin(); ItGlobalClassifierMap!=mData.mGlobalClassifierMap.end(); ItGlobalClassifierMap++)
-							{
-								double prediction = 0.0, th = mData.mGlobalClassifierThresholdMap[ItGlobalClassifierMap->first];
-								PredictGlobal(pClassifierType, ItGlobalClassifierMap->first, featureVector, prediction);
-								double mappedPrediction = 0;
-								if (prediction>=th) mappedPrediction = 2*(prediction-th)/(1.0-th);
-								else mappedPrediction = 2*(prediction-th)/th;
-								classProbabilities[ItGlobalClassifierMap->first] = exp(mappedPrediction)/(exp(mappedPrediction)+exp(-mappedPrediction));
-								//double temp = exp(mappedPrediction);
-
-								if (classProbabilities[ItGlobalClassifierMap->first] > maxAPrioriProbability)
-								{
-									maxAPrioriProbability = classProbabilities[ItGlobalClassifierMap->first];
-									maxAPrioriLabel = ItGlobalClassifierMap->first;
-								}
-							}
-							// max a posteriori label
-							std::map<std::string, double> p_ci_x;	// probability distribution for the actual object class given measurement x
-							std::map<std::string, double>::iterator ItGroundTruthClass, ItOutputClass;
-							for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)		// heuristic approach, light/fast probabilistic approach
+							const std::string& className = classifierTable.classNames[c];
+							double prediction = cvmGet(classifierResponses, 0, c), th = thresholdMap[className];
+							double mappedPrediction = 0;
+							if (prediction>=th) mappedPrediction = 2*(prediction-th)/(1.0-th);
+							else mappedPrediction = 2*(prediction-th)/th;
+							classProbabilities[className] = exp(mappedPrediction)/(exp(mappedPrediction)+exp(-mappedPrediction));
+
+							if (classProbabilities[className] > maxAPrioriProbability)
 							{
-								std::string groundTruthLabel = ItGroundTruthClass->first;
-								p_ci_x[groundTruthLabel] = 0.0;
-								for (ItOutputClass = classProbabilities.begin(); ItOutputClass != classProbabilities.end(); ItOutputClass++)
-								{
-									std::string outputLabel = ItOutputClass->first;
-									p_ci_x[groundTruthLabel] += mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel]/(p_ok[outputLabel]*classProbabilities.size()) * classProbabilities[outputLabel];
-								}
+								maxAPrioriProbability = classProbabilities[className];
+								maxAPrioriLabel = className;
 							}
-							//for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)
-							//	p_ci_x[ItGroundTruthClass->first] = 0.0;
-							//unsigned long numberCombinations = 1<<classProbabilities.size();
-							//for (unsigned long outputCombination = 0; outputCombination < numberCombinations; outputCombination++)
-							//{
-							//	double summandCommonPart=1;
-							//	int classShift=0;
-							//	for (ItOutputClass = classProbabilities.begin(); ItOutputClass != classProbabilities.end(); ItOutputClass++, classShift++)
-							//	{
-							//		std::string outputLabel = ItOutputClass->first;
-							//		bool outputState = ((outputCombination>>classShift) & 0x01) == 1;	// if true: p(o_k=1) is considered, else p(o_k=0)
-							//		if (outputState == true)
-							//			summandCommonPart *= classProbabilities[outputLabel] / p_ok[outputLabel];
-							//		else
-							//			summandCommonPart *= (1.-classProbabilities[outputLabel]) / (1.-p_ok[outputLabel]);
-							//	}
-							//	summandCommonPart /= classProbabilities.size();	// uniform ground truth class prior
-
-							//	for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)
-							//	{
-							//		std::string groundTruthLabel = ItGroundTruthClass->first;
-							//		double summandGroundTruthClassSpecific=1;
-							//		int classShift=0;
-							//		for (ItOutputClass = classProbabilities.begin(); ItOutputClass != classProbabilities.end(); ItOutputClass++, classShift++)
-							//		{
-							//			std::string outputLabel = ItOutputClass->first;
-							//			bool outputState = ((outputCombination>>classShift) & 0x01) == 1;	// if true: p(o_k=1) is considered, else p(o_k=0)
-							//			if (outputState == true)
-							//				summandGroundTruthClassSpecific *= mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel];
-							//			else
-							//				summandGroundTruthClassSpecific *= (1.-mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel]);
-							//		}
-							//		p_ci_x[groundTruthLabel] += summandGroundTruthClassSpecific * summandCommonPart;
-							//	}
-							//}
-
-							double maxAPosterioriProbability = -1.0;
-							std::string maxAPosterioriLabel = "";
-							for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)
+						}
+						// max a posteriori label
+						std::map<std::string, double> p_ci_x;	// probability distribution for the actual object class given measurement x
+						std::map<std::string, double>::iterator ItGroundTruthClass, ItOutputClass;
+						for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)		// heuristic approach, light/fast probabilistic approach
+						{
+							std::string groundTruthLabel = ItGroundTruthClass->first;
+							p_ci_x[groundTruthLabel] = 0.0;
+							for (ItOutputClass = classProbabilities.begin(); ItOutputClass != classProbabilities.end(); ItOutputClass++)
 							{
-								std::string groundTruthLabel = ItGroundTruthClass->first;
-								if (p_ci_x[groundTruthLabel] > maxAPosterioriProbability)
-								{
-									maxAPosterioriProbability = p_ci_x[groundTruthLabel];
-									maxAPosterioriLabel = groundTruthLabel;
-								}
+								std::string outputLabel = ItOutputClass->first;
+								p_ci_x[groundTruthLabel] += accuracy[outputLabel][groundTruthLabel]/(p_ok[outputLabel]*classProbabilities.size()) * classProbabilities[outputLabel];
 							}
+						}
 
-							std::string maxLabel = maxAPosterioriLabel;		// or: maxAPrioriLabel
-							if (maxLabel == label)
-							{
-								// correct classification
-								multiclassStatisticsBinary[label]["tp"]++;
-								singleFoldMulticlassStatisticsBinary[fold][label]["tp"]++;
-							}
-							else
+						double maxAPosterioriProbability = -1.0;
+						std::string maxAPosterioriLabel = "";
+						for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)
+						{
+							std::string groundTruthLabel = ItGroundTruthClass->first;
+							if (p_ci_x[groundTruthLabel] > maxAPosterioriProbability)
 							{
-								// false classification
-								multiclassStatisticsBinary[label]["fn"]++;
-								multiclassStatisticsBinary[maxLabel]["fp"]++;
-								singleFoldMulticlassStatisticsBinary[fold][label]["fn"]++;
-								singleFoldMulticlassStatisticsBinary[fold][maxLabel]["fp"]++;
+								maxAPosterioriProbability = p_ci_x[groundTruthLabel];
+								maxAPosterioriLabel = groundTruthLabel;
 							}
+						}
 
-							individualResults[label][*ItIndices].push_back(maxLabel);
+						std::string maxLabel = maxAPosterioriLabel;		// or: maxAPrioriLabel
+						if (maxLabel == label)
+						{
+							// correct classification
+							pResult->multiclassStatisticsBinary[label]["tp"]++;
+						}
+						else
+						{
+							// false classification
+							pResult->multiclassStatisticsBinary[label]["fn"]++;
+							pResult->multiclassStatisticsBinary[maxLabel]["fp"]++;
 						}
 
-						cvReleaseMat(&featureVector);
+						pResult->individualResults[label][*ItIndices].push_back(maxLabel);
 					}
+
+					cvReleaseMat(&featureVector);
 				}
 			}
-			SVM->clear();
-			delete SVM;
 		}
+		if (classifierResponses != NULL) cvReleaseMat(&classifierResponses);
+		SVM->clear();
+		delete SVM;
+	}
 
-		// write back the validation indices into the train index set for objects from class
-		for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	// release the binary classifiers of this fold
+	for (GlobalClassifierMap::iterator ItGlobalClassifierMap=classifierMap.begin(); ItGlobalClassifierMap!=classifierMap.end(); ItGlobalClassifierMap++)
+	{
+		ItGlobalClassifierMap->second->clear();
+		delete ItGlobalClassifierMap->second;
+	}
+
+	pResult->returnCode = ipa_utils::RET_OK;
+	pResult->screenOutput = screenOutput.str();
+}
+
+
+int ObjectClassifier::CrossValidationGlobalMultiClassRunFolds(std::vector<MultiClassFoldSetup>& pFoldSetups, int pNumberThreads, MultiClassStatistics& pMulticlassStatistics, MultiClassStatistics& pMulticlassStatisticsBinary,
+							std::vector<MultiClassStatistics>& pSingleFoldMulticlassStatistics, std::vector<MultiClassStatistics>& pSingleFoldMulticlassStatisticsBinary,
+							std::map<std::string, std::map< int, std::vector< std::string > > >& pIndividualResults, std::ofstream* pScreenLogFile)
+{
+	std::vector<MultiClassFoldResult> foldResults(pFoldSetups.size());
+
+	if (pNumberThreads != 1)
+	{
+		// the folds only read the feature data and train their own classifiers, each result is written into its own slot
+		ipa_utils::ThreadPool threadPool(pNumberThreads);
+		std::cout << "Running " << pFoldSetups.size() << " folds with " << threadPool.size() << " threads." << std::endl;
+		for (unsigned int fold=0; fold<pFoldSetups.size(); fold++)
+			threadPool.schedule(boost::bind(&ObjectClassifier::CrossValidationGlobalMultiClassFold, this, &pFoldSetups[fold], &foldResults[fold]));
+		threadPool.wait();
+	}
+
+	// merge the fold results in fold order, so the output does not depend on the number of threads
+	for (unsigned int fold=0; fold<pFoldSetups.size(); fold++)
+	{
+		if (pNumberThreads == 1)
+			CrossValidationGlobalMultiClassFold(&pFoldSetups[fold], &foldResults[fold]);
+		MultiClassFoldResult& result = foldResults[fold];
+
+		MultiClassStatistics::iterator ItStatistics;
+		std::map<std::string, int>::iterator ItValue;
+		for (ItStatistics = result.multiclassStatistics.begin(); ItStatistics != result.multiclassStatistics.end(); ItStatistics++)
+			for (ItValue = ItStatistics->second.begin(); ItValue != ItStatistics->second.end(); ItValue++)
+				pMulticlassStatistics[ItStatistics->first][ItValue->first] += ItValue->second;
+		for (ItStatistics = result.multiclassStatisticsBinary.begin(); ItStatistics != result.multiclassStatisticsBinary.end(); ItStatistics++)
+			for (ItValue = ItStatistics->second.begin(); ItValue != ItStatistics->second.end(); ItValue++)
+				pMulticlassStatisticsBinary[ItStatistics->first][ItValue->first] += ItValue->second;
+		pSingleFoldMulticlassStatistics[fold] = result.multiclassStatistics;
+		pSingleFoldMulticlassStatisticsBinary[fold] = result.multiclassStatisticsBinary;
+
+		std::map<std::string, std::map< int, std::vector< std::string > > >::iterator ItClass;
+		std::map< int, std::vector< std::string > >::iterator ItObject;
+		for (ItClass = result.individualResults.begin(); ItClass != result.individualResults.end(); ItClass++)
 		{
-			std::string label = ItGlobalFeaturesMap->first;
-			for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices = indicesValidation[label].begin())
+			for (ItObject = ItClass->second.begin(); ItObject != ItClass->second.end(); ItObject++)
 			{
-				indicesTrain[label].push_back(*ItIndices);
-				indicesValidation[label].remove(*ItIndices);
+				std::vector<std::string>& predictions = pIndividualResults[ItClass->first][ItObject->first];
+				predictions.insert(predictions.end(), ItObject->second.begin(), ItObject->second.end());
 			}
-			indicesTrain[label].sort();
 		}
-		std::cout << ".";
-		if (pScreenLogFile) *pScreenLogFile << ".";
+
+		std::cout << result.screenOutput << ".";
+		if (pScreenLogFile) *pScreenLogFile << result.screenOutput << ".";
+		if (result.returnCode != ipa_utils::RET_OK)
+			return ipa_utils::RET_FAILED;
 	}
 	std::cout << std::endl;
 	if (pScreenLogFile) *pScreenLogFile << std::endl;
+
+	return ipa_utils::RET_OK;
+}
+
+
+int ObjectClassifier::CrossValidationGlobalMultiClass(std::string pStatisticsPath, std::string pFileDescription, ClassifierType pClassifierType, int pFold, float pFactorIncorrect, float pPercentTest,
+														float pPercentValidation, int pViewsPerObject, std::ofstream* pScreenLogFile, int pNumberThreads)
+{
+	bool drawValidationSetRandomized = false;
+
+	if (pPercentTest > 0.)
+	{
+		std::cout << "Error: CrossValidationGlobalMultiClass: A test set is not supported at the moment. Please use only the training and validation sets." << std::endl;
+		if (pScreenLogFile) *pScreenLogFile << "Error: CrossValidationGlobalMultiClass: A test set is not supported at the moment. Please use only the training and validation sets." << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
+
+	// determine number of objects available for training/validation/test set for each class
+	GlobalFeaturesMap::iterator ItGlobalFeaturesMap, ItGlobalFeaturesMap2;
+	std::map<std::string, int> numberObjects;		// number of objects available for each class
+	std::map<std::string, int> numberObjectsTest;	// number of objects used in test set for each class
+	std::map<std::string, int> numberObjectsTrain;	// number of objects used in training set for each class
+	std::map<std::string, int> numberObjectsValidation;	// number of objects used in validation set for each class
+	int numberFeatures = 0;		// dimension of the feature vectors
+	std::map<std::string, int> objectClassNumberMapping;	// maps each object class name to a unique number
+	std::map<int, std::string> numberObjectClassMapping;	// maps a unique number to an object class name
+	int uniqueID = 0;
+	for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	{
+		std::string label = ItGlobalFeaturesMap->first;
+		objectClassNumberMapping[label] = uniqueID;
+		numberObjectClassMapping[uniqueID] = label;
+		uniqueID++;
+		numberObjects[label] = ItGlobalFeaturesMap->second.size();
+		
+		if (((numberObjectsTest[label]=cvRound((double)numberObjects[label]*pPercentTest)) < 1) && (pPercentTest > 0.0))	// check for a large enough number of objects
+		{
+			numberObjectsTest[label] = 1;
+			//std::cout << "ObjectClassifier::CrossValidationGlobal: Not enough objects to do cross validation for class " << pClass << ". Use more examples or increase the percentage of the test set.\n";
+			//return ipa_utils::RET_FAILED;
+		}
+		if ((numberObjectsValidation[label]=cvRound((double)numberObjects[label]*pPercentValidation)) < 1)
+		{
+			numberObjectsValidation[label] = 1;
+			//std::cout << "ObjectClassifier::CrossValidationGlobal: Not enough objects to do cross validation for class " << pClass << ". Use more examples or increase the percentage of the validation set.\n";
+			//return ipa_utils::RET_FAILED;
+		}
+		if ((numberObjectsTrain[label] = numberObjects[label]-numberObjectsTest[label]-numberObjectsValidation[label]) < 1)
+		{
+			std::cout << "ObjectClassifier::CrossValidationGlobal: Not enough objects to do cross validation for class " << label << ". Use more examples or leave more percentage for the train set.\n";
+			if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::CrossValidationGlobal: Not enough objects to do cross validation for class " << label << ". Use more examples or leave more percentage for the train set.\n";
+			return ipa_utils::RET_FAILED;
+		}
+
+		if (numberFeatures == 0)
+			numberFeatures = ItGlobalFeaturesMap->second[0]->cols;
+	}
+
+	// index lists of object indices (to put whole object datasets in individual sets, i.e. no data of object x can be split into validation and training set, it all goes into one set)
+	std::map<std::string, std::list<int> > indicesTrain;	// object indices for each set
+	std::map<std::string, std::list<int> > indicesValidation;
+	std::map<std::string, std::list<int> > indicesTest;
+	std::list<int>::iterator ItIndices;
+	std::map<std::string, int> numberSamples;		// total number of feature vectors available for each class
+	std::map<std::string, int> numberSamplesTest;	// number of feature vectors available for the test set of each class
+	for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	{
+		std::string label = ItGlobalFeaturesMap->first;
+		// fill index lists for training with all objects of each class and remove indices of objects for test and validation set later
+		for (int i=0; i<numberObjects[label]; i++) indicesTrain[label].push_back(i);
+
+		// note: was not used anywhere
+		//// determine total number of available feature vectors for this class
+		//numberSamples[label] = 0;
+		//for (ItIndices = indicesTrain[label].begin(); ItIndices != indicesTrain[label].end(); ItIndices++)
+		//	numberSamples[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows;
+
+		// prepare index list for test set
+		numberSamplesTest[label] = 0;
+		for (int i=0; i<numberObjectsTest[label]; i++)
+		{
+			int index = int(indicesTrain[label].size()*((double)rand()/((double)RAND_MAX+1.0)));
+			ItIndices = indicesTrain[label].begin();
+			for (int k=0; k<index; k++, ItIndices++);
+			numberSamplesTest[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows;
+			indicesTest[label].push_back(*ItIndices);
+			indicesTrain[label].remove(*ItIndices);
+		}
+	}
+
+
+	// cross validation cycles
+	std::map<std::string, std::map<std::string, int> > multiclassStatistics;   // statistics: tp=true positive, fp=false positive, fn=false negative
+	std::map<std::string, std::map<std::string, int> > multiclassStatisticsBinary;   // statistics: tp=true positive, fp=false positive, fn=false negative
+	std::map<std::string, std::map< int, std::vector< std::string > > > individualResults;	// prediction results, indices: classname - object number - view index - prediction
+
+	// prepare statistics
+	for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	{
+		std::string label = ItGlobalFeaturesMap->first;
+		multiclassStatistics[label]["tp"] = 0;
+		multiclassStatistics[label]["fp"] = 0;
+		multiclassStatistics[label]["fn"] = 0;
+		multiclassStatisticsBinary[label]["tp"] = 0;
+		multiclassStatisticsBinary[label]["fp"] = 0;
+		multiclassStatisticsBinary[label]["fn"] = 0;
+	}
+	std::vector<std::map<std::string, std::map<std::string, int> > > singleFoldMulticlassStatistics(pFold, multiclassStatistics);   // statistics: tp=true positive, fp=false positive, fn=false negative
+	std::vector<std::map<std::string, std::map<std::string, int> > > singleFoldMulticlassStatisticsBinary(pFold, multiclassStatisticsBinary);   // statistics: tp=true positive, fp=false positive, fn=false negative
+
+	// draw the validation sets of all folds in advance with the same sequence as before, the folds are independent afterwards
+	std::vector<MultiClassFoldSetup> foldSetups(pFold);
+	for (int fold=0; fold<pFold; fold++)
+	{
+		MultiClassFoldSetup& foldSetup = foldSetups[fold];
+		foldSetup.classifierType = pClassifierType;
+		foldSetup.factorIncorrect = pFactorIncorrect;
+		foldSetup.viewsPerObject = pViewsPerObject;
+		foldSetup.factorSamplesTrainData = 1.0;
+		foldSetup.validationStartFactor = 0.0;
+		foldSetup.svmGammaGridMax = 3.0;
+		foldSetup.numberFeatures = numberFeatures;
+		foldSetup.objectClassNumberMapping = objectClassNumberMapping;
+		foldSetup.numberObjectClassMapping = numberObjectClassMapping;
+		for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+		{
+			std::string label = ItGlobalFeaturesMap->first;
+			// prepare index list for validation and training set
+			std::list<int>& foldIndicesTrain = (foldSetup.indicesTrain[label] = indicesTrain[label]);
+			std::list<int>& foldIndicesValidation = foldSetup.indicesValidation[label];
+			for (int i=0; i<numberObjectsValidation[label]; i++)
+			{
+				int index = 0;
+				if (drawValidationSetRandomized == true || fold>=(int)foldIndicesTrain.size())
+					index = int(foldIndicesTrain.size()*((double)rand()/((double)RAND_MAX+1.0)));
+				else
+					index = (fold+i)%foldIndicesTrain.size();
+				ItIndices = foldIndicesTrain.begin();
+				for (int k=0; k<index; k++, ItIndices++);
+				foldIndicesValidation.push_back(*ItIndices);
+				foldIndicesTrain.remove(*ItIndices);
+			}
+		}
+		foldSetup.randomSeed = ((uint64)rand() << 32) ^ (uint64)rand();
+	}
+
+	if (CrossValidationGlobalMultiClassRunFolds(foldSetups, pNumberThreads, multiclassStatistics, multiclassStatisticsBinary, singleFoldMulticlassStatistics, singleFoldMulticlassStatisticsBinary, individualResults, pScreenLogFile) != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
 	
 	/// Test classifier with the unseen test set.
 	if (numberObjectsTest.begin()->second > 0)
@@ -3890,7 +4385,7 @@ int ObjectClassifier::CrossValidationGlobalMultiClass(std::string pStatisticsPat
 ///////////////////////////////////////////////////////////////////////////// ----
 
 int ObjectClassifier::CrossValidationGlobalMultiClassSampleRange(std::string pStatisticsPath, std::string pFileDescription, ClassifierType pClassifierType, int pFold, float pFactorIncorrect, float pPercentTest,
-														float pPercentValidation, int pViewsPerObject, std::ofstream* pScreenLogFile, double pFactorSamplesTrainData)
+														float pPercentValidation, int pViewsPerObject, std::ofstream* pScreenLogFile, double pFactorSamplesTrainData, int pNumberThreads)
 {
 	bool drawValidationSetRandomized = false;
 	double factorSamplesTrainData = pFactorSamplesTrainData;		// for each object, this ratio of samples should go to the training set, the rest is for testing
@@ -3995,374 +4490,50 @@ int ObjectClassifier::CrossValidationGlobalMultiClassSampleRange(std::string pSt
 	std::vector<std::map<std::string, std::map<std::string, int> > > singleFoldMulticlassStatistics(pFold, multiclassStatistics);   // statistics: tp=true positive, fp=false positive, fn=false negative
 	std::vector<std::map<std::string, std::map<std::string, int> > > singleFoldMulticlassStatisticsBinary(pFold, multiclassStatisticsBinary);   // statistics: tp=true positive, fp=false positive, fn=false negative
 
+	// draw the validation sets of all folds in advance with the same sequence as before, the folds are independent afterwards
+	std::vector<MultiClassFoldSetup> foldSetups(pFold);
 	for (int fold=0; fold<pFold; fold++)
 	{
-		int numberSamplesTrain = 0;	// number of feature vectors available for the training set
-		int numberSamplesValidation = 0;	// number of feature vectors available for the validation set
-		std::map<std::string, int> numberSamplesTrainClasswise;	// number of feature vectors available for the training set in each class
-		std::map<std::string, int> numberSamplesValidationClasswise;
+		MultiClassFoldSetup& foldSetup = foldSetups[fold];
+		foldSetup.classifierType = pClassifierType;
+		foldSetup.factorIncorrect = pFactorIncorrect;
+		foldSetup.viewsPerObject = pViewsPerObject;
+		foldSetup.factorSamplesTrainData = factorSamplesTrainData;
+		foldSetup.validationStartFactor = factorSamplesTrainData;
+		foldSetup.svmGammaGridMax = 5.0;
+		foldSetup.numberFeatures = numberFeatures;
+		foldSetup.objectClassNumberMapping = objectClassNumberMapping;
+		foldSetup.numberObjectClassMapping = numberObjectClassMapping;
 		for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
 		{
 			std::string label = ItGlobalFeaturesMap->first;
 			// prepare index list for validation and training set
+			std::list<int>& foldIndicesTrain = (foldSetup.indicesTrain[label] = indicesTrain[label]);
+			std::list<int>& foldIndicesValidation = foldSetup.indicesValidation[label];
 			for (int i=0; i<numberObjectsValidation[label]; i++)
 			{
 				int index = 0;
-				if (drawValidationSetRandomized == true || fold>=(int)indicesTrain[label].size())
-					index = int(indicesTrain[label].size()*((double)rand()/((double)RAND_MAX+1.0)));
+				if (drawValidationSetRandomized == true || fold>=(int)foldIndicesTrain.size())
+					index = int(foldIndicesTrain.size()*((double)rand()/((double)RAND_MAX+1.0)));
 				else
-					index = (fold+i)%indicesTrain[label].size();
-				ItIndices = indicesTrain[label].begin();
+					index = (fold+i)%foldIndicesTrain.size();
+				ItIndices = foldIndicesTrain.begin();
 				for (int k=0; k<index; k++, ItIndices++);
-				indicesValidation[label].push_back(*ItIndices);
-				indicesTrain[label].remove(*ItIndices);
-			}
-
-			// count number of feature vectors for each set
-			numberSamplesTrainClasswise[label] = 0;
-			for (ItIndices = indicesTrain[label].begin(); ItIndices != indicesTrain[label].end(); ItIndices++)
-			{
-				if (pViewsPerObject == -1)
-				{
-					numberSamplesTrain += ItGlobalFeaturesMap->second[*ItIndices]->rows * factorSamplesTrainData;
-					numberSamplesTrainClasswise[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows * factorSamplesTrainData;
-				}
-				else
-				{
-					numberSamplesTrain += min(pViewsPerObject, int(ItGlobalFeaturesMap->second[*ItIndices]->rows * factorSamplesTrainData));
-					numberSamplesTrainClasswise[label] += min(pViewsPerObject, int(ItGlobalFeaturesMap->second[*ItIndices]->rows * factorSamplesTrainData));
-				}
-			}
-			numberSamplesValidationClasswise[label] = 0;
-			for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices++)
-			{
-				numberSamplesValidation += ItGlobalFeaturesMap->second[*ItIndices]->rows * (1.-factorSamplesTrainData);
-				numberSamplesValidationClasswise[label] += ItGlobalFeaturesMap->second[*ItIndices]->rows * (1.-factorSamplesTrainData);
+				foldIndicesValidation.push_back(*ItIndices);
+				foldIndicesTrain.remove(*ItIndices);
 			}
 		}
+		foldSetup.randomSeed = ((uint64)rand() << 32) ^ (uint64)rand();
+	}
 
-		// construct training data and label matrices
-		cv::Mat TrainingFeatureMatrix(numberSamplesTrain, numberFeatures, CV_32FC1);	// contains all training data, suited for multiclass classifiers
-		cv::Mat TrainingFeatureResponseMatrix(numberSamplesTrain, 1, CV_32SC1);
-		std::map<std::string, cv::Mat> TrainingFeatureMatricesBinary;		// contains binary training data (class samples and non-class samples), suited for binary classifiers
-		std::map<std::string, cv::Mat> TrainingFeatureResponseMatricesBinary;
-		int insertPosition = 0;
-		for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-		{
-			std::string label = ItGlobalFeaturesMap->first;
-			int insertPositionBinary = 0;
-			TrainingFeatureMatricesBinary[label] = cv::Mat(cvRound((double)numberSamplesTrainClasswise[label]*(1.0+pFactorIncorrect)), numberFeatures, CV_32FC1);
-			TrainingFeatureResponseMatricesBinary[label] = cv::Mat(TrainingFeatureMatricesBinary[label].rows, 1, CV_32FC1);
-			// class samples
-			for (ItIndices = indicesTrain[label].begin(); ItIndices != indicesTrain[label].end(); ItIndices++)
-			{
-				for (double dSample=0; dSample<ItGlobalFeaturesMap->second[*ItIndices]->rows*factorSamplesTrainData; (pViewsPerObject==-1) ? dSample+=1. : dSample+=max(1., (double)ItGlobalFeaturesMap->second[*ItIndices]->rows*factorSamplesTrainData/(double)pViewsPerObject))
-				{
-					int sample = (int)dSample;
-					for (int j=0; j<numberFeatures; j++)
-					{
-						TrainingFeatureMatrix.at<float>(insertPosition, j) = (float)cvmGet(ItGlobalFeaturesMap->second[*ItIndices], sample, j);
-						TrainingFeatureMatricesBinary[label].at<float>(insertPositionBinary, j) = (float)cvmGet(ItGlobalFeaturesMap->second[*ItIndices], sample, j);
-					}
-					TrainingFeatureResponseMatrix.at<int>(insertPosition, 0) = objectClassNumberMapping[label];
-					TrainingFeatureResponseMatricesBinary[label].at<float>(insertPositionBinary, 0) = 1.0;
-					insertPosition++;
-					insertPositionBinary++;
-				}
-			}
-			// non-class samples for the matrices suited for binary classifiers
-			while (insertPositionBinary < TrainingFeatureMatricesBinary[label].rows)
-			{
-				// pick random class
-				int index =	int(mData.mGlobalFeaturesMap.size()*((double)rand()/((double)RAND_MAX+1.0)));
-				ItGlobalFeaturesMap2 = mData.mGlobalFeaturesMap.begin();
-				for (int k=0; k<index; k++, ItGlobalFeaturesMap2++);
-				std::string labelIncorrect = ItGlobalFeaturesMap2->first;
-				if (labelIncorrect == label) continue;		// do not pick samples from correct class
-				
-				// pick random training object
-				index = int(indicesTrain[labelIncorrect].size()*((double)rand()/((double)RAND_MAX+1.0)));
-				ItIndices = indicesTrain[labelIncorrect].begin();
-				for (int k=0; k<index; k++, ItIndices++);
-
-				// pick random sample from that object
-				if (pViewsPerObject == -1)
-					index = int((ItGlobalFeaturesMap2->second[*ItIndices]->rows*factorSamplesTrainData)*((double)rand()/((double)RAND_MAX+1.0)));
-				else
-				{
-					double step=(double)ItGlobalFeaturesMap2->second[*ItIndices]->rows*factorSamplesTrainData/(double)pViewsPerObject;
-					do
-					{
-						index = int((ItGlobalFeaturesMap2->second[*ItIndices]->rows*factorSamplesTrainData)*((double)rand()/((double)RAND_MAX+1.0)));
-					} while (index != int(step * int((double)index/step)));
-				}
-				for (int j=0; j<numberFeatures; j++)
-					TrainingFeatureMatricesBinary[label].at<float>(insertPositionBinary, j) = (float)cvmGet(ItGlobalFeaturesMap2->second[*ItIndices], index, j);
-				TrainingFeatureResponseMatricesBinary[label].at<float>(insertPositionBinary, 0) = 0.0;
-				insertPositionBinary++;
-			}
-		}
-
-		
-		if (pClassifierType == CLASSIFIER_KNN)
-		{
-			// train KNN multi classifier
-			CvKNearest* KNN = new CvKNearest;
-			CvMat trainMat = (CvMat)TrainingFeatureMatrix;
-			CvMat labelMat = (CvMat)TrainingFeatureResponseMatrix;
-			bool trainResult = KNN->train(&trainMat, &labelMat, 0, false);
-			if (!trainResult) std::cout << "Training Multiclass failed." << std::endl;
-
-			// validate KNN multi classifier
-			//statistics
-			for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-			{
-				std::string label = ItGlobalFeaturesMap->first;
-				for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices++)
-				{
-					for (int sample=ItGlobalFeaturesMap->second[*ItIndices]->rows*factorSamplesTrainData; sample<ItGlobalFeaturesMap->second[*ItIndices]->rows; sample++)
-					{
-						CvMat* featureVector = cvCreateMat(1, ItGlobalFeaturesMap->second[*ItIndices]->cols, ItGlobalFeaturesMap->second[*ItIndices]->type);
-						cvGetRow(ItGlobalFeaturesMap->second[*ItIndices], featureVector, sample);
-
-						// validate multi classifier
-						int k=1;
-						float result = KNN->find_nearest(featureVector, k);
-						if (result == (float)objectClassNumberMapping[label])
-						{
-							// correct classification
-							multiclassStatistics[label]["tp"]++;
-							singleFoldMulticlassStatistics[fold][label]["tp"]++;
-						}
-						else
-						{
-							// false classification
-							multiclassStatistics[label]["fn"]++;
-							multiclassStatistics[numberObjectClassMapping[(int)result]]["fp"]++;
-							singleFoldMulticlassStatistics[fold][label]["fn"]++;
-							singleFoldMulticlassStatistics[fold][numberObjectClassMapping[(int)result]]["fp"]++;
-						}
-						
-						individualResults[label][*ItIndices].push_back(numberObjectClassMapping[(int)result]);
-
-						cvReleaseMat(&featureVector);
-					}
-				}
-			}
-		}
-		else
-		{
-			CvSVM* SVM = new CvSVM;
-			if (pClassifierType == CLASSIFIER_SVM)
-			{
-				// train multi classifier
-				CvSVMParams SVMParams = CvSVMParams(CvSVM::NU_SVC, CvSVM::RBF, 0, 0.007, 0, 1.0, 0.09, 0, 0, cvTermCriteria(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 2500, 0.0001));
-				CvMat trainMat = (CvMat)TrainingFeatureMatrix;
-				CvMat labelMat = (CvMat)TrainingFeatureResponseMatrix;
-				//bool trainResult = SVM->train(&trainMat, &labelMat, 0, 0, SVMParams);
-				CvParamGrid cGrid(0, 1, 0);
-				CvParamGrid gammaGrid(0.00021875, 5.0, 2.0);//CvParamGrid gammaGrid(0.00021875, 5.0, 2.0);  //CvParamGrid gammaGrid(0.000875, 1.0, 2.0);
-				CvParamGrid pGrid(0, 1, 0);
-				CvParamGrid nuGrid(0.01125, 0.3, 2.0); //CvParamGrid nuGrid(0.01125, 0.3, 2.0);
-				CvParamGrid coeffGrid(0, 1, 0);
-				CvParamGrid degreeGrid(0, 1, 0);
-				bool trainResult = SVM->train_auto(&trainMat, &labelMat, 0, 0, SVMParams, 10, cGrid, gammaGrid, pGrid, nuGrid, coeffGrid, degreeGrid);
-				CvSVMParams optimalParams = SVM->get_params();
-				std::cout << "\nOptimal params: gamma=" << optimalParams.gamma << "  nu=" << optimalParams.nu << "  C=" << optimalParams.C << "  p=" << optimalParams.p << "  coeff=" << optimalParams.coef0 << "  degree=" << optimalParams.degree << std::endl;
-				*pScreenLogFile << "\nOptimal params: gamma=" << optimalParams.gamma << "  nu=" << optimalParams.nu << "  C=" << optimalParams.C << "  p=" << optimalParams.p << "  coeff=" << optimalParams.coef0 << "  degree=" << optimalParams.degree << std::endl;
-				if (trainResult) std::cout << "Training Multiclass finished successfully." << std::endl;
-				else std::cout << "Training Multiclass failed." << std::endl;
-			}
-			else
-			{
-				// train binary classifiers
-				for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-				{
-					std::string label = ItGlobalFeaturesMap->first;
-					CvMat trainMatBinary = TrainingFeatureMatricesBinary[label];
-					CvMat labelMatBinary = TrainingFeatureResponseMatricesBinary[label];
-					TrainGlobal(pClassifierType, label, &trainMatBinary, &labelMatBinary);
-				}
-			}
-
-			// validate multi classifier and binary classifiers
-			//compute marginals p(o_k) for output o_k, assuming p(c_i) uniformly distributed
-			std::map<std::string, double> p_ok;
-			for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-			{
-				std::string outputLabel = ItGlobalFeaturesMap->first;
-				p_ok[outputLabel] = 0.0;
-				for (ItGlobalFeaturesMap2 = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap2 != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap2++)
-				{
-					std::string groundTruthLabel = ItGlobalFeaturesMap2->first;
-					p_ok[outputLabel] += mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel];
-				}
-				p_ok[outputLabel] /= (double)mData.mGlobalFeaturesMap.size();
-			}
-			//statistics
-			for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-			{
-				std::string label = ItGlobalFeaturesMap->first;
-				for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices++)
-				{
-					for (int sample=ItGlobalFeaturesMap->second[*ItIndices]->rows*factorSamplesTrainData; sample<ItGlobalFeaturesMap->second[*ItIndices]->rows; sample++)
-					{
-						CvMat* featureVector = cvCreateMat(1, ItGlobalFeaturesMap->second[*ItIndices]->cols, ItGlobalFeaturesMap->second[*ItIndices]->type);
-						cvGetRow(ItGlobalFeaturesMap->second[*ItIndices], featureVector, sample);
-
-						if (pClassifierType == CLASSIFIER_SVM)
-						{
-							// validate multi classifier
-							float result = SVM->predict(featureVector);
-							if (result == (float)objectClassNumberMapping[label])
-							{
-								// correct classification
-								multiclassStatistics[label]["tp"]++;
-								singleFoldMulticlassStatistics[fold][label]["tp"]++;
-							}
-							else
-							{
-								// false classification
-								multiclassStatistics[label]["fn"]++;
-								multiclassStatistics[numberObjectClassMapping[(int)result]]["fp"]++;
-								singleFoldMulticlassStatistics[fold][label]["fn"]++;
-								singleFoldMulticlassStatistics[fold][numberObjectClassMapping[(int)result]]["fp"]++;
-							}
-
-							individualResults[label][*ItIndices].push_back(numberObjectClassMapping[(int)result]);
-						}
-						else if (pClassifierType == CLASSIFIER_RTC)
-						{
-							// validate binary classifiers
-							std::map<std::string, double> classProbabilities;	// outputs p(o_k|x) of the different binary classifiers given the sample x
-							double maxAPrioriProbability = -1.0;
-							std::string maxAPrioriLabel = "";
-							for (GlobalClassifierMap::iterator ItGlobalClassifierMap=mData.mGlobalClassifierMap.begin(); ItGlobalClassifierMap!=mData.mGlobalClassifierMap.end(); ItGlobalClassifierMap++)
-							{
-								double prediction = 0.0, th = mData.mGlobalClassifierThresholdMap[ItGlobalClassifierMap->first];
-								PredictGlobal(pClassifierType, ItGlobalClassifierMap->first, featureVector, prediction);
-								double mappedPrediction = 0;
-								if (prediction>=th) mappedPrediction = 2*(prediction-th)/(1.0-th);
-								else mappedPrediction = 2*(prediction-th)/th;
-								classProbabilities[ItGlobalClassifierMap->first] = exp(mappedPrediction)/(exp(mappedPrediction)+exp(-mappedPrediction));
-								//double temp = exp(mappedPrediction);
-
-								if (classProbabilities[ItGlobalClassifierMap->first] > maxAPrioriProbability)
-								{
-									maxAPrioriProbability = classProbabilities[ItGlobalClassifierMap->first];
-									maxAPrioriLabel = ItGlobalClassifierMap->first;
-								}
-							}
-							// max a posteriori label
-							std::map<std::string, double> p_ci_x;	// probability distribution for the actual object class given measurement x
-							std::map<std::string, double>::iterator ItGroundTruthClass, ItOutputClass;
-							for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)		// heuristic approach, light/fast probabilistic approach
-							{
-								std::string groundTruthLabel = ItGroundTruthClass->first;
-								p_ci_x[groundTruthLabel] = 0.0;
-								for (ItOutputClass = classProbabilities.begin(); ItOutputClass != classProbabilities.end(); ItOutputClass++)
-								{
-									std::string outputLabel = ItOutputClass->first;
-									p_ci_x[groundTruthLabel] += mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel]/(p_ok[outputLabel]*classProbabilities.size()) * classProbabilities[outputLabel];
-								}
-							}
-							//for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)
-							//	p_ci_x[ItGroundTruthClass->first] = 0.0;
-							//unsigned long numberCombinations = 1<<classProbabilities.size();
-							//for (unsigned long outputCombination = 0; outputCombination < numberCombinations; outputCombination++)
-							//{
-							//	double summandCommonPart=1;
-							//	int classShift=0;
-							//	for (ItOutputClass = classProbabilities.begin(); ItOutputClass != classProbabilities.end(); ItOutputClass++, classShift++)
-							//	{
-							//		std::string outputLabel = ItOutputClass->first;
-							//		bool outputState = ((outputCombination>>classShift) & 0x01) == 1;	// if true: p(o_k=1) is considered, else p(o_k=0)
-							//		if (outputState == true)
-							//			summandCommonPart *= classProbabilities[outputLabel] / p_ok[outputLabel];
-							//		else
-							//			summandCommonPart *= (1.-classProbabilities[outputLabel]) / (1.-p_ok[outputLabel]);
-							//	}
-							//	summandCommonPart /= classProbabilities.size();	// uniform ground truth class prior
-
-							//	for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)
-							//	{
-							//		std::string groundTruthLabel = ItGroundTruthClass->first;
-							//		double summandGroundTruthClassSpecific=1;
-							//		int classShift=0;
-							//		for (ItOutputClass = classProbabilities.begin(); ItOutputClass != classProbabilities.end(); ItOutputClass++, classShift++)
-							//		{
-							//			std::string outputLabel = ItOutputClass->first;
-							//			bool outputState = ((outputCombination>>classShift) & 0x01) == 1;	// if true: p(o_k=1) is considered, else p(o_k=0)
-							//			if (outputState == true)
-							//				summandGroundTruthClassSpecific *= mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel];
-							//			else
-							//				summandGroundTruthClassSpecific *= (1.-mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel]);
-							//		}
-							//		p_ci_x[groundTruthLabel] += summandGroundTruthClassSpecific * summandCommonPart;
-							//	}
-							//}
-
-							double maxAPosterioriProbability = -1.0;
-							std::string maxAPosterioriLabel = "";
-							for (ItGroundTruthClass = classProbabilities.begin(); ItGroundTruthClass != classProbabilities.end(); ItGroundTruthClass++)
-							{
-								std::string groundTruthLabel = ItGroundTruthClass->first;
-								if (p_ci_x[groundTruthLabel] > maxAPosterioriProbability)
-								{
-									maxAPosterioriProbability = p_ci_x[groundTruthLabel];
-									maxAPosterioriLabel = groundTruthLabel;
-								}
-							}
-
-							std::string maxLabel = maxAPosterioriLabel;		// or: maxAPrioriLabel
-							if (maxLabel == label)
-							{
-								// correct classification
-								multiclassStatisticsBinary[label]["tp"]++;
-								singleFoldMulticlassStatisticsBinary[fold][label]["tp"]++;
-							}
-							else
-							{
-								// false classification
-								multiclassStatisticsBinary[label]["fn"]++;
-								multiclassStatisticsBinary[maxLabel]["fp"]++;
-								singleFoldMulticlassStatisticsBinary[fold][label]["fn"]++;
-								singleFoldMulticlassStatisticsBinary[fold][maxLabel]["fp"]++;
-							}
-
-							individualResults[label][*ItIndices].push_back(maxLabel);
-						}
-
-						cvReleaseMat(&featureVector);
-					}
-				}
-			}
-			SVM->clear();
-			delete SVM;
-		}
-
-		// write back the validation indices into the train index set for objects from class
-		for (ItGlobalFeaturesMap = mData.mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mData.mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
-		{
-			std::string label = ItGlobalFeaturesMap->first;
-			for (ItIndices = indicesValidation[label].begin(); ItIndices != indicesValidation[label].end(); ItIndices = indicesValidation[label].begin())
-			{
-				indicesTrain[label].push_back(*ItIndices);
-				indicesValidation[label].remove(*ItIndices);
-			}
-			indicesTrain[label].sort();
-		}
-		std::cout << ".";
-		if (pScreenLogFile) *pScreenLogFile << ".";
-	}
-	std::cout << std::endl;
-	if (pScreenLogFile) *pScreenLogFile << std::endl;
-	
-	/// Test classifier with the unseen test set.
-	if (numberObjectsTest.begin()->second > 0)
-	{
-		// train classifier with whole train data
-		//TrainGlobal(pClassifierType, pClass, NumberSamplesCorrect-NumberSamplesCorrectTest+NumberSamplesIncorrect-NumberSamplesIncorrectTest, NumberFeatures, ItGlobalFeaturesClass, &IndicesTrainCorrect, &IndicesTrainIncorrect, NegativeSamplesMatrix);
+	if (CrossValidationGlobalMultiClassRunFolds(foldSetups, pNumberThreads, multiclassStatistics, multiclassStatisticsBinary, singleFoldMulticlassStatistics, singleFoldMulticlassStatisticsBinary, individualResults, pScreenLogFile) != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
+	
+	/// Test classifier with the unseen test set.
+	if (numberObjectsTest.begin()->second > 0)
+	{
+		// train classifier with whole train data
+		//TrainGlobal(pClassifierType, pClass, NumberSamplesCorrect-NumberSamplesCorrectTest+NumberSamplesIncorrect-NumberSamplesIncorrectTest, NumberFeatures, ItGlobalFeaturesClass, &IndicesTrainCorrect, &IndicesTrainIncorrect, NegativeSamplesMatrix);
 
 		// test classifier
 		//ValidateGlobal(pClassifierType, pClass, NumberFeatures, ItGlobalFeaturesClass, &IndicesTestCorrect, &IndicesTestIncorrect, NegativeSamplesMatrix, pTestSetOutput);
@@ -4530,6 +4701,19 @@ bool CompareDistances(ClassifiedBlob Blob1, ClassifiedBlob Blob2)
 	return true;
 }
 
+/// Read-only lookup of p(o_k|c_i) in the accuracy map, 0 for missing entries.
+/// Does not insert into the map like operator[], so CategorizeObject() may be called concurrently.
+static double ClassifierAccuracyEntry(const ClassifierAccuracy& pAccuracy, const std::string& pOutputLabel, const std::string& pGroundTruthLabel)
+{
+	ClassifierAccuracy::const_iterator itOutput = pAccuracy.find(pOutputLabel);
+	if (itOutput == pAccuracy.end())
+		return 0.0;
+	std::map<std::string, double>::const_iterator itGroundTruth = itOutput->second.find(pGroundTruthLabel);
+	if (itGroundTruth == itOutput->second.end())
+		return 0.0;
+	return itGroundTruth->second;
+}
+
 int ObjectClassifier::CategorizeObject(SharedImage* pSourceImage, std::map<std::string, double>& pResults, std::map<double, std::string>& pResultsOrdered, ClusterMode pClusterMode, ClassifierType pClassifierTypeGlobal, GlobalFeatureParams& pGlobalFeatureParams)
 {
 	/// create a pseudo blob
@@ -4571,7 +4755,7 @@ int ObjectClassifier::CategorizeObject(SharedImage* pSourceImage, std::map<std::
 		for (itClasses2 = mData.mGlobalClassifierAccuracy.begin(); itClasses2 != mData.mGlobalClassifierAccuracy.end(); itClasses2++)
 		{
 			std::string groundTruthLabel = itClasses2->first;
-			p_ok[outputLabel] += mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel];
+			p_ok[outputLabel] += ClassifierAccuracyEntry(mData.mGlobalClassifierAccuracy, outputLabel, groundTruthLabel);
 		}
 		p_ok[outputLabel] /= (double)mData.mGlobalClassifierAccuracy.size();
 
@@ -4591,22 +4775,34 @@ int ObjectClassifier::CategorizeObject(SharedImage* pSourceImage, std::map<std::
 		std::map<std::string, double> classProbabilities;	// outputs p(o_k|x) of the different binary classifiers given the sample x
 		double maxAPrioriProbability = -1.0;
 		std::string maxAPrioriLabel = "";
-		for (GlobalClassifierMap::iterator ItGlobalClassifierMap=mData.mGlobalClassifierMap.begin(); ItGlobalClassifierMap!=mData.mGlobalClassifierMap.end(); ItGlobalClassifierMap++)
+		GlobalClassifierTable classifierTable;
+		classifierTable.Build(mData.mGlobalClassifierMap);
+		CvMat* classifierResponses = NULL;
+		if (PredictGlobalBatch(pClassifierTypeGlobal, classifierTable, *featureVector, &classifierResponses) != ipa_utils::RET_OK)
+		{
+			std::cout << "ObjectClassifier::CategorizeObject: Error: Prediction of the global classifiers failed." << std::endl;
+			if (classifierResponses != NULL) cvReleaseMat(&classifierResponses);
+			cvReleaseMat(featureVector);
+			return ipa_utils::RET_FAILED;
+		}
+		for (int c=0; c<classifierTable.Size(); c++)
 		{
-			double prediction = 0.0, th = mData.mGlobalClassifierThresholdMap[ItGlobalClassifierMap->first];
-			PredictGlobal(pClassifierTypeGlobal, ItGlobalClassifierMap->first, *featureVector, prediction);
+			const std::string& className = classifierTable.classNames[c];
+			ClassifierThresholdMap::const_iterator itThreshold = mData.mGlobalClassifierThresholdMap.find(className);
+			double prediction = cvmGet(classifierResponses, 0, c), th = (itThreshold != mData.mGlobalClassifierThresholdMap.end()) ? itThreshold->second : 0.0;
 			double mappedPrediction = 0;
 			if (prediction>=th) mappedPrediction = 2*(prediction-th)/(1.0-th);
 			else mappedPrediction = 2*(prediction-th)/th;
-			classProbabilities[ItGlobalClassifierMap->first] = exp(mappedPrediction)/(exp(mappedPrediction)+exp(-mappedPrediction));
+			classProbabilities[className] = exp(mappedPrediction)/(exp(mappedPrediction)+exp(-mappedPrediction));
 						
-			if (classProbabilities[ItGlobalClassifierMap->first] > maxAPrioriProbability)
+			if (classProbabilities[className] > maxAPrioriProbability)
 			{
-				maxAPrioriProbability = classProbabilities[ItGlobalClassifierMap->first];
-				maxAPrioriLabel = ItGlobalClassifierMap->first;
+				maxAPrioriProbability = classProbabilities[className];
+				maxAPrioriLabel = className;
 			}
-			//std::cout << "a priori: " << ItGlobalClassifierMap->first << "\t" << classProbabilities[ItGlobalClassifierMap->first] << std::endl;
+			//std::cout << "a priori: " << className << "\t" << classProbabilities[className] << std::endl;
 		}
+		cvReleaseMat(&classifierResponses);
 		// max a posteriori label
 		std::map<std::string, double> p_ci_x;	// probability distribution for the actual object class given measurement x
 		std::map<std::string, double>::iterator ItGroundTruthClass, ItOutputClass;
@@ -4618,7 +4814,7 @@ int ObjectClassifier::CategorizeObject(SharedImage* pSourceImage, std::map<std::
 			for (ItOutputClass = classProbabilities.begin(); ItOutputClass != classProbabilities.end(); ItOutputClass++)
 			{
 				std::string outputLabel = ItOutputClass->first;
-				p_ci_x[groundTruthLabel] += mData.mGlobalClassifierAccuracy[outputLabel][groundTruthLabel]/(p_ok[outputLabel]*classProbabilities.size()) * classProbabilities[outputLabel];
+				p_ci_x[groundTruthLabel] += ClassifierAccuracyEntry(mData.mGlobalClassifierAccuracy, outputLabel, groundTruthLabel)/(p_ok[outputLabel]*classProbabilities.size()) * classProbabilities[outputLabel];
 			}
 			p_ci_x_sum += p_ci_x[groundTruthLabel];
 		}
@@ -5375,7 +5571,6 @@ int ObjectClassifier::ExtractLocalRSDorFPFHFeatures(SharedImage* pSourceImage, B
 }
 
 
-struct Point2Dbl{double s; double z; Point2Dbl(double ps, double pz){s=ps; z=pz;}; };
 int ObjectClassifier::ExtractGlobalFeatures(BlobListRiB* pBlobFeatures, CvMat** pGlobalFeatures, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, Database pDatabase, const IplImage* pCoordinateImage,
 											IplImage* pMask, IplImage* pOutputImage, bool pFileOutput, std::string pTimingLogFileName, std::ofstream* pScreenLogFile)
 {
@@ -5410,1380 +5605,525 @@ int ObjectClassifier::ExtractGlobalFeatures(BlobListRiB* pBlobFeatures, CvMat**
 		}
 	case CLUSTER_EM:
 		{
-			/// Feature number control variables, features are not extracted if 0.
-			const std::vector<int> polynomOrder = pGlobalFeatureParams.polynomOrder;	//2;
-			const std::vector<int> numberLinesX = pGlobalFeatureParams.numberLinesX;	//6;		// number lines parallel to the x-axis
-			const std::vector<int> numberLinesY = pGlobalFeatureParams.numberLinesY;	//6;		// number lines parallel to the y-axis
-			const int pointDataExcess =	pGlobalFeatureParams.pointDataExcess;	//int(3.01*(polynomOrder+1));	// polynomial fitting will not happen with less than PolynomOrder+1+pointDataExcess points
-			//const int Rotations = 6;		// old terminology, means that 6 curves are fitted
-			const int NumberFramesStatisticsFeatures = 6;		// 6 bin histogram for statistics about frame alignment of the feature points with respect to the largest PCA eigenvector
-			const unsigned int minNumber3DPixels = pGlobalFeatureParams.minNumber3DPixels;	//50;
-
-			std::map<std::string, bool> useFeature;
-			if (pGlobalFeatureParams.useFeature.find("bow") != pGlobalFeatureParams.useFeature.end())
-				useFeature["bow"] =	pGlobalFeatureParams.useFeature["bow"];	//false;
-			else
-			{
-				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['bow'] not set." << std::endl;
-				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['bow'] not set." << std::endl;
-				return ipa_utils::RET_FAILED;
-			}
-			if (pGlobalFeatureParams.useFeature.find("sap") != pGlobalFeatureParams.useFeature.end())
-				useFeature["sap"] =	pGlobalFeatureParams.useFeature["sap"];	//true;
-			else
-			{
-				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['sap'] not set." << std::endl;
-				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['sap'] not set." << std::endl;
-				return ipa_utils::RET_FAILED;
-			}
-			if (pGlobalFeatureParams.useFeature.find("sap2") != pGlobalFeatureParams.useFeature.end())
-				useFeature["sap2"] = pGlobalFeatureParams.useFeature["sap2"];	//true;
-			else
-			{
-				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['sap2'] not set." << std::endl;
-				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['sap2'] not set." << std::endl;
-				return ipa_utils::RET_FAILED;
-			}
-			if (pGlobalFeatureParams.useFeature.find("pointdistribution") != pGlobalFeatureParams.useFeature.end())
-				useFeature["pointdistribution"] =	pGlobalFeatureParams.useFeature["pointdistribution"];	//true;
-			else
-			{
-				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['pointdistribution'] not set." << std::endl;
-				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['pointdistribution'] not set." << std::endl;
-				return ipa_utils::RET_FAILED;
-			}
-			if (pGlobalFeatureParams.useFeature.find("normalstatistics") != pGlobalFeatureParams.useFeature.end())
-				useFeature["normalstatistics"] = pGlobalFeatureParams.useFeature["normalstatistics"];	//false;
-			else
-			{
-				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['normalstatistics'] not set." << std::endl;
-				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['normalstatistics'] not set." << std::endl;
-				return ipa_utils::RET_FAILED;
-			}
-			if (pGlobalFeatureParams.useFeature.find("vfh") != pGlobalFeatureParams.useFeature.end())
-				useFeature["vfh"] =	pGlobalFeatureParams.useFeature["vfh"];	//true;
-			else
-			{
-				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['vfh'] not set." << std::endl;
-				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['vfh'] not set." << std::endl;
-				return ipa_utils::RET_FAILED;
-			}
-			if (pGlobalFeatureParams.useFeature.find("grsd") != pGlobalFeatureParams.useFeature.end())
-				useFeature["grsd"] =	pGlobalFeatureParams.useFeature["grsd"];	//true;
-			else
-			{
-				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['grsd'] not set." << std::endl;
-				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['grsd'] not set." << std::endl;
-				return ipa_utils::RET_FAILED;
-			}
-			if (pGlobalFeatureParams.useFeature.find("gfpfh") != pGlobalFeatureParams.useFeature.end())
-				useFeature["gfpfh"] = pGlobalFeatureParams.useFeature["gfpfh"];	//true;
-			else
+			// resolve the enabled descriptor families once, the passes only iterate over the selected plugins
+			GlobalDescriptorRegistry& registry = GlobalDescriptorRegistry::Instance();
+			std::vector<const GlobalDescriptorPlugin*> plugins;
+			std::vector<int> pluginOffsets;
+			int descriptorSize = 0;
+			for (unsigned int f=0; f<registry.Names().size(); f++)
 			{
-				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['gfpfh'] not set." << std::endl;
-				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['gfpfh'] not set." << std::endl;
-				return ipa_utils::RET_FAILED;
+				const std::string& family = registry.Names()[f];
+				std::map<std::string, bool>::const_iterator itUseFeature = pGlobalFeatureParams.useFeature.find(family);
+				if (itUseFeature == pGlobalFeatureParams.useFeature.end())
+				{
+					std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['" << family << "'] not set." << std::endl;
+					if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: Parameter useFeature['" << family << "'] not set." << std::endl;
+					return ipa_utils::RET_FAILED;
+				}
+				if (itUseFeature->second == false)
+					continue;
+				const GlobalDescriptorPlugin* plugin = registry.Get(family);
+				plugins.push_back(plugin);
+				pluginOffsets.push_back(descriptorSize);
+				descriptorSize += plugin->Size(pGlobalFeatureParams, mData.mLocalFeatureClusterer);
 			}
-			if (pGlobalFeatureParams.useFeature["grsd"] == true && pGlobalFeatureParams.useFeature["gfpfh"] == true)
+			// the parameters are shared by concurrent calls, so the map is only read with find()
+			std::map<std::string, bool>::const_iterator itUseGrsd = pGlobalFeatureParams.useFeature.find("grsd");
+			std::map<std::string, bool>::const_iterator itUseGfpfh = pGlobalFeatureParams.useFeature.find("gfpfh");
+			if (itUseGrsd != pGlobalFeatureParams.useFeature.end() && itUseGrsd->second == true &&
+				itUseGfpfh != pGlobalFeatureParams.useFeature.end() && itUseGfpfh->second == true)
 			{
 				std::cout << "Error: ObjectClassifier::ExtractGlobalFeatures: useFeature['grsd'] and useFeature['gfpfh'] cannot be used together." << std::endl;
 				if (pScreenLogFile) *pScreenLogFile << "Error: ObjectClassifier::ExtractGlobalFeatures: useFeature['grsd'] and useFeature['gfpfh'] cannot be used together." << std::endl;
 				return ipa_utils::RET_FAILED;
 			}
 
-			bool useFullPCAPoseNormalization = pGlobalFeatureParams.useFullPCAPoseNormalization;	// true;
-			bool useRollPoseNormalization = pGlobalFeatureParams.useRollPoseNormalization;	// true;
-
-			int descriptorSize = 0;
-#if (CV_MAJOR_VERSION<=2 && CV_MINOR_VERSION<=3)
-			if (useFeature["bow"]) descriptorSize += mData.mLocalFeatureClusterer->get_nclusters();
-#else
-			if (useFeature["bow"]) descriptorSize += mData.mLocalFeatureClusterer->get<int>("nclusters");
-#endif
-			if (useFeature["sap"]) descriptorSize += 3+(numberLinesX[0]+numberLinesY[0])*(polynomOrder[0]+1);
-			if (useFeature["sap2"]) descriptorSize += (numberLinesX[1]+numberLinesY[1])*(polynomOrder[1]+1);
-			if (useFeature["pointdistribution"]) descriptorSize += pGlobalFeatureParams.cellCount[0] * pGlobalFeatureParams.cellCount[1];
-			if (useFeature["normalstatistics"]) descriptorSize += NumberFramesStatisticsFeatures;
-			if (useFeature["vfh"]) descriptorSize += 308;
-			if (useFeature["grsd"]) descriptorSize += 16;
-			if (useFeature["gfpfh"]) descriptorSize += 16;
-			
-			*pGlobalFeatures = cvCreateMat(1, descriptorSize, CV_32FC1);
-			cvSetZero(*pGlobalFeatures);
-			int GlobalFeatureVectorPosition = 0;		// data is inserted into pGlobalFeatures at this position
-			
-			// if required, the object is tilted by a given angle and a second descriptor is computed
+			// if required, the object is tilted by a given angle and a further descriptor (row) is computed
 			int numberOfTiltAngles = 1 + pGlobalFeatureParams.additionalArtificialTiltedViewAngle.size();
-			std::vector< std::vector<float> > descriptorBuffer(numberOfTiltAngles);
+			*pGlobalFeatures = cvCreateMat(numberOfTiltAngles, descriptorSize, CV_32FC1);
+			cvSetZero(*pGlobalFeatures);
+
 			for (int descriptorComputationPass = 0; descriptorComputationPass < numberOfTiltAngles; descriptorComputationPass++)
 			{
-				GlobalFeatureVectorPosition = 0;
-
-				IplImage* mask = cvCloneImage(pMask);
+				Timer tim;
+				tim.start();
 
-				CvMat* BlobFPCoordinates = 0;
-				if (pBlobFeatures->size() > 0)
-					BlobFPCoordinates = cvCreateMat(pBlobFeatures->size(), 3, CV_32FC1);
-			
-				// make histogram
-				//----------------
-				if (useFeature["bow"])
+				// intermediate results (3d points, PCA, normalized points, voxelized cloud, normals, ...) are shared by all descriptors of this pass
+				GlobalDescriptorContext context(pBlobFeatures, pGlobalFeatureParams, pDatabase, mData.mLocalFeatureClusterer, pFileOutput, pScreenLogFile);
+				if (context.Prepare(pCoordinateImage, pMask, descriptorComputationPass) != ipa_utils::RET_OK)
 				{
-					BlobListRiB::iterator ItBlobFeatures;
-					int FeatureCounter = 0;
-					for (ItBlobFeatures = pBlobFeatures->begin(); ItBlobFeatures != pBlobFeatures->end(); ItBlobFeatures++, FeatureCounter++)
-					{
-						CvMat* LocalFeatureVector = cvCreateMat(1, ItBlobFeatures->m_D.size(), CV_32FC1);
-						for (unsigned int j=0; j<ItBlobFeatures->m_D.size(); j++) cvSetReal1D(LocalFeatureVector, j, ItBlobFeatures->m_D[j]);
-#if (CV_MAJOR_VERSION<=2 && CV_MINOR_VERSION<=3)
-						int Bin = cvRound(mData.mLocalFeatureClusterer->predict((const CvMat*)LocalFeatureVector, NULL));		// speedup: replace round by (int)
-#else
-						cv::Mat localFeatureVectorMat(LocalFeatureVector);
-						int Bin = cvRound((mData.mLocalFeatureClusterer->predict(localFeatureVectorMat))[1]);		// speedup: replace round by (int)
-#endif
-						//std::cout << Bin << "\n";
-						cvSetReal1D(*pGlobalFeatures, Bin, cvGetReal1D(*pGlobalFeatures, Bin)+1.0);
-						cvReleaseMat(&LocalFeatureVector);
-
-						// make coordinate list (if 3D data available)
-						if (ItBlobFeatures->m_Frame.size() == 6)
-						{
-							ipa_utils::Point3Dbl Point;
-							ItBlobFeatures->m_Frame.GetT(Point);
-							cvmSet(BlobFPCoordinates, FeatureCounter, 0, Point.m_x);
-							cvmSet(BlobFPCoordinates, FeatureCounter, 1, Point.m_y);
-							cvmSet(BlobFPCoordinates, FeatureCounter, 2, Point.m_z);
-						}
-					}
-					if (NumberSamples > 0)
-						cvConvertScale(*pGlobalFeatures, *pGlobalFeatures, 1/(double)NumberSamples, 0);
-#if (CV_MAJOR_VERSION<=2 && CV_MINOR_VERSION<=3)
-					GlobalFeatureVectorPosition += mData.mLocalFeatureClusterer->get_nclusters();		// data is inserted into pGlobalFeatures at this position
-#else
-					GlobalFeatureVectorPosition += mData.mLocalFeatureClusterer->get<int>("nclusters");		// data is inserted into pGlobalFeatures at this position
-#endif
+					cvReleaseMat(pGlobalFeatures);
+					return ipa_utils::RET_FAILED;
 				}
 
-				/*std::cout << "pGlobalFeatures:\n";
-				for (int i=0; i<(*pGlobalFeatures)->height; i++)
-				{
-					for(int j=0; j<(*pGlobalFeatures)->width; j++) std::cout << cvGetReal2D(*pGlobalFeatures, i, j) << "\t";
-					std::cout << "\n";
-				}*/
-			
-				std::ofstream timeFout;
-				if (pTimingLogFileName.compare("") != 0)
-					timeFout.open(pTimingLogFileName.c_str(), std::ios::app);
-				unsigned int numberOfPoints = 0;
-				Timer tim, tim1;
-				double elapsedTime = 0.0;
-				double elapsedTime1[10];
-
-				tim.start();
-				tim1.start();
+				float* descriptor = (float*)((*pGlobalFeatures)->data.ptr + (size_t)(*pGlobalFeatures)->step*descriptorComputationPass);
+				bool hasPointData = context.HasPointData();
+				for (unsigned int p=0; p<plugins.size(); p++)
+					if (plugins[p]->RequiresPointData() == false || hasPointData == true)
+						plugins[p]->Compute(context, descriptor + pluginOffsets[p]);
 
-				/// Further features using 3D data
-				if (pBlobFeatures->size() == 0 || pBlobFeatures->begin()->m_Frame.size() == 6)
+				if (hasPointData == false)
 				{
-					//CvPoint ObjectCenter2D = cvPoint(0,0);
-					CvPoint3D32f ObjectCenter3D = cvPoint3D32f(0.f, 0.f, 0.f);
-
-					/// Perform PCA
-					CvMat* Coordinates = NULL;			// Matrix of 3D coordinates of points used for the PCA
-					pcl::PointCloud<pcl::PointXYZ>::Ptr pclPoints (new pcl::PointCloud<pcl::PointXYZ>);
-					IplImage* CoordinateImage = NULL;
-
-					if ((pCoordinateImage!=NULL) && (mask!=NULL))
-					{	// PCA using all points inside mask
-						if ((pCoordinateImage->width != mask->width) || (pCoordinateImage->height != mask->height))
-						{
-							std::cout << "ObjectClassifier::ExtractGlobalFeatures: pCoordinateImage and pMask do not have the same size." << std::endl;
-							if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: pCoordinateImage and pMask do not have the same size." << std::endl;
-							return ipa_utils::RET_FAILED;
-						}
-
-						//cvNamedWindow("mask before");
-						//cvShowImage("mask before", mask);
-						//cvWaitKey(10);
-						//IplConvKernel* kernel = cvCreateStructuringElementEx(1,3,0,1, CV_SHAPE_RECT);
-						if (pDatabase == CIN)
-							cvErode((IplImage*)mask, (IplImage*)mask, 0, 8);	// necessary to avoid false depth pixels at object borders
-						//cvErode((IplImage*)mask, (IplImage*)mask, 0, 3);	// necessary to avoid false depth pixels at object borders
-						//cvErode((IplImage*)mask, (IplImage*)mask, kernel, 10);
-						//cvReleaseStructuringElement(&kernel);
-
-						//cvNamedWindow("mask after");
-						//cvShowImage("mask after", mask);
-						//cvWaitKey();
-						//cvDestroyAllWindows();
-
-
-						CoordinateImage = cvCloneImage(pCoordinateImage); //cvCreateImageHeader(cvGetSize(pCoordinateImage), pCoordinateImage->depth, pCoordinateImage->nChannels);
-						cvSmooth(CoordinateImage, CoordinateImage, CV_GAUSSIAN, 5);
-
-
-						////////////////////////////////////////
-						// tilt point cloud if in second pass
-						if (descriptorComputationPass >= 1 && pGlobalFeatureParams.additionalArtificialTiltedViewAngle[descriptorComputationPass-1]!=0)
-						{
-							double tiltAngle = (double)pGlobalFeatureParams.additionalArtificialTiltedViewAngle[descriptorComputationPass-1] / 180. * M_PI;
-
-							// compute 3d center
-							double cx=0., cy=0., cz=0.;
-							int numberPoints = 0;
-							for (int v=0; v<mask->height; v++)
-							{
-								for (int u=0; u<mask->width; u++)
-								{
-									if (cvGetReal2D(mask, v, u) != 0)
-									{
-										CvScalar point = cvGet2D(CoordinateImage, v, u);
-										cx += point.val[0];
-										cy += point.val[1];
-										cz += point.val[2];
-										numberPoints++;
-									}
-								}
-							}
-							cx /= (double)numberPoints;
-							cy /= (double)numberPoints;
-							cz /= (double)numberPoints;
-
-							double cosTilt = cos(tiltAngle);
-							double sinTilt = sin(tiltAngle);
-
-							// rotate point cloud by tiltAngle around its centroid
-							for (int v=0; v<mask->height; v++)
-							{
-								// only keep cos(alpha) % of the lines, i.e. set the remainder of the data (and mask!) to zero
-								bool keepThisLine = (rand() <= cosTilt*RAND_MAX);
-								if (keepThisLine == false)
-									for (int u=0; u<mask->width; u++) cvSetReal2D(mask, v, u, 0);
-								else
-								{
-									for (int u=0; u<mask->width; u++)
-									{
-										if (cvGetReal2D(mask, v, u) != 0)
-										{
-											CvScalar point = cvGet2D(CoordinateImage, v, u);
-											//point.val[0] -= cx;	does not rotate
-											point.val[1] -= cy;
-											point.val[2] -= cz;
-
-											double y = cosTilt * point.val[1] - sinTilt * point.val[2];
-											double z = sinTilt * point.val[1] + cosTilt * point.val[2];
-
-											//point.val[0] += cx;
-											point.val[1] = y + cy;
-											point.val[2] = z + cz;
-											cvSet2D(CoordinateImage, v, u, point);
-										}
-									}	
-								}
-							}
-						}
-
-
-						elapsedTime1[0] = tim1.getElapsedTimeInMicroSec();
-						tim1.start();
-
-						//////////////////////// START: new, 2d rotation
-						if (useRollPoseNormalization == true)
-						{
-							// rotate 3d coordinates by rotating around z-axis so that mask image has a normalized orientation
-							double cx=0, cy=0;
-							unsigned int numberPoints = 0;
-							std::vector<cv::Point2f> maskPointList;
-							CvMat mask_buffer;
-							CvMat* mask_mat = cvGetMat(mask, &mask_buffer);
-							int type = CV_MAT_TYPE(mask_mat->type);
-							assert(type == CV_8UC1);
-							for (int y=0; y<mask->height; y++)
-							{
-								for (int x=0; x<mask->width; x++)
-								{
-									if (((uchar*)(mask_mat->data.ptr + (size_t)mask_mat->step*y))[x] != 0)  //cvmGet((CvMat*)mask, y, x) != 0)
-									{
-										maskPointList.push_back(cv::Point2i(x, y));
-										CvScalar point = cvGet2D(CoordinateImage, y, x);
-										cx += point.val[0];
-										cy += point.val[1];
-										numberPoints++;
-									}
-								}
-							}
-							cx /= (double)numberPoints;
-							cy /= (double)numberPoints;
-
-							elapsedTime1[1] = tim1.getElapsedTimeInMicroSec();
-							tim1.start();
-
-							if (maskPointList.size() > minNumber3DPixels)
-							{
-								cv::Mat maskPointMat(maskPointList.size(), 2, CV_32FC1);
-								for (int i=0; i<(int)maskPointList.size(); i++)
-								{
-									maskPointMat.at<float>(i, 0) = maskPointList[i].x;
-									maskPointMat.at<float>(i, 1) = maskPointList[i].y;
-								}
-
-								elapsedTime1[2] = tim1.getElapsedTimeInMicroSec();
-								tim1.start();
-
-								// find prominent direction in 2d image
-								cv::PCA pca(maskPointMat, cv::noArray(), CV_PCA_DATA_AS_ROW);
-								// find repeatable direction (e.g. side of the centroid with more points is always positive)
-								int positiveDirection = 0, negativeDirection = 0;
-								// is eigenvector of type float? yes, CV_32F
-								// std::cout << "eigenvectors: " << pca.eigenvectors.depth() << "   mean: " << pca.mean.depth() << "   eigenvalues: " << pca.eigenvalues.depth() << std::endl;
-								float e11 = pca.eigenvectors.at<float>(0, 0);
-								float e12 = pca.eigenvectors.at<float>(0, 1);
-								float m1 = pca.mean.at<float>(0, 0);
-								float m2 = pca.mean.at<float>(0, 1);
-
-								elapsedTime1[3] = tim1.getElapsedTimeInMicroSec();
-								tim1.start();
-
-								for (int i=0; i<(int)maskPointList.size(); i++)
-								{
-								//for (int y=0; y<mask->height; y++)		// todo: use maskPointList
-								//{
-								//	for (int x=0; x<mask->width; x++)
-								//	{
-										//if (cvGetReal2D(mask, y, x) != 0)
-										//{
-									float x = maskPointList[i].x;
-									float y = maskPointList[i].y;
-									if ((((float)x-m1)*e11 + ((float)y-m2)*e12) >= 0.f)
-										positiveDirection++;
-									else
-										negativeDirection++;
-//										}
-//									}
-								}
-								if (positiveDirection < negativeDirection)
-								{
-									e11 *= -1;
-									e12 *= -1;
-									std::cout << "Have to turn 2d direction\n";
-									if (pScreenLogFile) *pScreenLogFile << "Have to turn 2d direction\n";
-								}
-
-								elapsedTime1[4] = tim1.getElapsedTimeInMicroSec();
-								tim1.start();
-
-								// compute rotation around z-axis, i.e. the angle between old x-axis (1, 0, 0) and new x-axis (e11, e12, 0)
-								double cosAlpha = e11/sqrt(e11*e11+e12*e12);
-								double sinAlpha = sin(acos(cosAlpha));
-
-								std::cout << "alpha=" << acos(cosAlpha)/M_PI * 180 << "\n";
-								if (pScreenLogFile) *pScreenLogFile << "alpha=" << acos(cosAlpha)/M_PI * 180 << "\n";
-
-								// rotate 3d coordinates around z-axis by alpha
-								for (int i=0; i<(int)maskPointList.size(); i++)
-								{
-								//for (int v=0; v<mask->height; v++)		// todo: use maskPointList
-								//{
-								//	for (int u=0; u<mask->width; u++)
-								//	{
-								//		if (cvGetReal2D(mask, v, u) != 0)
-								//		{
-									int u = maskPointList[i].x;
-									int v = maskPointList[i].y;
-									CvScalar point = cvGet2D(CoordinateImage, v, u);
-									double x = point.val[0] - cx;
-									double y = point.val[1] - cy;
-									point.val[0] = cosAlpha * x - sinAlpha * y + cx;
-									point.val[1] = sinAlpha * x + cosAlpha * y + cy;
-									cvSet2D(CoordinateImage, v, u, point);
-									//	}
-									//}
-								}
-
-								elapsedTime1[5] = tim1.getElapsedTimeInMicroSec();
-								tim1.start();
-							}
-							else
-							{
-								std::cout << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3D points available for roll pose normalization." << std::endl;
-								if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3D points available for roll pose normalization." << std::endl;
-							}
-						}
-						//////////////////////// END: new, 2d rotation
-
-						std::vector<CvScalar> CoordinateList;
-						// get 3D coordinates of points inside mask and calculate object center (center of mass of mask)
-						double Cu=0;
-						double Cv=0;
-						int MaskPoints=0;
-						CvMat mask_buffer;
-						CvMat* mask_mat = cvGetMat(mask, &mask_buffer);
-						int type = CV_MAT_TYPE(mask_mat->type);
-						assert(type == CV_8UC1);
-						for (int i=0; i<mask->height; i++)
-						{
-							for (int j=0; j<mask->width; j++)
-							{
-								if (((uchar*)(mask_mat->data.ptr + (size_t)mask_mat->step*i))[j] != 0)  //(cvGetReal2D(mask, i, j) != 0)
-								{
-									Cu += j;
-									Cv += i;
-									MaskPoints++;
-									if (pGlobalFeatureParams.thinningFactor >= 1.0)
-										CoordinateList.push_back(cvGet2D(CoordinateImage, i, j));
-									else
-									{
-										if ((descriptorComputationPass == 0) || rand() < pGlobalFeatureParams.thinningFactor * RAND_MAX)		// thinning of data to emulate scale change
-											CoordinateList.push_back(cvGet2D(CoordinateImage, i, j));
-									}
-								}
-							}
-						}
-						//ObjectCenter2D.x = cvRound(Cu/(double)MaskPoints);
-						//ObjectCenter2D.y = cvRound(Cv/(double)MaskPoints);
-					
-						// can only process data if at least some 3d data of the object is available
-						if (CoordinateList.size() > minNumber3DPixels)
-						{
-							Coordinates = cvCreateMat(CoordinateList.size(), 3, CV_32FC1);
-							for (int i=0; i<(int)CoordinateList.size(); i++)
-								for (int j=0; j<Coordinates->width; j++)
-									cvmSet(Coordinates, i, j, CoordinateList[i].val[j]);
-
-							if (useFeature["vfh"] == true || useFeature["grsd"] == true || useFeature["gfpfh"] == true)
-							{
-								for (int i=0; i<(int)CoordinateList.size(); i++)
-								{
-									pcl::PointXYZ point;
-									point.x = CoordinateList[i].val[0];
-									point.y = CoordinateList[i].val[1];
-									point.z = CoordinateList[i].val[2];
-									pclPoints->push_back(point);
-								}
-							}
-						}
-						else
-						{	// PCA using feature points only
-							Coordinates = BlobFPCoordinates;
-							std::cout << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3D points available, switching to BlobFPCoordinates." << std::endl;
-							if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3D points available, switching to BlobFPCoordinates." << std::endl;
-						}
-					}
-					else
-					{	// PCA using feature points only
-						Coordinates = BlobFPCoordinates;
-						std::cout << "ObjectClassifier::ExtractGlobalFeatures: No 3D points available, switching to BlobFPCoordinates." << std::endl;
-						if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: No 3D points available, switching to BlobFPCoordinates." << std::endl;
-					}
-
-					// stop data processing if too few 3d data of the object is available
-					if (Coordinates == 0 || Coordinates->rows <= (int)minNumber3DPixels)
-					{
-						//for (int i=mData.mLocalFeatureClusterer->get_nclusters(); i<(*pGlobalFeatures)->cols; i++) cvSetReal1D(*pGlobalFeatures, i, 0.0);
-						// already done with setZero()
-						//timeFout << "0\t";
-						numberOfPoints = 0;
-						std::cout << "Not enough 3d points available. Skipping." << std::endl;
-						if (pScreenLogFile) *pScreenLogFile << "Not enough 3d points available. Skipping." << std::endl;
-					}
-					else
-					{
-						numberOfPoints = Coordinates->rows;
-						//timeFout << Coordinates->rows << "\t";
-
-						// PCA
-						CvMat* Avgs = NULL;
-						CvMat* Eigenvalues = NULL;
-						//cv::Mat* Eigenvalues = new cv::Mat(1, 3, CV_32FC1);
-						CvMat* Eigenvectors = NULL;			// Eigenvectors are stored one in each row -> cvGetReal2D(Eigenvectors, Eigenvector_index, Component_index)
-															// and are normalized to L_2 norm of each eigenvector is 1
-
-						if (Coordinates->height > 2)
-						{
-							Avgs = cvCreateMat(1, 3, CV_32FC1);
-							Eigenvalues = cvCreateMat(1, 3, CV_32FC1);
-							Eigenvectors = cvCreateMat(3, 3, CV_32FC1);
-
-							cvCalcPCA(Coordinates, Avgs, Eigenvalues, Eigenvectors, CV_PCA_DATA_AS_ROW);
-
-							// test: are the PCA eigenvectors orthogonal?
-							//double tempval = 0.0;
-							//for (int i=0; i<3; i++) tempval += cvGetReal2D(Eigenvectors, 0, i)*cvGetReal2D(Eigenvectors, 1, i);
-							//std::cout << "PCA: EV1*EV2 = " << tempval << "\n";
-							//tempval=0.0;
-							//for (int i=0; i<3; i++) tempval += cvGetReal2D(Eigenvectors, 0, i)*cvGetReal2D(Eigenvectors, 2, i);
-							//std::cout << "PCA: EV1*EV3 = " << tempval << "\n";
-							//tempval=0.0;
-							//for (int i=0; i<3; i++) tempval += cvGetReal2D(Eigenvectors, 1, i)*cvGetReal2D(Eigenvectors, 2, i);
-							//std::cout << "PCA: EV2*EV3 = " << tempval << "\n";
-
-							//std::cout << "Coordinates:\n";
-							//std::ofstream fout("common/files/coordinates.txt");
-							//for (int i=0; i<Coordinates->height; i++)
-							//{
-							//	for(int j=0; j<Coordinates->width; j++) fout << cvGetReal2D(Coordinates, i, j) << " \t";
-							//	fout << "\n";
-							//}
-							//fout.close();
-
-							//std::cout << "Avgs:\n";
-							//for (int i=0; i<3; i++)
-							//{
-							//	std::cout << cvGetReal1D(Avgs, i) << "\n";
-							//}
-							//std::cout << "Eigenvectors:\n";
-							//for (int i=0; i<3; i++)
-							//{
-							//	double sum = 0.0;
-							//	for(int j=0; j<3; j++)
-							//	{
-							//		double a = cvGetReal2D(Eigenvectors, i, j);
-							//		sum += a*a;
-							//		std::cout << a << "\t";
-							//	}
-							//	std::cout << "\t" << sum << "\n";
-							//}
-							//std::cout << "Eigenvalues:\n";
-							//for (int i=0; i<3; i++)
-							//{
-							//	std::cout << cvGetReal1D(Eigenvalues, i) << "\n";
-							//}
-
-							/// save all 3 PCA Eigenvalues as they are
-							//for (int s=0; s<3; s++, GlobalFeatureVectorPosition++) cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, cvGetReal1D(Eigenvalues, s)/10000.0);
-
-							// save largest PCA Eigenvalue as it is and the both others relative to it
-							if (useFeature["sap"])
-							{
-								if (pDatabase == CIN)
-									cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, cvGetReal1D(Eigenvalues, 0)/10000.0);	// CIN database measures 3d coordinates in mm
-								else
-									cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, cvGetReal1D(Eigenvalues, 0));	// for 3d coordinates measured in m
-								GlobalFeatureVectorPosition++;
-								for(int s=1; s<3; s++, GlobalFeatureVectorPosition++) cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, cvGetReal1D(Eigenvalues, s)/cvGetReal1D(Eigenvalues, 0));
-							}
-	
-							/// copy 3d data central point
-							ObjectCenter3D.x = (float)cvGetReal1D(Avgs, 0);
-							ObjectCenter3D.y = (float)cvGetReal1D(Avgs, 1);
-							ObjectCenter3D.z = (float)cvGetReal1D(Avgs, 2);
-						}
-
-						elapsedTime1[6] = tim1.getElapsedTimeInMicroSec();
-						tim1.start();
-
-						if (useFullPCAPoseNormalization == false)
-							elapsedTime += tim.getElapsedTimeInMicroSec();
-
-
-						//std::cout << "pGlobalFeatures:\n";
-						//for (int i=0; i<(*pGlobalFeatures)->height; i++)
-						//{
-						//	for(int j=0; j<(*pGlobalFeatures)->width; j++) std::cout << cvGetReal2D(*pGlobalFeatures, i, j) << "\t";
-						//	std::cout << "\n";
-						//}
-
-						cvReleaseImage(&CoordinateImage);
-						cvReleaseMat(&Avgs);
-
-
-						// polynomial fitting
-						if ((useFeature["sap"] || useFeature["pointdistribution"]) && Eigenvectors != NULL && mask != NULL)
-						{
-							// align coordinate system
-							if (useFullPCAPoseNormalization == true)
-							{
-								// check if eigenvalues form a right hand system ((XxY)*Z > 0)
-								std::vector<double> tempVec;
-								tempVec.resize(3);
-								tempVec[0] = (cvmGet(Eigenvectors, 0, 1)*cvmGet(Eigenvectors, 1, 2)-cvmGet(Eigenvectors, 0, 2)*cvmGet(Eigenvectors, 1, 1));
-								tempVec[1] = (cvmGet(Eigenvectors, 0, 2)*cvmGet(Eigenvectors, 1, 0)-cvmGet(Eigenvectors, 0, 0)*cvmGet(Eigenvectors, 1, 2));
-								tempVec[2] = (cvmGet(Eigenvectors, 0, 0)*cvmGet(Eigenvectors, 1, 1)-cvmGet(Eigenvectors, 0, 1)*cvmGet(Eigenvectors, 1, 0));
-								if (tempVec[0]*cvmGet(Eigenvectors, 2, 0) + tempVec[1]*cvmGet(Eigenvectors, 2, 1) + tempVec[2]*cvmGet(Eigenvectors, 2, 2) < 0)
-								{
-									// left hand system --> invert z-axis
-									std::cout << "Left hand system. Have to turn z." << std::endl;
-									if (pScreenLogFile) *pScreenLogFile << "Left hand system. Have to turn z." << std::endl;
-									for (int j=0; j<3; j++)
-										cvmSet(Eigenvectors, 2, j, -cvmGet(Eigenvectors, 2, j));
-								}
-
-
-								// keep the direction of the eigenvectors repeatable
-								// 1. rule: the new z'-axis must point towards the camera, which is z*z' < 0 or z'_3 < 0 since z = (0,0,1)   --> can be done before
-								// 2. rule: positive x'-direction on that side of the x'=0 plane where fewer points are located   --> will be decided after first point coordinate tranformation (50% chance that the outcome is already well-aligned)
-								// 3. rule: choose y' to yield a right-hand system   --> adapted after steps 1 and 2
-
-								if (cvmGet(Eigenvectors, 2, 2) > 0)
-								{
-									// 1. rule not fulfilled
-									// so keep x'-axis coordinates and invert y' and z' to enforce rule 1 and 3
-									for (int i=1; i<3; i++)
-										for (int j=0; j<3; j++)
-											cvmSet(Eigenvectors, i, j, -cvmGet(Eigenvectors, i, j));
-								}
-
-
-								// translate origin to center of mass of the point cloud and
-								// rotate frame so that the eigenvectors are the coordinate axes (1,0,0), (0,1,0) and (0,0,1)
-								// rotation matrix = scalar products of the old base vectors with the new base vectors (see DMS script eq. (1.3))
-								// in this case the Eigenvector matrix is the rotation matrix when the eigenvectors are stored row-wise
-								int pointMajoritySide = 0;	// counts +1 if a transformed point has positive x' coordinates and -1 for negative x' coordinates
-								for (int i=0; i<Coordinates->height; i++)
-								{
-									// translate
-									double x = cvmGet((CvMat*)Coordinates, i, 0) - ObjectCenter3D.x;
-									double y = cvmGet((CvMat*)Coordinates, i, 1) - ObjectCenter3D.y;
-									double z = cvmGet((CvMat*)Coordinates, i, 2) - ObjectCenter3D.z;
-
-									// rotate
-									double coordinateValue = 0.;
-									for (int j=2; j>=0; j--)
-									{
-										coordinateValue = cvmGet(Eigenvectors, j, 0)*x + cvmGet(Eigenvectors, j, 1)*y + cvmGet(Eigenvectors, j, 2)*z;		// todo: speedup possible
-										cvmSet(Coordinates, i, j, coordinateValue);  //cvSetReal2D(Coordinates, i, j, coordinateValue);
-									}
-									pointMajoritySide += (int)sign(coordinateValue);	// checks the x'-coordinate for rule 2
-								}
-
-								if (pointMajoritySide > 0)
-								{
-									std::cout << "Turning x' and y' coordinates necessary (rule 2)." << std::endl;
-									if (pScreenLogFile) *pScreenLogFile << "Turning x' and y' coordinates necessary (rule 2)." << std::endl;
-									// 2. rule not fulfilled -> invert x' and y' coordinates to enforce rule 2 and 3
-									for (int i=0; i<Coordinates->height; i++)
-									{
-										for (int j=0; j<2; j++)
-											cvmSet(Coordinates, i, j, -cvmGet(Coordinates, i, j));
-									}
-
-									// change the coordinate system as well
-									for (int i=0; i<2; i++)
-										for (int j=0; j<3; j++)
-											cvmSet(Eigenvectors, i, j, -cvmGet(Eigenvectors, i, j));
-								}
-							}
-
-							// approximate a polynomial along lines parallel to the x axis and the y axis in the new coordinate system of the principal components
-							double normX, normY;
-							if (useFullPCAPoseNormalization == true)
-							{
-								normX = 1.0/(2.0*sqrt(cvGetReal1D(Eigenvalues, 0))); // normalize the coordinates by the magnitude of the respective eigenvalue to the eigenvector (new coordinate system's axis)
-								normY = 1.0/(2.0*sqrt(cvGetReal1D(Eigenvalues, 1))); // this provides scale invariance
-							}
-
-							// without pose normalization
-							if (useFullPCAPoseNormalization == false)
-							{
-								tim.start();
-								double maxX=0, maxY=0;
-								for (int i=0; i<Coordinates->height; i++)
-								{
-									// translate
-									double x = cvmGet(Coordinates, i, 0) - ObjectCenter3D.x;
-									cvmSet(Coordinates, i, 0, x);
-									double y = cvmGet(Coordinates, i, 1) - ObjectCenter3D.y;
-									cvmSet(Coordinates, i, 1, y);
-									cvmSet(Coordinates, i, 2, cvmGet(Coordinates, i, 2) - ObjectCenter3D.z);
-									if (fabs(x) > maxX)
-										maxX = fabs(x);
-									if (fabs(y) > maxY)
-										maxY = fabs(y);
-								}
-								normX = 1.0/maxX;
-								normY = 1.0/maxY;
-							}
-
-							elapsedTime1[7] = tim1.getElapsedTimeInMicroSec();
-							tim1.start();
-
-							//if (normX > normY) normY = normX;	// this is wrong because it does not scale the largest dimension to 1
-							if (normX < normY) normY = normX;	// scale the largest dimension to 1 and use the same factor for the remaining dimensions
-							else normX = normY;
-							double normZ = normX;	//1.0/(2.0*sqrt(cvGetReal1D(Eigenvalues, 2)));
-							std::vector< std::vector<double> > linesX(numberLinesX.size(), std::vector<double>());	// y coordinates of the polynomials parallel to the x-axis (the outer vector enumerates the sap levels - sap, sap2, ...)
-							std::vector< std::vector<double> > linesY(numberLinesX.size(), std::vector<double>());	// x coordinates of the polynomials parallel to the y-axis (the outer vector enumerates the sap levels - sap, sap2, ...)
-							for (int i=0; i<(int)numberLinesX.size(); i++)
-							{
-								double step = 2.0/(double)(numberLinesX[i]+1.0);
-								for (double y=-1.0+step; y<0.998; y+=step) linesX[i].push_back(y);
-								step = 2.0/(double)(numberLinesY[i]+1.0);
-								for (double x=-1.0+step; x<0.998; x+=step) linesY[i].push_back(x);
-							}
-							std::vector< std::vector< std::vector<Point2Dbl> > > RegressionPointList(numberLinesX.size(), std::vector< std::vector<Point2Dbl> >());	// first index=sap level index (sap, sap2, ...) ; second index=list index (0..numberLinesX-1 -> x lines, numberLinesX..numberLinesY -> y lines), third index=point index
-							for (int i=0; i<(int)RegressionPointList.size(); i++) RegressionPointList[i].resize(numberLinesX[i]+numberLinesY[i], std::vector<Point2Dbl>());	
-							double distanceThreshold = 2.0/sqrt((double)Coordinates->height);	// sampling invariance - should it be dependent on number of curves? maybe not, since it is a sampling parameter
-						
-
-							//// output the point cloud to file
-							//std::cout << "Coordinates transformed:\n";
-							//std::ofstream fout("common/files/coordinatestf.txt");
-							//for (int i=0; i<Coordinates->height; i++)
-							//{
-							//	fout << cvGetReal2D(Coordinates, i, 0)*normX << " \t" << cvGetReal2D(Coordinates, i, 1)*normY << " \t" << cvGetReal2D(Coordinates, i, 2)*normZ << std::endl;
-							//}
-							//fout.close();
-							//std::cout << "press any key\n";
-							//getchar();
-
-							//double cellCount[2] = {3, 3};	// x/y-coordinate limits of intersections of the camera plane into segments in which the point percentages are counted
-							//double cellSize[2] = {0.8, 0.8};
-							std::map< double, std::map<double, int> > pointCount;	// matrix of point counts in the respective cells of the point distribution grid
-
-							// set number of SAP computations at different polynomial degrees
-							int numLevels = 1;
-							for (int i=1; i<(int)numberLinesX.size(); i++)
-							{
-								std::stringstream ss;
-								ss << "sap" << i+1;
-								//if (i>0) ss << i+1;
-								if ((useFeature.find(ss.str()) != useFeature.end()) && (useFeature[ss.str()]==true))
-									numLevels++;
-							}
-
-							// fill point lists for the polynomials
-							for (int p=0; p<Coordinates->height; p++)
-							{
-								// normalize 3d point coordinates
-								double x = cvmGet(Coordinates, p, 0)*normX;
-								double y = cvmGet(Coordinates, p, 1)*normY;
-								double z = cvmGet(Coordinates, p, 2)*normZ;
-							
-								// check whether this point contributes to any line
-	//#if (RUNTIME_TEST_SAP!=1)
-	//							for (int i=0; i<(int)numberLinesX.size(); i++)
-	//							{
-	//								std::stringstream ss;
-	//								ss << "sap";
-	//								if (i>0) ss << i+1;
-	//								if ((useFeature.find(ss.str()) != useFeature.end()) && (useFeature[ss.str()]==true))
-	//								{
-	//#else
-									for (int i=0; i<numLevels; i++)
-									{
-										//int i = 0;
-	//#endif
-										for (int l=0; l<(int)linesX[i].size(); l++)
-											if (fabs(y-linesX[i][l]) < distanceThreshold) RegressionPointList[i][l].push_back(Point2Dbl(x,z));
-										for (int l=0; l<(int)linesY[i].size(); l++)
-											if (fabs(x-linesY[i][l]) < distanceThreshold) RegressionPointList[i][linesX[i].size()+l].push_back(Point2Dbl(y,z));
-									}
-	//#if (RUNTIME_TEST_SAP!=1)
-	//							}
-	//#endif
-							
-							
-	#if (RUNTIME_TEST_SAP!=1)
-								// compute distribution of 3d points in the current camera plane (which is either the original view or normalized to the plane spanned by the two largest eigenvectors of the point cloud)
-								if (useFeature["pointdistribution"] == true)
-								{
-									double cell[2] = {floor(x/pGlobalFeatureParams.cellSize[0] + 0.5)*pGlobalFeatureParams.cellSize[0], floor(y/pGlobalFeatureParams.cellSize[1] + 0.5)*pGlobalFeatureParams.cellSize[1]};
-									if ((pointCount.find(cell[0]) != pointCount.end()) && (pointCount[cell[0]].find(cell[1]) != pointCount[cell[0]].end()))
-										pointCount[cell[0]][cell[1]]++;
-									else
-										pointCount[cell[0]][cell[1]] = 1;
-								}
-	#endif
-							}
-
-							// fit the polynomials into the data
-	//#if (RUNTIME_TEST_SAP!=1)
-	//						for (int level=0; level<(int)RegressionPointList.size(); level++)
-	//						{
-	//							std::stringstream ss;
-	//							ss << "sap";
-	//							if (level > 0) ss << level+1;
-	//							for (int l=0; l<(int)RegressionPointList[level].size() && useFeature.find(ss.str())!=useFeature.end() && useFeature[ss.str()]==true; l++)
-	//							{
-	//#else
-							for (int level=0; level<numLevels; level++)
-							{
-								//int level = 0;
-								for (int l=0; l<(int)RegressionPointList[level].size(); l++)
-								{
-	//#endif
-									// check availability of enough points for polynomial fitting
-									if (RegressionPointList[level][l].size()<=(polynomOrder[level]+1+pointDataExcess))
-									{
-										std::cout << "ObjectClassifier::ExtractGlobalFeatures: Too few points in polynomial " << l << ".\n";
-										if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Too few points in polynomial " << l << ".\n";
-										//save zeros in pGlobalFeatures
-										for (int s=0; s<=polynomOrder[level]; s++, GlobalFeatureVectorPosition++) cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, 0);
-										continue;
-									}
-
-									std::stringstream DataFileName, ParamsFileName;
-									std::ofstream DataFile, ParamsFile;
-									if (pFileOutput)
-									{
-										DataFileName << "GlobalFP_CurveFitting(" << level << "-" << l << ")_SensorData.txt";
-										ParamsFileName << "GlobalFP_CurveFitting(" << level << "-" << l << ")_PolyParams.txt";
-										DataFile.open((DataFileName.str()).c_str(), std::fstream::out);
-										ParamsFile.open(ParamsFileName.str().c_str(), std::fstream::out);
-									}
-
-									//create regression problem matrices
-									CvMat* A = cvCreateMat(RegressionPointList[level][l].size(), polynomOrder[level]+1, CV_32FC1);
-									CvMat* B = cvCreateMat(RegressionPointList[level][l].size(), 1, CV_32FC1);
-									CvMat* X = cvCreateMat(polynomOrder[level]+1, 1, CV_32FC1);
-
-									for (int i=0; i<A->height; i++)
-									{
-										//for (int j=0; j<A->width; j++) cvSetReal2D(A, i, j, pow(RegressionPointList[l][i].s, j));		// speedup: replace pow
-										double value = 1.0;
-										for (int j=0; j<A->width; j++)
-										{
-											cvmSet(A, i, j, value);
-											value *= RegressionPointList[level][l][i].s;
-										}
-										cvSetReal1D(B, i, RegressionPointList[level][l][i].z);
-										//std::cout << RegressionPointList[l][i].s/DeltaS << "\t" << RegressionPointList[l][i].z/DeltaS << "\n";
-										if (pFileOutput) DataFile << RegressionPointList[level][l][i].s << "\t" << RegressionPointList[level][l][i].z << "\n";
-									}
-									cvSolve(A, B, X, CV_SVD);
-
-									if (pFileOutput)
-									{
-										//std::cout << "Regression parameters: \n";
-										for (int i=0; i<X->height; i++)
-										{
-											//for (int j=0; j<X->width; j++) std::cout << cvGetReal2D(X, i, j) << "\t";
-											for (int j=0; j<X->width; j++) ParamsFile << cvmGet(X, i, j) << "\t";
-											//std::cout << "\n";
-											ParamsFile << "\n";
-										}
-										DataFile.close();
-										ParamsFile.close();
-									}
-
-									//save in pGlobalFeatures
-									//int d = mData.mLocalFeatureClusterer->get_nclusters()+3+polynomOrder*Rotation;		//start position in pGlobalFeatures
-									//bool exceedsLimits = false;
-									//for (int s=0; s<=polynomOrder; s++)
-									//	if (cvGetReal1D(X, s) > 15.)
-									//		exceedsLimits = true;
-									//if (exceedsLimits == false)
-									for (int s=0; s<=polynomOrder[level]; s++, GlobalFeatureVectorPosition++) cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, cvGetReal1D(X, s));
-									//else
-									//	for (int s=0; s<=polynomOrder; s++, GlobalFeatureVectorPosition++) cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, 0.);
-
-									cvReleaseMat(&A);
-									cvReleaseMat(&B);
-									cvReleaseMat(&X);
-								}
-							}
-
-							if (useFeature["pointdistribution"] == true)
-							{
-								double cellLimits[2] = { pGlobalFeatureParams.cellSize[0]/2*(pGlobalFeatureParams.cellCount[0]-1), pGlobalFeatureParams.cellSize[1]/2*(pGlobalFeatureParams.cellCount[1]-1) };
-								for (double cellX = -cellLimits[0]; cellX < cellLimits[0]+1e-3; cellX += pGlobalFeatureParams.cellSize[0])
-								{
-									for (double cellY = -cellLimits[1]; cellY < cellLimits[1]+1e-3; cellY += pGlobalFeatureParams.cellSize[1])
-									{
-										if ((pointCount.find(cellX) != pointCount.end()) && (pointCount[cellX].find(cellY) != pointCount[cellX].end()))
-											cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, (double)pointCount[cellX][cellY]/(double)Coordinates->height);
-										else
-											cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, 0);
-										GlobalFeatureVectorPosition++;
-									}
-								}
-							}
-						}
-						if (pOutputImage)
-						{
-							cvSaveImage("CurveFittingImage.png", pOutputImage);
-							cvReleaseImage(&pOutputImage);
-						}
-
-
+					std::cout << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3d points available. Skipping." << std::endl;
+					if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Not enough 3d points available. Skipping." << std::endl;
+				}
 
+				double elapsedTime = tim.getElapsedTimeInMicroSec();
+				if (pTimingLogFileName.compare("") != 0)
+				{
+					std::ofstream timeFout(pTimingLogFileName.c_str(), std::ios::app);
+					timeFout << context.NumberPoints() << "\t";
+					timeFout << elapsedTime;
+					for (int i=0; i<7; i++)
+						timeFout << "\t" << context.mStageTimes[i];
+					timeFout << std::endl;
+					timeFout.close();
+				}
 
+				if (pOutputImage)
+				{
+					cvSaveImage("CurveFittingImage.png", pOutputImage);
+					cvReleaseImage(&pOutputImage);
+				}
+			}
 
-		/*				// --old-- /// Curve fitting along the strongest Eigenvector and 3 further directions rotating the strongest eigenvector by 45deg steps counter-clockwise
-						/// Curve fitting along the Eigenvector projections.
-						if (Eigenvectors != NULL && pMask != NULL)
-						{
-							// determine object's center point z-value (approximate it by the mean of the neighborhood if the central value is not valid)
-							double CenterZ = 0.0;
-							for (int d=0; ; d++)
-							{
-								int ZCounter = 0;
-								for (int du=-d; du<=d; du++)
-								{
-									for (int dv=-d; dv<=d; dv++)
-									{
-										if (cvGetReal2D(pMask, ObjectCenter2D.y+dv, ObjectCenter2D.x+du) != 0)
-										{	// point is part of pMask
-											CvScalar Center = cvGet2D(pCoordinateImage, ObjectCenter2D.y+dv, ObjectCenter2D.x+du);
-											CenterZ += Center.val[2];
-											ZCounter++;
-										}
-									}
-								}
-								if (CenterZ!=0.0)
-								{
-									CenterZ /= (double)ZCounter;
-									break;
-								}
-							}
+			break;
+		}
+	default:
+		std::cout << "ObjectClassifier::ExtractGlobalFeatures: Invalid ClusterMode.\n";
+		if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Invalid ClusterMode.\n";
+		break;
+	}
 
-							double dx=0.0, dy=0.0;
-							for (int Rotation = 0; Rotation<Rotations; Rotation++)
-							{
-								// --old-- calculate direction, use second eigenvector if first shows directly into z-direction
-								// for (int EigenvectorIndex=0; (dx==0.0 && dy==0.0); EigenvectorIndex++)
-								// {
-								//	dx=cvGetReal2D(Eigenvectors, EigenvectorIndex, 0);
-								//	dy=cvGetReal2D(Eigenvectors, EigenvectorIndex, 1);
-								// }
-
-								dx=cvGetReal2D(Eigenvectors, Rotation, 0);
-								dy=cvGetReal2D(Eigenvectors, Rotation, 1);
-								if (dy==0.0 && dx==0.0) dy=1.0;
-
-								/// curve fitting
-								// normalize direction
-								if (fabs(dx) > fabs(dy))
-								{
-									dy = dy/dx;
-									dx = 1.0;
-								}
-								else
-								{
-									dx = dx/dy;
-									dy = 1.0;
-								}
+	// Output
+	//for (int i=0; i<(*pGlobalFeatures)->width; i++) std::cout << cvGetReal2D(*pGlobalFeatures, 0, i) << "\t";
+	//std::cout << "\n";
 
-								//if (fabs(dx) > fabs(dy))	// change start
-								//{
-								//	dy = dy/dx*sign(dx);
-								//	dx = sign(dx);
-								//}
-								//else
-								//{
-								//	dx = dx/dy*sign(dy);
-								//	dy = sign(dy);
-								//}							// change end 06.03.2011
-								// is this needed for anything but normalization?
-									// better rotation invariant decision:
-										//double SumNeg = 0.0;
-										//for (int Multiplicator = -1; ; Multiplicator--)
-										//{
-										//	int u = ObjectCenter2D.x + cvRound(dx * Multiplicator);
-										//	int v = ObjectCenter2D.y + cvRound(dy * Multiplicator);
-
-										//	if (u<0 || u>=pMask->width || v<0 || v>=pMask->height) break;
-
-										//	if (cvGetReal2D(pMask, v, u) != 0)
-										//	{
-										//		CvScalar Point = cvGet2D(pCoordinateImage, v, u);
-										//		SumNeg = Point.val[2] - CenterZ;
-										//	}
-										//}
-
-										//double SumPos = 0.0;
-										//for (int Multiplicator = 1; ; Multiplicator++)
-										//{
-										//	int u = ObjectCenter2D.x + cvRound(dx * Multiplicator);
-										//	int v = ObjectCenter2D.y + cvRound(dy * Multiplicator);
-
-										//	if (u<0 || u>=pMask->width || v<0 || v>=pMask->height) break;
-
-										//	if (cvGetReal2D(pMask, v, u) != 0)
-										//	{
-										//		CvScalar Point = cvGet2D(pCoordinateImage, v, u);
-										//		SumPos = Point.val[2] - CenterZ;
-										//	}
-										//}
-
-										////let (dx,dy) always point into the direction with positive Sum (larger z-values than other direction)
-										//if (SumNeg > SumPos)
-										//{
-										//	dx *= -1;
-										//	dy *= -1;
-										//	// correct eigenvector in eigenvector matrix, too
-										//	cvSetReal2D(Eigenvectors, Rotation, 0, -1*cvGetReal2D(Eigenvectors, Rotation, 0));
-										//	cvSetReal2D(Eigenvectors, Rotation, 1, -1*cvGetReal2D(Eigenvectors, Rotation, 1));
-										//	cvSetReal2D(Eigenvectors, Rotation, 2, -1*cvGetReal2D(Eigenvectors, Rotation, 2));
-										//}
-									//
-								//if (dx <= 0.0)			// change start
-								//{
-								//	if (dx==0.0 && dy<0.0) dy *= -1;
-								//	else
-								//	{
-								//		dx *= -1;
-								//		dy *= -1;
-								//	}
-								//}							// chnage end 06.03.2011
-								//create list with curve points along direction given by dx, dy
-								int u = 0;
-								int v = 0;
-								CvScalar Point;
-								struct Point2Dbl{double s; double z;} Point2D;
-								double SMin=0.0, SMax=0.0;
-								double UnitLength = sqrt(dx*dx + dy*dy);
-								std::vector<Point2Dbl> RegressionPointList;
-								for (int Step=-1; Step<2; Step+=2)	// go once into the negative and once into the positive direction along the eigenvector starting at the center point
-								{
-									for (int Multiplicator = 0; ; Multiplicator+=Step)
-									{
-										u = ObjectCenter2D.x + cvRound(dx * Multiplicator);
-										v = ObjectCenter2D.y + cvRound(dy * Multiplicator);
-
-										if (u<0 || u>=pMask->width || v<0 || v>=pMask->height)
-										{
-											if (RegressionPointList.size()!=0)
-											{
-												if (Step==-1) SMin = RegressionPointList.back().s;
-												else SMax = RegressionPointList.back().s;
-											}
-											break;
-										}
-
-										// OutputImage
-										if (pOutputImage)
-											cvSet2D(pOutputImage, v, u, CV_RGB(255.0*(double)Rotation/(Rotations-1.0),255.0-255.0*(double)Rotation/(Rotations-1.0), 0));
-									
-										if (cvGetReal2D(pMask, v, u) != 0)
-										{	// append point for regression
-								// use real 3D surface alignment to eigenvector
-											Point2D.s = sign(Multiplicator)*UnitLength * Multiplicator*Multiplicator;
-											Point = cvGet2D(pCoordinateImage, v, u);
-											Point2D.z = Point.val[2] - CenterZ;
-											RegressionPointList.push_back(Point2D);
-										}
-									}
-								}
-								if ((int)RegressionPointList.size()>polynomOrder)
-								{
-									std::stringstream DataFileName;
-									DataFileName << "GlobalFP_CurveFitting(" << Rotation << ")_SensorData.txt";
-									std::ofstream DataFile((DataFileName.str()).c_str(), std::fstream::out);
-									std::stringstream ParamsFileName;
-									ParamsFileName << "GlobalFP_CurveFitting(" << Rotation << ")_PolyParams.txt";
-									std::ofstream ParamsFile(ParamsFileName.str().c_str(), std::fstream::out);
-
-									//create regression problem matrices
-									double DeltaS = SMax-SMin;		// normalize RegressionPointList
-									CvMat* A = cvCreateMat(RegressionPointList.size(), polynomOrder, CV_32FC1);
-									CvMat* B = cvCreateMat(RegressionPointList.size(), 1, CV_32FC1);
-									CvMat* X = cvCreateMat(polynomOrder, 1, CV_32FC1);
-
-									for (int i=0; i<A->height; i++)
-									{
-										for (int j=0; j<A->width; j++)
-											cvSetReal2D(A, i, j, pow(RegressionPointList[i].s/DeltaS, (j+1)));
-										cvSetReal1D(B, i, RegressionPointList[i].z/DeltaS);
-										//std::cout << RegressionPointList[i].s/DeltaS << "\t" << RegressionPointList[i].z/DeltaS << "\n";
-										DataFile << RegressionPointList[i].s/DeltaS << "\t" << RegressionPointList[i].z/DeltaS << "\n";
-									}
-
-									cvSolve(A, B, X, CV_SVD);
-
-									//std::cout << "Regression parameters: \n";
-									for (int i=0; i<X->height; i++)
-									{
-										//for (int j=0; j<X->width; j++) std::cout << cvGetReal2D(X, i, j) << "\t";
-										for (int j=0; j<X->width; j++) ParamsFile << cvGetReal2D(X, i, j) << "\t";
-										//std::cout << "\n";
-										ParamsFile << "\n";
-									}
-									DataFile.close();
-									ParamsFile.close();
-
-									//save in pGlobalFeatures
-									//int d = mData.mLocalFeatureClusterer->get_nclusters()+3+polynomOrder*Rotation;		//start position in pGlobalFeatures
-									for (int s=0; s<polynomOrder; s++, GlobalFeatureVectorPosition++) cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, cvGetReal1D(X, s));
-
-									cvReleaseMat(&A);
-									cvReleaseMat(&B);
-									cvReleaseMat(&X);
-								}
-								else
-								{
-									std::cout << "ObjectClassifier::ExtractGlobalFeatures: No data for curve fitting available.\n";
-								}
+	return ipa_utils::RET_OK;
+}
 
-								// --old-- rotate direction
-								// double Temp = dx;
-								// dx = dx * cos(CV_PI/(double)Rotations) + dy * sin(CV_PI/(double)Rotations);
-								// dy = -Temp * sin(CV_PI/(double)Rotations) + dy * cos(CV_PI/(double)Rotations);
-							}
+int ObjectClassifier::GlobalFeatureFamilySize(const std::string& pFamily, GlobalFeatureParams& pGlobalFeatureParams)
+{
+	const GlobalDescriptorPlugin* plugin = GlobalDescriptorRegistry::Instance().Get(pFamily);
+	if (plugin == NULL)
+		return 0;
+	return plugin->Size(pGlobalFeatureParams, mData.mLocalFeatureClusterer);
+}
 
-							if (pOutputImage)
-							{
-								cvSaveImage("CurveFittingImage.png", pOutputImage);
-								cvReleaseImage(&pOutputImage);
-							}
-						}*/
+void ObjectClassifier::AddLocalFeatureClustererToCacheKey(ipa_utils::DescriptorCacheKey& pKey)
+{
+#if (CV_MAJOR_VERSION<=2 && CV_MINOR_VERSION<=3)
+	int numberClusters = mData.mLocalFeatureClusterer->get_nclusters();
+	CvMat* Means = (CvMat*)mData.mLocalFeatureClusterer->get_means();
+#else
+	int numberClusters = mData.mLocalFeatureClusterer->get<int>("nclusters");
+	cv::Mat meansMat = mData.mLocalFeatureClusterer->get<cv::Mat>("means");
+	CvMat Means_ = (CvMat)meansMat;
+	CvMat* Means = (meansMat.empty() == false) ? &Means_ : NULL;
+#endif
+	pKey.Add(std::string("clusterer"));
+	pKey.Add(numberClusters);
+	if (Means == NULL)
+		return;
+	pKey.Add(Means->rows);
+	pKey.Add(Means->cols);
+	for (int i=0; i<Means->rows; i++)
+		for (int j=0; j<Means->cols; j++)
+			pKey.Add(cvmGet(Means, i, j));
+}
 
+bool ObjectClassifier::LoadGlobalFeaturesFromCache(BlobListRiB* pBlobFeatures, CvMat** pGlobalFeatures, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, const ipa_utils::DescriptorCacheKey& pViewKey,
+												   std::vector<GlobalFeatureCacheGroup>& pGroups)
+{
+	pGroups.clear();
+	if (mDescriptorCache.Enabled() == false || pClusterMode != CLUSTER_EM)
+		return false;
 
-						/// Statistics about feature point frame directions compared to the largest principal component (eigenvector).
-						if (useFeature["normalstatistics"] && Eigenvectors!=NULL && NumberFramesStatisticsFeatures > 0)
-						{
-							BlobListRiB::iterator ItBlobFeatures;
-
-							// find invariant direction (largest PCA direction)
-							ipa_utils::Point3Dbl PCAMainDirection = ipa_utils::Point3Dbl(cvmGet(Eigenvectors, 0, 0), cvmGet(Eigenvectors, 0, 1), cvmGet(Eigenvectors, 0, 2));
-			// --improvement needed: direction is not chosen by chance but still not invariant with respect to the object
-			// simply use directed eigenvectors from above
-							if (PCAMainDirection.m_x < 0.0) PCAMainDirection.Negative();
-							else
-							{
-								if (PCAMainDirection.m_x==0.0)
-								{
-									if (PCAMainDirection.m_y < 0.0) PCAMainDirection.Negative();
-									else
-									{
-										if (PCAMainDirection.m_y==0.0)
-										{
-											if (PCAMainDirection.m_z < 0.0) PCAMainDirection.Negative();
-										}
-									}
-								}
-							}
-							PCAMainDirection.Normalize();
-			// improvement needed --
-							double Bins[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-							for (ItBlobFeatures = pBlobFeatures->begin(); ItBlobFeatures != pBlobFeatures->end(); ItBlobFeatures++)
-							{
-								ipa_utils::Point3Dbl FPDirection;
-								ItBlobFeatures->m_Frame.eX(FPDirection);
-								if (FPDirection.ScalarProd(PCAMainDirection) > 0) Bins[0]++;
-								else Bins[1]++;
-
-								ItBlobFeatures->m_Frame.eY(FPDirection);
-								if (FPDirection.ScalarProd(PCAMainDirection) > 0) Bins[2]++;
-								else Bins[3]++;
-
-								ItBlobFeatures->m_Frame.eZ(FPDirection);
-								if (FPDirection.ScalarProd(PCAMainDirection) > 0) Bins[4]++;
-								else Bins[5]++;
-							}
-							double Sum = 0;
-							for (int i=0; i<5; i+=2, GlobalFeatureVectorPosition+=2)
-							{
-								Sum = Bins[i]+Bins[i+1];
-								cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, Bins[i]/Sum);
-								cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition+1, Bins[i+1]/Sum);
-							}
-						}
+	// groups in the order of the descriptor of ExtractGlobalFeatures(), sap, sap2 and pointdistribution are computed together
+	std::vector< std::vector<std::string> > groupFamilies(6);
+	groupFamilies[0].push_back("bow");
+	groupFamilies[1].push_back("sap");
+	groupFamilies[1].push_back("sap2");
+	groupFamilies[1].push_back("pointdistribution");
+	groupFamilies[2].push_back("normalstatistics");
+	groupFamilies[3].push_back("vfh");
+	groupFamilies[4].push_back("grsd");
+	groupFamilies[5].push_back("gfpfh");
+
+	// parameters which influence all groups
+	ipa_utils::DescriptorCacheKey commonKey = pViewKey;
+	commonKey.Add(std::string("global"));
+	commonKey.Add((int)pGlobalFeatureParams.minNumber3DPixels);
+	commonKey.Add(pGlobalFeatureParams.thinningFactor);
+	commonKey.Add((int)pGlobalFeatureParams.useFullPCAPoseNormalization);
+	commonKey.Add((int)pGlobalFeatureParams.useRollPoseNormalization);
+	commonKey.Add((int)pGlobalFeatureParams.additionalArtificialTiltedViewAngle.size());
+	for (unsigned int i=0; i<pGlobalFeatureParams.additionalArtificialTiltedViewAngle.size(); i++)
+		commonKey.Add(pGlobalFeatureParams.additionalArtificialTiltedViewAngle[i]);
+	AddBlobListToCacheKey(*pBlobFeatures, commonKey);
+
+	bool usesClusterer = false;
+	for (unsigned int g=0; g<groupFamilies.size(); g++)
+	{
+		GlobalFeatureCacheGroup group;
+		group.size = 0;
+		group.key = commonKey;
+		group.available = false;
+		group.rows = 0;
+		for (unsigned int f=0; f<groupFamilies[g].size(); f++)
+		{
+			const std::string& family = groupFamilies[g][f];
+			std::map<std::string, bool>::const_iterator itUseFeature = pGlobalFeatureParams.useFeature.find(family);
+			if (itUseFeature == pGlobalFeatureParams.useFeature.end())
+			{
+				// ExtractGlobalFeatures() reports the missing parameter
+				pGroups.clear();
+				return false;
+			}
+			group.key.Add(family);
+			group.key.Add((int)itUseFeature->second);
+			if (itUseFeature->second == true)
+			{
+				group.families.push_back(family);
+				group.size += GlobalFeatureFamilySize(family, pGlobalFeatureParams);
+				if (family.compare("bow") == 0 || family.compare("gfpfh") == 0)
+					usesClusterer = true;
+			}
+		}
+		if (group.families.empty())
+			continue;
 
-					
-						// compute vfh feature
-						if (useFeature["vfh"]==true)
-						{
-							elapsedTime = 0.0;
-							tim.start();
+		if (g == 1)
+		{
+			for (unsigned int i=0; i<pGlobalFeatureParams.polynomOrder.size(); i++) group.key.Add(pGlobalFeatureParams.polynomOrder[i]);
+			for (unsigned int i=0; i<pGlobalFeatureParams.numberLinesX.size(); i++) group.key.Add(pGlobalFeatureParams.numberLinesX[i]);
+			for (unsigned int i=0; i<pGlobalFeatureParams.numberLinesY.size(); i++) group.key.Add(pGlobalFeatureParams.numberLinesY[i]);
+			group.key.Add(pGlobalFeatureParams.pointDataExcess);
+			for (int i=0; i<2; i++)
+			{
+				group.key.Add(pGlobalFeatureParams.cellCount[i]);
+				group.key.Add(pGlobalFeatureParams.cellSize[i]);
+			}
+		}
+		pGroups.push_back(group);
+	}
+	if (pGroups.empty())
+		return false;
 
-							// normalize viewpoint
-							double metricFactor = 1.0;
-							if (pDatabase == CIN) metricFactor = 0.001;
-							for (int i=0; i<(int)pclPoints->size(); i++)
-							{
-								pclPoints->at(i).x = pclPoints->at(i).x*metricFactor - ObjectCenter3D.x;
-								pclPoints->at(i).y = pclPoints->at(i).y*metricFactor - ObjectCenter3D.y;
-								pclPoints->at(i).z = pclPoints->at(i).z*metricFactor - ObjectCenter3D.z + 1.0;
-							}
+	if (usesClusterer == true)
+	{
+		ipa_utils::DescriptorCacheKey clustererKey;
+		AddLocalFeatureClustererToCacheKey(clustererKey);
+		boost::uint64_t clustererHash = clustererKey.Hash();
+		for (unsigned int g=0; g<pGroups.size(); g++)
+			if (pGroups[g].families[0].compare("bow") == 0 || pGroups[g].families[0].compare("gfpfh") == 0)
+				pGroups[g].key.Add(&clustererHash, sizeof(clustererHash));
+	}
 
-							// Create the filtering object
-							pcl::PointCloud<pcl::PointXYZ>::Ptr vfhPointsVoxelized(new pcl::PointCloud<pcl::PointXYZ>());
-							pcl::VoxelGrid<pcl::PointXYZ> voxg;
-							voxg.setInputCloud(pclPoints);
-							voxg.setLeafSize(0.005f, 0.005f, 0.005f);
-							voxg.filter(*vfhPointsVoxelized);
+	// read the groups, a group with a different size (e.g. other vocabulary) is computed again
+	bool allAvailable = true;
+	std::string cacheData;
+	for (unsigned int g=0; g<pGroups.size(); g++)
+	{
+		GlobalFeatureCacheGroup& group = pGroups[g];
+		int cols = 0;
+		group.available = mDescriptorCache.Load(group.key, cacheData) && DeserializeFloatBlock(cacheData, group.rows, cols, group.data) && cols == group.size;
+		allAvailable = allAvailable && group.available;
+	}
 
+	if (allAvailable == false)
+		return false;
+	return AssembleGlobalFeatureCacheGroups(pGroups, pGlobalFeatures);
+}
 
-							// Create the normal estimation class, and pass the input dataset to it
-							pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-							ne.setInputCloud(vfhPointsVoxelized);
+int ObjectClassifier::ExtractGlobalFeaturesCached(BlobListRiB* pBlobFeatures, CvMat** pGlobalFeatures, ClusterMode pClusterMode, GlobalFeatureParams& pGlobalFeatureParams, std::vector<GlobalFeatureCacheGroup>& pGroups,
+												  Database pDatabase, const IplImage* pCoordinateImage, IplImage* pMask, std::string pTimingLogFileName, std::ofstream* pScreenLogFile)
+{
+	if (pGroups.empty())
+		return ExtractGlobalFeatures(pBlobFeatures, pGlobalFeatures, pClusterMode, pGlobalFeatureParams, pDatabase, pCoordinateImage, pMask, 0, false, pTimingLogFileName, pScreenLogFile);
 
-							// Create an empty kdtree representation, and pass it to the normal estimation object.
-							// Its content will be filled inside the object, based on the given input dataset (as no other search surface is given).
-							pcl_search<pcl::PointXYZ>::Ptr tree (new pcl_search<pcl::PointXYZ> ());
-							ne.setSearchMethod(tree);
+	// compute only the families of the missing groups
+	GlobalFeatureParams missingParams = pGlobalFeatureParams;
+	int missingSize = 0;
+	for (unsigned int g=0; g<pGroups.size(); g++)
+	{
+		if (pGroups[g].available == true)
+			for (unsigned int f=0; f<pGroups[g].families.size(); f++)
+				missingParams.useFeature[pGroups[g].families[f]] = false;
+		else
+			missingSize += pGroups[g].size;
+	}
 
-							// Output datasets
-							pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>());
+	if (missingSize == 0)
+	{
+		if (AssembleGlobalFeatureCacheGroups(pGroups, pGlobalFeatures) == true)
+			return ipa_utils::RET_OK;
+		return ExtractGlobalFeatures(pBlobFeatures, pGlobalFeatures, pClusterMode, pGlobalFeatureParams, pDatabase, pCoordinateImage, pMask, 0, false, pTimingLogFileName, pScreenLogFile);
+	}
 
-							// Use all neighbors in a sphere of radius 3cm
-							ne.setRadiusSearch(0.03);	//0.03
+	CvMat* missingFeatures = NULL;
+	if (ExtractGlobalFeatures(pBlobFeatures, &missingFeatures, pClusterMode, missingParams, pDatabase, pCoordinateImage, pMask, 0, false, pTimingLogFileName, pScreenLogFile) != ipa_utils::RET_OK)
+	{
+		if (missingFeatures != NULL) cvReleaseMat(&missingFeatures);
+		return ipa_utils::RET_FAILED;
+	}
+	if (missingFeatures == NULL || missingFeatures->cols != missingSize)
+	{
+		std::cout << "ObjectClassifier::ExtractGlobalFeaturesCached: The descriptor size does not match the cached descriptor groups, the cache is not used for this view." << std::endl;
+		if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeaturesCached: The descriptor size does not match the cached descriptor groups, the cache is not used for this view." << std::endl;
+		if (missingFeatures != NULL) cvReleaseMat(&missingFeatures);
+		return ExtractGlobalFeatures(pBlobFeatures, pGlobalFeatures, pClusterMode, pGlobalFeatureParams, pDatabase, pCoordinateImage, pMask, 0, false, pTimingLogFileName, pScreenLogFile);
+	}
 
-							// Compute the normals
-							ne.compute(*normals);
+	// split the new columns into their groups and store them
+	int column = 0;
+	std::string cacheData;
+	for (unsigned int g=0; g<pGroups.size(); g++)
+	{
+		GlobalFeatureCacheGroup& group = pGroups[g];
+		if (group.available == true)
+			continue;
+		group.rows = missingFeatures->rows;
+		group.data.resize(group.rows*group.size);
+		for (int i=0; i<group.rows; i++)
+			for (int j=0; j<group.size; j++)
+				group.data[i*group.size+j] = (float)cvmGet(missingFeatures, i, column+j);
+		column += group.size;
+		group.available = true;
+		SerializeFloatBlock(group.rows, group.size, group.data, cacheData);
+		mDescriptorCache.Store(group.key, cacheData);
+	}
+	cvReleaseMat(&missingFeatures);
 
+	if (AssembleGlobalFeatureCacheGroups(pGroups, pGlobalFeatures) == false)
+	{
+		// cached groups were computed with a different number of tilt angles
+		std::cout << "ObjectClassifier::ExtractGlobalFeaturesCached: The number of descriptor rows does not match the cached descriptor groups, the cache is not used for this view." << std::endl;
+		if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeaturesCached: The number of descriptor rows does not match the cached descriptor groups, the cache is not used for this view." << std::endl;
+		return ExtractGlobalFeatures(pBlobFeatures, pGlobalFeatures, pClusterMode, pGlobalFeatureParams, pDatabase, pCoordinateImage, pMask, 0, false, pTimingLogFileName, pScreenLogFile);
+	}
+	return ipa_utils::RET_OK;
+}
 
-							// Create the VFH estimation class, and pass the input dataset+normals to it
-							pcl::VFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::VFHSignature308> vfh;
-							vfh.setInputCloud(vfhPointsVoxelized);
-							vfh.setInputNormals(normals);
-							// alternatively, if cloud is of tpe PointNormal, do vfh.setInputNormals (cloud);
+ObjectClassifier::DatabaseView ObjectClassifier::MakeDatabaseView(const std::string& pCategory, int pObjectIndex, const std::string& pClassName, const std::string& pFileName, BlobListStruct* pBlobList)
+{
+	DatabaseView view;
+	view.category = pCategory;
+	view.objectIndex = pObjectIndex;
+	view.className = pClassName;
+	view.localFeatures.FileName = pFileName;
+	view.blobList = pBlobList;
+	view.useCache = false;
+	view.readError = false;
+	view.result = ipa_utils::RET_FAILED;
+	view.globalFeatures = NULL;
+	return view;
+}
 
-							// Create an empty kdtree representation, and pass it to the FPFH estimation object.
-							// Its content will be filled inside the object, based on the given input dataset (as no other search surface is given).
-							pcl_search<pcl::PointXYZ>::Ptr vfhTree (new pcl_search<pcl::PointXYZ>());
-							vfh.setSearchMethod(vfhTree);
-						
-							// Output datasets
-							pcl::PointCloud<pcl::VFHSignature308>::Ptr vfhs (new pcl::PointCloud<pcl::VFHSignature308> ());
+bool ObjectClassifier::LoadDatabaseViewImages(const DatabaseLoaderSettings* pSettings, std::vector<DatabaseView>* pViews, int pViewIndex, boost::shared_ptr<SharedImage>& pImage)
+{
+	DatabaseView& view = (*pViews)[pViewIndex];
+	const std::string& fileName = view.localFeatures.FileName;
+
+	// input files of the view
+	std::string colorFileName, xyzFileName;
+	if (pSettings->database == CIN2)
+	{
+		size_t pos = fileName.rfind("sharedImage_");
+		colorFileName = fileName;
+		colorFileName.replace(pos, 12, "sharedImage_color_");
+		colorFileName += ".png";
+		xyzFileName = fileName;
+		xyzFileName.replace(pos, 12, "sharedImage_xyz_");
+		xyzFileName += ".bin";
+	}
+
+	// local features of this view from the descriptor cache (not with MASK_SAVE which has to write the mask files)
+	view.useCache = mDescriptorCache.Enabled() && pSettings->maskMode != MASK_SAVE;
+	if (view.useCache == true)
+	{
+		view.cacheKey.Add(std::string("local"));
+		view.cacheKey.Add((int)pSettings->database);
+		if (pSettings->database == CIN2)
+			view.cacheKey.Add(pSettings->localFeatureParams->useFeature);
+		view.cacheKey.Add((int)pSettings->clusterMode);
+		view.cacheKey.Add((int)pSettings->maskMode);
+		view.cacheKey.Add(view.className);
+		if (pSettings->database == CIN2)
+			view.useCache = mDescriptorCache.AddFile(view.cacheKey, colorFileName) == ipa_utils::RET_OK && mDescriptorCache.AddFile(view.cacheKey, xyzFileName) == ipa_utils::RET_OK;
+		else
+			view.useCache = mDescriptorCache.AddFile(view.cacheKey, fileName) == ipa_utils::RET_OK;
+		view.useCache = view.useCache && (pSettings->maskMode != MASK_LOAD || mDescriptorCache.AddFile(view.cacheKey, fileName + "_Mask.png") == ipa_utils::RET_OK);
+	}
+	std::string cacheData;
+	if (view.useCache == true && mDescriptorCache.Load(view.cacheKey, cacheData) == true && DeserializeBlobList(cacheData, view.localFeatures.BlobFPs) == true)
+	{
+		view.result = ipa_utils::RET_OK;
+		return false;
+	}
+	view.localFeatures.BlobFPs.clear();
 
-							// Compute the features
-							vfh.compute(*vfhs);
+	if (pSettings->database == CIN2)
+	{
+		// color (CV_8UC3)
+		cv::Mat colorImage = cv::imread(colorFileName);
+		IplImage colorImageIpl = (IplImage)colorImage;
+		IplImage* colorImageIplCopy = cvCreateImage(cvSize(colorImageIpl.width, colorImageIpl.height), colorImageIpl.depth, colorImageIpl.nChannels);
+		cvCopyImage(&colorImageIpl, colorImageIplCopy);
 
+		// xyz (CV_32FC3)
+		cv::Mat xyzImage;
+		LoadMat(xyzImage, xyzFileName);
+		IplImage xyzImageIpl = (IplImage)xyzImage;
+		IplImage* xyzImageIplCopy = cvCreateImage(cvSize(xyzImageIpl.width, xyzImageIpl.height), xyzImageIpl.depth, xyzImageIpl.nChannels);
+		cvCopyImage(&xyzImageIpl, xyzImageIplCopy);
 
-							// write descriptor into the descriptor vector
-							for (int i=0; i<308; i++, GlobalFeatureVectorPosition++)
-								cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, vfhs->at(0).histogram[i]);
-						}
+		// intensity (CV_32FC1)
+		cv::Mat intenImage;
+		//LoadMat(intenImage, inputFilename);	// intensity images are buggy
+		cv::cvtColor(colorImage, intenImage, CV_BGR2GRAY);
+		IplImage intenImageIpl = (IplImage)intenImage;
+		IplImage* intenImageIplCopy = cvCreateImage(cvSize(intenImageIpl.width, intenImageIpl.height), intenImageIpl.depth, intenImageIpl.nChannels);
+		cvCopyImage(&intenImageIpl, intenImageIplCopy);
 
-						if (useFeature["grsd"] == true || useFeature["gfpfh"] == true)
-						{
-#ifndef __LINUX__
-							elapsedTime = 0.0;
-							tim.start();
-
-							// normalize viewpoint
-							//double metricFactor = 1.0;
-							//if (pDatabase == CIN) metricFactor = 0.001;
-							//for (int i=0; i<pclPoints->size(); i++)
-							//{
-							//	pclPoints->at(i).x = pclPoints->at(i).x*metricFactor - ObjectCenter3D.x;
-							//	pclPoints->at(i).y = pclPoints->at(i).y*metricFactor - ObjectCenter3D.y;
-							//	pclPoints->at(i).z = pclPoints->at(i).z*metricFactor - ObjectCenter3D.z + 1.0;
-							//}
-
-							// Create the filtering object
-							pcl::PointCloud<pcl::PointXYZ>::Ptr pclPointsVoxelized(new pcl::PointCloud<pcl::PointXYZ>());
-							//pcl::VoxelGrid<pcl::PointXYZ> voxg;
-							//voxg.setInputCloud(pclPoints);
-							//voxg.setLeafSize(0.015f, 0.015f, 0.015f);
-							//voxg.filter(*pclPointsVoxelized);
-
-
-							// Create the normal estimation class, and pass the input dataset to it
-							//pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-							//ne.setInputCloud(pclPointsVoxelized);
-
-							//// Create an empty kdtree representation, and pass it to the normal estimation object.
-							//// Its content will be filled inside the object, based on the given input dataset (as no other search surface is given).
-							//pcl_search<pcl::PointXYZ>::Ptr tree (new pcl_search<pcl::PointXYZ> ());
-							//ne.setSearchMethod(tree);
-
-							//// Output datasets
-							//pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>());
-
-							//// Use all neighbors in a sphere of radius 3cm
-							//ne.setRadiusSearch(0.03);	//0.03
-
-							//// Compute the normals
-							//ne.compute(*normals);
-
-							// labels
-							//pcl::getSimpleType();
-							pcl::PointCloud<pcl::PointXYZL>::Ptr labels (new pcl::PointCloud<pcl::PointXYZL>());
-							for (BlobListRiB::iterator ItBlobFeatures = pBlobFeatures->begin(); ItBlobFeatures != pBlobFeatures->end(); ItBlobFeatures++)
-							{
-								pcl::PointXYZL pointl;
-								ipa_utils::Point3Dbl ipaPoint;
-								ItBlobFeatures->m_Frame.GetT(ipaPoint);
-								pointl.x = ipaPoint.m_x;
-								pointl.y = ipaPoint.m_y;
-								pointl.z = ipaPoint.m_z;
-								if (useFeature["grsd"] == true)
-									pointl.label = pcl::getSimpleType(ItBlobFeatures->m_D[0], ItBlobFeatures->m_D[1]);
-								else if (useFeature["gfpfh"] == true)
-								{
-									CvMat* LocalFeatureVector = cvCreateMat(1, ItBlobFeatures->m_D.size(), CV_32FC1);
-									for (unsigned int j=0; j<ItBlobFeatures->m_D.size(); j++) cvSetReal1D(LocalFeatureVector, j, ItBlobFeatures->m_D[j]);
-#if (CV_MAJOR_VERSION<=2 && CV_MINOR_VERSION<=3)
-									pointl.label = (unsigned char)cvRound(mData.mLocalFeatureClusterer->predict((const CvMat*)LocalFeatureVector, NULL));		// speedup: replace round by (int)
-#else
-									cv::Mat localFeatureVector(LocalFeatureVector);
-									pointl.label = (unsigned char)cvRound((mData.mLocalFeatureClusterer->predict(localFeatureVector))[1]);		// speedup: replace round by (int)
-#endif
-									cvReleaseMat(&LocalFeatureVector);
-								}
-								labels->push_back(pointl);
+		pImage.reset(new SharedImage);
+		pImage->setCoord(xyzImageIplCopy);
+		pImage->setShared(colorImageIplCopy);
+		pImage->setInten(intenImageIplCopy);
+	}
+	else
+	{
+		// load pcd file and write images
+		pcl::PointCloud<PointXYZRGBIM>::Ptr cloud (new pcl::PointCloud<PointXYZRGBIM>);
+		if (pcl::io::loadPCDFile<PointXYZRGBIM> (fileName, *cloud) == -1) //* load the file
+		{
+			view.readError = true;
+			return false;
+		}
 
-								pcl::PointXYZ point;
-								point.x = pointl.x;
-								point.y = pointl.y;
-								point.z = pointl.z;
-								pclPointsVoxelized->push_back(point);
-							}
+		IplImage* colorImage = cvCreateImage(cvSize(640, 480), IPL_DEPTH_8U, 3);
+		cvSetZero(colorImage);
+		IplImage* intenImage = cvCreateImage(cvSize(640, 480), IPL_DEPTH_8U, 1);
+		cvSetZero(intenImage);
+		IplImage* xyzImage = cvCreateImage(cvSize(640, 480), IPL_DEPTH_32F, 3);
+		cvSetZero(xyzImage);
 
-							// Output datasets
-							pcl::PointCloud<pcl::GFPFHSignature16>::Ptr gfpfhs (new pcl::PointCloud<pcl::GFPFHSignature16> ());
-							pcl::GFPFHEstimation<pcl::PointXYZ, pcl::PointXYZL, pcl::GFPFHSignature16> gfpfh;
-							gfpfh.setInputCloud(pclPointsVoxelized);
-							gfpfh.setInputLabels(labels);
+		for (size_t i = 0; i < cloud->points.size (); ++i)
+		{
+			uint32_t rgb = *reinterpret_cast<int*>(&cloud->points[i].rgb);
+			uint8_t r = (rgb >> 16) & 0x0000ff;
+			uint8_t g = (rgb >> 8)  & 0x0000ff;
+			uint8_t b = (rgb)       & 0x0000ff;
+			int u = cloud->points[i].imX;
+			int v = cloud->points[i].imY;
+			float x = cloud->points[i].x;
+			float y = -cloud->points[i].z;
+			float z = cloud->points[i].y;
 
-							// Its content will be filled inside the object, based on the given input dataset (as no other search surface is given).
-							pcl_search<pcl::PointXYZ>::Ptr gfpfhTree (new pcl_search<pcl::PointXYZ>());
-							gfpfh.setSearchMethod(gfpfhTree);
+			cvSet2D(colorImage, v, u, cvScalar(b, g, r, 0));
+			cvSet2D(xyzImage, v, u, cvScalar(x, y, z, 0));
+		}
 
-							gfpfh.compute(*gfpfhs);
+		cvCvtColor(colorImage, intenImage, CV_BGR2GRAY);
 
-							// write descriptor into the descriptor vector
-							for (int i=0; i<gfpfhs->at(0).descriptorSize(); i++, GlobalFeatureVectorPosition++)
-								cvSetReal1D(*pGlobalFeatures, GlobalFeatureVectorPosition, gfpfhs->at(0).histogram[i]);
-#endif
-						}
+		pImage.reset(new SharedImage);
+		pImage->setCoord(xyzImage);
+		pImage->setShared(colorImage);
+		pImage->setInten(intenImage);
+	}
+	return true;
+}
 
+void ObjectClassifier::ExtractDatabaseViewLocalFeatures(const DatabaseLoaderSettings* pSettings, std::vector<DatabaseView>* pViews, int pViewIndex, boost::shared_ptr<SharedImage>& pImage)
+{
+	DatabaseView& view = (*pViews)[pViewIndex];
+	BlobListStruct& localFeatures = view.localFeatures;
 
-						if (Eigenvalues) cvReleaseMat(&Eigenvalues);
-						if (Coordinates) cvReleaseMat(&Coordinates);
-						if (Eigenvectors) cvReleaseMat(&Eigenvectors);
-					}
-				}
-				elapsedTime += tim.getElapsedTimeInMicroSec();
+	if (pSettings->database == CIN2 && pSettings->localFeatureParams->useFeature.compare("surf") != 0)
+		view.result = ExtractLocalRSDorFPFHFeatures(pImage.get(), localFeatures.BlobFPs, *(pSettings->localFeatureParams), pSettings->maskMode, localFeatures.FileName, CIN2);
+	else
+		view.result = ExtractLocalFeatures(pImage.get(), localFeatures.BlobFPs, pSettings->clusterMode, pSettings->maskMode, localFeatures.FileName, pSettings->database, view.className); //, MASK_SAVE, ViewFileName.str() ... remove comment in order to create new masks
 
-				if (pTimingLogFileName.compare("") != 0)
-				{
-					timeFout << numberOfPoints << "\t";
-					timeFout << elapsedTime;
-					for (int i=0; i<7; i++)
-						timeFout << "\t" << elapsedTime1[i];
-					timeFout << std::endl;
-					timeFout.close();
-				}
+	pImage->Release();
 
-				cvReleaseMat(&BlobFPCoordinates);
+	if (view.useCache == true && view.result == ipa_utils::RET_OK)
+	{
+		std::string cacheData;
+		SerializeBlobList(localFeatures.BlobFPs, cacheData);
+		mDescriptorCache.Store(view.cacheKey, cacheData);
+	}
+}
 
-				// save descriptor in temporary buffer in case a second is computed which overwrites the first
-				if (numberOfTiltAngles > 1)
-				{
-					for (int j=0; j<(*pGlobalFeatures)->cols; j++)
-						descriptorBuffer[descriptorComputationPass].push_back(cvGetReal1D(*pGlobalFeatures, j));
-				}
+bool ObjectClassifier::LoadDatabaseViewCoordinates(const DatabaseLoaderSettings* pSettings, std::vector<DatabaseView>* pViews, int pViewIndex, DatabaseViewCoordinates& pCoordinates)
+{
+	DatabaseView& view = (*pViews)[pViewIndex];
+	const std::string& fileName = view.blobList->FileName;
 
-				cvReleaseImage(&mask);
-			}
+	// input files of the view
+	std::string xyzFileName = fileName;
+	std::string maskFileName = fileName + "_Mask.png";
+	if (pSettings->database == CIN2)
+	{
+		xyzFileName += ".bin";
+		size_t pos = xyzFileName.find("sharedImage_");
+		if (pos == std::string::npos)
+		{
+			view.readError = true;
+			return false;
+		}
+		xyzFileName.replace(pos, 12, "sharedImage_xyz_");
+	}
 
-			// return multiple descriptor vectors if a second/third/... was required from a tilted view
-			if (numberOfTiltAngles > 1)
-			{
-				cvReleaseMat(pGlobalFeatures);
-				*pGlobalFeatures = cvCreateMat(numberOfTiltAngles, descriptorSize, CV_32FC1);
-				for (int i=0; i<(int)descriptorBuffer.size(); i++)
-					for (int j=0; j<(int)descriptorBuffer[i].size(); j++)
-						cvmSet(*pGlobalFeatures, i, j, descriptorBuffer[i][j]);
-			}
+	// descriptor groups from the cache, the input files are only loaded if a group is missing
+	GlobalFeatureParams globalFeatureParams = *(pSettings->globalFeatureParams);	// the workers must not share the std::map inside
+	ipa_utils::DescriptorCacheKey viewKey;
+	viewKey.Add((int)pSettings->database);
+	viewKey.Add((int)pSettings->clusterMode);
+	if (mDescriptorCache.Enabled() == true && mDescriptorCache.AddFile(viewKey, xyzFileName) == ipa_utils::RET_OK &&
+		(pSettings->database != CIN2 || mDescriptorCache.AddFile(viewKey, maskFileName) == ipa_utils::RET_OK) &&
+		LoadGlobalFeaturesFromCache(&(view.blobList->BlobFPs), &(view.globalFeatures), pSettings->clusterMode, globalFeatureParams, viewKey, view.cacheGroups) == true)
+	{
+		view.result = ipa_utils::RET_OK;
+		return false;
+	}
 
-			break;
-		}
-	default:
-		std::cout << "ObjectClassifier::ExtractGlobalFeatures: Invalid ClusterMode.\n";
-		if (pScreenLogFile) *pScreenLogFile << "ObjectClassifier::ExtractGlobalFeatures: Invalid ClusterMode.\n";
-		break;
+	if (pSettings->database == CIN2)
+	{
+		LoadMat(pCoordinates.coordinateImage, xyzFileName);
+		pCoordinates.mask = cv::imread(maskFileName, 0);
 	}
+	else
+	{
+		pcl::PointCloud<PointXYZRGBIM>::Ptr cloud (new pcl::PointCloud<PointXYZRGBIM>);
+		if (pcl::io::loadPCDFile<PointXYZRGBIM> (fileName, *cloud) == -1) //* load the file
+		{
+			view.readError = true;
+			return false;
+		}
 
-	// Output
-	//for (int i=0; i<(*pGlobalFeatures)->width; i++) std::cout << cvGetReal2D(*pGlobalFeatures, 0, i) << "\t";
-	//std::cout << "\n";
+		pCoordinates.coordinateImage = cv::Mat::zeros(480, 640, CV_32FC3);
+		pCoordinates.mask = cv::Mat::zeros(480, 640, CV_8UC1);
+		for (size_t i = 0; i < cloud->points.size (); ++i)
+		{
+			int u = cloud->points[i].imX;
+			int v = cloud->points[i].imY;
+			pCoordinates.coordinateImage.at<cv::Point3f>(v, u) = cv::Point3f(cloud->points[i].x, -cloud->points[i].z, cloud->points[i].y);
+			pCoordinates.mask.at<uchar>(v, u) = 255;
+		}
+	}
+	return true;
+}
 
-	return ipa_utils::RET_OK;
+void ObjectClassifier::ExtractDatabaseViewGlobalFeatures(const DatabaseLoaderSettings* pSettings, std::vector<DatabaseView>* pViews, int pViewIndex, DatabaseViewCoordinates& pCoordinates)
+{
+	DatabaseView& view = (*pViews)[pViewIndex];
+
+	GlobalFeatureParams globalFeatureParams = *(pSettings->globalFeatureParams);
+	IplImage coordinateImage = (IplImage)pCoordinates.coordinateImage;
+	IplImage mask = (IplImage)pCoordinates.mask;
+	// both databases are processed with the CIN2 settings of ExtractGlobalFeatures()
+	view.result = ExtractGlobalFeaturesCached(&(view.blobList->BlobFPs), &(view.globalFeatures), pSettings->clusterMode, globalFeatureParams, view.cacheGroups, CIN2,
+											  &coordinateImage, (pCoordinates.mask.empty() ? NULL : &mask), pSettings->timingLogFileName, pSettings->screenLogFile);
 }
 
 int ObjectClassifier::BinaryToInt(ipa_utils::IpaVector<float> pBinary)
@@ -6887,6 +6227,14 @@ int ObjectClassifier::LoadParameters(std::string pFilename)
 	mConsideredClusterCenterVolume.y = 0.3;
 	mConsideredClusterCenterVolume.z = 1.0;
 	mTrackingInfluenceFactorOldData = 0.6;
+	mSegmentationMode = SEGMENTATION_VOXELGRID;
+	mOrganizedNormalMaxDepthChangeFactor = 0.02f;
+	mOrganizedNormalSmoothingSize = 10.0f;
+	mOrganizedPlaneMinInliers = 10000;
+	mOrganizedPlaneAngularThreshold = 3.0;
+	mOrganizedClusterDistanceThreshold = 0.01;
+	mOrganizedClusterMinClusterSize = 500;
+	mOrganizedClusterMaxClusterSize = 150000;
 
 	std::fstream paramFile(pFilename.c_str(), std::ios::in);
 	if (paramFile.is_open() == false)
@@ -6948,6 +6296,22 @@ int ObjectClassifier::LoadParameters(std::string pFilename)
 			paramFile >> mDisplayFontColorBGR.val[2];
 		else if (tag.compare("TrackingInfluenceFactorOldData:")==0)
 			paramFile >> mTrackingInfluenceFactorOldData;
+		else if (tag.compare("SegmentationMode:")==0)
+			paramFile >> mSegmentationMode;
+		else if (tag.compare("OrganizedNormalMaxDepthChangeFactor:")==0)
+			paramFile >> mOrganizedNormalMaxDepthChangeFactor;
+		else if (tag.compare("OrganizedNormalSmoothingSize:")==0)
+			paramFile >> mOrganizedNormalSmoothingSize;
+		else if (tag.compare("OrganizedPlaneMinInliers:")==0)
+			paramFile >> mOrganizedPlaneMinInliers;
+		else if (tag.compare("OrganizedPlaneAngularThreshold:")==0)
+			paramFile >> mOrganizedPlaneAngularThreshold;
+		else if (tag.compare("OrganizedClusterDistanceThreshold:")==0)
+			paramFile >> mOrganizedClusterDistanceThreshold;
+		else if (tag.compare("OrganizedClusterMinClusterSize:")==0)
+			paramFile >> mOrganizedClusterMinClusterSize;
+		else if (tag.compare("OrganizedClusterMaxClusterSize:")==0)
+			paramFile >> mOrganizedClusterMaxClusterSize;
 	}
 
 	paramFile.close();
@@ -7013,95 +6377,29 @@ void ObjectClassifier::PointcloudCallback(const pcl::PointCloud<pcl::PointXYZRGB
 
 		// segment incoming point cloud
 		std::cout << "\nSegmenting data..." << std::endl;
-
-		// only keep points inside a defined volume
-		pcl::PointCloud<pcl::PointXYZRGB>::Ptr inputCloudVoI(new pcl::PointCloud<pcl::PointXYZRGB>);
-		for (unsigned int v=0; v<pInputCloud->height; v++)
-			for (unsigned int u=0; u<pInputCloud->width; u++)
-				if (fabs(pInputCloud->at(u,v).x)<mConsideredVolume.x && fabs(pInputCloud->at(u,v).y)<mConsideredVolume.y && pInputCloud->at(u,v).z<mConsideredVolume.z)
-					inputCloudVoI->push_back(pInputCloud->at(u,v));
-	
-		// Create the filtering object: downsample the dataset using a leaf size of 1cm
-		pcl::VoxelGrid<pcl::PointXYZRGB> vg;
-		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_filtered (new pcl::PointCloud<pcl::PointXYZRGB>);
-		vg.setInputCloud(inputCloudVoI);
-		vg.setLeafSize(mVoxelFilterLeafSize.x, mVoxelFilterLeafSize.y, mVoxelFilterLeafSize.z);
-	//	vg.setLeafSize(0.02f, 0.02f, 0.02f);
-		vg.filter(*cloud_filtered);
-		std::cout << "PointCloud after filtering has: " << cloud_filtered->size()  << " data points left from " << pInputCloud->size() << "." << std::endl;
-	
-		if (cloud_filtered->points.size() == 0)
+		Timer tim;
+		tim.start();
+
+		std::vector<pcl::PointIndices> objectPixelIndices;
+		std::vector<cv::Point3d> objectCenters;
+		int segmentationResult = ipa_utils::RET_OK;
+		if (mSegmentationMode == SEGMENTATION_ORGANIZED)
+			segmentationResult = SegmentObjectsOrganized(pInputCloud, objectPixelIndices, objectCenters);
+		else
+			segmentationResult = SegmentObjectsVoxelGrid(pInputCloud, objectPixelIndices, objectCenters);
+		if (segmentationResult != ipa_utils::RET_OK)
 			return;
-
-		// Create the segmentation object for the planar model and set all the parameters
-		pcl::SACSegmentation<pcl::PointXYZRGB> seg;
-		pcl::PointIndices::Ptr inliers(new pcl::PointIndices);
-		pcl::ModelCoefficients::Ptr coefficients(new pcl::ModelCoefficients);
-	//	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_plane (new pcl::PointCloud<pcl::PointXYZRGB> ());
-		seg.setOptimizeCoefficients(true);
-		seg.setModelType(pcl::SACMODEL_PLANE);
-		seg.setMethodType(pcl::SAC_RANSAC);
-		seg.setMaxIterations(mPlaneSearchMaxIterations);
-		seg.setDistanceThreshold(mPlaneSearchDistanceThreshold);
-
-		int nr_points = (int) cloud_filtered->points.size();
-		while (cloud_filtered->points.size () > mPlaneSearchAbortRemainingPointsFraction * nr_points)
-		{
-			// Segment the largest planar component from the remaining cloud
-			seg.setInputCloud(cloud_filtered);
-			seg.segment (*inliers, *coefficients);
-			if (inliers->indices.size() == 0)
-			{
-				std::cout << "Could not estimate a planar model for the given dataset." << std::endl;
-				break;
-			}
-			if (inliers->indices.size() < mPlaneSearchAbortMinimumPlaneSize)
-				break;
-
-			// Extract the planar inliers from the input cloud
-			pcl::ExtractIndices<pcl::PointXYZRGB> extract;
-			extract.setInputCloud(cloud_filtered);
-			extract.setIndices(inliers);
-
-			// Write the planar inliers to disk
-			//extract.setNegative(false);
-			//extract.filter(*cloud_plane);
-			//std::cout << "PointCloud representing the planar component: " << cloud_plane->points.size () << " data points." << std::endl;
-
-			// Remove the planar inliers, extract the rest
-			pcl::PointCloud<pcl::PointXYZRGB>::Ptr temp(new pcl::PointCloud<pcl::PointXYZRGB>);
-			extract.setNegative(true);
-			extract.filter(*temp);
-			cloud_filtered = temp;
-		}
-
-		// Creating the KdTree object for the search method of the extraction
-		pcl_search<pcl::PointXYZRGB>::Ptr ktree(new pcl_search<pcl::PointXYZRGB>);
-		ktree->setInputCloud(cloud_filtered);
-
-		std::vector<pcl::PointIndices> cluster_indices;
-		pcl::EuclideanClusterExtraction<pcl::PointXYZRGB> ec;
-	//	ec.setClusterTolerance(0.05); //0.05 //0.10// 2cm
-		ec.setClusterTolerance(mClusterSearchToleranceValue); //0.05 //0.10// 2cm
-		ec.setMinClusterSize(mClusterSearchMinClusterSize);
-		ec.setMaxClusterSize(mClusterSearchMaxClusterSize);
-		ec.setSearchMethod(ktree);
-		ec.setInputCloud(cloud_filtered);
-		ec.extract(cluster_indices);
+		std::cout << "Segmentation took " << tim.getElapsedTimeInMilliSec() << " ms and found " << objectPixelIndices.size() << " objects in the center." << std::endl;
 
 		int height = pInputCloud->height;
 		int width = pInputCloud->width;
 		cv::Mat originalImage(cvSize(width, height), CV_8UC3);
-		int u=0, v=0;
-		for (unsigned int i=0; i<pInputCloud->size(); i++)
+		for (int v=0; v<height; v++)
 		{
-			pcl::PointXYZRGB point = pInputCloud->at(i);
-			originalImage.at< cv::Point3_<uchar> >(v, u) = cv::Point3_<uchar>(point.b, point.g, point.r);
-			u++;
-			if (u>=width)
+			for (int u=0; u<width; u++)
 			{
-				u=0;
-				v++;
+				const pcl::PointXYZRGB& point = pInputCloud->points[v*width+u];
+				originalImage.at< cv::Point3_<uchar> >(v, u) = cv::Point3_<uchar>(point.b, point.g, point.r);
 			}
 		}
 		//std::stringstream ss;
@@ -7112,91 +6410,42 @@ void ObjectClassifier::PointcloudCallback(const pcl::PointCloud<pcl::PointXYZRGB
 		mLastDetections = mCurrentDetections;
 		mCurrentDetections.clear();
 
-		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_cluster(new pcl::PointCloud<pcl::PointXYZRGB>);
-		//int j = 0;
-		int clusterIndex = 0;
-		for (std::vector<pcl::PointIndices>::const_iterator it = cluster_indices.begin(); it != cluster_indices.end(); ++it)
+		for (unsigned int objectIndex = 0; objectIndex < objectPixelIndices.size(); objectIndex++)
 		{
-			cv::Point3d avgPoint;
-			avgPoint.x = 0; avgPoint.y = 0; avgPoint.z = 0;
-			for (std::vector<int>::const_iterator pit = it->indices.begin(); pit != it->indices.end(); pit++)
-			{
-				cloud_cluster->points.push_back(cloud_filtered->points[*pit]);
-				avgPoint.x += cloud_filtered->points[*pit].x;
-				avgPoint.y += cloud_filtered->points[*pit].y;
-				avgPoint.z += cloud_filtered->points[*pit].z;
-			}
-
-			std::cout << "PointCloud representing the Cluster: " << cloud_cluster->points.size () << " data points." << std::endl;
-
-			//if ((fabs(avgPoint.x) < cloud_cluster->points.size()*0.15) && (fabs(avgPoint.y) < 0.30*cloud_cluster->points.size()))
-			if ((fabs(avgPoint.x) < mConsideredClusterCenterVolume.x*cloud_cluster->points.size()) && (fabs(avgPoint.y) < mConsideredClusterCenterVolume.y*cloud_cluster->points.size()) && (fabs(avgPoint.z) < mConsideredClusterCenterVolume.z*cloud_cluster->points.size()))
-			{
-				std::cout << "found a cluster in the center" << std::endl;
-
-				// write the pixels within the cluster back to an image
-				pcl_search<pcl::PointXYZRGB>::Ptr selectionTree (new pcl_search<pcl::PointXYZRGB>);
-				selectionTree->setInputCloud(cloud_cluster);
-
-				IplImage* coordinateImage = cvCreateImage(cvSize(width, height), IPL_DEPTH_32F, 3);
-				cvSetZero(coordinateImage);
-				IplImage* colorImage = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
-				cvSetZero(colorImage);
-
-				int u=0, v=0;
-				int umin=100000, vmin=100000;
-				cv::Point3_<uchar> randomColor(255.*rand()/(double)RAND_MAX, 255.*rand()/(double)RAND_MAX, 255.*rand()/(double)RAND_MAX);
-				for (unsigned int i=0; i<pInputCloud->size(); i++)
-				{
-					pcl::PointXYZRGB point = pInputCloud->at(i);
-
-					if (isnan(point.z) == false)
-					{
-						std::vector<int> indices;
-						std::vector<float> sqr_distances;
-						selectionTree->nearestKSearch(point, 1, indices, sqr_distances);
-
-						// if there is a voxel of the cluster close to the query point, save this point in the image
-						if (sqr_distances[0] < 0.01*0.01)
-						{
-							clusterImage.at< cv::Point3_<uchar> >(v, u) = randomColor;
-							cvSet2D(colorImage, v, u, CV_RGB(point.r, point.g, point.b));
-							cvSet2D(coordinateImage, v, u, cvScalar(point.x, point.y, point.z));
-							if (u<umin) umin=u;
-							if (v<vmin) vmin=v;
-						}
-					}
-
-					u++;
-					if (u>=width)
-					{
-						u=0;
-						v++;
-					}
-				}
-
-				std::map<double, std::string> resultsOrdered;
-				std::map<std::string, double> results;
-				SharedImage si;
-				si.setCoord(coordinateImage);
-				si.setShared(colorImage);
-				CategorizeObject(&si, results, resultsOrdered, pClusterMode, pClassifierTypeGlobal, pGlobalFeatureParams);
-				si.Release();
-
-				ObjectLocalizationIdentification oli;
-				oli.objectCenter = avgPoint;
-				oli.textPosition = cv::Point2i(umin, vmin);
-				oli.identificationPDF = results;
-				mCurrentDetections.push_back(oli);
+			// write the pixels of the object to an image
+			IplImage* coordinateImage = cvCreateImage(cvSize(width, height), IPL_DEPTH_32F, 3);
+			cvSetZero(coordinateImage);
+			IplImage* colorImage = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
+			cvSetZero(colorImage);
 
-				clusterIndex++;
-			}
-			cloud_cluster->clear();
+			int umin=100000, vmin=100000;
+			cv::Point3_<uchar> randomColor(255.*rand()/(double)RAND_MAX, 255.*rand()/(double)RAND_MAX, 255.*rand()/(double)RAND_MAX);
+			const std::vector<int>& indices = objectPixelIndices[objectIndex].indices;
+			for (unsigned int i=0; i<indices.size(); i++)
+			{
+				const pcl::PointXYZRGB& point = pInputCloud->points[indices[i]];
+				int u = indices[i] % width;
+				int v = indices[i] / width;
+				clusterImage.at< cv::Point3_<uchar> >(v, u) = randomColor;
+				cvSet2D(colorImage, v, u, CV_RGB(point.r, point.g, point.b));
+				cvSet2D(coordinateImage, v, u, cvScalar(point.x, point.y, point.z));
+				if (u<umin) umin=u;
+				if (v<vmin) vmin=v;
+			}
+
+			std::map<double, std::string> resultsOrdered;
+			std::map<std::string, double> results;
+			SharedImage si;
+			si.setCoord(coordinateImage);
+			si.setShared(colorImage);
+			CategorizeObject(&si, results, resultsOrdered, pClusterMode, pClassifierTypeGlobal, pGlobalFeatureParams);
+			si.Release();
 
-			//std::stringstream ss;
-			//ss << "cloud_cluster_" << j << ".pcd";
-			//writer.write<pcl::PointXYZ> (ss.str (), *cloud_cluster, false);
-			//j++;
+			ObjectLocalizationIdentification oli;
+			oli.objectCenter = objectCenters[objectIndex];
+			oli.textPosition = cv::Point2i(umin, vmin);
+			oli.identificationPDF = results;
+			mCurrentDetections.push_back(oli);
 		}
 
 		// display results
@@ -7375,6 +6624,242 @@ void ObjectClassifier::PointcloudCallback(const pcl::PointCloud<pcl::PointXYZRGB
 
 
 
+int ObjectClassifier::SegmentObjectsVoxelGrid(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& pInputCloud, std::vector<pcl::PointIndices>& pObjectPixelIndices, std::vector<cv::Point3d>& pObjectCenters)
+{
+	pObjectPixelIndices.clear();
+	pObjectCenters.clear();
+
+	// only keep points inside a defined volume
+	pcl::PointCloud<pcl::PointXYZRGB>::Ptr inputCloudVoI(new pcl::PointCloud<pcl::PointXYZRGB>);
+	for (unsigned int v=0; v<pInputCloud->height; v++)
+		for (unsigned int u=0; u<pInputCloud->width; u++)
+			if (fabs(pInputCloud->at(u,v).x)<mConsideredVolume.x && fabs(pInputCloud->at(u,v).y)<mConsideredVolume.y && pInputCloud->at(u,v).z<mConsideredVolume.z)
+				inputCloudVoI->push_back(pInputCloud->at(u,v));
+
+	// Create the filtering object: downsample the dataset using a leaf size of 1cm
+	pcl::VoxelGrid<pcl::PointXYZRGB> vg;
+	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_filtered (new pcl::PointCloud<pcl::PointXYZRGB>);
+	vg.setInputCloud(inputCloudVoI);
+	vg.setLeafSize(mVoxelFilterLeafSize.x, mVoxelFilterLeafSize.y, mVoxelFilterLeafSize.z);
+	vg.filter(*cloud_filtered);
+	std::cout << "PointCloud after filtering has: " << cloud_filtered->size()  << " data points left from " << pInputCloud->size() << "." << std::endl;
+
+	if (cloud_filtered->points.size() == 0)
+		return ipa_utils::RET_FAILED;
+
+	// Create the segmentation object for the planar model and set all the parameters
+	pcl::SACSegmentation<pcl::PointXYZRGB> seg;
+	pcl::PointIndices::Ptr inliers(new pcl::PointIndices);
+	pcl::ModelCoefficients::Ptr coefficients(new pcl::ModelCoefficients);
+	seg.setOptimizeCoefficients(true);
+	seg.setModelType(pcl::SACMODEL_PLANE);
+	seg.setMethodType(pcl::SAC_RANSAC);
+	seg.setMaxIterations(mPlaneSearchMaxIterations);
+	seg.setDistanceThreshold(mPlaneSearchDistanceThreshold);
+
+	int nr_points = (int) cloud_filtered->points.size();
+	while (cloud_filtered->points.size () > mPlaneSearchAbortRemainingPointsFraction * nr_points)
+	{
+		// Segment the largest planar component from the remaining cloud
+		seg.setInputCloud(cloud_filtered);
+		seg.segment (*inliers, *coefficients);
+		if (inliers->indices.size() == 0)
+		{
+			std::cout << "Could not estimate a planar model for the given dataset." << std::endl;
+			break;
+		}
+		if (inliers->indices.size() < mPlaneSearchAbortMinimumPlaneSize)
+			break;
+
+		// Extract the planar inliers from the input cloud
+		pcl::ExtractIndices<pcl::PointXYZRGB> extract;
+		extract.setInputCloud(cloud_filtered);
+		extract.setIndices(inliers);
+
+		// Remove the planar inliers, extract the rest
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr temp(new pcl::PointCloud<pcl::PointXYZRGB>);
+		extract.setNegative(true);
+		extract.filter(*temp);
+		cloud_filtered = temp;
+	}
+
+	// Creating the KdTree object for the search method of the extraction
+	pcl_search<pcl::PointXYZRGB>::Ptr ktree(new pcl_search<pcl::PointXYZRGB>);
+	ktree->setInputCloud(cloud_filtered);
+
+	std::vector<pcl::PointIndices> cluster_indices;
+	pcl::EuclideanClusterExtraction<pcl::PointXYZRGB> ec;
+	ec.setClusterTolerance(mClusterSearchToleranceValue); //0.05 //0.10// 2cm
+	ec.setMinClusterSize(mClusterSearchMinClusterSize);
+	ec.setMaxClusterSize(mClusterSearchMaxClusterSize);
+	ec.setSearchMethod(ktree);
+	ec.setInputCloud(cloud_filtered);
+	ec.extract(cluster_indices);
+
+	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_cluster(new pcl::PointCloud<pcl::PointXYZRGB>);
+	for (std::vector<pcl::PointIndices>::const_iterator it = cluster_indices.begin(); it != cluster_indices.end(); ++it)
+	{
+		cloud_cluster->clear();
+		cv::Point3d avgPoint(0., 0., 0.);
+		for (std::vector<int>::const_iterator pit = it->indices.begin(); pit != it->indices.end(); pit++)
+		{
+			cloud_cluster->points.push_back(cloud_filtered->points[*pit]);
+			avgPoint.x += cloud_filtered->points[*pit].x;
+			avgPoint.y += cloud_filtered->points[*pit].y;
+			avgPoint.z += cloud_filtered->points[*pit].z;
+		}
+		avgPoint *= 1.0/(double)cloud_cluster->points.size();
+
+		std::cout << "PointCloud representing the Cluster: " << cloud_cluster->points.size () << " data points." << std::endl;
+
+		if ((fabs(avgPoint.x) < mConsideredClusterCenterVolume.x) && (fabs(avgPoint.y) < mConsideredClusterCenterVolume.y) && (fabs(avgPoint.z) < mConsideredClusterCenterVolume.z))
+		{
+			std::cout << "found a cluster in the center" << std::endl;
+
+			// collect the pixels which are close to a voxel of the cluster
+			pcl_search<pcl::PointXYZRGB>::Ptr selectionTree (new pcl_search<pcl::PointXYZRGB>);
+			selectionTree->setInputCloud(cloud_cluster);
+
+			pcl::PointIndices pixelIndices;
+			std::vector<int> indices;
+			std::vector<float> sqr_distances;
+			for (unsigned int i=0; i<pInputCloud->size(); i++)
+			{
+				const pcl::PointXYZRGB& point = pInputCloud->points[i];
+				if (isnan(point.z) == false)
+				{
+					selectionTree->nearestKSearch(point, 1, indices, sqr_distances);
+					if (sqr_distances[0] < 0.01*0.01)
+						pixelIndices.indices.push_back(i);
+				}
+			}
+			pObjectPixelIndices.push_back(pixelIndices);
+			pObjectCenters.push_back(avgPoint);
+		}
+	}
+
+	return ipa_utils::RET_OK;
+}
+
+
+int ObjectClassifier::SegmentObjectsOrganized(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& pInputCloud, std::vector<pcl::PointIndices>& pObjectPixelIndices, std::vector<cv::Point3d>& pObjectCenters)
+{
+	pObjectPixelIndices.clear();
+	pObjectCenters.clear();
+
+	const int width = pInputCloud->width;
+	const int height = pInputCloud->height;
+	const int numberPixels = width*height;
+
+	// only keep points inside a defined volume, the remaining points are invalidated so that the cloud stays organized
+	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGB>(*pInputCloud));
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	for (int i=0; i<numberPixels; i++)
+	{
+		pcl::PointXYZRGB& point = cloud->points[i];
+		if (!(fabs(point.x)<mConsideredVolume.x && fabs(point.y)<mConsideredVolume.y && point.z<mConsideredVolume.z))
+			point.x = point.y = point.z = nan;
+	}
+	cloud->is_dense = false;
+
+	// normals from integral images
+	pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
+	pcl::IntegralImageNormalEstimation<pcl::PointXYZRGB, pcl::Normal> ne;
+	ne.setNormalEstimationMethod(pcl::IntegralImageNormalEstimation<pcl::PointXYZRGB, pcl::Normal>::AVERAGE_3D_GRADIENT);
+	ne.setMaxDepthChangeFactor(mOrganizedNormalMaxDepthChangeFactor);
+	ne.setNormalSmoothingSize(mOrganizedNormalSmoothingSize);
+	ne.setInputCloud(cloud);
+	ne.compute(*normals);
+
+	// all planes of the scene in one pass over the image grid
+	pcl::OrganizedMultiPlaneSegmentation<pcl::PointXYZRGB, pcl::Normal, pcl::Label> mps;
+	mps.setMinInliers(mOrganizedPlaneMinInliers);
+	mps.setAngularThreshold(mOrganizedPlaneAngularThreshold/180.*M_PI);
+	mps.setDistanceThreshold(mPlaneSearchDistanceThreshold);
+	mps.setInputNormals(normals);
+	mps.setInputCloud(cloud);
+	std::vector<pcl::PlanarRegion<pcl::PointXYZRGB>, Eigen::aligned_allocator<pcl::PlanarRegion<pcl::PointXYZRGB> > > regions;
+	std::vector<pcl::ModelCoefficients> modelCoefficients;
+	std::vector<pcl::PointIndices> inlierIndices, labelIndices, boundaryIndices;
+	pcl::PointCloud<pcl::Label>::Ptr labels(new pcl::PointCloud<pcl::Label>);
+	mps.segmentAndRefine(regions, modelCoefficients, inlierIndices, labels, labelIndices, boundaryIndices);
+	std::cout << "Found " << regions.size() << " planes." << std::endl;
+
+	// label image: -2 = invalid or plane, -1 = not visited yet, >=0 = cluster index
+	std::vector<int> clusterLabels(numberPixels, -1);
+	for (int i=0; i<numberPixels; i++)
+		if (isnan(cloud->points[i].z))
+			clusterLabels[i] = -2;
+	for (unsigned int r=0; r<inlierIndices.size(); r++)
+		for (unsigned int i=0; i<inlierIndices[r].indices.size(); i++)
+			clusterLabels[inlierIndices[r].indices[i]] = -2;
+
+	// connected components of the remaining pixels, neighboring pixels belong to the same cluster if their points are close
+	const float squaredDistanceThreshold = (float)(mOrganizedClusterDistanceThreshold*mOrganizedClusterDistanceThreshold);
+	const int neighborOffsetU[4] = {-1, 1, 0, 0};
+	const int neighborOffsetV[4] = {0, 0, -1, 1};
+	std::vector<int> stack;
+	int numberClusters = 0;
+	for (int seed=0; seed<numberPixels; seed++)
+	{
+		if (clusterLabels[seed] != -1)
+			continue;
+
+		pcl::PointIndices pixelIndices;
+		cv::Point3d avgPoint(0., 0., 0.);
+		clusterLabels[seed] = numberClusters;
+		stack.push_back(seed);
+		while (stack.empty() == false)
+		{
+			int index = stack.back();
+			stack.pop_back();
+			const pcl::PointXYZRGB& point = cloud->points[index];
+			pixelIndices.indices.push_back(index);
+			avgPoint.x += point.x;
+			avgPoint.y += point.y;
+			avgPoint.z += point.z;
+
+			int u = index % width;
+			int v = index / width;
+			for (int n=0; n<4; n++)
+			{
+				int nu = u + neighborOffsetU[n];
+				int nv = v + neighborOffsetV[n];
+				if (nu < 0 || nu >= width || nv < 0 || nv >= height)
+					continue;
+				int neighborIndex = nv*width + nu;
+				if (clusterLabels[neighborIndex] != -1)
+					continue;
+				const pcl::PointXYZRGB& neighbor = cloud->points[neighborIndex];
+				float dx = neighbor.x-point.x, dy = neighbor.y-point.y, dz = neighbor.z-point.z;
+				if (dx*dx+dy*dy+dz*dz < squaredDistanceThreshold)
+				{
+					clusterLabels[neighborIndex] = numberClusters;
+					stack.push_back(neighborIndex);
+				}
+			}
+		}
+		numberClusters++;
+
+		int clusterSize = (int)pixelIndices.indices.size();
+		if (clusterSize < mOrganizedClusterMinClusterSize || clusterSize > mOrganizedClusterMaxClusterSize)
+			continue;
+		avgPoint *= 1.0/(double)clusterSize;
+
+		std::cout << "PointCloud representing the Cluster: " << clusterSize << " data points." << std::endl;
+
+		if ((fabs(avgPoint.x) < mConsideredClusterCenterVolume.x) && (fabs(avgPoint.y) < mConsideredClusterCenterVolume.y) && (fabs(avgPoint.z) < mConsideredClusterCenterVolume.z))
+		{
+			std::cout << "found a cluster in the center" << std::endl;
+			pObjectPixelIndices.push_back(pixelIndices);
+			pObjectCenters.push_back(avgPoint);
+		}
+	}
+
+	return ipa_utils::RET_OK;
+}
+
+
 // capture code
 
 int ObjectClassifier::CaptureSegmentedPCD(ClusterMode pClusterMode, ClassifierType pClassifierTypeGlobal, GlobalFeatureParams& pGlobalFeatureParams)
@@ -8301,22 +7786,20 @@ int ObjectClassifier::HermesLoadCameraCalibration(const std::string& object_name
 }
 
 
-int ObjectClassifier::HermesDetectInit(const ClusterMode pClusterMode, const ClassifierType pClassifierTypeGlobal, const GlobalFeatureParams& pGlobalFeatureParams, const std::string& pObjectName)
+int ObjectClassifier::HermesLoadDetectionModel()
 {
-	if (pObjectName.compare("")==0)
-	{
-		std::cout << "Input object name: ";
-		std::cin >> mFilePrefix;
-	}
-	else
-		mFilePrefix = pObjectName;
+	mHermesLoadedObjectName.clear();
+	mSapData.clear();
+	mVfhData.clear();
+	mRollHistogram.clear();
+	mReferenceFilenames.clear();
 
 	std::string metaFileName = std::string(getenv("HOME")) + "/.ros/cob_object_categorization/hermes/" + mFilePrefix + "_labels.txt";
 
 	mLabelFile.open(metaFileName.c_str(), std::ios::in);
 	if (mLabelFile.is_open() == false)
 	{
-		std::cout << "ObjectClassifier::HermesCapture: Error: Could not open " << metaFileName << "." << std::endl;
+		std::cout << "ObjectClassifier::HermesLoadDetectionModel: Error: Could not open " << metaFileName << "." << std::endl;
 		return ipa_utils::RET_FAILED;
 	}
 
@@ -8390,6 +7873,7 @@ int ObjectClassifier::HermesDetectInit(const ClusterMode pClusterMode, const Cla
 			itInner->second.push_back(avgVfhDesc);
 		}
 	}
+	HermesBuildViewIndex();
 
 	// mean roll histogram
 	for (itOuter = mRollHistogram.begin(); itOuter != mRollHistogram.end(); itOuter++)
@@ -8410,8 +7894,44 @@ int ObjectClassifier::HermesDetectInit(const ClusterMode pClusterMode, const Cla
 		}
 	}
 
+	// load the reference views once, so that the pose refinement does not access the disk
+	mReferenceModels.clear();
+	for (std::map<double, std::map<double, std::string > >::iterator itPan = mReferenceFilenames.begin(); itPan != mReferenceFilenames.end(); itPan++)
+	{
+		for (std::map<double, std::string >::iterator itTilt = itPan->second.begin(); itTilt != itPan->second.end(); itTilt++)
+		{
+			HermesReferenceModel model;
+			if (HermesLoadReferenceModel(itTilt->second, model) == ipa_utils::RET_OK)
+				mReferenceModels[itPan->first][itTilt->first] = model;
+		}
+	}
+
+	mHermesLoadedObjectName = mFilePrefix;
 	std::cout << "Data for object " << mFilePrefix << " loaded." << std::endl;
 
+	return ipa_utils::RET_OK;
+}
+
+
+int ObjectClassifier::HermesDetectInit(const ClusterMode pClusterMode, const ClassifierType pClassifierTypeGlobal, const GlobalFeatureParams& pGlobalFeatureParams, const std::string& pObjectName)
+{
+	if (pObjectName.compare("")==0)
+	{
+		std::cout << "Input object name: ";
+		std::cin >> mFilePrefix;
+	}
+	else
+		mFilePrefix = pObjectName;
+
+	// the detection model stays loaded across requests for the same object
+	if (mHermesLoadedObjectName.compare(mFilePrefix) != 0)
+	{
+		if (HermesLoadDetectionModel() != ipa_utils::RET_OK)
+			return ipa_utils::RET_FAILED;
+	}
+	else
+		std::cout << "Data for object " << mFilePrefix << " already loaded." << std::endl;
+
 #ifndef __LINUX__
 
 	pcl::Grabber* kinectGrabber = new pcl::OpenNIGrabber();
@@ -8853,23 +8373,13 @@ int ObjectClassifier::HermesCategorizeObject(pcl::PointCloud<pcl::PointXYZRGB>::
 	pGlobalFeatureParams.useFeature["sap"] = false;
 	pGlobalFeatureParams.useFeature["vfh"] = true;
 	ExtractGlobalFeatures(&Blobs, featureVector, pClusterMode, pGlobalFeatureParams, INVALID, pSourceImage->Coord(), mask, NULL, false, "");
-	for (itOuter = mVfhData.begin(); itOuter != mVfhData.end(); itOuter++)
-	{
-		for (itInner = itOuter->second.begin(); itInner != itOuter->second.end(); itInner++)
-		{
-//			double diff = 0.;
-//			for (int i=0; i<(*featureVector)->cols; i++)
-//			{
-//				double val = cvGetReal1D(*featureVector, i) - itInner->second[0][i];
-//				diff += val*val;
-//			}
-			cv::Mat featureVectorMat(1, (*featureVector)->cols, CV_32FC1);
-			for (int i=0; i<(*featureVector)->cols; i++)
-				featureVectorMat.at<float>(i) = cvGetReal1D(*featureVector, i);
-			double diff = -HermesHistogramIntersectionKernel(itInner->second[0], featureVectorMat, 0);
-			vfhOrderedList.insert(std::pair<double, std::pair<double, double> >(diff, std::pair<double, double>(itOuter->first, itInner->first)));
-		}
-	}
+	cv::Mat featureVectorMat(1, (*featureVector)->cols, CV_32FC1);
+	for (int i=0; i<(*featureVector)->cols; i++)
+		featureVectorMat.at<float>(i) = cvGetReal1D(*featureVector, i);
+	std::vector<std::pair<double, std::pair<double, double> > > retrievedViews;
+	HermesRetrieveViews(featureVectorMat, 40, mHermesApproximateViewSearch, retrievedViews);
+	for (int i=0; i<(int)retrievedViews.size(); i++)
+		vfhOrderedList.insert(retrievedViews[i]);
 	std::cout << "pan\ttilt\tdiff" << std::endl;
 	double factor=180./CV_PI;
 	int counter = 0;
@@ -8877,7 +8387,7 @@ int ObjectClassifier::HermesCategorizeObject(pcl::PointCloud<pcl::PointXYZRGB>::
 		std::cout <<  itOrderedList->second.first*factor << "\t" << itOrderedList->second.second*factor << "\t" << itOrderedList->first << "\t" << itOrderedList->second.first << "\t" << itOrderedList->second.second << std::endl;
 
 	// check whether the cluster is the object
-	if (vfhOrderedList.begin()->first < -340.0)
+	if (vfhOrderedList.size() > 0 && vfhOrderedList.begin()->first < -340.0)
 	{
 		// hack: green: 0.511671  0.251772
 		pan = vfhOrderedList.begin()->second.first;
@@ -8960,38 +8470,202 @@ int ObjectClassifier::HermesMatchRollHistogram(std::vector<float>& pReferenceHis
 		double score = HermesHistogramIntersectionKernel(pReferenceHistogram, pMatchHistogram, pOffset+offset);
 		if (score > pMatchScore)
 		{
-			pMatchScore = score;
-			pOffset = pOffset+offset;
+			pMatchScore = score;
+			pOffset = pOffset+offset;
+		}
+	}
+
+	return ipa_utils::RET_OK;
+}
+
+
+double ObjectClassifier::HermesHistogramIntersectionKernel(std::vector<float>& pReferenceHistogram, cv::Mat& pMatchHistogram, int pOffset)
+{
+	double score = 0;
+
+	if ((int)pReferenceHistogram.size() != pMatchHistogram.cols)
+		std::cout << "ObjectClassifier::HermesHistogramIntersectionKernel: Error: Array sizes do not match." << std::endl;
+
+	int size = pMatchHistogram.cols;
+
+	for (int i=0; i<size; i++)
+		score += std::min<float>(pReferenceHistogram[i], pMatchHistogram.at<float>((i+pOffset)%size));
+	return score;
+}
+
+
+int ObjectClassifier::HermesBuildViewIndex()
+{
+	mHermesVfhViewIndex.release();
+	mHermesVfhViewAngles.clear();
+	mHermesVfhViewMaxMass = 0.f;
+
+	std::map<double, std::map<double, std::vector<std::vector<float> > > >::iterator itOuter;
+	std::map<double, std::vector<std::vector<float> > >::iterator itInner;
+	int descriptorSize = -1;
+	for (itOuter = mVfhData.begin(); itOuter != mVfhData.end(); itOuter++)
+		for (itInner = itOuter->second.begin(); itInner != itOuter->second.end(); itInner++)
+		{
+			if (descriptorSize == -1)
+				descriptorSize = (int)itInner->second[0].size();
+			else if (descriptorSize != (int)itInner->second[0].size())
+			{
+				std::cout << "ObjectClassifier::HermesBuildViewIndex: Error: The VFH descriptors of the views differ in size." << std::endl;
+				mHermesVfhViewDescriptors.release();
+				return ipa_utils::RET_FAILED;
+			}
+			mHermesVfhViewAngles.push_back(std::pair<double, double>(itOuter->first, itInner->first));
+		}
+	if (mHermesVfhViewAngles.size() == 0)
+	{
+		mHermesVfhViewDescriptors.release();
+		return ipa_utils::RET_FAILED;
+	}
+
+	// one row per view, the last column holds the mass of the descriptor
+	mHermesVfhViewDescriptors.create((int)mHermesVfhViewAngles.size(), descriptorSize+1, CV_32FC1);
+	for (int view=0; view<(int)mHermesVfhViewAngles.size(); view++)
+	{
+		const std::vector<float>& descriptor = mVfhData[mHermesVfhViewAngles[view].first][mHermesVfhViewAngles[view].second][0];
+		float* row = mHermesVfhViewDescriptors.ptr<float>(view);
+		float mass = 0.f;
+		for (int i=0; i<descriptorSize; i++)
+		{
+			row[i] = descriptor[i];
+			mass += descriptor[i];
+		}
+		row[descriptorSize] = mass;
+		mHermesVfhViewMaxMass = std::max(mHermesVfhViewMaxMass, mass);
+	}
+
+	mHermesVfhViewIndex = new cv::flann::Index(mHermesVfhViewDescriptors, cv::flann::KDTreeIndexParams(mHermesViewSearchTrees), cvflann::FLANN_DIST_L1);
+
+	return ipa_utils::RET_OK;
+}
+
+
+int ObjectClassifier::HermesRetrieveViews(const cv::Mat& pDescriptor, int pK, bool pApproximate, std::vector<std::pair<double, std::pair<double, double> > >& pViews)
+{
+	pViews.clear();
+	int descriptorSize = mHermesVfhViewDescriptors.cols-1;
+	if (mHermesVfhViewDescriptors.empty() == true || pDescriptor.cols != descriptorSize)
+	{
+		std::cout << "ObjectClassifier::HermesRetrieveViews: Error: No view index or the descriptor size does not match." << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
+	pK = std::min(pK, mHermesVfhViewDescriptors.rows);
+
+	if (pApproximate == true && mHermesVfhViewIndex.empty() == false)
+	{
+		cv::Mat query(1, descriptorSize+1, CV_32FC1);
+		pDescriptor.copyTo(query.colRange(0, descriptorSize));
+		query.at<float>(descriptorSize) = mHermesVfhViewMaxMass;
+		cv::Mat indices, dists;
+		mHermesVfhViewIndex->knnSearch(query, indices, dists, pK, cv::flann::SearchParams(mHermesViewSearchChecks));
+
+		// the scores of the retrieved views are computed exactly
+		const float* descriptor = pDescriptor.ptr<float>(0);
+		for (int k=0; k<pK; k++)
+		{
+			int view = indices.at<int>(k);
+			if (view < 0)
+				continue;
+			const float* row = mHermesVfhViewDescriptors.ptr<float>(view);
+			double score = 0.;
+			for (int i=0; i<descriptorSize; i++)
+				score += std::min<float>(row[i], descriptor[i]);
+			pViews.push_back(std::pair<double, std::pair<double, double> >(-score, mHermesVfhViewAngles[view]));
+		}
+		std::sort(pViews.begin(), pViews.end());
+	}
+	else
+	{
+		const float* descriptor = pDescriptor.ptr<float>(0);
+		std::vector<std::pair<double, int> > scores(mHermesVfhViewDescriptors.rows);
+		for (int view=0; view<mHermesVfhViewDescriptors.rows; view++)
+		{
+			const float* row = mHermesVfhViewDescriptors.ptr<float>(view);
+			double score = 0.;
+			for (int i=0; i<descriptorSize; i++)
+				score += std::min<float>(row[i], descriptor[i]);
+			scores[view] = std::pair<double, int>(-score, view);
 		}
+		std::partial_sort(scores.begin(), scores.begin()+pK, scores.end());
+		for (int k=0; k<pK; k++)
+			pViews.push_back(std::pair<double, std::pair<double, double> >(scores[k].first, mHermesVfhViewAngles[scores[k].second]));
 	}
 
 	return ipa_utils::RET_OK;
 }
 
 
-double ObjectClassifier::HermesHistogramIntersectionKernel(std::vector<float>& pReferenceHistogram, cv::Mat& pMatchHistogram, int pOffset)
+int ObjectClassifier::HermesViewIndexBenchmark(int pNumberQueries, int pK, double pNoiseLevel, std::ostream& pOutput)
 {
-	double score = 0;
-
-	if ((int)pReferenceHistogram.size() != pMatchHistogram.cols)
-		std::cout << "ObjectClassifier::HermesHistogramIntersectionKernel: Error: Array sizes do not match." << std::endl;
+	if (mHermesVfhViewDescriptors.empty() == true || pNumberQueries < 1 || pK < 1)
+	{
+		std::cout << "ObjectClassifier::HermesViewIndexBenchmark: Error: No views loaded or invalid parameters." << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
+	int descriptorSize = mHermesVfhViewDescriptors.cols-1;
+	int k = std::min(pK, mHermesVfhViewDescriptors.rows);
+
+	// queries: descriptors of random views with relative noise on each bin
+	cv::RNG rng(42);
+	std::vector<cv::Mat> queries(pNumberQueries);
+	for (int q=0; q<pNumberQueries; q++)
+	{
+		int view = rng.uniform(0, mHermesVfhViewDescriptors.rows);
+		queries[q].create(1, descriptorSize, CV_32FC1);
+		const float* row = mHermesVfhViewDescriptors.ptr<float>(view);
+		for (int i=0; i<descriptorSize; i++)
+			queries[q].at<float>(i) = std::max(0.f, row[i] * (float)(1. + rng.gaussian(pNoiseLevel)));
+	}
+
+	std::vector<std::vector<std::pair<double, std::pair<double, double> > > > exactViews(pNumberQueries), approximateViews(pNumberQueries);
+	PrecisionStopWatch sw;
+	sw.precisionStart();
+	for (int q=0; q<pNumberQueries; q++)
+		HermesRetrieveViews(queries[q], k, false, exactViews[q]);
+	double exactTime = sw.precisionStop();
+	sw.precisionStart();
+	for (int q=0; q<pNumberQueries; q++)
+		HermesRetrieveViews(queries[q], k, true, approximateViews[q]);
+	double approximateTime = sw.precisionStop();
+
+	// recall of the exact top k views and agreement of the best view
+	int retrieved = 0, sameBestView = 0;
+	for (int q=0; q<pNumberQueries; q++)
+	{
+		for (int i=0; i<(int)approximateViews[q].size(); i++)
+			for (int j=0; j<(int)exactViews[q].size(); j++)
+				if (approximateViews[q][i].second == exactViews[q][j].second)
+				{
+					retrieved++;
+					break;
+				}
+		if (approximateViews[q].size() > 0 && exactViews[q].size() > 0 && approximateViews[q][0].second == exactViews[q][0].second)
+			sameBestView++;
+	}
 
-	int size = pMatchHistogram.cols;
+	pOutput << "views\tdescriptor size\tqueries\tk\ttrees\tchecks\texact time per query [ms]\tapproximate time per query [ms]\trecall@k\tbest view identical" << std::endl;
+	pOutput << mHermesVfhViewDescriptors.rows << "\t" << descriptorSize << "\t" << pNumberQueries << "\t" << k << "\t" << mHermesViewSearchTrees << "\t" << mHermesViewSearchChecks << "\t"
+			<< 1000.*exactTime/pNumberQueries << "\t" << 1000.*approximateTime/pNumberQueries << "\t" << (double)retrieved/(pNumberQueries*k) << "\t" << (double)sameBestView/pNumberQueries << std::endl;
 
-	for (int i=0; i<size; i++)
-		score += std::min<float>(pReferenceHistogram[i], pMatchHistogram.at<float>((i+pOffset)%size));
-	return score;
+	return ipa_utils::RET_OK;
 }
 
 
-int ObjectClassifier::HermesMatchPointClouds(pcl::PointCloud<pcl::PointXYZRGB>::Ptr pCapturedCloud, pcl::PointXYZ pAvgPoint, double pan, double tilt, double roll, Eigen::Matrix4f& pFinalTransform, double& pMatchingScore)
+int ObjectClassifier::HermesLoadReferenceModel(const std::string& pFilename, HermesReferenceModel& pModel)
 {
-	// look up suitable file for reference point cloud
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr referenceCloudOriginal(new pcl::PointCloud<pcl::PointXYZRGB>);
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr referenceCloud(new pcl::PointCloud<pcl::PointXYZRGB>);
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr alignedReferenceCloud(new pcl::PointCloud<pcl::PointXYZRGB>);
-	std::cout << "ObjectClassifier::HermesMatchPointClouds: Loading pcd file... " << std::flush;
-	pcl::io::loadPCDFile(mReferenceFilenames[pan][tilt], *referenceCloudOriginal);
+	std::cout << "ObjectClassifier::HermesLoadReferenceModel: Loading pcd file " << pFilename << "... " << std::flush;
+	if (pcl::io::loadPCDFile(pFilename, *referenceCloudOriginal) != 0)
+	{
+		std::cout << "ObjectClassifier::HermesLoadReferenceModel: Error: Could not load " << pFilename << "." << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
 	std::cout << "finished." << std::endl;
 	pcl::PointXYZ avgRefrencePoint(0,0,0);
 	for (int p=0; p<(int)referenceCloudOriginal->points.size(); p++)
@@ -9024,6 +8698,35 @@ int ObjectClassifier::HermesMatchPointClouds(pcl::PointCloud<pcl::PointXYZRGB>::
 	transform(2,3) = -avgRefrencePoint.z;
 	pcl::transformPointCloud(*referenceCloud, *alignedReferenceCloud, transform);
 
+	if (mHermesReferenceVoxelSize > 0.)
+	{
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr downsampledReferenceCloud(new pcl::PointCloud<pcl::PointXYZRGB>);
+		pcl::VoxelGrid<pcl::PointXYZRGB> voxelGrid;
+		voxelGrid.setInputCloud(alignedReferenceCloud);
+		voxelGrid.setLeafSize(mHermesReferenceVoxelSize, mHermesReferenceVoxelSize, mHermesReferenceVoxelSize);
+		voxelGrid.filter(*downsampledReferenceCloud);
+		alignedReferenceCloud = downsampledReferenceCloud;
+	}
+
+	pModel.cloud = alignedReferenceCloud;
+	pModel.tree = pcl::search::KdTree<pcl::PointXYZRGB>::Ptr(new pcl::search::KdTree<pcl::PointXYZRGB>);
+	pModel.tree->setInputCloud(pModel.cloud);
+
+	return ipa_utils::RET_OK;
+}
+
+int ObjectClassifier::HermesMatchPointClouds(pcl::PointCloud<pcl::PointXYZRGB>::Ptr pCapturedCloud, pcl::PointXYZ pAvgPoint, double pan, double tilt, double roll, Eigen::Matrix4f& pFinalTransform, double& pMatchingScore)
+{
+	// look up the prepared reference point cloud, views missing in the store are loaded once
+	if (mReferenceModels.find(pan) == mReferenceModels.end() || mReferenceModels[pan].find(tilt) == mReferenceModels[pan].end())
+	{
+		HermesReferenceModel model;
+		if (HermesLoadReferenceModel(mReferenceFilenames[pan][tilt], model) != ipa_utils::RET_OK)
+			return ipa_utils::RET_FAILED;
+		mReferenceModels[pan][tilt] = model;
+	}
+	const HermesReferenceModel& referenceModel = mReferenceModels[pan][tilt];
+
 	// align roll of captured point cloud (reference roll is 0)
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr alignedCapturedCloud(new pcl::PointCloud<pcl::PointXYZRGB>);
 	Eigen::Matrix4f shift;
@@ -9038,7 +8741,7 @@ int ObjectClassifier::HermesMatchPointClouds(pcl::PointCloud<pcl::PointXYZRGB>::
 	rotation(0,1) = -si;
 	rotation(1,0) = si;
 	rotation(1,1) = co;
-	transform = rotation * shift;
+	Eigen::Matrix4f transform = rotation * shift;
 	pcl::transformPointCloud(*pCapturedCloud, *alignedCapturedCloud, transform);
 
 	for (int p=0; p<(int)alignedCapturedCloud->points.size(); p++)
@@ -9052,7 +8755,8 @@ int ObjectClassifier::HermesMatchPointClouds(pcl::PointCloud<pcl::PointXYZRGB>::
 	std::cout << "Starting ICP" << std::endl;
 	pcl::IterativeClosestPoint<pcl::PointXYZRGB, pcl::PointXYZRGB> icp;
 	icp.setInputSource(alignedCapturedCloud);
-	icp.setInputTarget(alignedReferenceCloud);
+	icp.setInputTarget(referenceModel.cloud);
+	icp.setSearchMethodTarget(referenceModel.tree, true);	// the tree is built for the target already
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr fusedCloud(new pcl::PointCloud<pcl::PointXYZRGB>);
 	icp.align(*fusedCloud);
 	std::cout << "ICP has converged:" << icp.hasConverged() << " score: " << icp.getFitnessScore() << std::endl;
@@ -9109,6 +8813,15 @@ int ObjectClassifier::HermesMatchPointClouds(pcl::PointCloud<pcl::PointXYZRGB>::
 
 
 
+/// Draws a random index from [0, pRange) with pRNG or with rand() if no generator is provided.
+static int RandomIndex(int pRange, cv::RNG* pRNG)
+{
+	if (pRNG == NULL)
+		return int(pRange*((double)rand()/((double)RAND_MAX+1.0)));
+	return pRNG->uniform(0, pRange);
+}
+
+
 ClassificationData::ClassificationData()
 {
 	mSqrtInverseCovarianceMatrix = NULL;
@@ -9125,9 +8838,12 @@ ClassificationData::~ClassificationData()
 }
 
 
-int ClassificationData::GetLocalFeatureMatrix(std::string pClass, CvMat** pFeatureMatrix, float pFactorCorrect, float pFactorIncorrect, int& pNumberCorrectSamples)
+int ClassificationData::GetLocalFeatureMatrix(std::string pClass, CvMat** pFeatureMatrix, float pFactorCorrect, float pFactorIncorrect, int& pNumberCorrectSamples, cv::RNG* pRNG)
 {
-	if ((mItLocalFeaturesMap=mLocalFeaturesMap.find(pClass)) == mLocalFeaturesMap.end())
+	// only local iterators are used in here, so the function may run concurrently for different classes
+	LocalFeaturesMap::iterator ItLocalFeaturesMap;
+	ObjectMap::iterator ItObjectMap;
+	if ((ItLocalFeaturesMap=mLocalFeaturesMap.find(pClass)) == mLocalFeaturesMap.end())
 	{
 		*pFeatureMatrix = NULL;
 		std::cout << "ClassificaionData::GetLocalFeatureMatrix: No class found with name" << pClass;
@@ -9159,10 +8875,9 @@ int ClassificationData::GetLocalFeatureMatrix(std::string pClass, CvMat** pFeatu
 
 	// fill temp matrix with all existing correct samples
 	int SampleCounter = 0;
-	mItLocalFeaturesMap=mLocalFeaturesMap.find(pClass);
-	for (mItObjectMap = mItLocalFeaturesMap->second.begin(); mItObjectMap != mItLocalFeaturesMap->second.end(); mItObjectMap++)
+	for (ItObjectMap = ItLocalFeaturesMap->second.begin(); ItObjectMap != ItLocalFeaturesMap->second.end(); ItObjectMap++)
 	{
-		for (ItBlobListStructs = mItObjectMap->second.begin(); ItBlobListStructs != mItObjectMap->second.end(); ItBlobListStructs++)
+		for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
 		{
 			BlobListRiB::iterator ItBlobList;
 			for (ItBlobList = ItBlobListStructs->BlobFPs.begin(); ItBlobList != ItBlobListStructs->BlobFPs.end(); ItBlobList++, SampleCounter++)
@@ -9181,7 +8896,7 @@ int ClassificationData::GetLocalFeatureMatrix(std::string pClass, CvMat** pFeatu
 	for (int i=0; i<NumberSamples; i++) Indices.push_back(i);
 	for (int i=0; i<NumberCorrectSamples; i++)
 	{
-		int Index = int(Indices.size()*((double)rand()/((double)RAND_MAX+1.0)));
+		int Index = RandomIndex((int)Indices.size(), pRNG);
 		ItIndices = Indices.begin();
 		for (int k=0; k<Index; k++, ItIndices++);
 		for (int j=0; j<NumberFeatures; j++)
@@ -9194,7 +8909,7 @@ int ClassificationData::GetLocalFeatureMatrix(std::string pClass, CvMat** pFeatu
 	cvReleaseMat(&TempFeatureMatrix);
 
 	// fill rest of *pFeatureMatrix with incorrect samples
-	GetNegativeSamplesMatrixLocal(pClass, *pFeatureMatrix, NumberCorrectSamples, (NumberCorrectSamples+NumberIncorrectSamples));
+	GetNegativeSamplesMatrixLocal(pClass, *pFeatureMatrix, NumberCorrectSamples, (NumberCorrectSamples+NumberIncorrectSamples), pRNG);
 	
 /*	// Output
 	for (int i=0; i<(*pFeatureMatrix)->height; i++)
@@ -9208,8 +8923,10 @@ int ClassificationData::GetLocalFeatureMatrix(std::string pClass, CvMat** pFeatu
 }
 
 
-int ClassificationData::GetNegativeSamplesMatrixLocal(std::string pClass, CvMat* pNegativeSamplesMatrix, int pLowerBound, int pUpperBound)
+int ClassificationData::GetNegativeSamplesMatrixLocal(std::string pClass, CvMat* pNegativeSamplesMatrix, int pLowerBound, int pUpperBound, cv::RNG* pRNG)
 {
+	LocalFeaturesMap::iterator ItLocalFeaturesMap;
+	ObjectMap::iterator ItObjectMap;
 	ObjectMap::value_type::second_type::iterator ItBlobListStructs;
 	int NumberFeatures = GetNumberLocalFeatures();
 
@@ -9218,27 +8935,27 @@ int ClassificationData::GetNegativeSamplesMatrixLocal(std::string pClass, CvMat*
 		// find class randomly
 		while(1)
 		{
-			int ClassIndex = int(mLocalFeaturesMap.size()*((double)rand()/((double)RAND_MAX+1.0)));
-			mItLocalFeaturesMap = mLocalFeaturesMap.begin();
-			for (int k=0; k<ClassIndex; k++, mItLocalFeaturesMap++);
-			if (mItLocalFeaturesMap->first != pClass) break;
+			int ClassIndex = RandomIndex((int)mLocalFeaturesMap.size(), pRNG);
+			ItLocalFeaturesMap = mLocalFeaturesMap.begin();
+			for (int k=0; k<ClassIndex; k++, ItLocalFeaturesMap++);
+			if (ItLocalFeaturesMap->first != pClass) break;
 		}
 
 		// find object randomly
-		int ObjectIndex = int(mItLocalFeaturesMap->second.size()*((double)rand()/((double)RAND_MAX+1.0)));
-		mItObjectMap = mItLocalFeaturesMap->second.begin();
-		for (int k=0; k<ObjectIndex; k++, mItObjectMap++);
+		int ObjectIndex = RandomIndex((int)ItLocalFeaturesMap->second.size(), pRNG);
+		ItObjectMap = ItLocalFeaturesMap->second.begin();
+		for (int k=0; k<ObjectIndex; k++, ItObjectMap++);
 
 		while(1)
 		{
 			// find view randomly (which has feature points)
-			int ViewIndex = int(mItObjectMap->second.size()*((double)rand()/((double)RAND_MAX+1.0)));
-			ItBlobListStructs = mItObjectMap->second.begin();
+			int ViewIndex = RandomIndex((int)ItObjectMap->second.size(), pRNG);
+			ItBlobListStructs = ItObjectMap->second.begin();
 			for (int k=0; k<ViewIndex; k++, ItBlobListStructs++);
 			if (ItBlobListStructs->BlobFPs.size() > 0) break;
 		}
 		// find sample randomly
-		int SampleIndex = int(ItBlobListStructs->BlobFPs.size()*((double)rand()/((double)RAND_MAX+1.0)));
+		int SampleIndex = RandomIndex((int)ItBlobListStructs->BlobFPs.size(), pRNG);
 		BlobListRiB::iterator ItBlobFPs = ItBlobListStructs->BlobFPs.begin();
 		for (int k=0; k<SampleIndex; k++, ItBlobFPs++);
 		
@@ -9290,11 +9007,12 @@ CvMat* ClassificationData::CreateAllLocalFeatureMatrix(int pNumberSamples, int p
 }
 
 
-int ClassificationData::GetGlobalFeatureMatrix(std::string pClass, CvMat** pFeatureMatrix, float pFactorCorrect, float pFactorIncorrect, int& pNumberCorrectSamples)
+int ClassificationData::GetGlobalFeatureMatrix(std::string pClass, cv::Mat& pFeatureMatrix, float pFactorCorrect, float pFactorIncorrect, int& pNumberCorrectSamples, cv::RNG* pRNG, TrainingMatrixBuffer* pBuffer)
 {
-	if ((mItGlobalFeaturesMap=mGlobalFeaturesMap.find(pClass)) == mGlobalFeaturesMap.end())
+	// only local iterators are used in here, so the function may run concurrently for different classes
+	GlobalFeaturesMap::iterator ItGlobalFeaturesMap;
+	if ((ItGlobalFeaturesMap=mGlobalFeaturesMap.find(pClass)) == mGlobalFeaturesMap.end())
 	{
-		*pFeatureMatrix = NULL;
 		std::cout << "ClassificaionData::GetGlobalFeatureMatrix: No class found with name" << pClass;
 		return ipa_utils::RET_FAILED;
 	}
@@ -9311,103 +9029,104 @@ int ClassificationData::GetGlobalFeatureMatrix(std::string pClass, CvMat** pFeat
 		return ipa_utils::RET_FAILED;
 	}
 
-	int NumberSamples=0;
+	// index view on all samples of the class: (object matrix, row)
+	std::vector<cv::Mat> objectSamples;
+	std::vector< std::pair<int, int> > Indices;
 	int NumberFeatures=0;
 	GlobalFeaturesMap::value_type::second_type::iterator ItObjectMap;
-	for (ItObjectMap = mItGlobalFeaturesMap->second.begin(); ItObjectMap != mItGlobalFeaturesMap->second.end(); ItObjectMap++)
+	for (ItObjectMap = ItGlobalFeaturesMap->second.begin(); ItObjectMap != ItGlobalFeaturesMap->second.end(); ItObjectMap++)
 	{
-		NumberSamples += ItObjectMap->second->rows; 
+		for (int i=0; i<ItObjectMap->second->rows; i++)
+			Indices.push_back(std::pair<int, int>((int)objectSamples.size(), i));
+		objectSamples.push_back(cv::Mat(ItObjectMap->second));
 		NumberFeatures = ItObjectMap->second->width;
 	}
-	
+	int NumberSamples = (int)Indices.size();
 
 	// create matrix
 	int NumberCorrectSamples = cvRound((double)NumberSamples * pFactorCorrect);
 	pNumberCorrectSamples = NumberCorrectSamples;
 	int NumberIncorrectSamples = cvRound((double)NumberCorrectSamples * pFactorIncorrect);
 
-	*pFeatureMatrix = cvCreateMat(NumberCorrectSamples+NumberIncorrectSamples, NumberFeatures, CV_32FC1);
-	CvMat* TempFeatureMatrix = cvCreateMat(NumberSamples, NumberFeatures, CV_32FC1);
-
-	// fill temp matrix with all existing correct samples
-	int RowNumber=0;
-	for (ItObjectMap = mItGlobalFeaturesMap->second.begin(); ItObjectMap != mItGlobalFeaturesMap->second.end(); ItObjectMap++)
-	{
-		for (int i=0; i<ItObjectMap->second->rows; i++, RowNumber++)
-			for (int j=0; j<ItObjectMap->second->cols; j++)
-				cvmSet(TempFeatureMatrix, RowNumber, j, cvmGet(ItObjectMap->second, i, j));
-	}
+	if (pBuffer != NULL)
+		pFeatureMatrix = pBuffer->Get(NumberCorrectSamples+NumberIncorrectSamples, NumberFeatures, CV_32FC1);
+	else
+		pFeatureMatrix.create(NumberCorrectSamples+NumberIncorrectSamples, NumberFeatures, CV_32FC1);
 
-	// fill first part of *pFeatureMatrix with chosen correct samples
-	std::list<int> Indices;
-	std::list<int>::iterator ItIndices;
-	for (int i=0; i<NumberSamples; i++) Indices.push_back(i);
+	// fill first part of pFeatureMatrix with chosen correct samples (drawn without replacement, same sequence of draws as before)
 	for (int i=0; i<NumberCorrectSamples; i++)
 	{
-		int Index = int(Indices.size()*((double)rand()/((double)RAND_MAX+1.0)));
-		ItIndices = Indices.begin();
-		for (int k=0; k<Index; k++, ItIndices++);
-		for (int j=0; j<NumberFeatures; j++)
-		{
-			cvmSet(*pFeatureMatrix, i, j, cvmGet(TempFeatureMatrix, *ItIndices, j));
-		}
-		Indices.remove(*ItIndices);
+		int Index = RandomIndex((int)Indices.size(), pRNG);
+		cv::Mat row = pFeatureMatrix.row(i);
+		objectSamples[Indices[Index].first].row(Indices[Index].second).convertTo(row, CV_32F);
+		Indices.erase(Indices.begin()+Index);
 	}
 
-	Indices.clear();
-	cvReleaseMat(&TempFeatureMatrix);
-
-	// fill rest of *pFeatureMatrix with incorrect samples
-	std::vector<std::string> negativeSamplesLabels;
-	GetNegativeSamplesMatrixGlobal(pClass, *pFeatureMatrix, negativeSamplesLabels, NumberCorrectSamples, (NumberCorrectSamples+NumberIncorrectSamples));
+	// fill rest of pFeatureMatrix with incorrect samples
+	std::vector<std::string> negativeSamplesLabels(pFeatureMatrix.rows);
+	GetNegativeSamplesMatrixGlobal(pClass, pFeatureMatrix, negativeSamplesLabels, NumberCorrectSamples, (NumberCorrectSamples+NumberIncorrectSamples), -1, pRNG);
 
-/*	// Output
-	for (int i=0; i<(*pFeatureMatrix)->height; i++)
-	{
-		for (int j=0; j<(*pFeatureMatrix)->width; j++)
-			std::cout << cvGetReal2D(*pFeatureMatrix, i, j) << "\t";
-		std::cout << "\n";
-	}
-*/
 	return ipa_utils::RET_OK;
 }
 
 
-int ClassificationData::GetNegativeSamplesMatrixGlobal(std::string pClass, CvMat* pNegativeSamplesMatrix, std::vector<std::string>& pLabels, int pLowerBound, int pUpperBound, int pViewsPerObject)
+int ClassificationData::GetNegativeSamplesMatrixGlobal(std::string pClass, CvMat* pNegativeSamplesMatrix, std::vector<std::string>& pLabels, int pLowerBound, int pUpperBound, int pViewsPerObject, cv::RNG* pRNG)
 {
-	GlobalFeaturesMap::value_type::second_type::iterator ItObjectMap;
+	cv::Mat negativeSamplesMatrix(pNegativeSamplesMatrix);
+	return GetNegativeSamplesMatrixGlobal(pClass, negativeSamplesMatrix, pLabels, pLowerBound, pUpperBound, pViewsPerObject, pRNG);
+}
+
+
+int ClassificationData::GetNegativeSamplesMatrixGlobal(std::string pClass, cv::Mat& pNegativeSamplesMatrix, std::vector<std::string>& pLabels, int pLowerBound, int pUpperBound, int pViewsPerObject, cv::RNG* pRNG)
+{
+	if (pUpperBound > pNegativeSamplesMatrix.rows || pUpperBound > (int)pLabels.size())
+	{
+		std::cout << "ClassificationData::GetNegativeSamplesMatrixGlobal: Error: pUpperBound exceeds the matrix or label vector.\n";
+		return ipa_utils::RET_FAILED;
+	}
 
+	// index the classes and objects once instead of walking the maps for every draw
+	std::vector<GlobalFeaturesMap::iterator> classes;
+	std::vector< std::vector<CvMat*> > objects;
+	for (GlobalFeaturesMap::iterator ItGlobalFeaturesMap = mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	{
+		classes.push_back(ItGlobalFeaturesMap);
+		objects.push_back(std::vector<CvMat*>());
+		for (ObjectNrFeatureMap::iterator ItObjectMap = ItGlobalFeaturesMap->second.begin(); ItObjectMap != ItGlobalFeaturesMap->second.end(); ItObjectMap++)
+			objects.back().push_back(ItObjectMap->second);
+	}
+
+	int type = pNegativeSamplesMatrix.type();
 	for (int i=pLowerBound; i<pUpperBound; i++)
 	{
 		// find class randomly
+		int ClassIndex = 0;
 		while(1)
 		{
-			int ClassIndex = int(mGlobalFeaturesMap.size()*((double)rand()/((double)RAND_MAX+1.0)));//(double)rand()/(double)(RAND_MAX+1)));
-			mItGlobalFeaturesMap = mGlobalFeaturesMap.begin();
-			for (int k=0; k<ClassIndex; k++, mItGlobalFeaturesMap++);
-			if (mItGlobalFeaturesMap->first != pClass) break;
+			ClassIndex = RandomIndex((int)classes.size(), pRNG);
+			if (classes[ClassIndex]->first != pClass) break;
 		}
 
 		// find object randomly
-		int ObjectIndex = int(mItGlobalFeaturesMap->second.size()*((double)rand()/((double)RAND_MAX+1.0)));
-		ItObjectMap = mItGlobalFeaturesMap->second.begin();
-		for (int k=0; k<ObjectIndex; k++, ItObjectMap++);
+		int ObjectIndex = RandomIndex((int)objects[ClassIndex].size(), pRNG);
+		CvMat* objectSamples = objects[ClassIndex][ObjectIndex];
 
 		// find sample randomly
 		int sampleIndex = 0;
 		if (pViewsPerObject == -1)
-			sampleIndex = int(ItObjectMap->second->rows*((double)rand()/((double)RAND_MAX+1.0)));
+			sampleIndex = RandomIndex(objectSamples->rows, pRNG);
 		else
 		{
-			double step=(double)ItObjectMap->second->rows/(double)pViewsPerObject;
+			double step=(double)objectSamples->rows/(double)pViewsPerObject;
 			do
 			{
-				sampleIndex = int(ItObjectMap->second->rows*((double)rand()/((double)RAND_MAX+1.0)));
+				sampleIndex = RandomIndex(objectSamples->rows, pRNG);
 			} while (sampleIndex != int(step * int((double)sampleIndex/step)));
 		}
-		for (int j=0; j<ItObjectMap->second->width; j++)
-			cvmSet(pNegativeSamplesMatrix, i, j, cvmGet(ItObjectMap->second, sampleIndex, j));
-		pLabels[i] = mItGlobalFeaturesMap->first;
+		CvMat sourceRow;
+		cv::Mat row = pNegativeSamplesMatrix.row(i);
+		cv::Mat(cvGetRow(objectSamples, &sourceRow, sampleIndex)).convertTo(row, type);
+		pLabels[i] = classes[ClassIndex]->first;
 	}
 
 	return ipa_utils::RET_OK;
@@ -9436,8 +9155,8 @@ int ClassificationData::GetNegativeSamplesMatrixGlobalSampleRange(std::string pC
 
 		// find sample randomly
 		int sampleIndex = int((ItObjectMap->second->rows*rangeStartFactor) + (ItObjectMap->second->rows*(rangeEndFactor-rangeStartFactor))*((double)rand()/((double)RAND_MAX+1.0)));
-		for (int j=0; j<ItObjectMap->second->width; j++)
-			cvmSet(pNegativeSamplesMatrix, i, j, cvmGet(ItObjectMap->second, sampleIndex, j));
+		CvMat sourceRow, destinationRow;
+		cvConvert(cvGetRow(ItObjectMap->second, &sourceRow, sampleIndex), cvGetRow(pNegativeSamplesMatrix, &destinationRow, i));
 		pLabels[i] = mItGlobalFeaturesMap->first;
 	}
 
@@ -9447,14 +9166,16 @@ int ClassificationData::GetNegativeSamplesMatrixGlobalSampleRange(std::string pC
 
 int ClassificationData::GetNumberLocalFeatures()
 {
+	LocalFeaturesMap::iterator ItLocalFeaturesMap;
+	ObjectMap::iterator ItObjectMap;
 	std::vector<BlobListStruct>::iterator ItBlobListStructs;
 	int NumberLocalFeatures = 0;
 
-	for (mItLocalFeaturesMap = mLocalFeaturesMap.begin(); mItLocalFeaturesMap != mLocalFeaturesMap.end(); mItLocalFeaturesMap++)
+	for (ItLocalFeaturesMap = mLocalFeaturesMap.begin(); ItLocalFeaturesMap != mLocalFeaturesMap.end(); ItLocalFeaturesMap++)
 	{
-		for (mItObjectMap = mItLocalFeaturesMap->second.begin(); mItObjectMap != mItLocalFeaturesMap->second.end(); mItObjectMap++)
+		for (ItObjectMap = ItLocalFeaturesMap->second.begin(); ItObjectMap != ItLocalFeaturesMap->second.end(); ItObjectMap++)
 		{
-			for (ItBlobListStructs = mItObjectMap->second.begin(); ItBlobListStructs != mItObjectMap->second.end(); ItBlobListStructs++)
+			for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
 			{
 				if (ItBlobListStructs->BlobFPs.size()!=0)
 				{
@@ -9493,14 +9214,16 @@ int ClassificationData::GetNumberLocalFeaturePoints()
 
 int ClassificationData::GetNumberLocalFeaturePoints(std::string pClass)
 {
+	LocalFeaturesMap::iterator ItLocalFeaturesMap;
+	ObjectMap::iterator ItObjectMap;
 	std::vector<BlobListStruct>::iterator ItBlobListStructs;
 	int NumberSamples = 0;
 
-	if ((mItLocalFeaturesMap = mLocalFeaturesMap.find(pClass)) != mLocalFeaturesMap.end())
+	if ((ItLocalFeaturesMap = mLocalFeaturesMap.find(pClass)) != mLocalFeaturesMap.end())
 	{
-		for (mItObjectMap = mItLocalFeaturesMap->second.begin(); mItObjectMap != mItLocalFeaturesMap->second.end(); mItObjectMap++)
+		for (ItObjectMap = ItLocalFeaturesMap->second.begin(); ItObjectMap != ItLocalFeaturesMap->second.end(); ItObjectMap++)
 		{
-			for (ItBlobListStructs = mItObjectMap->second.begin(); ItBlobListStructs != mItObjectMap->second.end(); ItBlobListStructs++)
+			for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
 			{
 				NumberSamples += ItBlobListStructs->BlobFPs.size();
 			}
@@ -9513,6 +9236,9 @@ int ClassificationData::GetNumberLocalFeaturePoints(std::string pClass)
 
 int ClassificationData::SaveLocalFeatures(std::string pFileName)
 {
+	if (ipa_utils::HasFeatureStoreExtension(pFileName) == true)
+		return SaveLocalFeaturesBinary(pFileName);
+
 	std::ofstream f(pFileName.c_str(), std::fstream::out);
 	if(!f.is_open())
 	{
@@ -9588,6 +9314,9 @@ int ClassificationData::SaveLocalFeatures(std::string pFileName)
 
 int ClassificationData::LoadLocalFeatures(std::string pFileName)
 {
+	if (ipa_utils::IsFeatureStoreFile(pFileName) == true)
+		return LoadLocalFeaturesBinary(pFileName);
+
 	mLocalFeaturesMap.clear();
 
 	std::ifstream f(pFileName.c_str(), std::fstream::in);
@@ -9638,6 +9367,9 @@ int ClassificationData::LoadLocalFeatures(std::string pFileName)
 
 int ClassificationData::SaveGlobalFeatures(std::string pFileName)
 {
+	if (ipa_utils::HasFeatureStoreExtension(pFileName) == true)
+		return SaveGlobalFeaturesBinary(pFileName);
+
 	std::ofstream f(pFileName.c_str(), std::fstream::out);
 	if(!f.is_open())
 	{
@@ -9685,15 +9417,11 @@ int ClassificationData::SaveGlobalFeatures(std::string pFileName)
 
 int ClassificationData::LoadGlobalFeatures(std::string pFileName)
 {
-	GlobalFeaturesMap::value_type::second_type::iterator ItObjectMap;
+	if (ipa_utils::IsFeatureStoreFile(pFileName) == true)
+		return LoadGlobalFeaturesBinary(pFileName);
 
 	/// Clear from old data
-	for (mItGlobalFeaturesMap = mGlobalFeaturesMap.begin(); mItGlobalFeaturesMap != mGlobalFeaturesMap.end(); mItGlobalFeaturesMap++)
-	{
-		for (ItObjectMap = mItGlobalFeaturesMap->second.begin(); ItObjectMap != mItGlobalFeaturesMap->second.end(); ItObjectMap++)
-		{ cvReleaseMat(&(ItObjectMap->second)); }
-	}
-	mGlobalFeaturesMap.clear();
+	ClearGlobalFeatures();
 
 	std::ifstream f(pFileName.c_str(), std::fstream::in);
 	if(!f.is_open())
@@ -9757,6 +9485,354 @@ int ClassificationData::LoadGlobalFeatures(std::string pFileName)
 }
 
 
+void ClassificationData::ClearGlobalFeatures()
+{
+	GlobalFeaturesMap::iterator ItGlobalFeaturesMap;
+	ObjectNrFeatureMap::iterator ItObjectMap;
+	for (ItGlobalFeaturesMap = mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	{
+		for (ItObjectMap = ItGlobalFeaturesMap->second.begin(); ItObjectMap != ItGlobalFeaturesMap->second.end(); ItObjectMap++)
+		{ cvReleaseMat(&(ItObjectMap->second)); }		// matrices of a mapped file are headers only, the data stays with the mapping
+	}
+	mGlobalFeaturesMap.clear();
+	mGlobalFeaturesFile.reset();
+}
+
+
+int ClassificationData::SaveLocalFeaturesBinary(std::string pFileName)
+{
+	if(mLocalFeaturesMap.size()==0)
+	{
+		std::cout << "ClassificationData::SaveLocalFeaturesBinary: No classes to be saved for '" << pFileName << "'" << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
+	ipa_utils::FeatureStoreWriter writer;
+	if (writer.Open(pFileName, ipa_utils::FEATURE_STORE_LOCAL) != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
+
+	LocalFeaturesMap::iterator ItLocalFeaturesMap;
+	ObjectMap::iterator ItObjectMap;
+	BlobListStructVector::iterator ItBlobListStructs;
+	std::vector<double> phis, frames;
+	std::vector<boost::int32_t> geometry;
+	std::vector<float> descriptors;
+
+	writer.IndexInt((int)mLocalFeaturesMap.size());			/// Number of categories
+	for (ItLocalFeaturesMap = mLocalFeaturesMap.begin(); ItLocalFeaturesMap != mLocalFeaturesMap.end(); ItLocalFeaturesMap++)
+	{
+		writer.IndexString(ItLocalFeaturesMap->first);				/// Class name
+		writer.IndexInt((int)ItLocalFeaturesMap->second.size());	/// Number of objects in this category
+		for (ItObjectMap = ItLocalFeaturesMap->second.begin(); ItObjectMap != ItLocalFeaturesMap->second.end(); ItObjectMap++)
+		{
+			writer.IndexInt(ItObjectMap->first);					/// Object number
+			writer.IndexInt((int)ItObjectMap->second.size());		/// Number of views (BlobListStructs)
+			for (ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
+			{
+				BlobListRiB& blobs = ItBlobListStructs->BlobFPs;
+				int numberPoints = (int)blobs.size();
+				int descriptorDimension = (numberPoints == 0) ? 0 : (int)blobs.begin()->m_D.size();
+				int frameDimension = (numberPoints == 0) ? 0 : (int)blobs.begin()->m_Frame.size();
+
+				// four blocks per view: phi (float64), frames (float64), y/x/r/id (int32), descriptors (float32)
+				phis.resize(numberPoints);
+				frames.resize(numberPoints*frameDimension);
+				geometry.resize(numberPoints*4);
+				descriptors.resize(numberPoints*descriptorDimension);
+				int point = 0;
+				for (BlobListRiB::iterator ItBlob = blobs.begin(); ItBlob != blobs.end(); ItBlob++, point++)
+				{
+					if ((int)ItBlob->m_D.size() != descriptorDimension || (int)ItBlob->m_Frame.size() != frameDimension)
+					{
+						std::cout << "ClassificationData::SaveLocalFeaturesBinary: Feature points of class " << ItLocalFeaturesMap->first << " object " << ItObjectMap->first << " have different dimensions." << std::endl;
+						return ipa_utils::RET_FAILED;
+					}
+					phis[point] = ItBlob->m_Phi;
+					for (int j=0; j<frameDimension; j++) frames[point*frameDimension+j] = ItBlob->m_Frame[j];
+					geometry[4*point] = ItBlob->m_y;
+					geometry[4*point+1] = ItBlob->m_x;
+					geometry[4*point+2] = ItBlob->m_r;
+					geometry[4*point+3] = ItBlob->m_Id;
+					for (int j=0; j<descriptorDimension; j++) descriptors[point*descriptorDimension+j] = ItBlob->m_D[j];
+				}
+				writer.IndexString(ItBlobListStructs->FileName);	/// BlobList origin file name
+				writer.IndexInt(numberPoints);
+				writer.IndexInt(descriptorDimension);
+				writer.IndexInt(frameDimension);
+				writer.IndexOffset(writer.WriteBlock(phis.empty() ? NULL : &phis[0], phis.size()*sizeof(double)));
+				writer.IndexOffset(writer.WriteBlock(frames.empty() ? NULL : &frames[0], frames.size()*sizeof(double)));
+				writer.IndexOffset(writer.WriteBlock(geometry.empty() ? NULL : &geometry[0], geometry.size()*sizeof(boost::int32_t)));
+				writer.IndexOffset(writer.WriteBlock(descriptors.empty() ? NULL : &descriptors[0], descriptors.size()*sizeof(float)));
+			}
+		}
+	}
+
+	if (writer.Close() != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
+
+	std::cout << "FP data saved (binary).\n";
+
+	return ipa_utils::RET_OK;
+}
+
+
+int ClassificationData::LoadLocalFeaturesBinary(std::string pFileName)
+{
+	mLocalFeaturesMap.clear();
+
+	ipa_utils::FeatureStoreReader reader;
+	if (reader.Open(pFileName, ipa_utils::FEATURE_STORE_LOCAL) != ipa_utils::RET_OK)
+	{
+		std::cout << "ClassificationData::LoadLocalFeaturesBinary: Could not load '" << pFileName << "'" << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
+
+	bool corrupt = false;
+	int LocalFeaturesMapSize = reader.ReadInt();			/// Number of categories
+	for (int i=0; i<LocalFeaturesMapSize && !reader.Error() && !corrupt; i++)
+	{
+		std::string ClassName = reader.ReadString();		/// Class name
+		int ClassSize = reader.ReadInt();					/// Number of objects in this category
+		for (int ObjectCounter=0; ObjectCounter<ClassSize && !reader.Error() && !corrupt; ObjectCounter++)
+		{
+			int ObjectNumber = reader.ReadInt();
+			int ObjectSize = reader.ReadInt();				/// Number of views (BlobListStructs)
+			if (reader.Error() || ObjectSize < 0)
+			{
+				corrupt = true;
+				break;
+			}
+			BlobListStructVector& views = mLocalFeaturesMap[ClassName][ObjectNumber];
+			views.resize(ObjectSize);
+			for (int BlobListStructCounter=0; BlobListStructCounter<ObjectSize && !reader.Error(); BlobListStructCounter++)
+			{
+				BlobListStruct& view = views[BlobListStructCounter];
+				view.FileName = reader.ReadString();		/// BlobList origin file name
+				int numberPoints = reader.ReadInt();
+				int descriptorDimension = reader.ReadInt();
+				int frameDimension = reader.ReadInt();
+				boost::uint64_t phiOffset = reader.ReadOffset();
+				boost::uint64_t frameOffset = reader.ReadOffset();
+				boost::uint64_t geometryOffset = reader.ReadOffset();
+				boost::uint64_t descriptorOffset = reader.ReadOffset();
+				if (numberPoints < 0 || descriptorDimension < 0 || frameDimension < 0)
+				{
+					corrupt = true;
+					break;
+				}
+				const double* phis = (const double*)reader.Block(phiOffset, (size_t)numberPoints*sizeof(double));
+				const double* frames = (const double*)reader.Block(frameOffset, (size_t)numberPoints*frameDimension*sizeof(double));
+				const boost::int32_t* geometry = (const boost::int32_t*)reader.Block(geometryOffset, (size_t)numberPoints*4*sizeof(boost::int32_t));
+				const float* descriptors = (const float*)reader.Block(descriptorOffset, (size_t)numberPoints*descriptorDimension*sizeof(float));
+				if (reader.Error())
+					break;
+
+				for (int point=0; point<numberPoints; point++)
+				{
+					BlobFeatureRiB fp;
+					fp.m_y = geometry[4*point];
+					fp.m_x = geometry[4*point+1];
+					fp.m_r = geometry[4*point+2];
+					fp.m_Id = geometry[4*point+3];
+					fp.m_Phi = phis[point];
+					fp.m_D.assign(descriptors+point*descriptorDimension, descriptors+(point+1)*descriptorDimension);
+					fp.m_Frame.assign(frames+point*frameDimension, frames+(point+1)*frameDimension);
+					view.BlobFPs.push_back(fp);
+				}
+			}
+		}
+	}
+
+	if (reader.Error() || corrupt)
+	{
+		std::cout << "ClassificationData::LoadLocalFeaturesBinary: The file '" << pFileName << "' is corrupt." << std::endl;
+		mLocalFeaturesMap.clear();
+		return ipa_utils::RET_FAILED;
+	}
+
+	std::cout << "FP data loaded (binary).\n";
+
+	return ipa_utils::RET_OK;
+}
+
+
+int ClassificationData::SaveGlobalFeaturesBinary(std::string pFileName)
+{
+	if(mGlobalFeaturesMap.size()==0)
+	{
+		std::cout << "ClassificationData::SaveGlobalFeaturesBinary: No classes to be saved for '" << pFileName << "'" << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
+	ipa_utils::FeatureStoreWriter writer;
+	if (writer.Open(pFileName, ipa_utils::FEATURE_STORE_GLOBAL) != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
+
+	GlobalFeaturesMap::iterator ItGlobalFeaturesMap;
+	ObjectNrFeatureMap::iterator ItObjectMap;
+	std::vector<float> data;
+
+	writer.IndexInt((int)mGlobalFeaturesMap.size());			/// Number of categories
+	for (ItGlobalFeaturesMap = mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+	{
+		writer.IndexString(ItGlobalFeaturesMap->first);				/// Class name
+		writer.IndexInt((int)ItGlobalFeaturesMap->second.size());	/// Number of objects in each class
+		for (ItObjectMap = ItGlobalFeaturesMap->second.begin(); ItObjectMap != ItGlobalFeaturesMap->second.end(); ItObjectMap++)
+		{
+			int NumberSamples = ItObjectMap->second->rows;
+			int NumberFeatures = ItObjectMap->second->cols;
+			data.resize(NumberSamples*NumberFeatures);
+			for (int i=0; i<NumberSamples; i++)
+				for (int j=0; j<NumberFeatures; j++)
+					data[i*NumberFeatures+j] = (float)cvmGet(ItObjectMap->second, i, j);
+
+			writer.IndexInt(ItObjectMap->first);		/// Object number
+			writer.IndexInt(NumberSamples);
+			writer.IndexInt(NumberFeatures);
+			writer.IndexOffset(writer.WriteBlock(data.empty() ? NULL : &data[0], data.size()*sizeof(float)));		/// Global feature matrix
+		}
+	}
+
+	if (writer.Close() != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
+
+	std::cout << "Global features data saved (binary).\n";
+
+	return ipa_utils::RET_OK;
+}
+
+
+int ClassificationData::LoadGlobalFeaturesBinary(std::string pFileName)
+{
+	ClearGlobalFeatures();
+
+	ipa_utils::FeatureStoreReader reader;
+	if (reader.Open(pFileName, ipa_utils::FEATURE_STORE_GLOBAL) != ipa_utils::RET_OK)
+	{
+		std::cout << "ClassificationData::LoadGlobalFeaturesBinary: Could not load '" << pFileName << "'" << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
+
+	bool corrupt = false;
+	int GlobalFeaturesMapSize = reader.ReadInt();			/// Number of categories
+	for (int ClassNumber=0; ClassNumber<GlobalFeaturesMapSize && !reader.Error() && !corrupt; ClassNumber++)
+	{
+		std::string ClassName = reader.ReadString();		/// Class name
+		int NumberObjects = reader.ReadInt();				/// Number of objects in each class
+		for (int ObjectCounter=0; ObjectCounter<NumberObjects && !reader.Error(); ObjectCounter++)
+		{
+			int ObjectNumber = reader.ReadInt();
+			int NumberSamples = reader.ReadInt();
+			int NumberFeatures = reader.ReadInt();
+			boost::uint64_t offset = reader.ReadOffset();
+			if (reader.Error() || NumberSamples < 0 || NumberFeatures < 1)
+			{
+				corrupt = true;
+				break;
+			}
+			float* data = (float*)reader.Block(offset, (size_t)NumberSamples*NumberFeatures*sizeof(float));
+			if (data == NULL)
+				break;
+
+			// the matrix header points into the mapped file
+			CvMat* featureMatrix = cvCreateMatHeader(NumberSamples, NumberFeatures, CV_32FC1);
+			cvSetData(featureMatrix, data, NumberFeatures*sizeof(float));
+			(mGlobalFeaturesMap[ClassName])[ObjectNumber] = featureMatrix;
+		}
+	}
+
+	if (reader.Error() || corrupt)
+	{
+		std::cout << "ClassificationData::LoadGlobalFeaturesBinary: The file '" << pFileName << "' is corrupt." << std::endl;
+		ClearGlobalFeatures();
+		return ipa_utils::RET_FAILED;
+	}
+	mGlobalFeaturesFile = reader.File();
+
+	std::cout << "Global features data loaded (binary).\n";
+
+	return ipa_utils::RET_OK;
+}
+
+
+int ClassificationData::ConvertFeatureFileToBinary(std::string pTextFileName, std::string pBinaryFileName, bool pLocalFeatures)
+{
+	if (pLocalFeatures == true)
+	{
+		if (LoadLocalFeatures(pTextFileName) != ipa_utils::RET_OK)
+			return ipa_utils::RET_FAILED;
+		return SaveLocalFeaturesBinary(pBinaryFileName);
+	}
+
+	if (LoadGlobalFeatures(pTextFileName) != ipa_utils::RET_OK)
+		return ipa_utils::RET_FAILED;
+	return SaveGlobalFeaturesBinary(pBinaryFileName);
+}
+
+
+double ClassificationData::FeatureChecksum(bool pLocalFeatures)
+{
+	double checksum = 0.;
+	if (pLocalFeatures == true)
+	{
+		for (LocalFeaturesMap::iterator ItLocalFeaturesMap = mLocalFeaturesMap.begin(); ItLocalFeaturesMap != mLocalFeaturesMap.end(); ItLocalFeaturesMap++)
+			for (ObjectMap::iterator ItObjectMap = ItLocalFeaturesMap->second.begin(); ItObjectMap != ItLocalFeaturesMap->second.end(); ItObjectMap++)
+				for (BlobListStructVector::iterator ItBlobListStructs = ItObjectMap->second.begin(); ItBlobListStructs != ItObjectMap->second.end(); ItBlobListStructs++)
+					for (BlobListRiB::iterator ItBlob = ItBlobListStructs->BlobFPs.begin(); ItBlob != ItBlobListStructs->BlobFPs.end(); ItBlob++)
+					{
+						checksum += ItBlob->m_x + ItBlob->m_y + ItBlob->m_r + ItBlob->m_Phi;
+						for (unsigned int j=0; j<ItBlob->m_D.size(); j++) checksum += ItBlob->m_D[j];
+					}
+	}
+	else
+	{
+		for (GlobalFeaturesMap::iterator ItGlobalFeaturesMap = mGlobalFeaturesMap.begin(); ItGlobalFeaturesMap != mGlobalFeaturesMap.end(); ItGlobalFeaturesMap++)
+			for (ObjectNrFeatureMap::iterator ItObjectMap = ItGlobalFeaturesMap->second.begin(); ItObjectMap != ItGlobalFeaturesMap->second.end(); ItObjectMap++)
+				checksum += cvSum(ItObjectMap->second).val[0];
+	}
+	return checksum;
+}
+
+
+int ClassificationData::BenchmarkFeatureFileLoading(std::string pTextFileName, std::string pBinaryFileName, bool pLocalFeatures, int pRepetitions)
+{
+	if (ipa_utils::IsFeatureStoreFile(pTextFileName) == true || ipa_utils::IsFeatureStoreFile(pBinaryFileName) == false)
+	{
+		std::cout << "ClassificationData::BenchmarkFeatureFileLoading: '" << pTextFileName << "' must be a text file and '" << pBinaryFileName << "' a binary feature file." << std::endl;
+		return ipa_utils::RET_FAILED;
+	}
+
+	PrecisionStopWatch sw;
+	double textTime = 0., binaryTime = 0.;
+	double textChecksum = 0., binaryChecksum = 0.;
+	for (int repetition=0; repetition<pRepetitions; repetition++)
+	{
+		sw.precisionStart();
+		int result = (pLocalFeatures==true) ? LoadLocalFeatures(pTextFileName) : LoadGlobalFeatures(pTextFileName);
+		textTime += sw.precisionStop();
+		if (result != ipa_utils::RET_OK)
+			return ipa_utils::RET_FAILED;
+		textChecksum = FeatureChecksum(pLocalFeatures);
+
+		sw.precisionStart();
+		result = (pLocalFeatures==true) ? LoadLocalFeaturesBinary(pBinaryFileName) : LoadGlobalFeaturesBinary(pBinaryFileName);
+		binaryTime += sw.precisionStop();
+		if (result != ipa_utils::RET_OK)
+			return ipa_utils::RET_FAILED;
+		binaryChecksum = FeatureChecksum(pLocalFeatures);
+	}
+	textTime /= (double)std::max(1, pRepetitions);
+	binaryTime /= (double)std::max(1, pRepetitions);
+
+	bool sameData = fabs(textChecksum-binaryChecksum) <= 1e-6*std::max(1., fabs(textChecksum));
+	std::cout << "Loading " << (pLocalFeatures ? "local" : "global") << " features (mean of " << pRepetitions << " loads):\n"
+		<< "  text:   " << textTime << " s  (" << pTextFileName << ")\n"
+		<< "  binary: " << binaryTime << " s  (" << pBinaryFileName << ")\n"
+		<< "  speedup: " << (binaryTime > 0. ? textTime/binaryTime : 0.) << "\n"
+		<< "  data " << (sameData ? "identical" : "DIFFERENT") << " (checksums " << textChecksum << " / " << binaryChecksum << ")" << std::endl;
+
+	return (sameData == true) ? ipa_utils::RET_OK : ipa_utils::RET_FAILED;
+}
+
+
 int ClassificationData::SaveGlobalClassifiers(std::string pPath, ClassifierType pClassifierType)
 {
 	std::stringstream FileName;
@@ -27,6 +27,12 @@ int main()
 	//std::cout << "end...";
 	//getchar();
 
+	// conversion of feature files into the binary format (.fpb), Load*Features() recognizes binary files automatically
+	//OC.GetDataPointer()->ConvertFeatureFileToBinary("IPA2Data/IPA2_Surf64Dev2_loc.txt", "IPA2Data/IPA2_Surf64Dev2_loc.fpb", true);
+	//OC.GetDataPointer()->BenchmarkFeatureFileLoading("IPA2Data/IPA2_Surf64Dev2_loc.txt", "IPA2Data/IPA2_Surf64Dev2_loc.fpb", true);
+	//OC.GetDataPointer()->ConvertFeatureFileToBinary("IPA2Data/IPA2_Surf64Dev2_glob.txt", "IPA2Data/IPA2_Surf64Dev2_glob.fpb", false);
+	//OC.GetDataPointer()->BenchmarkFeatureFileLoading("IPA2Data/IPA2_Surf64Dev2_glob.txt", "IPA2Data/IPA2_Surf64Dev2_glob.fpb", false);
+
 
 	// parameters
 	ObjectClassifier::LocalFeatureParams localFeatureParams;
@@ -71,6 +77,8 @@ int main()
 	const float factorNegativeSet = 6.f;	// very old: 5.f
 	const float percentTest = 0.f;
 	const float percentValidation = 0.1f;
+	const int numberThreads = 1;	// worker threads of the classifier training and the cross-validation folds, 0 = number of hardware threads, 1 = serial as before
+	const unsigned int trainingRandomSeed = 1;	// base seed of the multi-threaded training, the trained classifiers do not depend on numberThreads
 
 	// capture data
 	bool capture = false;
@@ -182,6 +190,22 @@ int main()
 	}
 
 
+	// train the global classifiers of all classes of a global feature file and save them
+	bool training = false;
+	if (training)
+	{
+		std::string globalFeatureFileName = "common/files/WashingtonData/Wa_Surf64Dev2_PCA3CF7-7-2_glob.txt";
+		std::string classifierPath = "common/files/WashingtonData/Classifier/";
+		if (OC.LoadFPDataGlobal(globalFeatureFileName) != ipa_utils::RET_OK)
+		{
+			std::cout << "Error: main: The global feature file " << globalFeatureFileName << " could not be loaded." << std::endl;
+			return 0;
+		}
+		OC.TrainGlobal(classifierPath, 1.0f, factorNegativeSet, classifierType, numberThreads, trainingRandomSeed);
+		return 0;
+	}
+
+
 	std::string comments = "Surf64 on RGBI image data.\n\n";
 
 	bool experimentalSeries = false;
@@ -387,7 +411,7 @@ int main()
 					OC.GetDataPointer()->SaveGlobalClassifiers(classifierPath.string(), classifierType);
 					//OC.GetDataPointer()->LoadGlobalClassifiers(classifierPath.string(), classifierType);
 					//OC.CrossValidationGlobalMultiClassSampleRange(statisticsPath.string(), nameTag, classifierType, crossValidationFold, factorNegativeSet, percentTest, percentValidation, viewsPerObject, &screenLogFile, factorSamplesTrainData);
-					OC.CrossValidationGlobalMultiClass(statisticsPath.string(), nameTag, classifierType, crossValidationFold, factorNegativeSet, percentTest, percentValidation, viewsPerObject, &screenLogFile);
+					OC.CrossValidationGlobalMultiClass(statisticsPath.string(), nameTag, classifierType, crossValidationFold, factorNegativeSet, percentTest, percentValidation, viewsPerObject, &screenLogFile, numberThreads);
 
 					screenLogFile.close();
 				}
@@ -515,7 +539,7 @@ int main()
 		OC.GetDataPointer()->SaveGlobalClassifiers(localClassifierSavePath, classifierType);
 		//OC.GetDataPointer()->LoadGlobalClassifiers(localClassifierSavePath, CLASSIFIER_RTC);
 		//OC.CrossValidationGlobalMultiClassSampleRange(statisticsPath, configurationPrefix, classifierType, crossValidationFold, factorNegativeSet, percentTest, percentValidation, viewsPerObject, &screenLogFile, factorSamplesTrainData);
-		OC.CrossValidationGlobalMultiClass(statisticsPath, configurationPrefix, classifierType, crossValidationFold, factorNegativeSet, percentTest, percentValidation, viewsPerObject, &screenLogFile);
+		OC.CrossValidationGlobalMultiClass(statisticsPath, configurationPrefix, classifierType, crossValidationFold, factorNegativeSet, percentTest, percentValidation, viewsPerObject, &screenLogFile, numberThreads);
 
 		screenLogFile.close();
 
@@ -591,7 +615,7 @@ int main()
 	// H -Histogram, P - PCA
 //	OC.LoadFPDataGlobal("IPAData/IPA_Surf64Dev2_EM184PCA3CF12FS6_glob.txt");
 //	OC.CrossValidationGlobal("IPAData/Classifier/Statistics/", "IPA_Surf64Dev2_EM184PCA3CF12FS6", CLASSIFIER_RTC, 8, 5.0, 0.0, 0.1);
-//	OC.TrainGlobal("IPAData/Classifier/", 1.0, 5.0, CLASSIFIER_RTC);
+//	OC.TrainGlobal("IPAData/Classifier/", 1.0, 5.0, CLASSIFIER_RTC, numberThreads, trainingRandomSeed);
 
 //	OC.LoadFPDataLocal("IPAData/IPA_Surf64Dev2_loc.txt");
 //	OC.CrossValidationLocal("IPAData/Classifier/Statistics/", "IPA_Surf64Dev2", CLASSIFIER_RTC, 8, 1.0, 0.2, 0.1);
@@ -599,7 +623,7 @@ int main()
 
 	// Train mode
 //	OC.LoadFPDataLocal("IPAData/IPA_Surf64Dev2_loc.txt");
-//	OC.TrainLocal("IPAData/Classifier/", 1.0, 2.0, CLASSIFIER_RTC);
+//	OC.TrainLocal("IPAData/Classifier/", 1.0, 2.0, CLASSIFIER_RTC, numberThreads, trainingRandomSeed);
 
 	// Run mode
 /*	OC.LoadClassifiersLocal("IPAData/Classifier/", CLASSIFIER_RTC);
@@ -31,6 +31,9 @@
 
 // boost
 #include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 // PCL
 #include <pcl/ModelCoefficients.h>
@@ -52,6 +55,7 @@
 #include <sensor_msgs/image_encodings.h>
 
 #include <object_categorization/ObjectClassifier.h>
+#include <object_categorization/ThreadPool.h>
 
 
 // this typedef just establishes the abbreviation SquareActionServer for the long data type
@@ -68,9 +72,37 @@ public:
 	void Training();
 
 protected:
+	/// a synchronized pair of segments and color image
+	struct InputFrame
+	{
+		cob_perception_msgs::PointCloud2Array::ConstPtr segments;
+		sensor_msgs::Image::ConstPtr image;
+	};
+
+	/// result of the categorization of a single segment, drawn into the display images after all segments are finished
+	struct SegmentCategorization
+	{
+		bool valid;		///< false if the segment contains no valid points
+		int umin, vmin;		///< upper left corner of the segment in the image
+		std::string label;	///< class and confidence
+		std::vector<cv::Point> pixels;	///< image positions of the segment points
+		std::vector<cv::Point3_<uchar> > colors;	///< colors of the segment points (BGR)
+	};
+
 	/// callback for the incoming pointcloud data stream
+	/// With latest_frame_wins_ the frame is only handed over to the processing thread, a frame which has not been started yet is replaced (and dropped).
+	/// Otherwise the frame is processed in the callback.
 	void inputCallback(const cob_perception_msgs::PointCloud2Array::ConstPtr& input_pointcloud_segments_msg, const sensor_msgs::Image::ConstPtr& input_image_msg);
 
+	/// processes the latest handed over frame until the node shuts down
+	void processingLoop();
+
+	/// categorizes all segments of a frame, in mode_of_operation_ 1 the segments are distributed over the worker pool
+	void processFrame(const cob_perception_msgs::PointCloud2Array::ConstPtr& input_pointcloud_segments_msg, const sensor_msgs::Image::ConstPtr& input_image_msg);
+
+	/// converts a segment into a shared image and categorizes it with the object classifier (only reads the loaded classifiers, can run concurrently)
+	void categorizeSegment(const sensor_msgs::PointCloud2* segment_msg, const cv::Mat* projection_matrix, unsigned int width, unsigned int height, SegmentCategorization* result);
+
 	void drawObjectCoordinateSystem(const tf::Transform& object_pose, cv::Mat& display_image);
 	cv::Point projectVector3ToUV(tf::Vector3 point_C);
 
@@ -103,6 +135,17 @@ protected:
 	ObjectClassifier::GlobalFeatureParams global_feature_params_;
 
 	int mode_of_operation_;		///< 1=normal, 2=hermes recognize 3=hermes train
+
+	bool latest_frame_wins_;	///< if true, frames arriving while a frame is processed replace each other and only the latest one is processed next
+	ipa_utils::ThreadPool* worker_pool_;	///< categorizes the segments of a frame in parallel (mode_of_operation_ 1)
+	boost::thread* processing_thread_;	///< runs processingLoop() if latest_frame_wins_ is set
+	boost::mutex frame_mutex_;	///< protects pending_frame_, has_pending_frame_, shutdown_, latest_object_detection_ and the camera calibration
+	boost::mutex model_mutex_;	///< held while a frame is processed or the detection model is initialized for a new goal, also protects hermes_object_name_ (lock before frame_mutex_)
+	boost::condition_variable frame_available_;
+	InputFrame pending_frame_;	///< latest frame which has not been processed yet
+	bool has_pending_frame_;
+	bool shutdown_;
+	unsigned int number_dropped_frames_;	///< frames replaced before they were processed
 };
 
 #endif /* OBJECT_CATEGORIZATION_H_ */
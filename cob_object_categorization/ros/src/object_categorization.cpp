@@ -12,6 +12,14 @@ ObjectCategorization::ObjectCategorization(ros::NodeHandle nh)
   object_classifier_(ros::package::getPath("cob_object_categorization") + "/common/files/classifier/EMClusterer5.txt", ros::package::getPath("cob_object_categorization") + "/common/files/classifier/"),
   detect_objects_action_server_(nh, "categorize_object", boost::bind(&ObjectCategorization::detectObjectsCallback, this, _1), false)	// this initializes the action server; important: always set the last parameter to false
 {
+	it_ = 0;
+	sync_input_ = 0;
+	worker_pool_ = 0;
+	processing_thread_ = 0;
+	has_pending_frame_ = false;
+	shutdown_ = false;
+	number_dropped_frames_ = 0;
+
 	// Parameters
 	global_feature_params_.minNumber3DPixels = 50;
 	global_feature_params_.numberLinesX.push_back(7);
@@ -52,6 +60,23 @@ ObjectCategorization::ObjectCategorization(ros::NodeHandle nh)
 	bool start_categorization_on_startup = true;
 	node_handle_.param("/object_categorization/object_categorization/start_categorization_on_startup", start_categorization_on_startup, true);
 	std::cout<< "start_categorization_on_startup: " << start_categorization_on_startup << "\n";
+	int number_worker_threads = 0;
+	node_handle_.param("/object_categorization/object_categorization/number_worker_threads", number_worker_threads, 0);
+	std::cout<< "number_worker_threads: " << number_worker_threads << "\n";
+	node_handle_.param("/object_categorization/object_categorization/latest_frame_wins", latest_frame_wins_, true);
+	std::cout<< "latest_frame_wins: " << latest_frame_wins_ << "\n";
+
+	node_handle_.param("/object_categorization/object_categorization/hermes_approximate_view_search", object_classifier_.mHermesApproximateViewSearch, true);
+	std::cout<< "hermes_approximate_view_search: " << object_classifier_.mHermesApproximateViewSearch << "\n";
+	node_handle_.param("/object_categorization/object_categorization/hermes_view_search_trees", object_classifier_.mHermesViewSearchTrees, 4);
+	std::cout<< "hermes_view_search_trees: " << object_classifier_.mHermesViewSearchTrees << "\n";
+	node_handle_.param("/object_categorization/object_categorization/hermes_view_search_checks", object_classifier_.mHermesViewSearchChecks, 64);
+	std::cout<< "hermes_view_search_checks: " << object_classifier_.mHermesViewSearchChecks << "\n";
+	node_handle_.param("/object_categorization/object_categorization/hermes_reference_voxel_size", object_classifier_.mHermesReferenceVoxelSize, 0.);
+	std::cout<< "hermes_reference_voxel_size: " << object_classifier_.mHermesReferenceVoxelSize << "\n";
+	int hermes_view_search_benchmark_queries = 0;
+	node_handle_.param("/object_categorization/object_categorization/hermes_view_search_benchmark_queries", hermes_view_search_benchmark_queries, 0);
+	std::cout<< "hermes_view_search_benchmark_queries: " << hermes_view_search_benchmark_queries << "\n";
 
 	hermes_object_name_ = object_name;
 
@@ -60,6 +85,8 @@ ObjectCategorization::ObjectCategorization(ros::NodeHandle nh)
 	{
 		object_classifier_.HermesLoadCameraCalibration(object_name, projection_matrix_);
 		object_classifier_.HermesDetectInit((ClusterMode)CLUSTER_EM, (ClassifierType)CLASSIFIER_RTC, global_feature_params_, object_name);
+		if (hermes_view_search_benchmark_queries > 0)
+			object_classifier_.HermesViewIndexBenchmark(hermes_view_search_benchmark_queries, 10, 0.1, std::cout);
 	}
 	else if (mode_of_operation_ == 3)
 	{
@@ -70,6 +97,11 @@ ObjectCategorization::ObjectCategorization(ros::NodeHandle nh)
 		return;
 	}
 
+	// categorization workers
+	worker_pool_ = new ipa_utils::ThreadPool(number_worker_threads);
+	if (latest_frame_wins_ == true)
+		processing_thread_ = new boost::thread(boost::bind(&ObjectCategorization::processingLoop, this));
+
 	// subscribers
 	it_ = new image_transport::ImageTransport(node_handle_);
 	color_image_sub_.subscribe(*it_, "input_color_image", 1);
@@ -88,91 +120,167 @@ ObjectCategorization::ObjectCategorization(ros::NodeHandle nh)
 
 ObjectCategorization::~ObjectCategorization()
 {
-	if (it_ != 0) delete it_;
 	if (sync_input_ != 0) delete sync_input_;
+	if (it_ != 0) delete it_;
+
+	if (processing_thread_ != 0)
+	{
+		{
+			boost::mutex::scoped_lock lock(frame_mutex_);
+			shutdown_ = true;
+		}
+		frame_available_.notify_all();
+		processing_thread_->join();
+		delete processing_thread_;
+	}
+	if (worker_pool_ != 0) delete worker_pool_;
 }
 
 /// callback for the incoming pointcloud data stream
 void ObjectCategorization::inputCallback(const cob_perception_msgs::PointCloud2Array::ConstPtr& input_pointcloud_segments_msg, const sensor_msgs::Image::ConstPtr& input_image_msg)
+{
+	if (latest_frame_wins_ == false)
+	{
+		processFrame(input_pointcloud_segments_msg, input_image_msg);
+		return;
+	}
+
+	// hand the frame over to the processing thread, a frame which is still waiting is stale now
+	{
+		boost::mutex::scoped_lock lock(frame_mutex_);
+		if (has_pending_frame_ == true)
+		{
+			number_dropped_frames_++;
+			ROS_DEBUG("ObjectCategorization: Dropped a stale frame (%u frames dropped so far).", number_dropped_frames_);
+		}
+		pending_frame_.segments = input_pointcloud_segments_msg;
+		pending_frame_.image = input_image_msg;
+		has_pending_frame_ = true;
+	}
+	frame_available_.notify_one();
+}
+
+void ObjectCategorization::processingLoop()
+{
+	while (true)
+	{
+		InputFrame frame;
+		{
+			boost::mutex::scoped_lock lock(frame_mutex_);
+			while (has_pending_frame_ == false && shutdown_ == false)
+				frame_available_.wait(lock);
+			if (shutdown_ == true)
+				return;
+			frame = pending_frame_;
+			pending_frame_ = InputFrame();
+			has_pending_frame_ = false;
+		}
+
+		processFrame(frame.segments, frame.image);
+	}
+}
+
+void ObjectCategorization::processFrame(const cob_perception_msgs::PointCloud2Array::ConstPtr& input_pointcloud_segments_msg, const sensor_msgs::Image::ConstPtr& input_image_msg)
 {
 	std::cout << "Categorizing data..." << std::endl;
 
+	// the detection model must not be exchanged by a new goal while this frame is processed
+	boost::mutex::scoped_lock model_lock(model_mutex_);
+
+	// camera calibration of this frame
+	cv::Mat projection_matrix;
+	unsigned int width = 0, height = 0;
+	{
+		boost::mutex::scoped_lock lock(frame_mutex_);
+		projection_matrix = projection_matrix_.clone();
+		width = pointcloud_width_;
+		height = pointcloud_height_;
+	}
+
 	// convert color image to cv::Mat
 	cv_bridge::CvImageConstPtr color_image_ptr;
 	cv::Mat display_color;
-	cv::Mat display_segmentation(pointcloud_height_, pointcloud_width_, CV_8UC3);
+	cv::Mat display_segmentation(height, width, CV_8UC3);
 	display_segmentation.setTo(cv::Scalar(255,255,255,255));
 	if (convertColorImageMessageToMat(input_image_msg, color_image_ptr, display_color) == false)
 		return;
 
-	for (int segmentIndex=0; segmentIndex<(int)input_pointcloud_segments_msg->segments.size(); segmentIndex++)
+	if (mode_of_operation_ == 1)
 	{
-		typedef pcl::PointXYZRGB PointType;
-		pcl::PointCloud<PointType>::Ptr input_pointcloud(new pcl::PointCloud<PointType>);
-
-		pcl::PCLPointCloud2 pcl_pc;
-		pcl_conversions::toPCL(input_pointcloud_segments_msg->segments[segmentIndex], pcl_pc);
-		pcl::fromPCLPointCloud2(pcl_pc, *input_pointcloud);
-
-		//pcl::fromROSMsg(input_pointcloud_segments_msg->segments[segmentIndex], *input_pointcloud);
-
-		// convert to shared image
-		int umin=1e8, vmin=1e8;
-		IplImage* color_image = cvCreateImage(cvSize(pointcloud_width_, pointcloud_height_), IPL_DEPTH_8U, 3);
-		cvSetZero(color_image);
-		IplImage* coordinate_image = cvCreateImage(cvSize(pointcloud_width_, pointcloud_height_), IPL_DEPTH_32F, 3);
-		cvSetZero(coordinate_image);
-		pcl::PointXYZ avgPoint(0., 0., 0.), minPoint(1e10, 1e10, 1e10), maxPoint(-1e10,-1e10,-1e10);
-		unsigned int number_valid_points = 0;
-		for (unsigned int i=0; i<input_pointcloud->size(); i++)
+		// normal mode of operation: the segments are independent, the classifiers are only read
+		std::vector<SegmentCategorization> results(input_pointcloud_segments_msg->segments.size());
+		for (int segmentIndex=0; segmentIndex<(int)input_pointcloud_segments_msg->segments.size(); segmentIndex++)
+			worker_pool_->schedule(boost::bind(&ObjectCategorization::categorizeSegment, this, &(input_pointcloud_segments_msg->segments[segmentIndex]), &projection_matrix, width, height, &(results[segmentIndex])));
+		try
 		{
-			if ((*input_pointcloud)[i].x==0 && (*input_pointcloud)[i].y==0 && (*input_pointcloud)[i].z==0)
-				continue;
-			++number_valid_points;
-			avgPoint.x += (*input_pointcloud)[i].x;
-			avgPoint.y += (*input_pointcloud)[i].y;
-			avgPoint.z += (*input_pointcloud)[i].z;
-			minPoint.x = std::min(minPoint.x, (*input_pointcloud)[i].x);
-			minPoint.y = std::min(minPoint.y, (*input_pointcloud)[i].y);
-			minPoint.z = std::min(minPoint.z, (*input_pointcloud)[i].z);
-			maxPoint.x = std::max(maxPoint.x, (*input_pointcloud)[i].x);
-			maxPoint.y = std::max(maxPoint.y, (*input_pointcloud)[i].y);
-			maxPoint.z = std::max(maxPoint.z, (*input_pointcloud)[i].z);
-
-			cv::Mat X = (cv::Mat_<double>(4, 1) << (*input_pointcloud)[i].x, (*input_pointcloud)[i].y, (*input_pointcloud)[i].z, 1.0);
-			cv::Mat x = projection_matrix_ * X;
-			int v = x.at<double>(1)/x.at<double>(2), u = x.at<double>(0)/x.at<double>(2);
-			cvSet2D(color_image, v, u, CV_RGB((*input_pointcloud)[i].r, (*input_pointcloud)[i].g, (*input_pointcloud)[i].b));
-			cvSet2D(coordinate_image, v, u, cvScalar((*input_pointcloud)[i].x, (*input_pointcloud)[i].y, (*input_pointcloud)[i].z));
-			display_segmentation.at< cv::Point3_<uchar> >(v,u) = cv::Point3_<uchar>((*input_pointcloud)[i].b, (*input_pointcloud)[i].g, (*input_pointcloud)[i].r);
-
-			if (u<umin) umin=u;
-			if (v<vmin) vmin=v;
+			worker_pool_->wait();
 		}
-		avgPoint.x /= (double)number_valid_points;
-		avgPoint.y /= (double)number_valid_points;
-		avgPoint.z /= (double)number_valid_points;
-
-		SharedImage si;
-		si.setCoord(coordinate_image);
-		si.setShared(color_image);
-		if (mode_of_operation_ == 1)
+		catch (std::exception& e)
 		{
-			// normal mode of operation
-			std::map<double, std::string> resultsOrdered;
-			std::map<std::string, double> results;
-			object_classifier_.CategorizeObject(&si, results, resultsOrdered, (ClusterMode)CLUSTER_EM, (ClassifierType)CLASSIFIER_RTC, global_feature_params_);
-			std::map<double, std::string>::iterator it = resultsOrdered.end();
-			it--;
-			std::stringstream label;
-			label << it->second;
-			label << " (" << setprecision(3) << 100*it->first << "%)";
-			cv::putText(display_color, label.str().c_str(), cvPoint(umin, max(0,vmin-20)), cv::FONT_HERSHEY_SIMPLEX, 1.0, CV_RGB(0, 255, 0));
-			cv::putText(display_segmentation, label.str().c_str(), cvPoint(umin, max(0,vmin-20)), cv::FONT_HERSHEY_SIMPLEX, 1.0, CV_RGB(0, 255, 0));
+			ROS_ERROR("ObjectCategorization: categorizing a segment failed: %s", e.what());
+			return;
 		}
-		else if (mode_of_operation_ == 2)
+
+		// display in the order of the segments
+		for (unsigned int segmentIndex=0; segmentIndex<results.size(); segmentIndex++)
 		{
-			// Hermes mode
+			const SegmentCategorization& result = results[segmentIndex];
+			for (unsigned int i=0; i<result.pixels.size(); i++)
+				display_segmentation.at< cv::Point3_<uchar> >(result.pixels[i]) = result.colors[i];
+			if (result.valid == false)
+				continue;
+			cv::putText(display_color, result.label.c_str(), cvPoint(result.umin, max(0,result.vmin-20)), cv::FONT_HERSHEY_SIMPLEX, 1.0, CV_RGB(0, 255, 0));
+			cv::putText(display_segmentation, result.label.c_str(), cvPoint(result.umin, max(0,result.vmin-20)), cv::FONT_HERSHEY_SIMPLEX, 1.0, CV_RGB(0, 255, 0));
+		}
+	}
+	else if (mode_of_operation_ == 2)
+	{
+		// Hermes mode, works on the detection model of the classifier and is therefore processed sequentially
+		for (int segmentIndex=0; segmentIndex<(int)input_pointcloud_segments_msg->segments.size(); segmentIndex++)
+		{
+			typedef pcl::PointXYZRGB PointType;
+			pcl::PointCloud<PointType>::Ptr input_pointcloud(new pcl::PointCloud<PointType>);
+
+			pcl::PCLPointCloud2 pcl_pc;
+			pcl_conversions::toPCL(input_pointcloud_segments_msg->segments[segmentIndex], pcl_pc);
+			pcl::fromPCLPointCloud2(pcl_pc, *input_pointcloud);
+
+			// convert to shared image
+			IplImage* color_image = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
+			cvSetZero(color_image);
+			IplImage* coordinate_image = cvCreateImage(cvSize(width, height), IPL_DEPTH_32F, 3);
+			cvSetZero(coordinate_image);
+			pcl::PointXYZ avgPoint(0., 0., 0.), minPoint(1e10, 1e10, 1e10), maxPoint(-1e10,-1e10,-1e10);
+			unsigned int number_valid_points = 0;
+			for (unsigned int i=0; i<input_pointcloud->size(); i++)
+			{
+				if ((*input_pointcloud)[i].x==0 && (*input_pointcloud)[i].y==0 && (*input_pointcloud)[i].z==0)
+					continue;
+				++number_valid_points;
+				avgPoint.x += (*input_pointcloud)[i].x;
+				avgPoint.y += (*input_pointcloud)[i].y;
+				avgPoint.z += (*input_pointcloud)[i].z;
+				minPoint.x = std::min(minPoint.x, (*input_pointcloud)[i].x);
+				minPoint.y = std::min(minPoint.y, (*input_pointcloud)[i].y);
+				minPoint.z = std::min(minPoint.z, (*input_pointcloud)[i].z);
+				maxPoint.x = std::max(maxPoint.x, (*input_pointcloud)[i].x);
+				maxPoint.y = std::max(maxPoint.y, (*input_pointcloud)[i].y);
+				maxPoint.z = std::max(maxPoint.z, (*input_pointcloud)[i].z);
+
+				cv::Mat X = (cv::Mat_<double>(4, 1) << (*input_pointcloud)[i].x, (*input_pointcloud)[i].y, (*input_pointcloud)[i].z, 1.0);
+				cv::Mat x = projection_matrix * X;
+				int v = x.at<double>(1)/x.at<double>(2), u = x.at<double>(0)/x.at<double>(2);
+				cvSet2D(color_image, v, u, CV_RGB((*input_pointcloud)[i].r, (*input_pointcloud)[i].g, (*input_pointcloud)[i].b));
+				cvSet2D(coordinate_image, v, u, cvScalar((*input_pointcloud)[i].x, (*input_pointcloud)[i].y, (*input_pointcloud)[i].z));
+				display_segmentation.at< cv::Point3_<uchar> >(v,u) = cv::Point3_<uchar>((*input_pointcloud)[i].b, (*input_pointcloud)[i].g, (*input_pointcloud)[i].r);
+			}
+			avgPoint.x /= (double)number_valid_points;
+			avgPoint.y /= (double)number_valid_points;
+			avgPoint.z /= (double)number_valid_points;
+
+			SharedImage si;
+			si.setCoord(coordinate_image);
+			si.setShared(color_image);
 			if (maxPoint.x-minPoint.x < 0.5 && maxPoint.y-minPoint.y < 0.5 && maxPoint.z-minPoint.z < 0.5)
 			{
 				double pan=0, tilt=0, roll=0;
@@ -200,23 +308,89 @@ void ObjectCategorization::inputCallback(const cob_perception_msgs::PointCloud2A
 						object_pose = pose4.inverse() * finalTransformTf.inverse() * pose4 * pose1 * pose2 * pose3;	// transformation pointing from camera system to object system
 					}
 //					drawObjectCoordinateSystem(object_pose, display_color);
-					latest_object_detection_.label = hermes_object_name_;
+					cob_object_detection_msgs::Detection object_detection;
+					object_detection.label = hermes_object_name_;
 					tf::Stamped<tf::Transform> object_pose_stamped = tf::Stamped<tf::Transform>(object_pose, input_pointcloud_segments_msg->header.stamp, input_pointcloud_segments_msg->header.frame_id);
-					tf::poseStampedTFToMsg(object_pose_stamped, latest_object_detection_.pose);
-					latest_object_detection_.header.frame_id = input_pointcloud_segments_msg->header.frame_id;
-					latest_object_detection_.header.stamp = input_pointcloud_segments_msg->header.stamp;
+					tf::poseStampedTFToMsg(object_pose_stamped, object_detection.pose);
+					object_detection.header.frame_id = input_pointcloud_segments_msg->header.frame_id;
+					object_detection.header.stamp = input_pointcloud_segments_msg->header.stamp;
+					{
+						boost::mutex::scoped_lock lock(frame_mutex_);
+						latest_object_detection_ = object_detection;
+					}
 					transform_broadcaster_.sendTransform(tf::StampedTransform(object_pose, input_pointcloud_segments_msg->header.stamp, input_pointcloud_segments_msg->header.frame_id, "detected_shoe"));
 				}
 			}
+			si.Release();
 		}
-		si.Release();
-
 	}
 //	cv::imshow("categorized objects", display_color);
 //	cv::imshow("segmented image", display_segmentation);
 //	cv::waitKey(80);
 }
 
+void ObjectCategorization::categorizeSegment(const sensor_msgs::PointCloud2* segment_msg, const cv::Mat* projection_matrix, unsigned int width, unsigned int height, SegmentCategorization* result)
+{
+	result->valid = false;
+	if (projection_matrix->empty() == true)
+		return;
+
+	typedef pcl::PointXYZRGB PointType;
+	pcl::PointCloud<PointType>::Ptr input_pointcloud(new pcl::PointCloud<PointType>);
+
+	pcl::PCLPointCloud2 pcl_pc;
+	pcl_conversions::toPCL(*segment_msg, pcl_pc);
+	pcl::fromPCLPointCloud2(pcl_pc, *input_pointcloud);
+
+	// convert to shared image
+	result->umin = 1e8;
+	result->vmin = 1e8;
+	result->pixels.reserve(input_pointcloud->size());
+	result->colors.reserve(input_pointcloud->size());
+	IplImage* color_image = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
+	cvSetZero(color_image);
+	IplImage* coordinate_image = cvCreateImage(cvSize(width, height), IPL_DEPTH_32F, 3);
+	cvSetZero(coordinate_image);
+	for (unsigned int i=0; i<input_pointcloud->size(); i++)
+	{
+		const PointType& point = (*input_pointcloud)[i];
+		if (point.x==0 && point.y==0 && point.z==0)
+			continue;
+
+		cv::Mat X = (cv::Mat_<double>(4, 1) << point.x, point.y, point.z, 1.0);
+		cv::Mat x = (*projection_matrix) * X;
+		int v = x.at<double>(1)/x.at<double>(2), u = x.at<double>(0)/x.at<double>(2);
+		if (u<0 || u>=(int)width || v<0 || v>=(int)height)
+			continue;
+		cvSet2D(color_image, v, u, CV_RGB(point.r, point.g, point.b));
+		cvSet2D(coordinate_image, v, u, cvScalar(point.x, point.y, point.z));
+		result->pixels.push_back(cv::Point(u, v));
+		result->colors.push_back(cv::Point3_<uchar>(point.b, point.g, point.r));
+
+		if (u<result->umin) result->umin=u;
+		if (v<result->vmin) result->vmin=v;
+	}
+
+	SharedImage si;
+	si.setCoord(coordinate_image);
+	si.setShared(color_image);
+	std::map<double, std::string> resultsOrdered;
+	std::map<std::string, double> results;
+	object_classifier_.CategorizeObject(&si, results, resultsOrdered, (ClusterMode)CLUSTER_EM, (ClassifierType)CLASSIFIER_RTC, global_feature_params_);
+	si.Release();
+
+	if (resultsOrdered.empty() == false)
+	{
+		std::map<double, std::string>::iterator it = resultsOrdered.end();
+		it--;
+		std::stringstream label;
+		label << it->second;
+		label << " (" << setprecision(3) << 100*it->first << "%)";
+		result->label = label.str();
+		result->valid = true;
+	}
+}
+
 void ObjectCategorization::drawObjectCoordinateSystem(const tf::Transform& object_pose, cv::Mat& display_image)
 {
 	cv::Point o_C = projectVector3ToUV(object_pose*tf::Vector3(0.,0.,0.));
@@ -259,12 +433,26 @@ void ObjectCategorization::detectObjectsCallback(const cob_object_detection_msgs
 {
 	// this callback function is executed each time a request (= goal message) comes in for this service server
 	std::string object_name = goal->object_name.data;
-	hermes_object_name_ = object_name;
 	ROS_INFO("Detect Object Action Server: Received a request for detecting object %s.", object_name.c_str());
 
 	// init the algorithm for the requested object
-	object_classifier_.HermesLoadCameraCalibration(object_name, projection_matrix_);
-	object_classifier_.HermesDetectInit((ClusterMode)CLUSTER_EM, (ClassifierType)CLASSIFIER_RTC, global_feature_params_, object_name);
+	{
+		// drop the frame waiting for the previous model and wait until the frame in progress is finished
+		{
+			boost::mutex::scoped_lock lock(frame_mutex_);
+			pending_frame_ = InputFrame();
+			has_pending_frame_ = false;
+		}
+		boost::mutex::scoped_lock model_lock(model_mutex_);
+		hermes_object_name_ = object_name;
+		cv::Mat projection_matrix;
+		bool calibration_loaded = (object_classifier_.HermesLoadCameraCalibration(object_name, projection_matrix) != false);
+		object_classifier_.HermesDetectInit((ClusterMode)CLUSTER_EM, (ClassifierType)CLASSIFIER_RTC, global_feature_params_, object_name);
+		boost::mutex::scoped_lock lock(frame_mutex_);
+		if (calibration_loaded == true)
+			projection_matrix_ = projection_matrix;
+		latest_object_detection_ = cob_object_detection_msgs::Detection();
+	}
 
 	// activate detection
 	message_filters::Connection connection = sync_input_->registerCallback(boost::bind(&ObjectCategorization::inputCallback, this, _1, _2));
@@ -273,8 +461,15 @@ void ObjectCategorization::detectObjectsCallback(const cob_object_detection_msgs
 	ros::Time start_time = ros::Time::now();
 	ros::Rate loop_rate(0.1);
 	bool abort_with_timeout = false;
-	while ((ros::Time::now() - latest_object_detection_.header.stamp).toSec() > 2.0 && abort_with_timeout==false)
+	cob_object_detection_msgs::Detection object_detection;
+	while (abort_with_timeout==false)
 	{
+		{
+			boost::mutex::scoped_lock lock(frame_mutex_);
+			object_detection = latest_object_detection_;
+		}
+		if ((ros::Time::now() - object_detection.header.stamp).toSec() <= 2.0)
+			break;
 		if ((ros::Time::now() - start_time).toSec() > 30.0)
 			abort_with_timeout = true;
 		loop_rate.sleep();
@@ -286,8 +481,8 @@ void ObjectCategorization::detectObjectsCallback(const cob_object_detection_msgs
 	cob_object_detection_msgs::DetectObjectsResult res;
 	if (abort_with_timeout == false)
 	{
-		res.object_list.detections.push_back(latest_object_detection_);
-		res.object_list.header = latest_object_detection_.header;
+		res.object_list.detections.push_back(object_detection);
+		res.object_list.header = object_detection.header;
 	}
 	else
 		ROS_WARN("Did not find any object of type %s in the allowed time span.", object_name.c_str());
@@ -298,6 +493,7 @@ void ObjectCategorization::detectObjectsCallback(const cob_object_detection_msgs
 
 void ObjectCategorization::calibrationCallback(const sensor_msgs::CameraInfo::ConstPtr& calibration_msg)
 {
+	boost::mutex::scoped_lock lock(frame_mutex_);
 	pointcloud_height_ = calibration_msg->height;
 	pointcloud_width_ = calibration_msg->width;
 	cv::Mat temp(3,4,CV_64FC1);
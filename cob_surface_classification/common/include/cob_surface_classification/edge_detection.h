@@ -70,6 +70,10 @@
 #include <pcl_ros/point_cloud.h>
 #include <pcl/pcl_base.h>
 
+#include <vector>
+#include <cmath>
+#include <cstring>
+
 // timer
 #include <iostream>
 #include "timer.h"
@@ -96,225 +100,85 @@ public:
 		number_processed_images_ = 0;
 	};
 
+	/// Detects the depth and surface discontinuities of an organized point cloud.
+	/// @param pointcloud organized point cloud
+	/// @param edge returns the edge image (CV_8UC1, edges 255)
 	void computeDepthEdges(PointCloudInConstPtr pointcloud, cv::Mat& edge)
 	{
 		// compute x,y, z images
 		Timer tim;
 		tim.start();
-		cv::Mat x_image = cv::Mat::zeros(pointcloud->height, pointcloud->width, CV_32FC1);
-		cv::Mat y_image = cv::Mat::zeros(pointcloud->height, pointcloud->width, CV_32FC1);
-		cv::Mat z_image = cv::Mat::zeros(pointcloud->height, pointcloud->width, CV_32FC1);
-		int i=0;
-		for (unsigned int v=0; v<pointcloud->height; v++)
-		{
-			float* x_ptr = (float*)x_image.ptr(v);
-			float* y_ptr = (float*)y_image.ptr(v);
-			float* z_ptr = (float*)z_image.ptr(v);
-			for (unsigned int u=0; u<pointcloud->width; u++, i++)
-			{
-				//matrix indices: row y, column x!
-				const pcl::PointXYZRGB& point = pointcloud->at(u,v);
-
-				if(point.z == point.z)	//test nan
-				{
-					*x_ptr = point.x;
-					*y_ptr = point.y;
-					*z_ptr = point.z;
-					//z_image.at<float>(v,u) = point.z;
-				}
-				++x_ptr;
-				++y_ptr;
-				++z_ptr;
-			}
-		}
+		x_image_.create(pointcloud->height, pointcloud->width, CV_32FC1);
+		y_image_.create(pointcloud->height, pointcloud->width, CV_32FC1);
+		z_image_.create(pointcloud->height, pointcloud->width, CV_32FC1);
+		cv::parallel_for_(cv::Range(0, pointcloud->height), DepthImageBody(*pointcloud, x_image_, y_image_, z_image_), std::max(1, (int)pointcloud->height/BAND_SIZE));
 		//std::cout << "Time for x/y/z images: " << tim.getElapsedTimeInMilliSec() << "\n";
 		runtime_depth_image_ += tim.getElapsedTimeInMilliSec();
 
 		//visualization
 //		cv::Mat depth_im_scaled;
-//		cv::normalize(z_image, depth_im_scaled,0,1,cv::NORM_MINMAX);
+//		cv::normalize(z_image_, depth_im_scaled,0,1,cv::NORM_MINMAX);
 //		cv::imshow("depth_image", depth_im_scaled);
 //		cv::waitKey(10);
 
+		computeDepthEdges(x_image_, y_image_, z_image_, edge);
+	}
 
-		//int key = 0;
+	/// Detects the depth and surface discontinuities of an organized point cloud that is given as separate coordinate images (structure of arrays).
+	/// @param x_image x coordinates (CV_32FC1), 0 at invalid points
+	/// @param y_image y coordinates (CV_32FC1), 0 at invalid points
+	/// @param z_image z coordinates (CV_32FC1), 0 at invalid points, the images must not be ROIs of larger images
+	/// @param edge returns the edge image (CV_8UC1, edges 255)
+	void computeDepthEdges(const cv::Mat& x_image, const cv::Mat& y_image, const cv::Mat& z_image, cv::Mat& edge)
+	{
+		// the bodies index the three images with the same row and column offsets
+		CV_Assert(x_image.type() == CV_32FC1 && y_image.type() == CV_32FC1 && z_image.type() == CV_32FC1);
+		CV_Assert(x_image.size() == z_image.size() && y_image.size() == z_image.size());
+		CV_Assert(!x_image.isSubmatrix() && !y_image.isSubmatrix() && !z_image.isSubmatrix());
+
+		// the images are processed in bands of rows (or columns) in parallel, a band of a VGA image fits into the cache
+		const int height = z_image.rows;
+		const int width = z_image.cols;
+		const double row_bands = std::max(1, height/BAND_SIZE);
+		const double column_bands = std::max(1, width/BAND_SIZE);
+		const int max_line_width = 30;
+
+		// the workspace is only reallocated if the image size changes
+		x_dx_.create(height, width, CV_32FC1);
+		y_dy_.create(height, width, CV_32FC1);
+		z_dx_unsmoothed_.create(height, width, CV_32FC1);
+		z_dy_unsmoothed_.create(height, width, CV_32FC1);
+		z_dx_.create(height, width, CV_32FC1);
+		z_dy_.create(height, width, CV_32FC1);
+		y_dy_integralY_.create(height, width, CV_32FC1);
+		z_dy_integralY_.create(height, width, CV_32FC1);
 
 		Timer total;
 		total.start();
+		Timer tim;
 		tim.start();
-		cv::Mat x_dx, y_dy, z_dx, z_dy;
-		//cv::medianBlur(z_image, z_image, 5);
-		cv::Sobel(x_image, x_dx, -1, 1, 0, 5, 1./(6.*16.));
-		cv::Sobel(y_image, y_dy, -1, 0, 1, 5, 1./(6.*16.));
-		cv::Sobel(z_image, z_dx, -1, 1, 0, 5, 1./(6.*16.));
-		cv::Sobel(z_image, z_dy, -1, 0, 1, 5, 1./(6.*16.));
-		//cv::medianBlur(z_dx, z_dx, 5);
-		//cv::medianBlur(z_dy, z_dy, 5);
-		cv::GaussianBlur(z_dx, z_dx, cv::Size(5,5), 0, 0);
-		cv::GaussianBlur(z_dy, z_dy, cv::Size(5,5), 0, 0);
+		cv::parallel_for_(cv::Range(0, height), DerivativesBody(x_image, y_image, z_image, x_dx_, y_dy_, z_dx_unsmoothed_, z_dy_unsmoothed_), row_bands);
 		//std::cout << "Time for slope Sobel: " << tim.getElapsedTimeInMilliSec() << "\n";
 		runtime_sobel_ += tim.getElapsedTimeInMilliSec();
 
 		tim.start();
-//		cv::Mat kx, ky;
-//		cv::getDerivKernels(kx, ky, 1, 0, 5, false, CV_32F);
-//		std::cout << "kx:\n";
-//		for (int i=0; i<kx.rows; ++i)
-//		{
-//			for (int j=0; j<kx.cols; ++j)
-//				std::cout << kx.at<float>(i,j) << "\t";
-//			std::cout << std::endl;
-//		}
-//		std::cout << "\nky:\n";
-//		for (int i=0; i<ky.rows; ++i)
-//		{
-//			for (int j=0; j<ky.cols; ++j)
-//				std::cout << ky.at<float>(i,j) << "\t";
-//			std::cout << std::endl;
-//		}
-
-		// depth discontinuities
-		//cv::Mat edge = cv::Mat::zeros(z_image.rows, z_image.cols, CV_8UC1);
-		edge = cv::Mat::zeros(z_image.rows, z_image.cols, CV_8UC1);
-		const int max_line_width = 30;
-		for (int v = max_line_width; v < z_dx.rows - max_line_width - 1; ++v)
-		{
-			for (int u = max_line_width; u < z_dx.cols - max_line_width - 1; ++u)
-			{
-				float depth = z_image.at<float>(v, u);
-				if (depth==0.f)
-					continue;
-				if (z_dx.at<float>(v, u) <= -0.02*depth || z_dx.at<float>(v, u) >= 0.02*depth ||
-						z_dy.at<float>(v, u) <= -0.02*depth || z_dy.at<float>(v, u) >= 0.02*depth)
-					edge.at<uchar>(v, u) = 255;
-			}
-		}
-//		cv::Mat edge_integral;
-//		cv::integral(edge, edge_integral, CV_32S);
-		//std::cout << "Time for edge+integral: " << tim.getElapsedTimeInMilliSec() << "\n";
-
-		// surface discontinuities
-		// x lines
-		int line_width = 10; // 1px/0.10m
-		int last_line_width = 10;
-		cv::Mat x_dx_integralX, z_dx_integralX;
-		computeIntegralImageX(x_dx, x_dx_integralX, z_dx, z_dx_integralX);
-		for (int v = max_line_width; v < z_dx.rows - max_line_width - 1; ++v)
-		{
-			int edge_start_index = -1;
-			for (int u = max_line_width; u < z_dx.cols - max_line_width - 1; ++u)
-			{
-				float depth = z_image.at<float>(v, u);
-				if (depth==0.f)
-					continue;
-				//if (z_dx.at<float>(v, u) <= -0.05 || z_dx.at<float>(v, u) >= 0.05)
-//				if (z_dx.at<float>(v, u) <= -0.02*depth || z_dx.at<float>(v, u) >= 0.02*depth)
-//				{
-//					edge.at<uchar>(v, u) = 255;
-//				}
-//				else
-//				{
-					// depth dependent scan line width for slope computation (1px/0.10m)
-					line_width = std::min(int(10 * depth), max_line_width);
-					if (line_width == 0)
-						line_width = last_line_width;
-					else
-						last_line_width = line_width;
-					// do not compute if a depth discontinuity is on the line (ATTENTION: opencv uses a different indexing scheme which is basically +1 in x and y direction, so pixel itself is not included in sum)
-		//			if (edge_integral.at<int>(v+1,u+line_width+1)-edge_integral.at<int>(v+1,u-line_width)-edge_integral.at<int>(v,u+line_width+1)+edge_integral.at<int>(v,u-line_width) != 0)
-		//				continue;
-
-					// get average differences in x and z direction (ATTENTION: the integral images provide just the sum, not divided by number of elements, however, further processing only needs the sum, not the real average)
-					double avg_dx_l = x_dx_integralX.at<float>(v, u-1) - x_dx_integralX.at<float>(v, u-line_width);
-					double avg_dz_l = z_dx_integralX.at<float>(v, u-1) - z_dx_integralX.at<float>(v, u-line_width);
-					float avg_dx_r = x_dx_integralX.at<float>(v, u+line_width) - x_dx_integralX.at<float>(v, u+1);
-					float avg_dz_r = z_dx_integralX.at<float>(v, u+line_width) - z_dx_integralX.at<float>(v, u+1);
-
-					// estimate angle difference
-					float alpha_left = fast_atan2f_1(-avg_dz_l, -avg_dx_l);
-					float alpha_right = fast_atan2f_1(avg_dz_r, avg_dx_r);
-					float diff = fabs(alpha_left - alpha_right);
-					if (diff!=0 && (diff < 145. / 180. * CV_PI || diff > 215. / 180. * CV_PI))
-					{
-						//edge.at<uchar>(v, u) = 16; //(diff < 145. / 180. * CV_PI ? -64 : 64);//64 + 64 * 2 * fabs(CV_PI - fabs(alpha_left - alpha_right)) / CV_PI;
-						if (edge_start_index == -1)
-							edge_start_index = u;
-					}
-					else
-					{
-						if (edge_start_index != -1)
-						{
-							edge.at<uchar>(v, (edge_start_index+u-1)/2) = 255;	//192
-							edge_start_index = -1;
-						}
-					}
-//				}
-			}
-		}
-		// y lines
-		line_width = 10; // 1px/0.10m
-		last_line_width = 10;
-		cv::Mat y_dy_integralY, z_dy_integralY;
-		computeIntegralImageY(y_dy, y_dy_integralY, z_dy, z_dy_integralY);
-		std::vector<int> edge_start_index(z_dy.cols, -1);
-		for (int v = max_line_width; v < z_dy.rows - max_line_width - 1; ++v)
-		{
-			for (int u = max_line_width; u < z_dy.cols - max_line_width - 1; ++u)
-			{
-				float depth = z_image.at<float>(v, u);
-				if (depth==0.f)
-					continue;
-				//if (z_dy.at<float>(v, u) <= -0.05 || z_dy.at<float>(v, u) >= 0.05)
-//				if (z_dy.at<float>(v, u) <= -0.02*depth || z_dy.at<float>(v, u) >= 0.02*depth)
-//				{
-//					edge.at<uchar>(v, u) = 255;
-//				}
-//				else
-				if (edge.at<uchar>(v, u) == 0)
-				{
-					// depth dependent scan line width for slope computation (1px/0.10m)
-					line_width = std::min(int(10 * depth), max_line_width);
-					if (line_width == 0)
-						line_width = last_line_width;
-					else
-						last_line_width = line_width;
-					// do not compute if a depth discontinuity is on the line (ATTENTION: opencv uses a different indexing scheme which is basically +1 in x and y direction, so pixel itself is not included in sum)
-		//			if (edge_integral.at<int>(v+line_width+1,u+1)-edge_integral.at<int>(v-line_width,u+1)-edge_integral.at<int>(v+line_width+1,u)+edge_integral.at<int>(v-line_width,u) != 0)
-		//todo:				continue;
-
-					// get average differences in x and z direction (ATTENTION: the integral images provide just the sum, not divided by number of elements, however, further processing only needs the sum, not the real average)
-					double avg_dy_u = y_dy_integralY.at<float>(v-1, u) - y_dy_integralY.at<float>(v-line_width, u);
-					double avg_dz_u = z_dy_integralY.at<float>(v-1, u) - z_dy_integralY.at<float>(v-line_width, u);
-					float avg_dy_l = y_dy_integralY.at<float>(v+line_width, u) - y_dy_integralY.at<float>(v+1, u);
-					float avg_dz_l = z_dy_integralY.at<float>(v+line_width, u) - z_dy_integralY.at<float>(v+1, u);
-
-					// estimate angle difference
-					float alpha_upper = fast_atan2f_1(-avg_dz_u, -avg_dy_u);
-					float alpha_lower = fast_atan2f_1(avg_dz_l, avg_dy_l);
-					float diff = fabs(alpha_upper - alpha_lower);
-					if (diff!=0 && (diff < 145. / 180. * CV_PI || diff > 215. / 180. * CV_PI))
-					{
-						//edge.at<uchar>(v, u) = 32; //128 + (diff < 145. / 180. * CV_PI ? -64 : 64);//64 + 64 * 2 * fabs(CV_PI - fabs(alpha_left - alpha_right)) / CV_PI;
-						if (edge_start_index[u] == -1)
-							edge_start_index[u] = v;
-					}
-					else
-					{
-						if (edge_start_index[u] != -1)
-						{
-							edge.at<uchar>((edge_start_index[u]+v-1)/2, u) = 255;  //192;
-							edge_start_index[u] = -1;
-						}
-					}
-				}
-			}
-		}
+		// depth discontinuities and surface discontinuities along the x lines, row by row
+		edge.create(height, width, CV_8UC1);
+		cv::parallel_for_(cv::Range(0, height), HorizontalEdgesBody(z_image, x_dx_, z_dx_unsmoothed_, z_dy_unsmoothed_, z_dx_, z_dy_, edge, max_line_width), row_bands);
+
+		// surface discontinuities along the y lines, column by column
+		cv::parallel_for_(cv::Range(0, width), VerticalEdgesBody(z_image, y_dy_, z_dy_, y_dy_integralY_, z_dy_integralY_, edge, max_line_width), column_bands);
+
 		cv::dilate(edge, edge, cv::Mat(), cv::Point(-1,-1), 1);
 		cv::erode(edge, edge, cv::Mat(), cv::Point(-1,-1), 1);
-		for (int v=0; v<z_image.rows; ++v)
-			for (int u=0; u<z_image.cols; ++u)
-				if (z_image.at<float>(v,u)==0)
-					edge.at<uchar>(v,u)=0;
+		for (int v=0; v<height; ++v)
+		{
+			const float* z_ptr = (const float*)z_image.ptr(v);
+			uchar* edge_ptr = edge.ptr(v);
+			for (int u=0; u<width; ++u)
+				if (z_ptr[u]==0.f)
+					edge_ptr[u]=0;
+		}
 		//std::cout << "Time for slope+edge: " << tim.getElapsedTimeInMilliSec() << "\n";
 		runtime_edge_ += tim.getElapsedTimeInMilliSec();
 
@@ -331,17 +195,16 @@ public:
 //					"\nruntime_edge: " << runtime_edge_/(double)number_processed_images_ << std::endl;
 					//"\nruntime_visibility: " << runtime_visibility_/(double)number_processed_images_ <<
 
-//		cv::imshow("z_dx", z_dx);
-//		cv::normalize(x_dx, x_dx, 0., 1., cv::NORM_MINMAX);
-//		cv::imshow("x_dx", x_dx);
-		//cv::normalize(average_slope, average_slope, 0., 1., cv::NORM_MINMAX);
-//		average_dz_right = average_dz_right * 15 + 0.5;
-//		cv::imshow("average_slope", average_dz_right);
+//		cv::imshow("z_dx", z_dx_);
+//		cv::imshow("x_dx", x_dx_);
 //		cv::imshow("edge", edge);
 	}
 
 private:
 
+	// number of rows (columns) of a band that is processed by one task of cv::parallel_for_
+	enum { BAND_SIZE = 32 };
+
 	// from https://gist.github.com/volkansalma/2972237
 	//  or  http://lists.apple.com/archives/perfoptimization-dev/2005/Jan/msg00051.html
 	const float PI_FLOAT; // = 3.14159265f;
@@ -407,83 +270,292 @@ private:
 		return (CV_PI/2.0 - (x + 1./6.*x*x2 + 3./40.*x*x4));
 	}
 
-	// creates an integral image within x-direction (i.e. line-wise, horizontally) for two source images
-	void computeIntegralImageX(const cv::Mat& srcX, cv::Mat& dstX, const cv::Mat& srcZ, cv::Mat& dstZ)
+	// Surface discontinuity test of a scan line: the averaged slopes before and after each pixel are
+	// (d1_before, dz_before) and (d1_after, dz_after), a pixel is a discontinuity candidate if the two
+	// slope directions enclose an angle below 145 deg, i.e. if the surface is bent by more than 35 deg.
+	// The angle is evaluated by the dot product instead of two atan2 calls, so the loop is free of
+	// branches and vectorized by the compiler. Pixels with a zero slope on either side are no candidates.
+	static void computeSlopeDiscontinuities(const float* d1_before, const float* dz_before, const float* d1_after, const float* dz_after, const int length, uchar* discontinuity)
+	{
+		const float cos_min_angle = -0.81915204f;	// cos(145 deg)
+		for (int i=0; i<length; ++i)
+		{
+			const float dot = -(d1_before[i]*d1_after[i] + dz_before[i]*dz_after[i]);
+			const float norm2 = (d1_before[i]*d1_before[i] + dz_before[i]*dz_before[i]) * (d1_after[i]*d1_after[i] + dz_after[i]*dz_after[i]);
+			discontinuity[i] = (uchar)((norm2 > 0.f) & (dot > cos_min_angle*std::sqrt(norm2)));
+		}
+	}
+
+	// depth dependent scan line width for slope computation (1px/0.10m), points closer than 0.1m keep the width of the previous point on the scan line
+	static int scanLineWidth(const float depth, const int max_line_width, int& last_line_width)
+	{
+		int line_width = std::min(int(10 * depth), max_line_width);
+		if (line_width == 0)
+			line_width = last_line_width;
+		else
+			last_line_width = line_width;
+		return line_width;
+	}
+
+	// copies the coordinates of the organized point cloud into x, y and z images, invalid points are 0
+	class DepthImageBody : public cv::ParallelLoopBody
+	{
+	public:
+		DepthImageBody(const PointCloudIn& pointcloud, cv::Mat& x_image, cv::Mat& y_image, cv::Mat& z_image)
+		: pointcloud_(pointcloud), x_image_(x_image), y_image_(y_image), z_image_(z_image)
+		{
+		}
+
+		virtual void operator()(const cv::Range& range) const
+		{
+			const int width = pointcloud_.width;
+			for (int v=range.start; v<range.end; ++v)
+			{
+				const PointInT* point = &pointcloud_.points[v*width];
+				float* x_ptr = (float*)x_image_.ptr(v);
+				float* y_ptr = (float*)y_image_.ptr(v);
+				float* z_ptr = (float*)z_image_.ptr(v);
+				for (int u=0; u<width; ++u, ++point)
+				{
+					const bool valid = (point->z == point->z);	//test nan
+					x_ptr[u] = valid ? point->x : 0.f;
+					y_ptr[u] = valid ? point->y : 0.f;
+					z_ptr[u] = valid ? point->z : 0.f;
+				}
+			}
+		}
+
+	private:
+		const PointCloudIn& pointcloud_;
+		cv::Mat& x_image_;
+		cv::Mat& y_image_;
+		cv::Mat& z_image_;
+	};
+
+	// Sobel derivatives of a band of rows, the filters read the neighboring rows of the full images at the band borders,
+	// so the result is identical to filtering the whole image at once
+	class DerivativesBody : public cv::ParallelLoopBody
+	{
+	public:
+		DerivativesBody(const cv::Mat& x_image, const cv::Mat& y_image, const cv::Mat& z_image, cv::Mat& x_dx, cv::Mat& y_dy, cv::Mat& z_dx, cv::Mat& z_dy)
+		: x_image_(x_image), y_image_(y_image), z_image_(z_image), x_dx_(x_dx), y_dy_(y_dy), z_dx_(z_dx), z_dy_(z_dy)
+		{
+		}
+
+		virtual void operator()(const cv::Range& range) const
+		{
+			cv::Mat x_dx = x_dx_.rowRange(range), y_dy = y_dy_.rowRange(range), z_dx = z_dx_.rowRange(range), z_dy = z_dy_.rowRange(range);
+			cv::Sobel(x_image_.rowRange(range), x_dx, -1, 1, 0, 5, 1./(6.*16.));
+			cv::Sobel(y_image_.rowRange(range), y_dy, -1, 0, 1, 5, 1./(6.*16.));
+			cv::Sobel(z_image_.rowRange(range), z_dx, -1, 1, 0, 5, 1./(6.*16.));
+			cv::Sobel(z_image_.rowRange(range), z_dy, -1, 0, 1, 5, 1./(6.*16.));
+		}
+
+	private:
+		const cv::Mat& x_image_;
+		const cv::Mat& y_image_;
+		const cv::Mat& z_image_;
+		cv::Mat& x_dx_;
+		cv::Mat& y_dy_;
+		cv::Mat& z_dx_;
+		cv::Mat& z_dy_;
+	};
+
+	// Smooths the depth derivatives of a band of rows and marks the depth discontinuities and the surface discontinuities along the rows.
+	// The running sums of the x and z slopes are computed per row right before the row is scanned.
+	class HorizontalEdgesBody : public cv::ParallelLoopBody
 	{
-		dstX = cv::Mat(srcX.rows, srcX.cols, CV_32FC1);
-		dstZ = cv::Mat(srcX.rows, srcX.cols, CV_32FC1);
-		for (int v=0; v<srcX.rows; ++v)
+	public:
+		HorizontalEdgesBody(const cv::Mat& z_image, const cv::Mat& x_dx, const cv::Mat& z_dx_unsmoothed, const cv::Mat& z_dy_unsmoothed, cv::Mat& z_dx, cv::Mat& z_dy, cv::Mat& edge, const int max_line_width)
+		: z_image_(z_image), x_dx_(x_dx), z_dx_unsmoothed_(z_dx_unsmoothed), z_dy_unsmoothed_(z_dy_unsmoothed), z_dx_(z_dx), z_dy_(z_dy), edge_(edge), max_line_width_(max_line_width)
+		{
+		}
+
+		virtual void operator()(const cv::Range& range) const
 		{
-			float* dstX_ptr = (float*)dstX.ptr(v);
-			const float* srcX_ptr = (const float*)srcX.ptr(v);
-			float* dstZ_ptr = (float*)dstZ.ptr(v);
-			const float* srcZ_ptr = (const float*)srcZ.ptr(v);
-			float sumX = 0.f;
-			float sumZ = 0.f;
-			for (int u=0; u<srcX.cols; ++u)
+			cv::Mat z_dx_band = z_dx_.rowRange(range), z_dy_band = z_dy_.rowRange(range);
+			cv::GaussianBlur(z_dx_unsmoothed_.rowRange(range), z_dx_band, cv::Size(5,5), 0, 0);
+			cv::GaussianBlur(z_dy_unsmoothed_.rowRange(range), z_dy_band, cv::Size(5,5), 0, 0);
+
+			const int width = z_image_.cols;
+			std::vector<float> x_dx_integral(width), z_dx_integral(width);
+			std::vector<float> dx_l(width), dz_l(width), dx_r(width), dz_r(width);
+			std::vector<int> pixel_u(width);
+			std::vector<uchar> discontinuity(width);
+			for (int v=range.start; v<range.end; ++v)
 			{
-				if (*srcX_ptr > 0.f)
+				const float* z_ptr = (const float*)z_image_.ptr(v);
+				const float* x_dx_ptr = (const float*)x_dx_.ptr(v);
+				const float* z_dx_ptr = (const float*)z_dx_.ptr(v);
+				const float* z_dy_ptr = (const float*)z_dy_.ptr(v);
+				uchar* edge_ptr = edge_.ptr(v);
+				memset(edge_ptr, 0, width);
+				if (v < max_line_width_ || v >= z_image_.rows - max_line_width_ - 1)
+					continue;
+
+				// depth discontinuities
+				for (int u = max_line_width_; u < width - max_line_width_ - 1; ++u)
+				{
+					const float depth = z_ptr[u];
+					if (depth!=0.f && (z_dx_ptr[u] <= -0.02*depth || z_dx_ptr[u] >= 0.02*depth || z_dy_ptr[u] <= -0.02*depth || z_dy_ptr[u] >= 0.02*depth))
+						edge_ptr[u] = 255;
+				}
+
+				// surface discontinuities
+				// running sums of the x and z slopes along the row, the sums only need to be compared, so they are not divided by the number of elements
+				float sum_x = 0.f, sum_z = 0.f;
+				for (int u=0; u<width; ++u)
 				{
-					sumX += *srcX_ptr;
-					sumZ += *srcZ_ptr;
+					if (x_dx_ptr[u] > 0.f)
+					{
+						sum_x += x_dx_ptr[u];
+						sum_z += z_dx_ptr[u];
+					}
+					x_dx_integral[u] = sum_x;
+					z_dx_integral[u] = sum_z;
+				}
+				// slopes left and right of all valid pixels
+				int number_pixels = 0;
+				int last_line_width = 10;
+				for (int u = max_line_width_; u < width - max_line_width_ - 1; ++u)
+				{
+					const float depth = z_ptr[u];
+					if (depth==0.f)
+						continue;
+					const int line_width = scanLineWidth(depth, max_line_width_, last_line_width);
+					dx_l[number_pixels] = x_dx_integral[u-1] - x_dx_integral[u-line_width];
+					dz_l[number_pixels] = z_dx_integral[u-1] - z_dx_integral[u-line_width];
+					dx_r[number_pixels] = x_dx_integral[u+line_width] - x_dx_integral[u+1];
+					dz_r[number_pixels] = z_dx_integral[u+line_width] - z_dx_integral[u+1];
+					pixel_u[number_pixels] = u;
+					++number_pixels;
+				}
+				computeSlopeDiscontinuities(&dx_l[0], &dz_l[0], &dx_r[0], &dz_r[0], number_pixels, &discontinuity[0]);
+				// the edge is placed in the center of each run of discontinuity candidates
+				int edge_start_index = -1;
+				for (int i=0; i<number_pixels; ++i)
+				{
+					if (discontinuity[i] != 0)
+					{
+						if (edge_start_index == -1)
+							edge_start_index = pixel_u[i];
+					}
+					else if (edge_start_index != -1)
+					{
+						edge_ptr[(edge_start_index+pixel_u[i]-1)/2] = 255;
+						edge_start_index = -1;
+					}
 				}
-				*dstX_ptr = sumX;
-				srcX_ptr++;
-				dstX_ptr++;
-				*dstZ_ptr = sumZ;
-				srcZ_ptr++;
-				dstZ_ptr++;
 			}
 		}
-	}
 
-	// creates an integral image within y-direction (i.e. column-wise, vertically) for two source images
-	void computeIntegralImageY(const cv::Mat& srcY, cv::Mat& dstY, const cv::Mat& srcZ, cv::Mat& dstZ)
+	private:
+		const cv::Mat& z_image_;
+		const cv::Mat& x_dx_;
+		const cv::Mat& z_dx_unsmoothed_;
+		const cv::Mat& z_dy_unsmoothed_;
+		cv::Mat& z_dx_;
+		cv::Mat& z_dy_;
+		cv::Mat& edge_;
+		const int max_line_width_;
+	};
+
+	// Marks the surface discontinuities along the columns of a band of columns, pixels that are already marked as edge are skipped.
+	// The running sums of the y and z slopes are computed for the band before the columns are scanned.
+	class VerticalEdgesBody : public cv::ParallelLoopBody
 	{
-		dstY = cv::Mat(srcY.rows, srcY.cols, CV_32FC1);
-		dstZ = cv::Mat(srcY.rows, srcY.cols, CV_32FC1);
-		float* dstY_ptr = (float*)dstY.ptr(0);
-		const float* srcY_ptr = (const float*)srcY.ptr(0);
-		float* dstZ_ptr = (float*)dstZ.ptr(0);
-		const float* srcZ_ptr = (const float*)srcZ.ptr(0);
-		// copy first line
-		for (int u=0; u<srcY.cols; ++u)
+	public:
+		VerticalEdgesBody(const cv::Mat& z_image, const cv::Mat& y_dy, const cv::Mat& z_dy, cv::Mat& y_dy_integralY, cv::Mat& z_dy_integralY, cv::Mat& edge, const int max_line_width)
+		: z_image_(z_image), y_dy_(y_dy), z_dy_(z_dy), y_dy_integralY_(y_dy_integralY), z_dy_integralY_(z_dy_integralY), edge_(edge), max_line_width_(max_line_width)
 		{
-			*dstY_ptr = *srcY_ptr;
-			dstY_ptr++; srcY_ptr++;
-			*dstZ_ptr = *srcZ_ptr;
-			dstZ_ptr++; srcZ_ptr++;
 		}
-		// process remainder
-		for (int v=1; v<srcY.rows; ++v)
+
+		virtual void operator()(const cv::Range& range) const
 		{
-			float* dstY_ptr = (float*)dstY.ptr(v);
-			float* dstYprev_ptr = (float*)dstY.ptr(v-1);
-			const float* srcY_ptr = (const float*)srcY.ptr(v);
-			float* dstZ_ptr = (float*)dstZ.ptr(v);
-			float* dstZprev_ptr = (float*)dstZ.ptr(v-1);
-			const float* srcZ_ptr = (const float*)srcZ.ptr(v);
-			for (int u=0; u<srcY.cols; ++u)
+			// running sums of the y and z slopes along the columns of the band
+			const int band_width = range.end - range.start;
+			memcpy(y_dy_integralY_.ptr<float>(0)+range.start, y_dy_.ptr<float>(0)+range.start, band_width*sizeof(float));
+			memcpy(z_dy_integralY_.ptr<float>(0)+range.start, z_dy_.ptr<float>(0)+range.start, band_width*sizeof(float));
+			for (int v=1; v<z_image_.rows; ++v)
 			{
-				if (*srcY_ptr > 0.f)
+				const float* y_dy_ptr = y_dy_.ptr<float>(v);
+				const float* z_dy_ptr = z_dy_.ptr<float>(v);
+				const float* y_prev_ptr = y_dy_integralY_.ptr<float>(v-1);
+				const float* z_prev_ptr = z_dy_integralY_.ptr<float>(v-1);
+				float* y_integral_ptr = y_dy_integralY_.ptr<float>(v);
+				float* z_integral_ptr = z_dy_integralY_.ptr<float>(v);
+				for (int u=range.start; u<range.end; ++u)
 				{
-					*dstY_ptr = *dstYprev_ptr + *srcY_ptr;
-					*dstZ_ptr = *dstZprev_ptr + *srcZ_ptr;
+					const bool valid = (y_dy_ptr[u] > 0.f);
+					y_integral_ptr[u] = y_prev_ptr[u] + (valid ? y_dy_ptr[u] : 0.f);
+					z_integral_ptr[u] = z_prev_ptr[u] + (valid ? z_dy_ptr[u] : 0.f);
 				}
-				else
+			}
+
+			// scan the columns of the band row by row
+			const int u_start = std::max(range.start, max_line_width_);
+			const int u_end = std::min(range.end, z_image_.cols - max_line_width_ - 1);
+			if (u_start >= u_end)
+				return;
+			const int length = u_end - u_start;
+			std::vector<int> edge_start_index(length, -1), last_line_width(length, 10);
+			std::vector<float> dy_u(length), dz_u(length), dy_l(length), dz_l(length);
+			std::vector<int> pixel_u(length);
+			std::vector<uchar> discontinuity(length);
+			for (int v = max_line_width_; v < z_image_.rows - max_line_width_ - 1; ++v)
+			{
+				const float* z_ptr = z_image_.ptr<float>(v);
+				const uchar* edge_ptr = edge_.ptr(v);
+				// slopes above and below all valid pixels that are not yet an edge
+				int number_pixels = 0;
+				for (int u=u_start; u<u_end; ++u)
 				{
-					*dstY_ptr = *dstYprev_ptr;
-					*dstZ_ptr = *dstZprev_ptr;
+					const float depth = z_ptr[u];
+					if (depth==0.f || edge_ptr[u]!=0)
+						continue;
+					const int line_width = scanLineWidth(depth, max_line_width_, last_line_width[u-u_start]);
+					dy_u[number_pixels] = y_dy_integralY_.at<float>(v-1, u) - y_dy_integralY_.at<float>(v-line_width, u);
+					dz_u[number_pixels] = z_dy_integralY_.at<float>(v-1, u) - z_dy_integralY_.at<float>(v-line_width, u);
+					dy_l[number_pixels] = y_dy_integralY_.at<float>(v+line_width, u) - y_dy_integralY_.at<float>(v+1, u);
+					dz_l[number_pixels] = z_dy_integralY_.at<float>(v+line_width, u) - z_dy_integralY_.at<float>(v+1, u);
+					pixel_u[number_pixels] = u;
+					++number_pixels;
+				}
+				computeSlopeDiscontinuities(&dy_u[0], &dz_u[0], &dy_l[0], &dz_l[0], number_pixels, &discontinuity[0]);
+				// the edge is placed in the center of each run of discontinuity candidates
+				for (int i=0; i<number_pixels; ++i)
+				{
+					const int u = pixel_u[i];
+					int& start_index = edge_start_index[u-u_start];
+					if (discontinuity[i] != 0)
+					{
+						if (start_index == -1)
+							start_index = v;
+					}
+					else if (start_index != -1)
+					{
+						edge_.at<uchar>((start_index+v-1)/2, u) = 255;
+						start_index = -1;
+					}
 				}
-				srcY_ptr++;
-				dstY_ptr++;
-				dstYprev_ptr++;
-				srcZ_ptr++;
-				dstZ_ptr++;
-				dstZprev_ptr++;
 			}
 		}
-	}
+
+	private:
+		const cv::Mat& z_image_;
+		const cv::Mat& y_dy_;
+		const cv::Mat& z_dy_;
+		cv::Mat& y_dy_integralY_;
+		cv::Mat& z_dy_integralY_;
+		cv::Mat& edge_;
+		const int max_line_width_;
+	};
+
+	// workspace, kept over the frames
+	cv::Mat x_image_, y_image_, z_image_;	// coordinates of the last point cloud
+	cv::Mat x_dx_, y_dy_;	// slopes of x and y
+	cv::Mat z_dx_unsmoothed_, z_dy_unsmoothed_, z_dx_, z_dy_;	// depth derivatives before and after smoothing
+	cv::Mat y_dy_integralY_, z_dy_integralY_;	// running sums of the slopes along the columns
 
 	double runtime_total_;
 	double runtime_depth_image_;
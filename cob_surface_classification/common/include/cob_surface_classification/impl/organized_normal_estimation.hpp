@@ -157,6 +157,15 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::checkDire
 template <typename PointInT, typename PointOutT, typename LabelOutT> void
 cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computePointNormal (
 		const PointCloudIn &cloud, int index,  float &n_x, float &n_y, float &n_z, int& label_out)
+{
+	std::vector<Eigen::Vector2f> directionsOfEdges;
+	computePointNormal(cloud, index, n_x, n_y, n_z, label_out, directionsOfEdges);
+}
+
+
+template <typename PointInT, typename PointOutT, typename LabelOutT> void
+cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computePointNormal (
+		const PointCloudIn &cloud, int index,  float &n_x, float &n_y, float &n_z, int& label_out, std::vector<Eigen::Vector2f>& directionsOfEdges)
 {
 	//two vectors computed in the tangential plane: origin of vectors = query point,
 	//end points are two points at the boundary of the neighbourhood.
@@ -201,7 +210,6 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computePo
 
 	bool has_prev_point;	//true if a vector to a point in the neighbourhood has been computed before -> only then the normal can be computed
 
-	std::vector<int> range_border_counter(mask_.size(), 0);
 	Eigen::Vector3f p_curr;	//vector from query point to currently treated point in neighbourhood
 	//Eigen::Vector2f ind_curr; //from query point to currently treated point in neighbourhood, "index coordinates"
 
@@ -211,12 +219,11 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computePo
 
 	std::vector<std::vector<int> >::iterator it_c; // circle iterator
 	std::vector<int>::iterator it_ci; // points in circle iterator
-	std::vector<int>::iterator it_rbc = range_border_counter.begin();
 
 	//indices of currently evaluated point in edgeImage_:
 	int idx_inDepIm_x = 0;
 	int idx_inDepIm_y = 0;
-	std::vector<Eigen::Vector2f> directionsOfEdges;
+	directionsOfEdges.clear();
 	bool ignorePoint;
 
 
@@ -232,7 +239,7 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computePo
 
 		//iterate over circles with decreasing radius (from pixel_search_radius to 0) -> cover entire circular neighbourhood from outside border to inside
 		//compute normal for every pair of points on every circle (that is a specific distance to query point)
-		for (it_c = mask_.begin(); it_c != mask_.end(); ++it_c, ++it_rbc) // iterate circles
+		for (it_c = mask_.begin(); it_c != mask_.end(); ++it_c) // iterate circles
 		{
 
 			has_prev_point = false; init_gab = gab = 0;
@@ -278,7 +285,7 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computePo
 						ignorePoint = true;
 				}
 
-				if(ignorePoint){ ++gab; ++(*it_rbc); continue; }  // count as gab point
+				if(ignorePoint){ ++gab; continue; }  // count as gab point
 
 
 				if ( gab <= max_gab && has_prev_point ) // check if gab is small enough and a previous point exists
@@ -320,7 +327,7 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computePo
 	//point near image boundaries:
 	else
 	{
-		for (it_c = mask_.begin(); it_c != mask_.end(); ++it_c, ++it_rbc) // iterate circles
+		for (it_c = mask_.begin(); it_c != mask_.end(); ++it_c) // iterate circles
 		{
 			has_prev_point = false; gab = 0; max_gab = 0.25 * (*it_c).size(); // reset circle loop
 
@@ -355,7 +362,7 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computePo
 						ignorePoint = true;
 				}
 
-				if(ignorePoint){ ++gab; ++(*it_rbc); continue; }  // count as gab point
+				if(ignorePoint){ ++gab; continue; }  // count as gab point
 
 
 				if ( gab <= max_gab && has_prev_point) // check gab is small enough and a previous point exists
@@ -428,6 +435,13 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computeFe
 		labels_->width = input_->width;
 	}
 
+	if (parallel_computation_ && !NEIGHBOURH_VIS)
+	{
+		// one stripe per image row for dense indices
+		cv::parallel_for_(cv::Range(0, (int)indices_->size()), ComputeNormalsBody(*this, output), std::max(1, (int)input_->height));
+		return;
+	}
+
 //	int radius = mask_.size();
 //	std::vector<std::vector<int> >::iterator it_c; // circle iterator
 //	std::vector<int>::iterator it_ci; // points in circle iterator
@@ -458,4 +472,17 @@ cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::computeFe
 
 }
 
+
+template <typename PointInT, typename PointOutT, typename LabelOutT> void
+cob_features::OrganizedNormalEstimation<PointInT,PointOutT,LabelOutT>::ComputeNormalsBody::operator() (const cv::Range& range) const
+{
+	std::vector<Eigen::Vector2f> directionsOfEdges;	// scratch array of this thread
+	for (int i=range.start; i<range.end; ++i)
+	{
+		const int index = (*estimator_.indices_)[i];
+		estimator_.labels_->points[index].label = I_UNDEF;
+		estimator_.computePointNormal(*estimator_.surface_, index, output_.points[index].normal[0], output_.points[index].normal[1], output_.points[index].normal[2], estimator_.labels_->points[index].label, directionsOfEdges);
+	}
+}
+
 #endif
@@ -67,6 +67,8 @@
 #include "cob_surface_classification/organized_features.h"
 #include "cob_3d_mapping_common/label_defines.h"
 
+#include <opencv2/core/core.hpp>
+
 namespace cob_features
 {
   template <typename PointInT, typename PointOutT, typename LabelOutT>
@@ -101,6 +103,7 @@ namespace cob_features
     {
       feature_name_ = "OrganizedNormalEstimation";
       sameDirectionThres_ = 0.96;
+      parallel_computation_ = true;
     };
 
 
@@ -119,6 +122,14 @@ namespace cob_features
       sameDirectionThres_ = th;
     }
 
+    // If true, the rows of the image are distributed over several threads (cv::parallel_for_).
+    // The normals and labels are identical to the serial computation.
+    inline void
+      setParallelComputation(bool parallel)
+    {
+      parallel_computation_ = parallel;
+    }
+
     void computePointNormal(const PointCloudIn &cloud, int index, float &n_x, float &n_y, float &n_z, int& label_out);
 
 
@@ -132,11 +143,31 @@ namespace cob_features
     float sameDirectionThres_;	//threshold for scalarproduct, so that vectors are detected as pointing in the same direction
     cv::Mat controlImage;
     LabelCloudOutPtr labels_;
+    bool parallel_computation_;
 
     private:
     bool compareCoordToEdgeCoord(int idx, int inx_x, int inx_y, std::vector<Eigen::Vector2f>& directionsOfEdges);
     bool checkDirectionForEdge(int idx,	Eigen::Vector2f p_curr, std::vector<Eigen::Vector2f>&  directionsOfEdges);
 
+    // computePointNormal with a caller provided scratch array for the edge directions, which is reused over the points
+    void computePointNormal(const PointCloudIn &cloud, int index, float &n_x, float &n_y, float &n_z, int& label_out, std::vector<Eigen::Vector2f>& directionsOfEdges);
+
+    // computes the normals of a range of indices_, one range per thread
+    class ComputeNormalsBody : public cv::ParallelLoopBody
+    {
+      public:
+      ComputeNormalsBody(OrganizedNormalEstimation& estimator, PointCloudOut& output)
+      : estimator_(estimator), output_(output)
+      {
+      }
+
+      virtual void operator()(const cv::Range& range) const;
+
+      private:
+      OrganizedNormalEstimation& estimator_;
+      PointCloudOut& output_;
+    };
+
 
 
   };
@@ -0,0 +1,152 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2013 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: Care-O-bot
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_surface_classification
+ *
+ * \author
+ * Author: Richard Bormann (stage code of surface_classification_node.cpp)
+ * \author
+ * Supervised by:
+ *
+ * \date Date of creation: 22.04.2013
+ *
+ * \brief
+ * processing stages of the surface classification (edge detection, normal estimation, segmentation, classification)
+ * moved out of surface_classification_node.cpp so that the node and surface_classification_benchmark run the same code
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef SURFACE_CLASSIFICATION_STAGES_H_
+#define SURFACE_CLASSIFICATION_STAGES_H_
+
+#include <string>
+#include <vector>
+
+// opencv
+#include <opencv/cv.h>
+
+// point cloud
+#include <pcl/point_types.h>
+#include <pcl_ros/point_cloud.h>
+
+//internal includes
+#include <cob_surface_classification/edge_detection.h>
+
+//package includes
+#include <cob_3d_segmentation/depth_segmentation.h>
+#include <cob_3d_segmentation/cluster_classifier.h>
+#include <cob_3d_mapping_common/point_types.h>
+#include <cob_3d_features/organized_normal_estimation_omp.h>
+#include <cob_3d_features/organized_normal_estimation_edge_omp.h>
+
+
+// data of one color image + point cloud pair on its way through the stages
+struct SurfaceClassificationFrame
+{
+	typedef cob_3d_segmentation::PredefinedSegmentationTypes ST;
+
+	// allocates the (empty) results for the given input
+	SurfaceClassificationFrame(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud, const cv::Mat& input_color_image);
+
+	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud;
+	cv::Mat color_image;
+	cv::Mat edge;	// depth edges (255), all 0 if the edge detection is disabled
+	pcl::PointCloud<pcl::Normal>::Ptr normals;
+	pcl::PointCloud<PointLabel>::Ptr labels;
+	ST::Graph::Ptr graph;	// segments and their classification
+};
+
+
+// The processing stages of the surface classification, which can be enabled at runtime.
+// Each stage keeps its own objects, so consecutive frames may be in different stages at the same time,
+// but one stage must not process two frames concurrently. SEGMENTATION and REFINEMENT share the
+// segmentation object, so the refinement of a frame has to follow its segmentation on the same thread.
+class SurfaceClassificationStages
+{
+public:
+	typedef cob_3d_segmentation::PredefinedSegmentationTypes ST;
+
+	enum Stage {EDGE_DETECTION=0, NORMAL_ESTIMATION, SEGMENTATION, REFINEMENT, CLASSIFICATION, NUMBER_STAGES};
+
+	SurfaceClassificationStages();
+
+	// name of the stage, as used in stage lists
+	static std::string stageName(int stage);
+
+	// enables the stages of a comma separated list of stage names (e.g. "edge_detection,normal_estimation,segmentation"), all other stages are disabled
+	// returns false if the list contains an unknown name
+	bool setEnabledStages(const std::string& stage_list);
+
+	inline void setStageEnabled(int stage, bool enabled) { enabled_stages_[stage] = enabled; }
+	inline bool isStageEnabled(int stage) const { return enabled_stages_[stage]; }
+
+	// maximum number of OpenMP threads of the normal estimation, 0 keeps the OpenMP default (all cores)
+	// the limit is set on the thread that runs the normal estimation, so it does not affect other threads
+	inline void setNormalEstimationThreads(int number_threads) { normal_estimation_threads_ = number_threads; }
+
+	// threads left to the normal estimation if edge detection and segmentation run concurrently on their own threads
+	static int pipelinedNormalEstimationThreads();
+
+	// runs one stage on the frame, disabled stages return immediately
+	// a stage expects the results of its enabled predecessors, the normal estimation is required by all later stages
+	void process(int stage, SurfaceClassificationFrame& frame);
+
+private:
+	void computeEdges(SurfaceClassificationFrame& frame);
+	void computeNormals(SurfaceClassificationFrame& frame);
+	void segment(SurfaceClassificationFrame& frame);
+	void refineSegmentation(SurfaceClassificationFrame& frame);
+	void classify(SurfaceClassificationFrame& frame);
+
+	std::vector<bool> enabled_stages_;
+	int normal_estimation_threads_;
+
+	EdgeDetection<pcl::PointXYZRGB> edge_detection_;
+	cob_3d_features::OrganizedNormalEstimationEdgeOMP<pcl::PointXYZRGB, pcl::Normal, PointLabel> one_;
+	cob_3d_segmentation::DepthSegmentation<ST::Graph, ST::Point, ST::Normal, ST::Label> seg_;
+	cob_3d_segmentation::ClusterClassifier<ST::CH, ST::Point, ST::Normal, ST::Label> cc_;
+};
+
+#endif /* SURFACE_CLASSIFICATION_STAGES_H_ */
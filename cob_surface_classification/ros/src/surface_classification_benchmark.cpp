@@ -0,0 +1,450 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2026 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: Care-O-bot
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_surface_classification
+ *
+ * \author
+ * Author: Richard Bormann
+ * \author
+ * Supervised by:
+ *
+ * \date Date of creation: 17.10.2026
+ *
+ * \brief
+ * offline benchmark of the surface classification stages on recorded scenes
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+// Replays the scenes recorded with Scene_recording (<n>cloud.pcd, <n>color.png) through the enabled stages of the
+// surface classification without ROS and writes the latency of each stage, the throughput and the memory as CSV.
+// The memory is reported as the resident size after loading the scenes, the peak resident size of the process
+// (including the scenes) and the difference of both, which approximates the working memory of the stages.
+// With pipelining, the stages run on the three threads of the node (edge detection | normal estimation |
+// segmentation, refinement, classification) and the normal estimation is limited to the remaining cores like in the node,
+// but every frame is processed (the node drops frames if a stage is busy). The frame latency then includes the waiting
+// between the stages.
+//
+// With check_normals, the normals of cob_features::OrganizedNormalEstimation are computed for each scene with the rows
+// distributed over several threads and serially before the replay, and the benchmark fails if a normal or label differs
+// in any bit (the memory of the check is included in the process peak).
+//
+// usage: surface_classification_benchmark <records directory> [stages] [repetitions] [output prefix] [histogram bin width in ms] [pipelining] [check_normals]
+//   stages: comma separated list out of edge_detection,normal_estimation,segmentation,refinement,classification
+//           (default: normal_estimation,segmentation,refinement, the default of the node)
+//   pipelining: false, true or both (default: both, first without and then with pipelining)
+//   check_normals: true or false (default: false)
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <pcl/io/pcd_io.h>
+#include <opencv/highgui.h>
+
+#include "cob_surface_classification/surface_classification_stages.h"
+#include "cob_surface_classification/organized_normal_estimation.h"
+#include "cob_surface_classification/timer.h"
+
+
+// current resident set size of the process in [kB], 0 if unknown
+long currentResidentMemoryKb()
+{
+	std::ifstream statm("/proc/self/statm");
+	long size_pages = 0, resident_pages = 0;
+	if (!(statm >> size_pages >> resident_pages))
+		return 0;
+	return resident_pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// latency statistics of one stage
+struct LatencyStatistics
+{
+	std::vector<double> latencies;	// in [ms]
+
+	double percentile(std::vector<double>& sorted, double fraction) const
+	{
+		if (sorted.empty())
+			return 0.;
+		size_t index = std::min(sorted.size()-1, (size_t)(fraction*sorted.size()));
+		return sorted[index];
+	}
+
+	void writeSummary(std::ofstream& file, const std::string& name) const
+	{
+		std::vector<double> sorted = latencies;
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.;
+		for (size_t i=0; i<sorted.size(); ++i)
+			sum += sorted[i];
+		file << name << "," << sorted.size() << "," << (sorted.empty() ? 0. : sum/sorted.size()) << ","
+				<< (sorted.empty() ? 0. : sorted.front()) << "," << percentile(sorted, 0.5) << "," << percentile(sorted, 0.9) << ","
+				<< percentile(sorted, 0.99) << "," << (sorted.empty() ? 0. : sorted.back()) << "\n";
+	}
+
+	void writeHistogram(std::ofstream& file, const std::string& name, double bin_width) const
+	{
+		std::map<int, int> bins;
+		for (size_t i=0; i<latencies.size(); ++i)
+			++bins[(int)(latencies[i]/bin_width)];
+		for (std::map<int, int>::iterator it=bins.begin(); it!=bins.end(); ++it)
+			file << name << "," << it->first*bin_width << "," << (it->first+1)*bin_width << "," << it->second << "\n";
+	}
+};
+
+// computes the normals of the scene with the parallel and the serial path of cob_features::OrganizedNormalEstimation
+// returns the number of points whose normal or label is not bitwise identical
+int compareParallelNormals(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr& cloud)
+{
+	cob_features::OrganizedNormalEstimation<pcl::PointXYZRGB, pcl::Normal, PointLabel> one;
+	pcl::PointCloud<pcl::Normal> normals[2];
+	pcl::PointCloud<PointLabel>::Ptr labels[2];
+	for (int parallel=0; parallel<2; ++parallel)
+	{
+		labels[parallel] = pcl::PointCloud<PointLabel>::Ptr(new pcl::PointCloud<PointLabel>);
+		one.setInputCloud(cloud);
+		one.setPixelSearchRadius(4,2,2);	//call before calling computeMaskManually()!!!
+		one.computeMaskManually(cloud->width);
+		one.setOutputLabels(labels[parallel]);
+		one.setSkipDistantPointThreshold(8);
+		one.setParallelComputation(parallel == 1);
+		one.compute(normals[parallel]);
+	}
+
+	if (normals[0].points.size() != normals[1].points.size() || labels[0]->points.size() != labels[1]->points.size())
+		return (int)std::max(normals[0].points.size(), normals[1].points.size());
+	int differences = 0;
+	for (size_t i=0; i<normals[0].points.size(); ++i)
+	{
+		// memcmp, so that NaN normals are equal if their bits are equal
+		if (memcmp(normals[0].points[i].normal, normals[1].points[i].normal, 3*sizeof(float)) != 0
+				|| (i < labels[0]->points.size() && labels[0]->points[i].label != labels[1]->points[i].label))
+			++differences;
+	}
+	return differences;
+}
+
+// frame on its way through the pipeline, frame_time runs since the first stage started with it
+struct PipelineItem
+{
+	boost::shared_ptr<SurfaceClassificationFrame> frame;
+	Timer frame_time;
+};
+
+// Frame queue between two pipeline threads. Unlike the queue of the node, push() waits while the queue is full,
+// so every frame passes all stages.
+class PipelineQueue
+{
+public:
+	PipelineQueue(size_t capacity)
+	: capacity_(std::max<size_t>(1, capacity)), closed_(false)
+	{
+	}
+
+	void push(const PipelineItem& item)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		while (queue_.size() >= capacity_)
+			not_full_.wait(lock);
+		queue_.push_back(item);
+		not_empty_.notify_one();
+	}
+
+	// waits for the next item, returns false if the queue is closed and empty
+	bool pop(PipelineItem& item)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		while (queue_.empty() && !closed_)
+			not_empty_.wait(lock);
+		if (queue_.empty())
+			return false;
+		item = queue_.front();
+		queue_.pop_front();
+		not_full_.notify_one();
+		return true;
+	}
+
+	// no more items follow
+	void close()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		closed_ = true;
+		not_empty_.notify_all();
+	}
+
+private:
+	std::deque<PipelineItem> queue_;
+	size_t capacity_;
+	bool closed_;
+	boost::mutex mutex_;
+	boost::condition_variable not_empty_;
+	boost::condition_variable not_full_;
+};
+
+// runs one stage on the frame and records its latency if the stage is enabled
+void processStage(SurfaceClassificationStages& stages, int stage, SurfaceClassificationFrame& frame, std::vector<LatencyStatistics>& stage_statistics)
+{
+	Timer stage_time;
+	stage_time.start();
+	stages.process(stage, frame);
+	if (stages.isStageEnabled(stage))
+		stage_statistics[stage].latencies.push_back(stage_time.getElapsedTimeInMilliSec());
+}
+
+// pipeline thread for the stages first_stage..last_stage, the last thread (output == 0) records the frame latency
+// each statistics entry is written by one thread only
+void pipelineThread(SurfaceClassificationStages* stages, int first_stage, int last_stage, PipelineQueue* input, PipelineQueue* output,
+		std::vector<LatencyStatistics>* stage_statistics, LatencyStatistics* total_statistics)
+{
+	PipelineItem item;
+	while (input->pop(item) == true)
+	{
+		if (first_stage == SurfaceClassificationStages::EDGE_DETECTION)
+			item.frame_time.start();
+		for (int stage=first_stage; stage<=last_stage; ++stage)
+			processStage(*stages, stage, *item.frame, *stage_statistics);
+		if (output != 0)
+			output->push(item);
+		else
+			total_statistics->latencies.push_back(item.frame_time.getElapsedTimeInMilliSec());
+	}
+	if (output != 0)
+		output->close();
+}
+
+// replays all scenes through the stages, one frame after the other or pipelined like in the node
+// returns the wall time in [s]
+double replay(SurfaceClassificationStages& stages, const std::vector<pcl::PointCloud<pcl::PointXYZRGB>::Ptr>& clouds, const std::vector<cv::Mat>& color_images,
+		int repetitions, bool pipelining, std::vector<LatencyStatistics>& stage_statistics, LatencyStatistics& total_statistics)
+{
+	Timer wall_time;
+	wall_time.start();
+	if (pipelining == false)
+	{
+		Timer frame_time;
+		for (int repetition=0; repetition<repetitions; ++repetition)
+		{
+			for (size_t i=0; i<clouds.size(); ++i)
+			{
+				SurfaceClassificationFrame frame(clouds[i], color_images[i]);
+				frame_time.start();
+				for (int stage=0; stage<SurfaceClassificationStages::NUMBER_STAGES; ++stage)
+					processStage(stages, stage, frame, stage_statistics);
+				total_statistics.latencies.push_back(frame_time.getElapsedTimeInMilliSec());
+			}
+		}
+		return wall_time.getElapsedTimeInSec();
+	}
+
+	// the three threads of the node: edge detection -> normal estimation -> segmentation, refinement, classification
+	PipelineQueue edge_queue(1), normal_queue(1), segmentation_queue(1);
+	boost::thread_group pipeline_threads;
+	pipeline_threads.create_thread(boost::bind(&pipelineThread, &stages, (int)SurfaceClassificationStages::EDGE_DETECTION, (int)SurfaceClassificationStages::EDGE_DETECTION,
+			&edge_queue, &normal_queue, &stage_statistics, &total_statistics));
+	pipeline_threads.create_thread(boost::bind(&pipelineThread, &stages, (int)SurfaceClassificationStages::NORMAL_ESTIMATION, (int)SurfaceClassificationStages::NORMAL_ESTIMATION,
+			&normal_queue, &segmentation_queue, &stage_statistics, &total_statistics));
+	pipeline_threads.create_thread(boost::bind(&pipelineThread, &stages, (int)SurfaceClassificationStages::SEGMENTATION, (int)SurfaceClassificationStages::NUMBER_STAGES-1,
+			&segmentation_queue, (PipelineQueue*)0, &stage_statistics, &total_statistics));
+	for (int repetition=0; repetition<repetitions; ++repetition)
+	{
+		for (size_t i=0; i<clouds.size(); ++i)
+		{
+			PipelineItem item;
+			item.frame = boost::shared_ptr<SurfaceClassificationFrame>(new SurfaceClassificationFrame(clouds[i], color_images[i]));
+			edge_queue.push(item);
+		}
+	}
+	edge_queue.close();
+	pipeline_threads.join_all();
+	return wall_time.getElapsedTimeInSec();
+}
+
+
+int main (int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: surface_classification_benchmark <records directory> [stages] [repetitions] [output prefix] [histogram bin width in ms] [pipelining] [check_normals]\n"
+				<< "  stages: comma separated list out of edge_detection,normal_estimation,segmentation,refinement,classification\n"
+				<< "          (default: normal_estimation,segmentation,refinement)\n"
+				<< "  pipelining: false, true or both (default: both)\n"
+				<< "  check_normals: true or false (default: false)" << std::endl;
+		return 1;
+	}
+	const std::string records_path = argv[1];
+	const std::string stage_list = (argc > 2 ? argv[2] : "normal_estimation,segmentation,refinement");
+	const int repetitions = (argc > 3 ? std::max(1, atoi(argv[3])) : 1);
+	const std::string output_prefix = (argc > 4 ? argv[4] : "surface_classification_benchmark");
+	const double bin_width = (argc > 5 ? std::max(0.01, atof(argv[5])) : 1.);
+	const std::string pipelining_mode = (argc > 6 ? argv[6] : "both");
+	std::vector<bool> pipelining_runs;
+	if (pipelining_mode == "false" || pipelining_mode == "both")
+		pipelining_runs.push_back(false);
+	if (pipelining_mode == "true" || pipelining_mode == "both")
+		pipelining_runs.push_back(true);
+	if (pipelining_runs.empty())
+	{
+		std::cout << "Error: pipelining has to be false, true or both, not " << pipelining_mode << "." << std::endl;
+		return 1;
+	}
+	const bool check_normals = (argc > 7 && std::string(argv[7]) == "true");
+
+	SurfaceClassificationStages stages;
+	if (stages.setEnabledStages(stage_list) == false)
+		return 1;
+
+	// load all recorded scenes beforehand, so that the disk access is not measured
+	std::vector<pcl::PointCloud<pcl::PointXYZRGB>::Ptr> clouds;
+	std::vector<cv::Mat> color_images;
+	for (int record=1; ; ++record)
+	{
+		std::stringstream nr;
+		nr << record;
+		const std::string pcd_filename = records_path + "/" + nr.str() + "cloud.pcd";
+		const std::string image_filename = records_path + "/" + nr.str() + "color.png";
+		if (boost::filesystem::exists(pcd_filename) == false)
+			break;
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGB>);
+		if (pcl::io::loadPCDFile<pcl::PointXYZRGB>(pcd_filename, *cloud) == -1)
+		{
+			std::cout << "Error: could not read " << pcd_filename << "." << std::endl;
+			return 1;
+		}
+		if(cloud->height == 1 && cloud->points.size() == 307200)
+		{
+			cloud->height = 480;
+			cloud->width = 640;
+		}
+		clouds.push_back(cloud);
+		color_images.push_back(cv::imread(image_filename, 1));
+		if (color_images.back().empty())
+		{
+			std::cout << "Error: could not read " << image_filename << "." << std::endl;
+			return 1;
+		}
+	}
+	if (clouds.empty())
+	{
+		std::cout << "Error: no recorded scenes (1cloud.pcd, 2cloud.pcd, ...) in " << records_path << "." << std::endl;
+		return 1;
+	}
+	const long scenes_memory_kb = currentResidentMemoryKb();
+	std::cout << "Loaded " << clouds.size() << " scenes, stages: " << stage_list << ", repetitions: " << repetitions << std::endl;
+
+	if (check_normals == true)
+	{
+		for (size_t i=0; i<clouds.size(); ++i)
+		{
+			const int differences = compareParallelNormals(clouds[i]);
+			if (differences != 0)
+			{
+				std::cout << "Error: the parallel normal estimation differs from the serial one at " << differences << " points of scene " << i+1 << "." << std::endl;
+				return 1;
+			}
+		}
+		std::cout << "The parallel and the serial normal estimation are identical on all " << clouds.size() << " scenes." << std::endl;
+	}
+
+	std::ofstream stages_file((output_prefix + "_stages.csv").c_str());
+	stages_file << "pipelining,stage,frames,mean_ms,min_ms,median_ms,p90_ms,p99_ms,max_ms\n";
+	std::ofstream histogram_file((output_prefix + "_histogram.csv").c_str());
+	histogram_file << "pipelining,stage,bin_start_ms,bin_end_ms,frames\n";
+	std::ofstream summary_file((output_prefix + "_summary.csv").c_str());
+	summary_file << "stages,pipelining,normal_estimation_threads,frames,wall_time_s,throughput_fps,scenes_memory_kb,process_peak_memory_kb,stages_memory_kb\n";
+
+	for (size_t run=0; run<pipelining_runs.size(); ++run)
+	{
+		const bool pipelining = pipelining_runs[run];
+		const std::string pipelining_name = (pipelining ? "true" : "false");
+		// 0: OpenMP default, the node limits the normal estimation only with pipelining
+		const int normal_estimation_threads = (pipelining ? SurfaceClassificationStages::pipelinedNormalEstimationThreads() : 0);
+		stages.setNormalEstimationThreads(normal_estimation_threads);
+
+		std::vector<LatencyStatistics> stage_statistics(SurfaceClassificationStages::NUMBER_STAGES);
+		LatencyStatistics total_statistics;
+		const double wall_time_s = replay(stages, clouds, color_images, repetitions, pipelining, stage_statistics, total_statistics);
+		const int number_frames = (int)total_statistics.latencies.size();
+
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		const long peak_memory_kb = usage.ru_maxrss;	// peak of the whole process so far, including the loaded scenes and the previous runs
+		const long stages_memory_kb = std::max(0L, peak_memory_kb - scenes_memory_kb);
+
+		// write results
+		for (int stage=0; stage<SurfaceClassificationStages::NUMBER_STAGES; ++stage)
+			if (stages.isStageEnabled(stage))
+				stage_statistics[stage].writeSummary(stages_file, pipelining_name + "," + SurfaceClassificationStages::stageName(stage));
+		total_statistics.writeSummary(stages_file, pipelining_name + ",total");
+
+		for (int stage=0; stage<SurfaceClassificationStages::NUMBER_STAGES; ++stage)
+			if (stages.isStageEnabled(stage))
+				stage_statistics[stage].writeHistogram(histogram_file, pipelining_name + "," + SurfaceClassificationStages::stageName(stage), bin_width);
+		total_statistics.writeHistogram(histogram_file, pipelining_name + ",total", bin_width);
+
+		summary_file << "\"" << stage_list << "\"," << pipelining_name << "," << normal_estimation_threads << "," << number_frames << "," << wall_time_s << ","
+				<< number_frames/wall_time_s << "," << scenes_memory_kb << "," << peak_memory_kb << "," << stages_memory_kb << "\n";
+
+		std::cout << "pipelining " << pipelining_name << ": " << number_frames << " frames in " << wall_time_s << " s (" << number_frames/wall_time_s
+				<< " fps), memory of the stages " << stages_memory_kb << " kB (process peak " << peak_memory_kb << " kB including "
+				<< scenes_memory_kb << " kB after loading the scenes)" << std::endl;
+	}
+	std::cout << "results in " << output_prefix << "_stages.csv, " << output_prefix << "_histogram.csv, " << output_prefix << "_summary.csv" << std::endl;
+
+	return 0;
+}
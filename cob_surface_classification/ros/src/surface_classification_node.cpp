@@ -58,6 +58,7 @@
  ****************************************************************/
 
 /*switches for execution of processing steps*/
+// the processing stages (edge detection, segmentation, refinement, classification, publishing) are enabled by ROS parameters, see surface_classification.launch
 
 #define RECORD_MODE					false		//save color image and cloud for usage in EVALUATION_OFFLINE_MODE
 #define COMPUTATION_MODE			true		//computations without record
@@ -66,19 +67,13 @@
 
 //steps in computation/evaluation_online mode:
 
-#define SEG 						true 	//segmentation + refinement
-#define SEG_WITHOUT_EDGES 			false 	//segmentation without considering edge image (wie Steffen)
 #define SEG_REFINE					false 	//segmentation refinement according to curvatures (outdated)
-#define CLASSIFY 					false	//classification
 
 
 #define NORMAL_VIS 					false 	//visualisation of normals
 #define SEG_VIS 					false 	//visualisation of segmentation
-#define SEG_WITHOUT_EDGES_VIS 		false 	//visualisation of segmentation without edge image
 #define CLASS_VIS 					false 	//visualisation of classification
 
-#define PUBLISH_SEGMENTATION		true	//publish segmented point cloud on topic
-
 
 // ROS includes
 #include <ros/ros.h>
@@ -103,6 +98,8 @@
 
 // boost
 #include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
 
 // point cloud
 #include <pcl/point_types.h>
@@ -112,48 +109,152 @@
 #include <pcl/io/io.h>
 #include <pcl/io/pcd_io.h>
 
+#include <deque>
+#include <algorithm>
+
 
 //internal includes
-#include <cob_surface_classification/edge_detection.h>
-//#include <cob_surface_classification/surface_classification.h>
-//#include <cob_surface_classification/organized_normal_estimation.h>
+#include <cob_surface_classification/surface_classification_stages.h>
 #include <cob_surface_classification/refine_segmentation.h>
 
-//package includes
-#include <cob_3d_segmentation/depth_segmentation.h>
-#include <cob_3d_segmentation/cluster_classifier.h>
-#include <cob_3d_mapping_common/point_types.h>
-#include <cob_3d_features/organized_normal_estimation_omp.h>
-#include <cob_3d_features/organized_normal_estimation_edge_omp.h>
-
-
 //records
 #include "cob_surface_classification/scene_recording.h"
 //evaluation
 #include "cob_surface_classification/evaluation.h"
 
-int global_imagecount;
+
+// Frame queue between two pipeline threads. If the queue is full, the oldest frame is dropped,
+// so a slow stage always continues with the latest data.
+template <typename T>
+class BoundedQueue
+{
+public:
+	BoundedQueue(size_t capacity)
+	: capacity_(std::max<size_t>(1, capacity)), shutdown_(false), number_dropped_(0)
+	{
+	}
+
+	// returns false if an element had to be dropped
+	bool push(const T& element)
+	{
+		bool dropped = false;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if (queue_.size() >= capacity_)
+			{
+				queue_.pop_front();
+				++number_dropped_;
+				dropped = true;
+			}
+			queue_.push_back(element);
+		}
+		condition_.notify_one();
+		return !dropped;
+	}
+
+	// waits for the next element, returns false after shutdown()
+	bool pop(T& element)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		while (queue_.empty() && !shutdown_)
+			condition_.wait(lock);
+		if (shutdown_)
+			return false;
+		element = queue_.front();
+		queue_.pop_front();
+		return true;
+	}
+
+	// wakes up all waiting threads, pop() fails from now on
+	void shutdown()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			shutdown_ = true;
+		}
+		condition_.notify_all();
+	}
+
+	unsigned long numberDropped()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return number_dropped_;
+	}
+
+private:
+	std::deque<T> queue_;
+	size_t capacity_;
+	bool shutdown_;
+	unsigned long number_dropped_;
+	boost::mutex mutex_;
+	boost::condition_variable condition_;
+};
+
 
 class SurfaceClassificationNode
 {
 public:
 	typedef cob_3d_segmentation::PredefinedSegmentationTypes ST;
 
+	// a frame with the message it originates from
+	struct PipelineItem
+	{
+		boost::shared_ptr<SurfaceClassificationFrame> frame;
+		sensor_msgs::PointCloud2::ConstPtr pointcloud_msg;	// published with the segmentation
+		cv_bridge::CvImageConstPtr color_image_ptr;	// owns the data of frame->color_image
+	};
+	typedef BoundedQueue<PipelineItem> PipelineQueue;
+
 	SurfaceClassificationNode(ros::NodeHandle nh)
 	: node_handle_(nh)
 	{
-		runtime_total_ = 0.;
-		runtime_depth_image_ = 0.;
-		runtime_sobel_ = 0.;	// image derivatives
-		runtime_edge_ = 0.;
-		runtime_visibility_ = 0.;
-		runtime_normal_original_ = 0.;
-		runtime_normal_edge_ = 0.;
-		number_processed_images_ = 0;
-
 		it_ = 0;
 		sync_input_ = 0;
 
+		// parameters
+		ros::NodeHandle parameter_node_handle("~");
+		bool enabled = true;
+		parameter_node_handle.param("edge_detection", enabled, false);
+		std::cout << "edge_detection: " << enabled << std::endl;
+		stages_.setStageEnabled(SurfaceClassificationStages::EDGE_DETECTION, enabled);
+		stages_.setStageEnabled(SurfaceClassificationStages::NORMAL_ESTIMATION, true);
+		parameter_node_handle.param("segmentation", enabled, true);
+		std::cout << "segmentation: " << enabled << std::endl;
+		stages_.setStageEnabled(SurfaceClassificationStages::SEGMENTATION, enabled);
+		parameter_node_handle.param("refinement", enabled, true);
+		std::cout << "refinement: " << enabled << std::endl;
+		stages_.setStageEnabled(SurfaceClassificationStages::REFINEMENT, enabled);
+		parameter_node_handle.param("classification", enabled, false);
+		std::cout << "classification: " << enabled << std::endl;
+		stages_.setStageEnabled(SurfaceClassificationStages::CLASSIFICATION, enabled);
+		parameter_node_handle.param("publish_segmentation", publish_segmentation_, true);
+		std::cout << "publish_segmentation: " << publish_segmentation_ << std::endl;
+		parameter_node_handle.param("display_image", display_image_, true);
+		std::cout << "display_image: " << display_image_ << std::endl;
+		parameter_node_handle.param("pipelining", pipelining_, true);
+		std::cout << "pipelining: " << pipelining_ << std::endl;
+		int queue_size = 1;
+		parameter_node_handle.param("queue_size", queue_size, 1);
+		std::cout << "queue_size: " << queue_size << std::endl;
+		int normal_estimation_threads = 0;
+		parameter_node_handle.param("normal_estimation_threads", normal_estimation_threads, 0);
+		// with pipelining, the normal estimation shares the cores with the edge detection and segmentation threads
+		if (normal_estimation_threads <= 0 && pipelining_ == true)
+			normal_estimation_threads = SurfaceClassificationStages::pipelinedNormalEstimationThreads();
+		std::cout << "normal_estimation_threads: " << normal_estimation_threads << std::endl;
+		stages_.setNormalEstimationThreads(normal_estimation_threads);
+
+		// pipeline: edge detection -> normal estimation -> segmentation, refinement, classification and publishing
+		// each queue feeds one thread, so consecutive frames are processed in different stages concurrently
+		if (pipelining_ == true)
+		{
+			for (int i=0; i<3; ++i)
+				queues_.push_back(boost::shared_ptr<PipelineQueue>(new PipelineQueue(queue_size)));
+			pipeline_threads_.create_thread(boost::bind(&SurfaceClassificationNode::edgeThread, this));
+			pipeline_threads_.create_thread(boost::bind(&SurfaceClassificationNode::normalThread, this));
+			pipeline_threads_.create_thread(boost::bind(&SurfaceClassificationNode::segmentationThread, this));
+		}
+
 		it_ = new image_transport::ImageTransport(node_handle_);
 		colorimage_sub_.subscribe(*it_, "colorimage_in", 1);
 		pointcloud_sub_.subscribe(node_handle_, "pointcloud_in", 1);
@@ -171,11 +272,15 @@ public:
 			delete it_;
 		if (sync_input_ != 0)
 			delete sync_input_;
+		for (size_t i=0; i<queues_.size(); ++i)
+			queues_[i]->shutdown();
+		pipeline_threads_.join_all();
 	}
 
 
 	// Converts a color image message to cv::Mat format.
-	void convertColorImageMessageToMat(const sensor_msgs::Image::ConstPtr& image_msg, cv_bridge::CvImageConstPtr& image_ptr, cv::Mat& image)
+	// returns false if the conversion failed
+	bool convertColorImageMessageToMat(const sensor_msgs::Image::ConstPtr& image_msg, cv_bridge::CvImageConstPtr& image_ptr, cv::Mat& image)
 	{
 		try
 		{
@@ -183,9 +288,11 @@ public:
 		}
 		catch (cv_bridge::Exception& e)
 		{
-			ROS_ERROR("PeopleDetection: cv_bridge exception: %s", e.what());
+			ROS_ERROR("SurfaceClassificationNode: cv_bridge exception: %s", e.what());
+			return false;
 		}
 		image = image_ptr->image;
+		return true;
 	}
 
 	void inputCallback(const sensor_msgs::Image::ConstPtr& color_image_msg, const sensor_msgs::PointCloud2::ConstPtr& pointcloud_msg)
@@ -195,7 +302,8 @@ public:
 		// convert color image to cv::Mat
 		cv_bridge::CvImageConstPtr color_image_ptr;
 		cv::Mat color_image;
-		convertColorImageMessageToMat(color_image_msg, color_image_ptr, color_image);
+		if (convertColorImageMessageToMat(color_image_msg, color_image_ptr, color_image) == false)
+			return;
 
 		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZRGB>);
 		pcl::fromROSMsg(*pointcloud_msg, *cloud);
@@ -205,107 +313,12 @@ public:
 			cloud->width = 640;
 		}
 
-
-		//SAVE Pointcloud
-		bool savepointcloud=false;
-		if(savepointcloud)
-		{
-			pcl::io::savePCDFileASCII ("/home/rmb-dh/evaluation/test_pcd.pcd", *cloud);
-			std::cout<<"cloud saved"<<std::endl;
-			cv::imwrite("/home/rmb-dh/evaluation/pointcloud_img.jpg", color_image );
-			cv::imshow("Saved Image", color_image);
-			cv::waitKey(100000);
-			std::cout<<"Get new Image"<<std::endl;
-		}
-
-		//Load Pointcloud for Evaluation
-		bool loadpointcloud = false;
-		sensor_msgs::PointCloud2 cloud_blob;
-
-		std::vector<int> image_indices;
-		image_indices.push_back(16);	//!
-		image_indices.push_back(17);
-		image_indices.push_back(19);
-		image_indices.push_back(21);
-		image_indices.push_back(27);
-		image_indices.push_back(29);
-		image_indices.push_back(33);
-		image_indices.push_back(34);	//!
-		image_indices.push_back(35);
-		image_indices.push_back(36);
-		image_indices.push_back(37);
-		image_indices.push_back(38);
-		image_indices.push_back(39);
-		image_indices.push_back(40);
-		image_indices.push_back(43);
-		image_indices.push_back(44);
-		image_indices.push_back(45);
-		image_indices.push_back(46);
-		image_indices.push_back(47);
-		image_indices.push_back(48);
-		image_indices.push_back(49);
-		image_indices.push_back(50);
-		image_indices.push_back(51);	//!
-
-		std::ostringstream outStream;
-		outStream << image_indices[global_imagecount];
-		std::string num;
-		num  = outStream.str();
-
-//		std::ostringstream outStream2;
-//		if(global_imagecount==1)
-//		{
-//			outStream2 << global_imagecount;
-//		}else{
-//			outStream2 << global_imagecount-1;
-//		}
-//		std::string num2;
-//		num2  = outStream2.str();
-//		std::string num = "34";
-//		std::string num2 = "34";
-
-
-//		std::string pcd = "/home/rmb-dh/evaluation/Final2/ev"+ num + ".pcd";
-//		std::string jpg = "/home/rmb-dh/evaluation/Final2/ev"+ num +".jpg";
-////		std::string pcd = "/home/rmb-dh/evaluation/test.pcd";
-////		std::string jpg = "/home/rmb-dh/evaluation/test.jpg";
-//		std::string segmented = "/home/rmb-dh/evaluation/Segmented/Segmented"+ num2 +".jpg";
-		std::string pcd = "/home/rbormann/git/care-o-bot/cob_object_perception/cob_texture_categorization/common/files/scenes_database/Table"+ num + ".pcd";
-		std::string jpg = "/home/rbormann/git/care-o-bot/cob_object_perception/cob_texture_categorization/common/files/scenes_database/Table"+ num +".jpg";
-		std::cout<< pcd <<" Used PCD File   "<<jpg<<" Used JPG File"<<std::endl;
-
-		--global_imagecount;
-		if(global_imagecount>=(int)image_indices.size())
-			global_imagecount=0;
-		if(global_imagecount<0)
-			global_imagecount=(int)image_indices.size()-1;
-
-//		cv::imshow("imagebefore", cv::imread(segmented,1));
-
-
-		if(loadpointcloud)
-		{
-			if (pcl::io::loadPCDFile<pcl::PointXYZRGB> (pcd, *cloud) == -1) //* load the file
-			{
-			PCL_ERROR ("Couldn't read file test_pcd.pcd \n");
-			}
-			io::loadPCDFile (pcd, cloud_blob);
-			color_image = cv::imread(jpg, 1);
-			std::cout << "Loaded "
-					<< cloud->width * cloud->height
-					<< " data points from test_pcd.pcd with the following fields: "
-					<< std::endl;
-		}
-
-
-
 		int key = 0;
-		cv::imshow("image", color_image);
-		cv::waitKey(10);
-//		if(!EVALUATION_ONLINE_MODE)
-//			cv::waitKey(10);
-//		if(EVALUATION_ONLINE_MODE)
+		if (display_image_ == true)
+		{
+			cv::imshow("image", color_image);
 			key = cv::waitKey(10);
+		}
 
 		//record scene
 		//----------------------------------------
@@ -326,256 +339,190 @@ public:
 
 		//----------------------------------------
 
-		Timer tim;
-
-		//std::cout << key <<endl;
 		//record if "e" is pressed while "image"-window is activated
 		if(COMPUTATION_MODE || (EVALUATION_ONLINE_MODE && key == 1048677))
 		{
-			pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
-			pcl::PointCloud<pcl::Normal>::Ptr normalsWithoutEdges(new pcl::PointCloud<pcl::Normal>);
-			pcl::PointCloud<PointLabel>::Ptr labels(new pcl::PointCloud<PointLabel>);
-			pcl::PointCloud<PointLabel>::Ptr labelsWithoutEdges(new pcl::PointCloud<PointLabel>);
-			ST::Graph::Ptr graph(new ST::Graph);
-			ST::Graph::Ptr graphWithoutEdges(new ST::Graph);
-
-/*
-			if (key=='n')
+			PipelineItem item;
+			item.frame = boost::shared_ptr<SurfaceClassificationFrame>(new SurfaceClassificationFrame(cloud, color_image));
+			item.pointcloud_msg = pointcloud_msg;
+			item.color_image_ptr = color_image_ptr;
+
+			if (pipelining_ == true)
 			{
-				tim.start();
-				oneWithoutEdges_.setInputCloud(cloud);
-				oneWithoutEdges_.setPixelSearchRadius(8,2,2);	//(8,1,1)   (8,2,2)
-				oneWithoutEdges_.setOutputLabels(labelsWithoutEdges);
-				oneWithoutEdges_.setSkipDistantPointThreshold(8);	//PUnkte mit einem Abstand in der Tiefe von 8 werden nicht mehr zur Nachbarschaft gezählt
-				oneWithoutEdges_.compute(*normalsWithoutEdges);
-				//std::cout << "Normal computation without edges: " << tim.getElapsedTimeInMilliSec() << "\n";
-				runtime_normal_original_ += tim.getElapsedTimeInMilliSec();
-				//return;
+				if (queues_[0]->push(item) == false)
+					ROS_DEBUG("SurfaceClassificationNode: dropped the oldest frame before the edge detection.");
 			}
-//*/
-			cv::Mat edge; // = cv::Mat::ones(z_image.rows,z_image.cols,CV_32FC1);
-//			for (int v=0; v<edge.rows; ++v)
-//				for (int u=0; u<edge.cols; ++u)
-//					edgeImage.at<float>(v,u) = 255-edge.at<uchar>(v,u);
-			edge_detection_.computeDepthEdges(cloud, edge);
-			// hack:
-			edge = cv::Mat::zeros(cloud->height,cloud->width,CV_8UC1);	// hack:
-
-			//edge_detection_.sobelLaplace(color_image,depth_image);
-
-//			cv::imshow("edge", edge);
-//			cv::waitKey(10);
-
-			//Timer timer;
-			//timer.start();
-			//for(int i=0; i<10; i++)
-			//{
-
-//			if (key=='n')
-//			{
-				tim.start();
-				one_.setInputCloud(cloud);
-				one_.setPixelSearchRadius(4,2,2);	//call before calling computeMaskManually()!!!
-				//one_.computeMaskManually_increasing(cloud->width);
-				one_.computeMaskManually(cloud->width);
-				one_.computePointAngleLookupTable(16);
-				one_.setEdgeImage(edge);
-				one_.setOutputLabels(labels);
-				//one_.setSameDirectionThres(0.94);
-				one_.setSkipDistantPointThreshold(8);	//don't consider points in neighbourhood with depth distance larger than 8
-				one_.compute(*normals);
-				//std::cout << "Normal computation obeying edges: " << tim.getElapsedTimeInMilliSec() << "\n";
-				runtime_normal_edge_ += tim.getElapsedTimeInMilliSec();
-				++number_processed_images_;
-				std::cout << "runtime_normal_original: " << runtime_normal_original_/(double)number_processed_images_ <<
-							"\nruntime_normal_edge: " << runtime_normal_edge_/(double)number_processed_images_ << std::endl;
-//			}
-			//}timer.stop();
-			//std::cout << timer.getElapsedTimeInMilliSec() << " ms for normalEstimation on the whole image, averaged over 10 iterations\n";
-
-
-
-			if(NORMAL_VIS || key=='n')
+			else
 			{
-				// visualize normals
-				pcl::visualization::PCLVisualizer viewerNormals("Cloud and Normals");
-				viewerNormals.setBackgroundColor (0.0, 0.0, 0);
-				pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbNormals(cloud);
-
-				viewerNormals.addPointCloud<pcl::PointXYZRGB> (cloud, rgbNormals, "cloud");
-				viewerNormals.addPointCloudNormals<pcl::PointXYZRGB,pcl::Normal>(cloud, normals,2,0.005,"normals");
-				//viewerNormals.addPointCloudNormals<pcl::PointXYZRGB,pcl::Normal>(cloud, normalsWithoutEdges,2,0.005,"normalsWithoutEdges");
-				viewerNormals.setPointCloudRenderingProperties (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 3, "cloud");
-
-				while (!viewerNormals.wasStopped ())
-				{
-					viewerNormals.spinOnce();
-				}
-				viewerNormals.removePointCloud("cloud");
+				for (int stage=0; stage<SurfaceClassificationStages::NUMBER_STAGES; ++stage)
+					stages_.process(stage, *item.frame);
+				finishFrame(item);
 			}
+		}
+//		if(EVALUATION_OFFLINE_MODE)
+//		{
+//			TODO
+//			std::string gt_filename = ...; //path to ground truth cloud
+//			eval_.compareClassification(gt_filename);
+//		}
 
-			//return;
 
-			if(SEG || EVALUATION_ONLINE_MODE || key=='n')
-			{
-				tim.start();
-				seg_.setInputCloud(cloud);
-				seg_.setNormalCloudIn(normals);
-				seg_.setLabelCloudInOut(labels);
-				seg_.setClusterGraphOut(graph);
-				seg_.performInitialSegmentation();
-				seg_.refineSegmentation();
-				double runtime_segmentation = tim.getElapsedTimeInMilliSec();
-				std::cout << "runtime_segmentation: " << runtime_segmentation << std::endl;
-			}
-			if(SEG_WITHOUT_EDGES)
-			{
-				segWithoutEdges_.setInputCloud(cloud);
-				segWithoutEdges_.setNormalCloudIn(normalsWithoutEdges);
-				segWithoutEdges_.setLabelCloudInOut(labelsWithoutEdges);
-				segWithoutEdges_.setClusterGraphOut(graphWithoutEdges);
-				segWithoutEdges_.performInitialSegmentation();
-			}
+	}//inputCallback()
 
-			if(SEG_VIS || key=='n')
-			{
-				pcl::PointCloud<pcl::PointXYZRGB>::Ptr segmented(new pcl::PointCloud<pcl::PointXYZRGB>);
-				*segmented = *cloud;
-				graph->clusters()->mapClusterColor(segmented);
-
-				// visualize segmentation
-				pcl::visualization::PCLVisualizer viewer("segmentation");
-				viewer.setBackgroundColor (0.0, 0.0, 0);
-				pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgb(segmented);
-				viewer.addPointCloud<pcl::PointXYZRGB> (segmented,rgb,"seg");
-				//viewer.setCameraPosition()
-				while (!viewer.wasStopped ())
-				{
-					viewer.spinOnce();
-				}
-				viewer.removePointCloud("seg");
-			}
-			if(SEG_WITHOUT_EDGES_VIS)
+
+private:
+
+	// pipeline threads, each one owns the objects of its stages
+	void edgeThread()
+	{
+		PipelineItem item;
+		while (queues_[0]->pop(item) == true)
+		{
+			stages_.process(SurfaceClassificationStages::EDGE_DETECTION, *item.frame);
+			if (queues_[1]->push(item) == false)
+				ROS_DEBUG("SurfaceClassificationNode: dropped the oldest frame before the normal estimation.");
+		}
+	}
+
+	void normalThread()
+	{
+		PipelineItem item;
+		while (queues_[1]->pop(item) == true)
+		{
+			stages_.process(SurfaceClassificationStages::NORMAL_ESTIMATION, *item.frame);
+			if (queues_[2]->push(item) == false)
+				ROS_DEBUG("SurfaceClassificationNode: dropped the oldest frame before the segmentation.");
+		}
+	}
+
+	void segmentationThread()
+	{
+		PipelineItem item;
+		while (queues_[2]->pop(item) == true)
+		{
+			stages_.process(SurfaceClassificationStages::SEGMENTATION, *item.frame);
+			stages_.process(SurfaceClassificationStages::REFINEMENT, *item.frame);
+			stages_.process(SurfaceClassificationStages::CLASSIFICATION, *item.frame);
+			finishFrame(item);
+		}
+	}
+
+	// visualization, evaluation and publishing of a processed frame
+	void finishFrame(PipelineItem& item)
+	{
+		SurfaceClassificationFrame& frame = *item.frame;
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr& cloud = frame.cloud;
+		ST::Graph::Ptr& graph = frame.graph;
+
+		if(NORMAL_VIS)
+		{
+			// visualize normals
+			pcl::visualization::PCLVisualizer viewerNormals("Cloud and Normals");
+			viewerNormals.setBackgroundColor (0.0, 0.0, 0);
+			pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbNormals(cloud);
+
+			viewerNormals.addPointCloud<pcl::PointXYZRGB> (cloud, rgbNormals, "cloud");
+			viewerNormals.addPointCloudNormals<pcl::PointXYZRGB,pcl::Normal>(cloud, frame.normals,2,0.005,"normals");
+			viewerNormals.setPointCloudRenderingProperties (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 3, "cloud");
+
+			while (!viewerNormals.wasStopped ())
 			{
-				pcl::PointCloud<pcl::PointXYZRGB>::Ptr segmentedWithoutEdges(new pcl::PointCloud<pcl::PointXYZRGB>);
-				pcl::copyPointCloud<pcl::PointXYZRGB,pcl::PointXYZRGB>(*cloud, *segmentedWithoutEdges);
-				graphWithoutEdges->clusters()->mapClusterColor(segmentedWithoutEdges);
-
-				pcl::visualization::PCLVisualizer viewerWithoutEdges("segmentationWithoutEdges");
-
-				viewerWithoutEdges.setBackgroundColor (0.0, 0.0, 0);
-				pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbWithoutEdges(segmentedWithoutEdges);
-				viewerWithoutEdges.addPointCloud<pcl::PointXYZRGB> (segmentedWithoutEdges,rgbWithoutEdges,"segWithoutEdges");
-				while (!viewerWithoutEdges.wasStopped ())
-				{
-					viewerWithoutEdges.spinOnce();
-				}
+				viewerNormals.spinOnce();
 			}
+			viewerNormals.removePointCloud("cloud");
+		}
 
-			if(SEG_REFINE)
+		if(SEG_VIS)
+		{
+			pcl::PointCloud<pcl::PointXYZRGB>::Ptr segmented(new pcl::PointCloud<pcl::PointXYZRGB>);
+			*segmented = *cloud;
+			graph->clusters()->mapClusterColor(segmented);
+
+			// visualize segmentation
+			pcl::visualization::PCLVisualizer viewer("segmentation");
+			viewer.setBackgroundColor (0.0, 0.0, 0);
+			pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgb(segmented);
+			viewer.addPointCloud<pcl::PointXYZRGB> (segmented,rgb,"seg");
+			//viewer.setCameraPosition()
+			while (!viewer.wasStopped ())
 			{
-				//merge segments with similar curvature characteristics
-				segRefined_.setInputCloud(cloud);
-				segRefined_.setClusterGraphInOut(graph);
-				segRefined_.setLabelCloudInOut(labels);
-				segRefined_.setNormalCloudIn(normals);
-				//segRefined_.setCurvThres()
-				segRefined_.refineUsingCurvature();
-				//segRefined_.printCurvature(color_image);
-
-				pcl::PointCloud<pcl::PointXYZRGB>::Ptr segmentedRef(new pcl::PointCloud<pcl::PointXYZRGB>);
-				*segmentedRef = *cloud;
-				graph->clusters()->mapClusterColor(segmentedRef);
-
-				// visualize refined segmentation
-				pcl::visualization::PCLVisualizer viewerRef("segmentationRef");
-				viewerRef.setBackgroundColor (0.0, 0.0, 0);
-				pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbRef(segmentedRef);
-				viewerRef.addPointCloud<pcl::PointXYZRGB> (segmentedRef,rgbRef,"segRef");
-
-				while (!viewerRef.wasStopped ())
-				{
-					viewerRef.spinOnce();
-				}
-				viewerRef.removePointCloud("segRef");
+				viewer.spinOnce();
 			}
+			viewer.removePointCloud("seg");
+		}
 
-			if (PUBLISH_SEGMENTATION)
+		if(SEG_REFINE)
+		{
+			//merge segments with similar curvature characteristics
+			segRefined_.setInputCloud(cloud);
+			segRefined_.setClusterGraphInOut(graph);
+			segRefined_.setLabelCloudInOut(frame.labels);
+			segRefined_.setNormalCloudIn(frame.normals);
+			//segRefined_.setCurvThres()
+			segRefined_.refineUsingCurvature();
+			//segRefined_.printCurvature(color_image);
+
+			pcl::PointCloud<pcl::PointXYZRGB>::Ptr segmentedRef(new pcl::PointCloud<pcl::PointXYZRGB>);
+			*segmentedRef = *cloud;
+			graph->clusters()->mapClusterColor(segmentedRef);
+
+			// visualize refined segmentation
+			pcl::visualization::PCLVisualizer viewerRef("segmentationRef");
+			viewerRef.setBackgroundColor (0.0, 0.0, 0);
+			pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbRef(segmentedRef);
+			viewerRef.addPointCloud<pcl::PointXYZRGB> (segmentedRef,rgbRef,"segRef");
+
+			while (!viewerRef.wasStopped ())
 			{
-				cob_surface_classification::SegmentedPointCloud2 msg;
-				if(!loadpointcloud)
-				{
-					msg.pointcloud = *pointcloud_msg;
-				}else
-				{
-					msg.pointcloud = cloud_blob;
-				}
-				for (ST::Graph::ClusterPtr c = graph->clusters()->begin(); c != graph->clusters()->end(); ++c)
-				{
-					cob_surface_classification::Int32Array point_indices;
-					point_indices.array.resize(c->size());
-					int i=0;
-					for (ST::Graph::ClusterType::iterator it = c->begin(); it != c->end(); ++it, ++i)
-						point_indices.array[i] = *it;
-					msg.clusters.push_back(point_indices);
-				}
-				segmented_pointcloud_pub_.publish(msg);
+				viewerRef.spinOnce();
 			}
+			viewerRef.removePointCloud("segRef");
+		}
 
-			return;
+		if(CLASS_VIS)
+		{
 
-			if(CLASSIFY|| EVALUATION_ONLINE_MODE)
-			{
-				//classification
-
-				cc_.setClusterHandler(graph->clusters());
-				cc_.setNormalCloudInOut(normals);
-				cc_.setLabelCloudIn(labels);
-				cc_.setPointCloudIn(cloud);
-				//cc_.setMaskSizeSmooth(14);
-				cc_.classify();
-			}
-			if(CLASS_VIS)
-			{
+			pcl::PointCloud<pcl::PointXYZRGB>::Ptr classified(new pcl::PointCloud<pcl::PointXYZRGB>);
+			*classified = *cloud;
+			graph->clusters()->mapTypeColor(classified);
+			graph->clusters()->mapClusterBorders(classified);
 
-				pcl::PointCloud<pcl::PointXYZRGB>::Ptr classified(new pcl::PointCloud<pcl::PointXYZRGB>);
-				*classified = *cloud;
-				graph->clusters()->mapTypeColor(classified);
-				graph->clusters()->mapClusterBorders(classified);
-
-				// visualize classification
-				pcl::visualization::PCLVisualizer viewerClass("classification");
-				viewerClass.setBackgroundColor (0.0, 0.0, 0);
-				pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbClass(classified);
-				viewerClass.addPointCloud<pcl::PointXYZRGB> (classified,rgbClass,"class");
-
-				while (!viewerClass.wasStopped ())
-				{
-					viewerClass.spinOnce();
-				}
-				viewerClass.removePointCloud("class");
-			}
+			// visualize classification
+			pcl::visualization::PCLVisualizer viewerClass("classification");
+			viewerClass.setBackgroundColor (0.0, 0.0, 0);
+			pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbClass(classified);
+			viewerClass.addPointCloud<pcl::PointXYZRGB> (classified,rgbClass,"class");
 
-			if(EVALUATION_ONLINE_MODE)
+			while (!viewerClass.wasStopped ())
 			{
-				eval_.setClusterHandler(graph->clusters());
-				eval_.compareClassification(cloud,color_image);
+				viewerClass.spinOnce();
 			}
-
-
+			viewerClass.removePointCloud("class");
 		}
-//		if(EVALUATION_OFFLINE_MODE)
-//		{
-//			TODO
-//			std::string gt_filename = ...; //path to ground truth cloud
-//			eval_.compareClassification(gt_filename);
-//		}
 
+		if(EVALUATION_ONLINE_MODE)
+		{
+			eval_.setClusterHandler(graph->clusters());
+			eval_.compareClassification(cloud,frame.color_image);
+		}
 
-	}//inputCallback()
-
+		if (publish_segmentation_ == true && stages_.isStageEnabled(SurfaceClassificationStages::SEGMENTATION) == true)
+		{
+			cob_surface_classification::SegmentedPointCloud2 msg;
+			msg.pointcloud = *item.pointcloud_msg;
+			for (ST::Graph::ClusterPtr c = graph->clusters()->begin(); c != graph->clusters()->end(); ++c)
+			{
+				cob_surface_classification::Int32Array point_indices;
+				point_indices.array.resize(c->size());
+				int i=0;
+				for (ST::Graph::ClusterType::iterator it = c->begin(); it != c->end(); ++it, ++i)
+					point_indices.array[i] = *it;
+				msg.clusters.push_back(point_indices);
+			}
+			segmented_pointcloud_pub_.publish(msg);
+		}
+	}
 
-private:
 	ros::NodeHandle node_handle_;
 
 	// messages
@@ -585,38 +532,27 @@ private:
 	message_filters::Synchronizer<message_filters::sync_policies::ApproximateTime<sensor_msgs::Image, sensor_msgs::PointCloud2> >* sync_input_;
 	ros::Publisher segmented_pointcloud_pub_;	// publisher for the segmented point cloud
 
+	// parameters
+	bool publish_segmentation_;	// publishes the segmented point cloud
+	bool display_image_;	// displays the color image of each frame
+	bool pipelining_;	// if true, the stages run on separate threads connected by queues, if false, each frame is processed completely in the callback
+
+	// processing
+	SurfaceClassificationStages stages_;
+	std::vector<boost::shared_ptr<PipelineQueue> > queues_;	// inputs of the edge detection, normal estimation and segmentation threads
+	boost::thread_group pipeline_threads_;
+
 	//records
 	Scene_recording rec_;
 
-	cob_3d_features::OrganizedNormalEstimationEdgeOMP<pcl::PointXYZRGB, pcl::Normal, PointLabel> one_;
-	cob_3d_features::OrganizedNormalEstimationOMP<pcl::PointXYZRGB, pcl::Normal, PointLabel> oneWithoutEdges_;
-
-	EdgeDetection<pcl::PointXYZRGB> edge_detection_;
-	cob_3d_segmentation::DepthSegmentation<ST::Graph, ST::Point, ST::Normal, ST::Label> seg_;
 	cob_3d_segmentation::RefineSegmentation<ST::Graph, ST::Point, ST::Normal, ST::Label> segRefined_;
 
-	cob_3d_segmentation::DepthSegmentation<ST::Graph, ST::Point, ST::Normal, ST::Label> segWithoutEdges_;
-
-	cob_3d_segmentation::ClusterClassifier<ST::CH, ST::Point, ST::Normal, ST::Label> cc_;
-
 	//evaluation
 	Evaluation eval_;
-
-	double runtime_total_;
-	double runtime_depth_image_;
-	double runtime_sobel_;	// image derivatives
-	double runtime_edge_;
-	double runtime_visibility_;
-	double runtime_normal_original_;
-	double runtime_normal_edge_;
-	int number_processed_images_;
-
-
 };
 
 int main (int argc, char** argv)
 {
-	global_imagecount=0;
 	// Initialize ROS, specify name of node
 	ros::init(argc, argv, "cob_surface_classification");
 
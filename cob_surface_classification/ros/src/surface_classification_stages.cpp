@@ -0,0 +1,195 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2013 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: Care-O-bot
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_surface_classification
+ *
+ * \author
+ * Author: Richard Bormann (stage code of surface_classification_node.cpp)
+ * \author
+ * Supervised by:
+ *
+ * \date Date of creation: 22.04.2013
+ *
+ * \brief
+ * processing stages of the surface classification (edge detection, normal estimation, segmentation, classification)
+ * moved out of surface_classification_node.cpp so that the node and surface_classification_benchmark run the same code
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include "cob_surface_classification/surface_classification_stages.h"
+
+#include <sstream>
+#include <algorithm>
+
+#include <boost/thread.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+SurfaceClassificationFrame::SurfaceClassificationFrame(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud, const cv::Mat& input_color_image)
+: cloud(input_cloud), color_image(input_color_image),
+  normals(new pcl::PointCloud<pcl::Normal>), labels(new pcl::PointCloud<PointLabel>), graph(new ST::Graph)
+{
+}
+
+
+SurfaceClassificationStages::SurfaceClassificationStages()
+: enabled_stages_(NUMBER_STAGES, false), normal_estimation_threads_(0)
+{
+	// the stages of the default configuration of the node, edge detection is optional there
+	enabled_stages_[NORMAL_ESTIMATION] = true;
+	enabled_stages_[SEGMENTATION] = true;
+	enabled_stages_[REFINEMENT] = true;
+}
+
+std::string SurfaceClassificationStages::stageName(int stage)
+{
+	switch (stage)
+	{
+	case EDGE_DETECTION: return "edge_detection";
+	case NORMAL_ESTIMATION: return "normal_estimation";
+	case SEGMENTATION: return "segmentation";
+	case REFINEMENT: return "refinement";
+	case CLASSIFICATION: return "classification";
+	}
+	return "unknown";
+}
+
+int SurfaceClassificationStages::pipelinedNormalEstimationThreads()
+{
+	return std::max(1, (int)boost::thread::hardware_concurrency() - 2);
+}
+
+bool SurfaceClassificationStages::setEnabledStages(const std::string& stage_list)
+{
+	std::vector<bool> enabled_stages(NUMBER_STAGES, false);
+	std::stringstream list(stage_list);
+	std::string name;
+	while (std::getline(list, name, ','))
+	{
+		if (name.empty())
+			continue;
+		int stage = 0;
+		while (stage < NUMBER_STAGES && stageName(stage) != name)
+			++stage;
+		if (stage == NUMBER_STAGES)
+		{
+			std::cout << "SurfaceClassificationStages::setEnabledStages: Error: unknown stage " << name << "." << std::endl;
+			return false;
+		}
+		enabled_stages[stage] = true;
+	}
+	enabled_stages_ = enabled_stages;
+	return true;
+}
+
+void SurfaceClassificationStages::process(int stage, SurfaceClassificationFrame& frame)
+{
+	if (enabled_stages_[stage] == false)
+	{
+		// the normal estimation reads the edge image in any case
+		if (stage == EDGE_DETECTION)
+			frame.edge = cv::Mat::zeros(frame.cloud->height, frame.cloud->width, CV_8UC1);
+		return;
+	}
+
+	switch (stage)
+	{
+	case EDGE_DETECTION: computeEdges(frame); break;
+	case NORMAL_ESTIMATION: computeNormals(frame); break;
+	case SEGMENTATION: segment(frame); break;
+	case REFINEMENT: refineSegmentation(frame); break;
+	case CLASSIFICATION: classify(frame); break;
+	}
+}
+
+void SurfaceClassificationStages::computeEdges(SurfaceClassificationFrame& frame)
+{
+	edge_detection_.computeDepthEdges(frame.cloud, frame.edge);
+}
+
+void SurfaceClassificationStages::computeNormals(SurfaceClassificationFrame& frame)
+{
+#ifdef _OPENMP
+	if (normal_estimation_threads_ > 0)
+		omp_set_num_threads(normal_estimation_threads_);
+#endif
+	one_.setInputCloud(frame.cloud);
+	one_.setPixelSearchRadius(4,2,2);	//call before calling computeMaskManually()!!!
+	one_.computeMaskManually(frame.cloud->width);
+	one_.computePointAngleLookupTable(16);
+	one_.setEdgeImage(frame.edge);
+	one_.setOutputLabels(frame.labels);
+	one_.setSkipDistantPointThreshold(8);	//don't consider points in neighbourhood with depth distance larger than 8
+	one_.compute(*frame.normals);
+}
+
+void SurfaceClassificationStages::segment(SurfaceClassificationFrame& frame)
+{
+	seg_.setInputCloud(frame.cloud);
+	seg_.setNormalCloudIn(frame.normals);
+	seg_.setLabelCloudInOut(frame.labels);
+	seg_.setClusterGraphOut(frame.graph);
+	seg_.performInitialSegmentation();
+}
+
+void SurfaceClassificationStages::refineSegmentation(SurfaceClassificationFrame& frame)
+{
+	// the refinement continues the segmentation of this frame
+	if (enabled_stages_[SEGMENTATION] == false)
+		return;
+	seg_.refineSegmentation();
+}
+
+void SurfaceClassificationStages::classify(SurfaceClassificationFrame& frame)
+{
+	cc_.setClusterHandler(frame.graph->clusters());
+	cc_.setNormalCloudInOut(frame.normals);
+	cc_.setLabelCloudIn(frame.labels);
+	cc_.setPointCloudIn(frame.cloud);
+	cc_.classify();
+}